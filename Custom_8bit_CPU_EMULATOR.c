@@ -4,8 +4,20 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
-
-bool DEBUG = false;
+#include "ec72_cpu.h"
+#include "ec72_out.h"
+#include "ec72_trace.h"
+#include "ec72_prof.h"
+#include "ec72_snap.h"
+#include "ec72_asm.h"
+#include "ec72_image.h"
+#include "ec72_verify.h"
+#include "ec72_bus.h"
+#include "ec72_cycles.h"
+#include "ec72_gdb.h"
+#include "ec72_journal.h"
+#include "ec72_smp.h"
+#include "ec72_xmem.h"
 
 // ANSI escape codes for colors
     #define RED     "\x1b[31m"
@@ -16,241 +28,412 @@ bool DEBUG = false;
     #define CYAN    "\x1b[36m"
     #define RESET   "\x1b[0m"
 
-// Memory: 256 addresses, each 16-bit (instruction)
-#define MEM_SIZE 256
-uint16_t memory[MEM_SIZE];
-
-// Registers
-uint8_t RA = 0, RB = 0, RC = 0, RE = 0;
-uint16_t IR  = 0; // Instruction Register
-uint8_t PC   = 0; // Program Counter
-uint16_t MAR = 0; // Memory Address Register
-uint8_t STOFR = 0;// STack OverFlow Register
-uint8_t STUFR = (MEM_SIZE -1);// STack UnderFlow Register
-uint8_t SP;
-
-
-// Flags
-bool ZF = false; // Zero Flag
-bool NF = false; // Negative Flag
-bool OF = false; // Overflow Flag
-
-// Control Signals
-bool sub_enable = false;
-
-// Bus (for simulation purposes only)
-uint8_t bus = 0;
-
-// Opcodes
-enum OPCODE {
-    MOVR = 0x01,
-    MOVA, MOVB, MOVC, MOVE,
-    STORA, STORB, STORC, STORE,
-    LDIMA, LDIMB, LDIMC, LDIME,
-    JMPN, JMPZ, JMPO, JMP,
-    ADD, SUB, ADDR, SUBR,
-    OUT, CALL, RET, MOVA_PTRB,
-    STORA_PTRB, PUSH, POP, 
-    ADDSP, SUBSP, SSTOF, SSTUF, HLT = 0xFF
-};
+// path "-" is stdout
+static bool write_profile(const char *path, const ec72_prof_t *prof, const ec72_cpu_t *cpu,
+                          const ec72_symtab_t *syms, bool folded) {
+    FILE *f = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!f) {
+        perror("Error opening profile output");
+        return false;
+    }
+    if (folded) ec72_prof_write_folded(prof, syms, f);
+    else ec72_prof_report(prof, cpu, syms, f);
+    if (f != stdout) fclose(f);
+    return true;
+}
 
-// Helpers
-void update_flags(int result) {
-    ZF = (result == 0);
-    NF = (result < 0);
-    OF = (result > 255 || result < 0);
+// Assembled in memory, no .bin in between; the labels become the symbols
+static bool load_source(ec72_cpu_t *cpu, const char *path, ec72_symtab_t *syms) {
+    ec72_asm_result_t r;
+    bool ok = ec72_asm_assemble_file(path, 0, &r);
+    if (ok) {
+        ec72_cpu_load_words(cpu, r.words, r.word_count);
+        for (size_t i = 0; i < r.label_count; i++) ec72_symtab_add(syms, r.labels[i].name, (uint8_t)r.labels[i].address);
+        ec72_symtab_sort(syms);
+        if (cpu->debug) printf("%sAssembled %zu instructions into memory%s\n", CYAN, r.word_count, RESET);
+    } else if (r.diag_count && r.diags[0].error == EC72_ASM_IO) {
+        perror("Error opening file");
+    } else {
+        ec72_asm_print_diags(&r, stderr);
+    }
+    ec72_asm_result_free(&r);
+    return ok;
 }
 
-void alu_add(uint8_t value) {
-    int result = RA + value;
-    update_flags(result);
-    RA = (uint8_t)(result & 0xFF);
+static bool has_suffix(const char *s, const char *suffix) {
+    size_t ls = strlen(s), lx = strlen(suffix);
+    return ls >= lx && strcmp(s + ls - lx, suffix) == 0;
 }
 
-void alu_sub(uint8_t value) {
-    int result = RA - value;
-    update_flags(result);
-    RA = (uint8_t)(result & 0xFF);
+// false if the socket cannot be opened
+static bool serve_debugger(ec72_cpu_t *cpu, const char *where, bool *killed) {
+    ec72_gdb_t gdb;
+    if (!ec72_gdb_listen(&gdb, where)) return false;
+    fprintf(stderr, "Waiting for a debugger on %s\n", where);
+    *killed = ec72_gdb_serve(&gdb, cpu) == EC72_GDB_KILLED;
+    ec72_gdb_close(&gdb);
+    if (*killed) fprintf(stderr, "%sKilled by the debugger%s\n", RED, RESET);
+    return true;
 }
 
-uint8_t* get_register(uint8_t code) {
-    switch(code) {
-        case 0x01: return &RA;
-        case 0x02: return &RB;
-        case 0x03: return &RC;
-        case 0x04: return &RE;
-        case 0x05: return &SP;
-        default: return NULL;
-    }
+// Every core prints into the one output, in core order per quantum
+static void smp_out(void *user, int core, uint8_t value) {
+    (void)core;
+    ec72_out_put(user, value);
 }
 
-void load_program(const char* filename) {
-    FILE* file = fopen(filename, "rb");
-    if (!file) {
-        perror("Error opening file");
-        exit(1);
+// The loaded program on cores cores; the status banner of each core that
+// stopped, prefixed with its number
+static ec72_status_t run_smp(const ec72_cpu_t *cpu, ec72_out_t *out, bool color, int cores, int threads,
+                             uint32_t quantum, int stack_words, uint64_t max_instructions) {
+    ec72_smp_t *m = ec72_smp_create(cores, threads);
+    if (!m || !ec72_smp_set_quantum(m, quantum)) {
+        fprintf(stderr, "%sCannot set up %d cores (at most %d)%s\n", RED, cores, EC72_SMP_MAX_CORES, RESET);
+        ec72_smp_destroy(m);
+        return EC72_ERR_IO;
     }
-    size_t loaded = fread(memory, sizeof(uint16_t), MEM_SIZE, file);
-    fclose(file);
+    ec72_smp_set_engine(m, cpu->engine);
+    ec72_smp_load(m, cpu);
+    if (stack_words && (stack_words > 255 || !ec72_smp_split_stack(m, (uint8_t)stack_words))) {
+        fprintf(stderr, "%s%d stacks of %d words do not fit below STUFR=%d%s\n", RED, cores, stack_words,
+                cpu->image_stufr, RESET);
+        ec72_smp_destroy(m);
+        return EC72_ERR_IO;
+    }
+    ec72_smp_set_output(m, smp_out, out);
+    ec72_smp_run(m, max_instructions);
+    ec72_out_flush(out);
 
-    if (DEBUG) {
-        printf("%sLoaded %zu instructions into memory%s\n", CYAN, loaded, RESET);
+    for (int i = 0; i < cores; i++) {
+        const ec72_cpu_t *core = ec72_smp_core(m, i);
+        if (core->status == EC72_OK) continue;
+        if (color) {
+            printf("%sCore %d: ", CYAN, i);
+            ec72_cpu_print_status(core, stdout);
+        } else if (core->status != EC72_HALTED) {
+            fprintf(stderr, "Core %d: ", i);
+            ec72_cpu_print_status_plain(core, stderr);
+        }
     }
+    ec72_status_t status = ec72_smp_status(m);
+    ec72_smp_destroy(m);
+    return status;
 }
 
-void execute_instruction() {
-    IR = memory[PC++];
-    uint8_t opcode = (IR >> 8) & 0xFF;
-    uint8_t operand = IR & 0xFF;
-
-    if (DEBUG){
-        printf("%sPC=%02X IR=%04X STOFR=%d STUFR=%d %sOPCODE=%02X OPERAND=%02X %sRA=%d RB=%d RC=%d RE=%d %sZF=%d NF=%d OF=%d %sSP= %d%s\n",
-           MAGENTA, PC-1, IR, STOFR, STUFR, GREEN, opcode, operand, CYAN, RA, RB, RC, RE, YELLOW, ZF, NF, OF, BLUE, SP, RESET);
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <program.bin|program.ec72img|program.ec72asm|checkpoint> [-d] [-e switch|threaded|jit|lazy] [-m color|dec|raw] [-o file|\"|command\"]\n"
+                        "       [-t trace_file [-tring records] [-tpc lo-hi] [-top opcode,...]]\n"
+                        "       [-p report.txt] [-pf stacks.folded] [-sym symbols.sym]\n"
+                        "       [-n max_instructions] [-cs checkpoint] [-fast]\n"
+                        "       [-io base] [-in file|-] [-port file|\"|command\"] [-tick instructions]\n"
+                        "       [-cycles] [-ct cycle_table] [-noff] [-gdb port|socket_path]\n"
+                        "       [-journal megabytes[,interval]] [-gdbfault port|socket_path]\n"
+                        "       [-smp cores[,threads] [-quantum instructions] [-smpstack words]]\n"
+                        "       [-xmem] [-xfile data.bin] [-xbytes data_file]\n", argv[0]);
+        return 1;
     }
 
-    switch(opcode) {
+    ec72_cpu_t cpu;
+    ec72_cpu_init(&cpu);
+    ec72_out_mode_t out_mode = EC72_OUT_COLOR;
+    const char *out_target = NULL;
+    const char *trace_path = NULL, *trace_pc = NULL, *trace_op = NULL;
+    uint32_t trace_ring = 0;
+    const char *prof_report = NULL, *prof_folded = NULL, *sym_path = NULL;
+    const char *ckpt_path = NULL;
+    uint64_t max_instructions = EC72_RUN_FOREVER;
+    bool fast = false;
+    bool use_bus = false;
+    uint8_t bus_base = EC72_BUS_DEFAULT_BASE;
+    const char *in_path = NULL, *port_target = NULL;
+    uint64_t bus_tick = 1;
+    bool use_cycles = false, fast_forward = true;
+    const char *cycle_table = NULL;
+    const char *gdb_where = NULL, *gdb_fault = NULL;
+    size_t journal_budget = 0;
+    uint32_t journal_interval = 0;
+    int smp_cores = 0, smp_threads = 0, smp_stack = 0;
+    uint32_t quantum = EC72_SMP_DEFAULT_QUANTUM;
+    bool use_xmem = false;
+    const char *xmem_path = NULL;
+    ec72_xmem_layout_t xmem_layout = EC72_XMEM_FILE_WORDS;
 
-        case MOVR: {
-            uint8_t dest = (operand >> 4) & 0x0F;
-            uint8_t src = operand & 0x0F;
-            uint8_t* d = get_register(dest);
-            uint8_t* s = get_register(src);
-            if (d && s) *d = *s;
-            break;
-        }
-        case MOVA: RA = memory[operand] & 0xFF; break;
-        case MOVB: RB = memory[operand] & 0xFF; break;
-        case MOVC: RC = memory[operand] & 0xFF; break;
-        case MOVE: RE = memory[operand] & 0xFF; break;
-        case STORA: memory[operand] = RA; break;
-        case STORB: memory[operand] = RB; break;
-        case STORC: memory[operand] = RC; break;
-        case STORE: memory[operand] = RE; break;
-        case LDIMA: RA = operand; break;
-        case LDIMB: RB = operand; break;
-        case LDIMC: RC = operand; break;
-        case LDIME: RE = operand; break;
-        case JMPN: if (NF) PC = operand; break;
-        case JMPZ: if (ZF) PC = operand; break;
-        case JMPO: if (OF) PC = operand; break;
-        case JMP: PC = operand; break;
-        case ADD: alu_add(operand); break;
-        case SUB: alu_sub(operand); break;
-        case ADDR: {
-            uint8_t *reg = get_register(operand);
-            alu_add(*reg);
-            break;
-        }
-        case SUBR: {
-            uint8_t *reg = get_register(operand);
-            alu_sub(*reg);
-            break;
-        }
-        case CALL: {
-            if ( (SP == STOFR) || (SP == 0) ) {
-                printf("%sStack overflow%s\n" , RED, RESET);
-                exit(1);
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0) {
+            cpu.debug = true;
+            printf("%sDEBUG%s mode enabled\n", MAGENTA, RESET);
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            ec72_engine_t engine;
+            if (!ec72_engine_from_name(argv[++i], &engine)) {
+                fprintf(stderr, "Unknown engine: %s\n", argv[i]);
+                return 1;
+            }
+            ec72_cpu_set_engine(&cpu, engine);
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            if (!ec72_out_mode_from_name(argv[++i], &out_mode)) {
+                fprintf(stderr, "Unknown output mode: %s\n", argv[i]);
+                return 1;
             }
-            uint16_t v = (uint16_t)(PC & (MEM_SIZE-1));        // only store low byte into stack cell
-            memory[--SP] = v;
-            if (DEBUG) printf("  [CALL] push return=0x%02X at mem[%s%u%s]\n", (uint8_t)v, BLUE, SP, RESET);
-            PC = operand;
-            break;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_target = argv[++i];
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "-tring") == 0 && i + 1 < argc) {
+            trace_ring = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-tpc") == 0 && i + 1 < argc) {
+            trace_pc = argv[++i];
+        } else if (strcmp(argv[i], "-top") == 0 && i + 1 < argc) {
+            trace_op = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            prof_report = argv[++i];
+        } else if (strcmp(argv[i], "-pf") == 0 && i + 1 < argc) {
+            prof_folded = argv[++i];
+        } else if (strcmp(argv[i], "-sym") == 0 && i + 1 < argc) {
+            sym_path = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            max_instructions = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-cs") == 0 && i + 1 < argc) {
+            ckpt_path = argv[++i];
+        } else if (strcmp(argv[i], "-fast") == 0) {
+            fast = true;
+        } else if (strcmp(argv[i], "-io") == 0 && i + 1 < argc) {
+            bus_base = (uint8_t)strtoul(argv[++i], NULL, 0);
+            use_bus = true;
+        } else if (strcmp(argv[i], "-in") == 0 && i + 1 < argc) {
+            in_path = argv[++i];
+            use_bus = true;
+        } else if (strcmp(argv[i], "-port") == 0 && i + 1 < argc) {
+            port_target = argv[++i];
+            use_bus = true;
+        } else if (strcmp(argv[i], "-tick") == 0 && i + 1 < argc) {
+            bus_tick = strtoull(argv[++i], NULL, 0);
+            use_bus = true;
+        } else if (strcmp(argv[i], "-cycles") == 0) {
+            use_cycles = true;
+        } else if (strcmp(argv[i], "-ct") == 0 && i + 1 < argc) {
+            cycle_table = argv[++i];
+            use_cycles = true;
+        } else if (strcmp(argv[i], "-noff") == 0) {
+            fast_forward = false;
+        } else if (strcmp(argv[i], "-gdb") == 0 && i + 1 < argc) {
+            gdb_where = argv[++i];
+        } else if (strcmp(argv[i], "-gdbfault") == 0 && i + 1 < argc) {
+            gdb_fault = argv[++i];
+        } else if (strcmp(argv[i], "-journal") == 0 && i + 1 < argc) {
+            char *rest;
+            journal_budget = (size_t)strtoull(argv[++i], &rest, 0) << 20;
+            if (*rest == ',') journal_interval = (uint32_t)strtoul(rest + 1, NULL, 0);
+        } else if (strcmp(argv[i], "-smp") == 0 && i + 1 < argc) {
+            char *rest;
+            smp_cores = (int)strtol(argv[++i], &rest, 0);
+            if (*rest == ',') smp_threads = (int)strtol(rest + 1, NULL, 0);
+        } else if (strcmp(argv[i], "-quantum") == 0 && i + 1 < argc) {
+            quantum = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-smpstack") == 0 && i + 1 < argc) {
+            smp_stack = (int)strtol(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-xmem") == 0) {
+            use_xmem = true;
+        } else if ((strcmp(argv[i], "-xfile") == 0 || strcmp(argv[i], "-xbytes") == 0) && i + 1 < argc) {
+            xmem_layout = argv[i][2] == 'b' ? EC72_XMEM_FILE_BYTES : EC72_XMEM_FILE_WORDS;
+            xmem_path = argv[++i];
+            use_xmem = true;
+        } else {
+            fprintf(stderr, "Unknown flag: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    // The cores of -smp run on the plain engines
+    if (smp_cores && (cpu.debug || trace_path || prof_report || prof_folded || ckpt_path || fast || use_bus ||
+                      use_cycles || gdb_where || gdb_fault || journal_budget || use_xmem)) {
+        fprintf(stderr, "-smp cannot be combined with -d, -t, -p, -pf, -cs, -fast, -io, -cycles, -gdb, -journal or -x*\n");
+        return 1;
+    }
+
+    // Sources are assembled in memory; a checkpoint continues where the run
+    // that saved it stopped. Images bring their own symbols.
+    ec72_image_t image;
+    ec72_image_init(&image);
+    if (has_suffix(argv[1], ".ec72asm")) {
+        if (!load_source(&cpu, argv[1], &image.symbols)) return 1;
+    } else if (ec72_checkpoint_probe(argv[1])) {
+        if (ec72_checkpoint_load(&cpu, argv[1]) != EC72_OK) {
+            perror("Error opening file");
+            return 1;
         }
-        case RET: {
-            if (SP == MEM_SIZE-1) { printf("%sStack underflow%s\n", RED, RESET); exit(1); }
-            uint16_t v = memory[SP++];
-            PC = (uint8_t)(v & (MEM_SIZE-1));
-            if (DEBUG) printf("  [RET] popped return=0x%02X from mem[%s%u%s]\n", (uint8_t)(v & 0xFF), BLUE, SP-1, RESET);
-            break;
+    } else if (ec72_image_load(&image, argv[1])) {
+        ec72_cpu_load_image(&cpu, &image);
+    } else {
+        if (image.error) fprintf(stderr, "%sError loading %s: %s%s\n", RED, argv[1], image.error, RESET);
+        else perror("Error opening file");
+        return 1;
+    }
+
+    // Verified mode drops the stack checks; a program that cannot be proven
+    // safe runs checked, with the reason on stderr
+    if (fast) {
+        static ec72_verify_t v;
+        if (!ec72_cpu_verify(&cpu, &v) || cpu.debug) ec72_verify_print_result(&v, &image.symbols, stderr);
+    }
+
+    ec72_trace_t trace;
+    if (trace_path) {
+        if (!ec72_trace_open(&trace, trace_path, trace_ring)) return 1;
+        if (trace_pc && !ec72_trace_parse_pc_range(&trace, trace_pc)) {
+            fprintf(stderr, "Invalid PC range: %s\n", trace_pc);
+            return 1;
         }
-        case MOVA_PTRB: {
-            RA = (uint8_t)(memory[RB] & (MEM_SIZE-1)); // load low byte of memory[RB];//anding with 0xff
-            break;
+        if (trace_op && !ec72_trace_parse_opcodes(&trace, trace_op)) {
+            fprintf(stderr, "Invalid opcode list: %s\n", trace_op);
+            return 1;
         }
-        case STORA_PTRB: {
-            memory[RB] = RA;
-            break;
+        ec72_cpu_set_trace(&cpu, &trace);
+    }
+
+    ec72_prof_t prof;
+    ec72_symtab_t syms = {0};
+    bool profiling = prof_report || prof_folded;
+    if (profiling) {
+        if (sym_path && !ec72_symtab_load(&syms, sym_path)) return 1;
+        if (!sym_path) {
+            syms = image.symbols;
+            image.symbols = (ec72_symtab_t){0};
         }
-        case PUSH: {
-            uint8_t *reg = get_register(operand);
-            if ( (SP == STOFR) || (SP == 0) ) { 
-                printf("%sStack overflow%s\n", RED, RESET);
-                exit(1);
-            }
-            uint16_t v = (uint16_t)(*reg & (MEM_SIZE-1));
-            memory[--SP] = v;
-            if (DEBUG) printf("  [PUSH] push 0x%02X into mem[%s%u%s]\n", (uint8_t)v, BLUE, SP, RESET);
-            break;
+        if (!ec72_prof_init(&prof, cpu.PC)) {
+            fprintf(stderr, "%sOut of memory for profiler%s\n", RED, RESET);
+            return 1;
         }
-        case POP: {
-            uint8_t *reg = get_register(operand);
-            if ( (SP == STUFR ) || (SP == (MEM_SIZE -1) ) ) {     
-                printf("%sStack underflow%s\n", RED, RESET);
-                exit(1);
-            }
-             uint16_t v = memory[SP++];
-            *reg = (uint8_t)(v & (MEM_SIZE-1));
-            if (DEBUG) printf("  [POP] pop 0x%02X from mem[%s%u%s]\n", (uint8_t)(v & 0xFF), BLUE, SP-1, RESET);
-            break;
+        ec72_cpu_set_prof(&cpu, &prof);
+    }
+
+    // Debug traces interleave with OUT, so they are written through unbuffered;
+    // so is everything while a debugger single-steps the program
+    bool unbuffered = cpu.debug || gdb_where;
+    ec72_out_t out;
+    if (!ec72_out_open(&out, out_mode, out_target, unbuffered ? 0 : EC72_OUT_DEFAULT_BUFFER)) {
+        return 1;
+    }
+    ec72_cpu_attach_output(&cpu, &out);
+
+    if (smp_cores) {
+        ec72_status_t status = run_smp(&cpu, &out, out_mode == EC72_OUT_COLOR, smp_cores, smp_threads,
+                                       quantum, smp_stack, max_instructions);
+        ec72_image_free(&image);
+        bool out_ok = ec72_out_close(&out);
+        ec72_cpu_fini(&cpu);
+        if (!out_ok) {
+            fprintf(stderr, "%sError writing program output%s\n", RED, RESET);
+            return 1;
         }
-        case ADDSP:{
-            if ( (SP == STUFR ) || (SP == (MEM_SIZE -1) ) ) {     
-                printf("%sStack underflow%s\n", RED, RESET);
-                exit(1);
-            }
-            SP += operand;
-            break;
+        return status == EC72_HALTED ? 0 : 1;
+    }
+
+    // I/O bus: input from a file or stdin, the port as raw bytes
+    ec72_bus_t bus;
+    ec72_out_t port;
+    FILE *in = NULL;
+    if (use_bus) {
+        if (!ec72_bus_init(&bus, bus_base)) return 1;
+        in = (!in_path || strcmp(in_path, "-") == 0) ? stdin : fopen(in_path, "rb");
+        if (!in) {
+            perror("Error opening input file");
+            return 1;
         }
-        case SUBSP:{
-            if ( (SP == STOFR) || (SP == 0) ) { 
-                printf("%sStack overflow%s\n", RED, RESET);
-                exit(1);
-            }
-            SP -= operand;
-            break;
+        if (!ec72_out_open(&port, EC72_OUT_RAW, port_target, unbuffered ? 0 : EC72_OUT_DEFAULT_BUFFER)) {
+            return 1;
         }
-        case OUT: printf("%sOUT: %d%s\n", GREEN, RA, RESET); break;
-        case SSTOF:{// Set STack OverFlow
-            if(operand > 255 || operand < 0) {
-                printf("%sIllegal operand for SSTOF(0x%02X): 0x%02X%s\n", RED, opcode, operand, RESET);
-                exit(1);
-            }
-            STOFR = operand;
-            break;
-        };
-        case SSTUF:{// Set STack UnderFlow
-            if(operand > 255 || operand < 0) {
-                printf("%sIllegal operand for SSTUF(0x%02X): 0x%02X%s\n", RED, opcode, operand, RESET);
-                exit(1);
-            }
-            STUFR = operand;
-            SP = operand;
-            break;
-        };
-        case HLT: printf("%sProgramm Halted Execution%s\n", YELLOW, RESET); exit(0);
-        default: printf("%sUnknown opcode: 0x%02X%s\n", RED, opcode, RESET); exit(1);
+        ec72_bus_set_input(&bus, in);
+        ec72_bus_set_port(&bus, ec72_out_put, &port);
+        ec72_bus_set_tick(&bus, bus_tick);
+        ec72_cpu_attach_bus(&cpu, &bus);
     }
-}
 
-int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <program.bin> [-d]\n", argv[0]);
-        return 1;
+    // Extended memory for FLD/FST, over a data file mapped on demand
+    static ec72_xmem_t xmem;
+    if (use_xmem) {
+        ec72_xmem_init(&xmem);
+        if (xmem_path && !ec72_xmem_map_file(&xmem, xmem_path, xmem_layout)) return 1;
+        ec72_cpu_attach_xmem(&cpu, &xmem);
+    }
+
+    // Cycle counting runs on the reference interpreter; idle loops are
+    // fast-forwarded unless -noff
+    static ec72_cycles_t cycles;
+    if (use_cycles) {
+        ec72_cycles_init(&cycles);
+        if (cycle_table && !ec72_cycles_load(&cycles, cycle_table)) return 1;
+        cycles.fast_forward = fast_forward;
+        ec72_cpu_set_cycles(&cpu, &cycles);
+    }
+
+    // Time travel: the last -journal megabytes of execution can be stepped
+    // back through by the debugger
+    static ec72_journal_t journal;
+    if (journal_budget) {
+        if (!ec72_journal_init(&journal, journal_budget, journal_interval)) return 1;
+        ec72_cpu_set_journal(&cpu, &journal);
+    }
+
+    // The debugger drives the program until it detaches; the rest of the run
+    // (and -n) takes the normal engines again. -gdbfault only waits for one
+    // if the run ends in a fault.
+    bool killed = false;
+    if (gdb_where && !serve_debugger(&cpu, gdb_where, &killed)) return 1;
+    ec72_status_t status = killed ? cpu.status : ec72_cpu_run(&cpu, max_instructions);
+    if (gdb_fault && status != EC72_OK && status != EC72_HALTED) {
+        fprintf(stderr, "%s%s at PC=0x%02X%s\n", RED, ec72_status_str(status), (uint8_t)(cpu.PC - 1), RESET);
+        if (serve_debugger(&cpu, gdb_fault, &killed)) status = cpu.status;
     }
+    ec72_out_flush(&out);
+    if (use_bus) ec72_out_flush(&port);
+    if (ckpt_path && !ec72_checkpoint_save(&cpu, ckpt_path)) status = EC72_ERR_IO;
 
-    if (argc >= 3 && strcmp(argv[2], "-d") == 0) {
-        DEBUG = true;
-        printf("%sDEBUG%s mode enabled\n", MAGENTA, RESET);
+    // Only the colored mode mixes the status banner into the program output
+    if (out_mode == EC72_OUT_COLOR) {
+        ec72_cpu_print_status(&cpu, stdout);
+        if (use_cycles) ec72_cycles_print(&cycles, &cpu, stdout);
+    } else {
+        if (status != EC72_HALTED) ec72_cpu_print_status_plain(&cpu, stderr);
+        if (use_cycles) ec72_cycles_print(&cycles, &cpu, stderr);
     }
 
-    SP = STUFR;
+    if (trace_path && !ec72_trace_close(&trace)) {
+        fprintf(stderr, "%sError writing trace file%s\n", RED, RESET);
+    }
 
-    load_program(argv[1]);
+    if (profiling) {
+        if (prof_report && !write_profile(prof_report, &prof, &cpu, &syms, false)) status = EC72_ERR_IO;
+        if (prof_folded && !write_profile(prof_folded, &prof, &cpu, &syms, true)) status = EC72_ERR_IO;
+        ec72_prof_free(&prof);
+        ec72_symtab_free(&syms);
+    }
 
-    while (1) {
-        execute_instruction();
+    ec72_image_free(&image);
+    bool out_ok = ec72_out_close(&out);
+    if (use_bus) {
+        if (!ec72_out_close(&port)) out_ok = false;
+        if (in != stdin) fclose(in);
+        ec72_bus_free(&bus);
+    }
+    if (journal_budget) {
+        ec72_cpu_set_journal(&cpu, NULL);
+        ec72_journal_free(&journal);
+    }
+    if (use_xmem) {
+        if (xmem.lost_stores) {
+            fprintf(stderr, "%sOut of memory: %llu FST stores to extended memory were dropped%s\n", RED,
+                    (unsigned long long)xmem.lost_stores, RESET);
+        }
+        ec72_xmem_free(&xmem);
+    }
+    ec72_cpu_fini(&cpu);
+    if (!out_ok) {
+        fprintf(stderr, "%sError writing program output%s\n", RED, RESET);
+        return 1;
     }
 
-    return 0;
+    // Stopping at -n is a success when the state was asked for
+    if (status == EC72_OK && ckpt_path) return 0;
+    return status == EC72_HALTED ? 0 : 1;
 }
@@ -0,0 +1,100 @@
+//Copyright © Martin H. Sharp; August 2025
+// Assembler speed: generates a large source (labels every few lines, forward
+// and backward references, comments, every operand form) and times the
+// assembler on it.
+//
+//   asm_bench [-n lines] [-a assembler] [-f source.ec72asm]
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define GREEN   "\x1b[32m"
+#define RED     "\x1b[31m"
+#define RESET   "\x1b[0m"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static const char *regs[] = { "RA", "RB", "RC", "RE", "SP" };
+static const char *imm_ops[] = { "LDIMA", "LDIMB", "LDIMC", "ADD", "SUB", "MOVA", "STORB", "SSTOF" };
+static const char *jump_ops[] = { "JMP", "JMPZ", "JMPN", "JMPO", "CALL" };
+
+static unsigned long long rng = 88172645463325252ULL;
+static unsigned next(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return (unsigned)rng;
+}
+
+static void generate(const char *path, long lines) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    long label = 0;
+    fprintf(f, "; generated by asm_bench, %ld lines\n", lines);
+    for (long i = 1; i < lines; i++) {
+        unsigned r = next() % 16;
+        if (r == 0) {
+            fprintf(f, "L%ld:\n", label++);
+        } else if (r == 1) {
+            // Back to a label seen already, or ahead to one not defined yet
+            long target = (next() & 1) && label ? (long)(next() % label) : label + (long)(next() % 8);
+            fprintf(f, "        %s L%ld      ; branch\n", jump_ops[next() % 5], target);
+        } else if (r < 6) {
+            fprintf(f, "        %s 0x%02X\n", imm_ops[next() % 8], next() & 0xFF);
+        } else if (r < 9) {
+            fprintf(f, "        %s %u\n", imm_ops[next() % 8], next() & 0xFF);
+        } else if (r < 11) {
+            fprintf(f, "        MOVR %s, %s\n", regs[next() % 5], regs[next() % 5]);
+        } else if (r < 13) {
+            fprintf(f, "        %s %s\n", next() & 1 ? "PUSH" : "POP", regs[next() % 4]);
+        } else if (r == 13) {
+            fprintf(f, "\n");
+        } else {
+            fprintf(f, "        OUT\n");
+        }
+    }
+    // Every forward reference resolves
+    for (long k = 0; k < 8; k++) fprintf(f, "L%ld:\n", label + k);
+    fclose(f);
+}
+
+int main(int argc, char *argv[]) {
+    long lines = 1000000;
+    const char *assembler = "./EC72ASM";
+    const char *source = "bench/asm_big.ec72asm";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) lines = strtol(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) assembler = argv[++i];
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) source = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [-n lines] [-a assembler] [-f source.ec72asm]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    generate(source, lines);
+
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "%s %s bench/asm_big.bin > bench/asm_big.log 2>&1", assembler, source);
+    double start = now();
+    int rc = system(cmd);
+    double seconds = now() - start;
+
+    if (rc != 0) {
+        printf("%s%s failed on %ld lines (see bench/asm_big.log)%s\n", RED, assembler, lines, RESET);
+        return 1;
+    }
+    printf("%s%s: %ld lines in %.3f s, %.2f M lines/s%s\n", GREEN, assembler, lines, seconds,
+           lines / seconds / 1e6, RESET);
+    return 0;
+}
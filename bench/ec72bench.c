@@ -0,0 +1,217 @@
+//Copyright © Martin H. Sharp; August 2025
+// Emulator speed: runs every program on every engine for a fixed
+// instruction budget (restarting programs that halt or fault) and reports
+// instructions/s, ns/instruction and peak RSS. Each run is a separate child
+// process so peak RSS belongs to that run alone.
+//
+//   ec72bench [-n instructions] [-e engine,...] [-t tag] [-o results.csv] [-c baseline.csv] prog.bin...
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "ec72_cpu.h"
+
+#ifndef _WIN32
+    #include <unistd.h>
+    #include <sys/resource.h>
+    #include <sys/wait.h>
+#endif
+
+#define RED     "\x1b[31m"
+#define GREEN   "\x1b[32m"
+#define CYAN    "\x1b[36m"
+#define RESET   "\x1b[0m"
+
+#define DEFAULT_BUDGET 100000000ULL
+#define CHUNK          10000000ULL
+#define MAX_ENGINES    8
+
+typedef struct {
+    uint64_t instructions;
+    uint64_t restarts;          // program halted or faulted and was reset
+    double seconds;
+    long peak_rss_kb;
+} Result_t;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool run_program(const char *path, ec72_engine_t engine, uint64_t budget, Result_t *r) {
+    ec72_cpu_t cpu;
+    ec72_cpu_init(&cpu);
+    ec72_cpu_set_engine(&cpu, engine);
+    if (ec72_cpu_load_file(&cpu, path) != EC72_OK) {
+        perror(path);
+        return false;
+    }
+
+    memset(r, 0, sizeof(*r));
+    double start = now();
+    while (r->instructions < budget) {
+        uint64_t before = cpu.retired;
+        uint64_t left = budget - r->instructions;
+        ec72_status_t s = ec72_cpu_run(&cpu, left < CHUNK ? left : CHUNK);
+        r->instructions += cpu.retired - before;
+        if (s != EC72_OK) {
+            // A fault retires nothing; count the attempt so a program that
+            // faults immediately still terminates the loop
+            if (cpu.retired == before) r->instructions++;
+            ec72_cpu_reset(&cpu);
+            r->restarts++;
+        }
+    }
+    r->seconds = now() - start;
+    ec72_cpu_fini(&cpu);
+    return true;
+}
+
+// Runs in a child process and collects its peak RSS
+static bool measure(const char *path, ec72_engine_t engine, uint64_t budget, Result_t *r) {
+#ifndef _WIN32
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        close(fds[0]);
+        Result_t child;
+        bool ok = run_program(path, engine, budget, &child);
+        if (ok && write(fds[1], &child, sizeof(child)) != (ssize_t)sizeof(child)) ok = false;
+        _exit(ok ? 0 : 1);
+    }
+    close(fds[1]);
+    bool ok = read(fds[0], r, sizeof(*r)) == (ssize_t)sizeof(*r);
+    close(fds[0]);
+
+    int status;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) ok = false;
+    r->peak_rss_kb = ru.ru_maxrss;
+    return ok;
+#else
+    // No fork: measured in-process, RSS not available
+    if (!run_program(path, engine, budget, r)) return false;
+    r->peak_rss_kb = 0;
+    return true;
+#endif
+}
+
+static const char *base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// ns/instruction of program/engine in a results file written earlier, 0 if absent
+static double baseline_ns(const char *csv, const char *program, const char *engine) {
+    if (!csv) return 0;
+    FILE *f = fopen(csv, "r");
+    if (!f) return 0;
+    char line[512];
+    double ns = 0;
+    while (fgets(line, sizeof(line), f)) {
+        char tag[64], prog[128], eng[32];
+        double v;
+        // tag,program,engine,instructions,seconds,mips,ns_per_instruction,peak_rss_kb
+        if (sscanf(line, "%63[^,],%127[^,],%31[^,],%*[^,],%*[^,],%*[^,],%lf", tag, prog, eng, &v) == 4 &&
+            strcmp(prog, program) == 0 && strcmp(eng, engine) == 0) {
+            ns = v;
+        }
+    }
+    fclose(f);
+    return ns;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t budget = DEFAULT_BUDGET;
+    ec72_engine_t engines[MAX_ENGINES] = { EC72_ENGINE_SWITCH, EC72_ENGINE_THREADED, EC72_ENGINE_JIT, EC72_ENGINE_LAZY };
+    int engine_count = 4;
+    const char *tag = "local", *out_path = NULL, *baseline = NULL;
+    const char *programs[256];
+    int program_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            budget = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            engine_count = 0;
+            char list[256];
+            snprintf(list, sizeof(list), "%s", argv[++i]);
+            for (char *name = strtok(list, ","); name && engine_count < MAX_ENGINES; name = strtok(NULL, ",")) {
+                if (!ec72_engine_from_name(name, &engines[engine_count++])) {
+                    fprintf(stderr, "Unknown engine: %s\n", name);
+                    return 1;
+                }
+            }
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            tag = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Unknown flag: %s\n", argv[i]);
+            return 1;
+        } else if (program_count < 256) {
+            programs[program_count++] = argv[i];
+        }
+    }
+    if (program_count == 0) {
+        fprintf(stderr, "Usage: %s [-n instructions] [-e engine,...] [-t tag] [-o results.csv] [-c baseline.csv] prog.bin...\n", argv[0]);
+        return 1;
+    }
+
+    FILE *out = NULL;
+    if (out_path) {
+        out = fopen(out_path, "w");
+        if (!out) {
+            perror("Error opening results file");
+            return 1;
+        }
+        fprintf(out, "tag,program,engine,instructions,seconds,mips,ns_per_instruction,peak_rss_kb\n");
+    }
+
+    printf("%-16s %-9s %12s %10s %10s %10s", "program", "engine", "instructions", "MIPS", "ns/instr", "RSS kB");
+    if (baseline) printf(" %10s", "vs base");
+    printf("\n");
+
+    int failed = 0;
+    for (int p = 0; p < program_count; p++) {
+        for (int e = 0; e < engine_count; e++) {
+            const char *engine = ec72_engine_name(engines[e]);
+            const char *name = base_name(programs[p]);
+            Result_t r;
+            if (!measure(programs[p], engines[e], budget, &r)) {
+                printf("%s%-16s %-9s failed%s\n", RED, name, engine, RESET);
+                failed++;
+                continue;
+            }
+            double mips = r.instructions / r.seconds / 1e6;
+            double ns = r.seconds * 1e9 / r.instructions;
+            printf("%-16s %-9s %12llu %10.1f %10.3f %10ld", name, engine,
+                   (unsigned long long)r.instructions, mips, ns, r.peak_rss_kb);
+
+            // Speedup against the baseline run: >1 is faster now
+            double base = baseline_ns(baseline, name, engine);
+            if (base > 0) printf(" %s%9.2fx%s", base / ns >= 0.95 ? GREEN : RED, base / ns, RESET);
+            if (r.restarts) printf("  %s(%llu restarts)%s", CYAN, (unsigned long long)r.restarts, RESET);
+            printf("\n");
+
+            if (out) {
+                fprintf(out, "%s,%s,%s,%llu,%.6f,%.3f,%.4f,%ld\n", tag, name, engine,
+                        (unsigned long long)r.instructions, r.seconds, mips, ns, r.peak_rss_kb);
+            }
+        }
+    }
+
+    if (out) {
+        fclose(out);
+        printf("Results written to %s\n", out_path);
+    }
+    return failed ? 1 : 0;
+}
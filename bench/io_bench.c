@@ -0,0 +1,156 @@
+//Copyright © Martin H. Sharp; August 2025
+// I/O bus throughput and overhead. First streams a generated text through
+// a filter program (bench/upcase.bin: IN -> PORT) on every engine and
+// reports bytes and instructions per second, checking that every engine
+// writes the same output. Then runs the other programs for a fixed number
+// of instructions without a bus and with one mapped at an address they do
+// not use, to show what the window costs accesses outside of it.
+//
+//   io_bench [-s megabytes] [-n instructions] [-io base] filter.bin [prog.bin...]
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "ec72_cpu.h"
+#include "ec72_bus.h"
+
+#define RED     "\x1b[31m"
+#define GREEN   "\x1b[32m"
+#define RESET   "\x1b[0m"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef struct {
+    uint64_t bytes;
+    uint64_t hash;
+} Sink_t;
+
+static void sink_put(void *user, uint8_t value) {
+    Sink_t *s = user;
+    s->bytes++;
+    s->hash = (s->hash ^ value) * 0x100000001B3ULL;
+}
+
+static uint64_t digest(const ec72_cpu_t *cpu) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < EC72_MEM_SIZE; i++) h = (h ^ cpu->memory[i]) * 0x100000001B3ULL;
+    h = (h ^ cpu->RA ^ (cpu->RB << 8) ^ ((uint64_t)cpu->RC << 16) ^ ((uint64_t)cpu->RE << 24)) * 0x100000001B3ULL;
+    return (h ^ cpu->PC ^ ((uint64_t)cpu->SP << 8) ^ cpu->retired) * 0x100000001B3ULL;
+}
+
+// Lines of lower/upper case words, like a log file
+static FILE *make_input(uint64_t size) {
+    FILE *f = tmpfile();
+    if (!f) return NULL;
+    static const char words[] = "the quick brown FOX jumps over 13 lazy Dogs; ";
+    uint64_t seed = 1;
+    char line[128];
+    for (uint64_t written = 0; written < size; ) {
+        size_t len = 0;
+        while (len < 80) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            size_t at = (size_t)(seed >> 33) % (sizeof(words) - 8);
+            memcpy(line + len, words + at, 6);
+            len += 6;
+        }
+        line[len++] = '\n';
+        if (len > size - written) len = (size_t)(size - written);
+        fwrite(line, 1, len, f);
+        written += len;
+    }
+    return f;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t megabytes = 16, instructions = 100000000;
+    uint8_t base = 0xF8;
+    const char *filter = NULL;
+    const char *progs[64];
+    int nprogs = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) megabytes = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) instructions = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-io") == 0 && i + 1 < argc) base = (uint8_t)strtoul(argv[++i], NULL, 0);
+        else if (!filter) filter = argv[i];
+        else if (nprogs < 64) progs[nprogs++] = argv[i];
+    }
+    if (!filter) {
+        fprintf(stderr, "Usage: %s [-s megabytes] [-n instructions] [-io base] filter.bin [prog.bin...]\n", argv[0]);
+        return 1;
+    }
+
+    static ec72_cpu_t cpu;
+    ec72_cpu_init(&cpu);
+    ec72_bus_t bus;
+    if (!ec72_bus_init(&bus, EC72_BUS_DEFAULT_BASE)) return 1;
+    bool same = true;
+
+    FILE *in = make_input(megabytes << 20);
+    if (!in) {
+        perror("tmpfile");
+        return 1;
+    }
+    printf("%s: %llu MiB through the bus at 0x%02X\n", filter, (unsigned long long)megabytes, bus.base);
+    uint64_t first_hash = 0;
+    for (int e = 0; e <= EC72_ENGINE_JIT; e++) {
+        if (ec72_cpu_load_file(&cpu, filter) != EC72_OK) {
+            perror(filter);
+            return 1;
+        }
+        rewind(in);
+        Sink_t sink = { 0, 0xCBF29CE484222325ULL };
+        ec72_bus_set_input(&bus, in);
+        ec72_bus_set_port(&bus, sink_put, &sink);
+        ec72_cpu_attach_bus(&cpu, &bus);
+        ec72_cpu_set_engine(&cpu, (ec72_engine_t)e);
+        double start = now();
+        ec72_status_t s = ec72_cpu_run(&cpu, EC72_RUN_FOREVER);
+        double seconds = now() - start;
+        if (e == 0) first_hash = sink.hash;
+        bool ok = s == EC72_HALTED && sink.hash == first_hash;
+        same &= ok;
+        printf("%-9s %8.3f s %9.1f MiB/s %9.1f M instructions/s  %s%s%s\n", ec72_engine_name((ec72_engine_t)e),
+               seconds, sink.bytes / seconds / (1 << 20), cpu.retired / seconds / 1e6,
+               ok ? GREEN : RED, ok ? "ok" : ec72_status_str(s), RESET);
+    }
+    fclose(in);
+
+    // Same program, same instructions, with and without the window mapped
+    for (int p = 0; p < nprogs; p++) {
+        printf("%s: %llu instructions, bus at 0x%02X vs none\n", progs[p], (unsigned long long)instructions, base);
+        bus.base = base;
+        for (int e = 0; e <= EC72_ENGINE_JIT; e++) {
+            double seconds[2];
+            uint64_t h[2];
+            for (int with_bus = 0; with_bus < 2; with_bus++) {
+                if (ec72_cpu_load_file(&cpu, progs[p]) != EC72_OK) {
+                    perror(progs[p]);
+                    return 1;
+                }
+                ec72_cpu_attach_bus(&cpu, with_bus ? &bus : NULL);
+                ec72_cpu_set_engine(&cpu, (ec72_engine_t)e);
+                double start = now();
+                ec72_cpu_run(&cpu, instructions);
+                seconds[with_bus] = now() - start;
+                h[with_bus] = digest(&cpu);
+            }
+            bool ok = h[0] == h[1];
+            same &= ok;
+            printf("%-9s %8.3f s without %8.3f s with  %+6.1f%%  %s%s%s\n", ec72_engine_name((ec72_engine_t)e),
+                   seconds[0], seconds[1], (seconds[1] / seconds[0] - 1) * 100,
+                   ok ? GREEN : RED, ok ? "same state" : "states differ", RESET);
+        }
+    }
+
+    ec72_cpu_attach_bus(&cpu, NULL);
+    ec72_bus_free(&bus);
+    ec72_cpu_fini(&cpu);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+//Copyright © Martin H. Sharp; August 2025
+// Differential test of the assembler's peephole pass (-O): every program is
+// assembled plain and optimized, both are run, and the OUT streams must
+// agree. A program that halts must also halt in both forms with the same
+// registers and flags; one that is still running when the budget runs out
+// is compared on the OUT values both produced. Besides the sources given,
+// it generates programs full of what -O looks for (jump chains, CALL; RET,
+// dead code, reloads, ADD/SUB chains).
+//
+//   opt_diff [-g count] [-seed n] [-n max_instructions] [prog.ec72asm ...]
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_cpu.h"
+#include "ec72_asm.h"
+
+#define RED     "\x1b[31m"
+#define GREEN   "\x1b[32m"
+#define CYAN    "\x1b[36m"
+#define RESET   "\x1b[0m"
+
+#define OUT_KEEP 4096
+
+typedef struct {
+    uint8_t values[OUT_KEEP];
+    size_t count;
+} Out_t;
+
+static void record_out(void *user, uint8_t value) {
+    Out_t *o = user;
+    if (o->count < OUT_KEEP) o->values[o->count] = value;
+    o->count++;
+}
+
+static uint64_t gen_state;
+static unsigned gen_next(unsigned range) {
+    gen_state ^= gen_state << 13;
+    gen_state ^= gen_state >> 7;
+    gen_state ^= gen_state << 17;
+    return (unsigned)(gen_state % range);
+}
+
+// A counted loop over random blocks, subroutines and trampolines behind
+// the HLT; always assembles and halts
+static size_t generate_source(char *src, size_t cap, size_t index) {
+    size_t n = 0;
+    unsigned hops = 0, skips = 0;
+#define EMIT(...) (n += (size_t)snprintf(src + n, n < cap ? cap - n : 0, __VA_ARGS__))
+    EMIT("; opt_diff program %zu\n", index);
+    EMIT("        SSTUF 250\n        SSTOF 160\n        LDIMA %u\n        STORA 0xF0\nLOOP:\n", 1 + gen_next(20));
+    for (unsigned k = 4 + gen_next(12); k > 0; k--) {
+        unsigned v = gen_next(4) ? gen_next(4) : gen_next(256);
+        switch (gen_next(12)) {
+            case 0: EMIT("        LDIMA %u\n        OUT\n        LDIMA %u\n", v, v); break;
+            case 1: EMIT("        LDIMB %u\n        MOVR RC RB\n        LDIMC %u\n", v, v); break;
+            case 2: EMIT("        ADD %u\n        SUB %u\n        ADD %u\n", v, gen_next(256), gen_next(3)); break;
+            case 3: EMIT("        ADD 0\n        OUT\n"); break;
+            case 4: EMIT("        ADD %u\n        JMPZ S%u\n        OUT\nS%u:\n", v, skips, skips); skips++; break;
+            case 5: EMIT("        CALL F%u\n", gen_next(3)); break;
+            case 6: EMIT("        JMP H%u\n        OUT\n        ADD 9\nB%u:\n", hops, hops); hops++; break;
+            case 7: EMIT("        JMP N%u\nN%u:\n", skips, skips); skips++; break;
+            case 8: EMIT("        MOVR RE RA\n        ADDR RB\n        OUT\n"); break;
+            case 9: EMIT("        PUSH RA\n        POP RB\n"); break;
+            case 10: EMIT("        STORA 0x%02X\n        MOVA 0x%02X\n", 0xE0 + v % 16, 0xE0 + gen_next(16)); break;
+            default: EMIT("        SUB %u\n        OUT\n", v); break;
+        }
+    }
+    EMIT("        MOVA 0xF0\n        SUB 1\n        STORA 0xF0\n        JMPZ DONE\n        JMP LOOP\n");
+    EMIT("DONE:\n        HLT\n        OUT\n        JMP DONE\n");
+    // Trampolines: H -> G -> B
+    for (unsigned h = 0; h < hops; h++) EMIT("H%u:\n        JMP G%u\n        LDIMA 1\nG%u:\n        JMP B%u\n", h, h, h, h);
+    EMIT("F0:\n        ADD 3\n        ADD 4\n        OUT\n        RET\n        OUT\n");
+    EMIT("F1:\n        LDIMC 7\n        CALL F0\n        RET\n");
+    EMIT("F2:\n        JMP F1\n");
+#undef EMIT
+    return n;
+}
+
+typedef struct {
+    ec72_status_t status;
+    Out_t out;
+    uint8_t RA, RB, RC, RE;
+    bool ZF, NF, OF;
+    uint64_t instructions;
+} Run_t;
+
+static ec72_cpu_t cpu;
+
+static void run(const ec72_asm_result_t *r, uint64_t budget, Run_t *run) {
+    memset(run, 0, sizeof(*run));
+    ec72_cpu_set_output(&cpu, record_out, &run->out);
+    ec72_cpu_load_words(&cpu, r->words, r->word_count);
+    run->status = ec72_cpu_run(&cpu, budget);
+    run->RA = cpu.RA; run->RB = cpu.RB; run->RC = cpu.RC; run->RE = cpu.RE;
+    run->ZF = cpu.ZF; run->NF = cpu.NF; run->OF = cpu.OF;
+    run->instructions = cpu.retired;
+}
+
+static size_t total_before, total_after, total_skipped;
+static uint64_t instr_before, instr_after;
+
+// Returns false on a mismatch
+static bool check(const char *name, const char *source, size_t len, uint64_t budget, bool verbose) {
+    ec72_asm_result_t plain, opt;
+    bool ok_plain = ec72_asm_assemble(source, len, 0, &plain);
+    bool ok_opt = ec72_asm_assemble(source, len, EC72_ASM_OPTIMIZE, &opt);
+    bool same = true;
+    if (!ok_plain || !ok_opt) {
+        printf("%s%s: assembly failed%s\n", RED, name, RESET);
+        ec72_asm_print_diags(&plain, stdout);
+        same = false;
+        goto done;
+    }
+
+    static Run_t a, b;
+    run(&plain, budget, &a);
+    run(&opt, budget, &b);
+
+    size_t common = a.out.count < b.out.count ? a.out.count : b.out.count;
+    if (common > OUT_KEEP) common = OUT_KEEP;
+    if (memcmp(a.out.values, b.out.values, common) != 0) same = false;
+    if (a.status != EC72_OK && b.status != EC72_OK) {
+        // Both stopped: everything they produced must match
+        same = same && a.status == b.status && a.out.count == b.out.count;
+        if (a.status == EC72_HALTED) {
+            same = same && a.RA == b.RA && a.RB == b.RB && a.RC == b.RC && a.RE == b.RE &&
+                   a.ZF == b.ZF && a.NF == b.NF && a.OF == b.OF;
+        }
+    } else if (a.status != EC72_OK && b.out.count > a.out.count) {
+        same = false;
+    } else if (b.status != EC72_OK && a.out.count > b.out.count) {
+        same = false;
+    }
+
+    total_before += opt.opt.words_before;
+    total_after += opt.opt.words_after;
+    if (!opt.opt.applied) total_skipped++;
+    instr_before += a.instructions;
+    instr_after += b.instructions;
+
+    if (!same || verbose) {
+        printf("%s%s: %zu -> %zu words, %s/%s, %zu/%zu OUT, %llu/%llu instructions%s\n",
+               same ? "" : RED, name, opt.opt.words_before, opt.opt.words_after,
+               ec72_status_str(a.status), ec72_status_str(b.status), a.out.count, b.out.count,
+               (unsigned long long)a.instructions, (unsigned long long)b.instructions, same ? "" : RESET);
+        if (verbose && !opt.opt.applied) ec72_asm_print_opt(&opt, stdout);
+    }
+done:
+    ec72_asm_result_free(&plain);
+    ec72_asm_result_free(&opt);
+    return same;
+}
+
+static char *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    char *text = malloc(size > 0 ? (size_t)size : 1);
+    *len = text ? fread(text, 1, (size_t)(size > 0 ? size : 0), f) : 0;
+    fclose(f);
+    return text;
+}
+
+int main(int argc, char *argv[]) {
+    size_t generate = 1000;
+    uint64_t seed = 1, budget = 1000000;
+    size_t checked = 0, bad = 0;
+
+    ec72_cpu_init(&cpu);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) generate = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) budget = strtoull(argv[++i], NULL, 10);
+        else if (argv[i][0] == '-') {
+            fprintf(stderr, "Usage: %s [-g count] [-seed n] [-n max_instructions] [prog.ec72asm ...]\n", argv[0]);
+            return 1;
+        } else {
+            size_t len;
+            char *text = read_file(argv[i], &len);
+            if (!text) {
+                perror(argv[i]);
+                return 1;
+            }
+            bad += !check(argv[i], text, len, budget, true);
+            checked++;
+            free(text);
+        }
+    }
+
+    static char src[16384];
+    gen_state = seed ? seed : 1;
+    for (size_t g = 0; g < generate; g++) {
+        char name[32];
+        snprintf(name, sizeof(name), "generated-%zu", g);
+        size_t len = generate_source(src, sizeof(src), g);
+        bad += !check(name, src, len, budget, false);
+        checked++;
+    }
+
+    printf("%s%zu programs, %zu -> %zu words (%.1f%% smaller), %llu -> %llu instructions run, %zu not optimized%s\n",
+           CYAN, checked, total_before, total_after,
+           total_before ? 100.0 * (double)(total_before - total_after) / (double)total_before : 0.0,
+           (unsigned long long)instr_before, (unsigned long long)instr_after, total_skipped, RESET);
+    printf("%s%zu mismatches%s\n", bad ? RED : GREEN, bad, RESET);
+    ec72_cpu_fini(&cpu);
+    return bad ? 1 : 0;
+}
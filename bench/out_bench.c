@@ -0,0 +1,110 @@
+//Copyright © Martin H. Sharp; August 2025
+// Throughput of the OUT path: runs a tight OUT loop and compares the old
+// per-OUT printf callback with the buffered ec72_out channel in every mode.
+//
+//   out_bench [million_outs] [target] [-e engine]
+//
+// target defaults to /dev/null so only the formatting/stdio cost is measured.
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "ec72_cpu.h"
+#include "ec72_out.h"
+
+#define GREEN   "\x1b[32m"
+#define CYAN    "\x1b[36m"
+#define RESET   "\x1b[0m"
+
+// LOOP: OUT / ADD 1 / JMP LOOP
+static const uint16_t loop_program[] = {
+    EC72_WORD(OP_OUT, 0),
+    EC72_WORD(OP_ADD, 1),
+    EC72_WORD(OP_JMP, 0),
+};
+
+// What EC72CPU did before the output channel existed
+static void legacy_out(void *user, uint8_t value) {
+    fprintf(user, "%sOUT: %d%s\n", GREEN, value, RESET);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double run_loop(ec72_cpu_t *cpu, uint64_t outs) {
+    ec72_cpu_reset(cpu);
+    double start = now();
+    ec72_cpu_run(cpu, outs * 3);
+    return now() - start;
+}
+
+static void report(const char *name, uint64_t outs, double seconds, double baseline) {
+    printf("%-16s %8.3f s %10.2f M OUT/s", name, seconds, outs / seconds / 1e6);
+    if (baseline > 0) printf("   %s%6.2fx%s", CYAN, baseline / seconds, RESET);
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t outs = 5000000;
+    const char *target = "/dev/null";
+    ec72_engine_t engine = EC72_ENGINE_SWITCH;
+
+    int pos = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            if (!ec72_engine_from_name(argv[++i], &engine)) {
+                fprintf(stderr, "Unknown engine: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (pos == 0) {
+            outs = strtoull(argv[i], NULL, 0) * 1000000ULL;
+            pos++;
+        } else {
+            target = argv[i];
+        }
+    }
+
+    ec72_cpu_t cpu;
+    ec72_cpu_init(&cpu);
+    ec72_cpu_set_engine(&cpu, engine);
+    ec72_cpu_load_words(&cpu, loop_program, sizeof(loop_program)/sizeof(loop_program[0]));
+
+    printf("%llu OUTs into %s, %s engine\n", (unsigned long long)outs, target, ec72_engine_name(engine));
+
+    // Baseline: colored printf per OUT through stdio
+    FILE *f = fopen(target, "w");
+    if (!f) {
+        perror("Error opening output");
+        return 1;
+    }
+    ec72_cpu_set_output(&cpu, legacy_out, f);
+    double legacy = run_loop(&cpu, outs);
+    fclose(f);
+    report("printf (old)", outs, legacy, 0);
+
+    static const char *modes[] = { "color", "dec", "raw" };
+    for (size_t m = 0; m < sizeof(modes)/sizeof(modes[0]); m++) {
+        ec72_out_mode_t mode;
+        ec72_out_mode_from_name(modes[m], &mode);
+
+        ec72_out_t out;
+        if (!ec72_out_open(&out, mode, target, EC72_OUT_DEFAULT_BUFFER)) return 1;
+        ec72_cpu_attach_output(&cpu, &out);
+        double start = now();
+        run_loop(&cpu, outs);
+        ec72_out_close(&out);
+        double seconds = now() - start;
+
+        char name[32];
+        snprintf(name, sizeof(name), "ec72_out %s", modes[m]);
+        report(name, outs, seconds, legacy);
+    }
+
+    ec72_cpu_fini(&cpu);
+    return 0;
+}
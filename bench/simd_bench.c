@@ -0,0 +1,112 @@
+//Copyright © Martin H. Sharp; August 2025
+// Lockstep SIMD engine against N scalar runs of the same program. Lane i
+// gets parameter i (or 0 with -same) at the parameter address, every lane
+// runs the same number of instructions, and all final states are compared.
+//
+//   simd_bench [-l lanes] [-n instructions_per_lane] [-p param_address] [-same] prog.bin
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "ec72_cpu.h"
+#include "ec72_simd.h"
+
+#define RED     "\x1b[31m"
+#define GREEN   "\x1b[32m"
+#define CYAN    "\x1b[36m"
+#define RESET   "\x1b[0m"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool same_state(const ec72_cpu_t *a, const ec72_cpu_t *b) {
+    return memcmp(a->memory, b->memory, sizeof(a->memory)) == 0 &&
+           a->RA == b->RA && a->RB == b->RB && a->RC == b->RC && a->RE == b->RE &&
+           a->IR == b->IR && a->PC == b->PC && a->SP == b->SP &&
+           a->STOFR == b->STOFR && a->STUFR == b->STUFR &&
+           a->ZF == b->ZF && a->NF == b->NF && a->OF == b->OF &&
+           a->status == b->status && a->retired == b->retired;
+}
+
+int main(int argc, char *argv[]) {
+    int lanes = 256;
+    uint64_t budget = 1000000;
+    uint8_t param = 0xF0;
+    bool same = false;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) lanes = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) budget = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) param = (uint8_t)strtol(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-same") == 0) same = true;
+        else path = argv[i];
+    }
+    if (!path || lanes <= 0) {
+        fprintf(stderr, "Usage: %s [-l lanes] [-n instructions_per_lane] [-p param_address] [-same] prog.bin\n", argv[0]);
+        return 1;
+    }
+
+    ec72_cpu_t *cpus = malloc((size_t)lanes * sizeof(ec72_cpu_t));
+    ec72_simd_t *simd = ec72_simd_create(lanes);
+    if (!cpus || !simd) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    // Image once through a scalar context, then into every lane
+    ec72_cpu_t *cpu = &cpus[0];
+    ec72_cpu_init(cpu);
+    if (ec72_cpu_load_file(cpu, path) != EC72_OK) {
+        perror(path);
+        return 1;
+    }
+    ec72_simd_load_words(simd, cpu->image, cpu->image_words);
+    for (int l = 0; l < lanes; l++) {
+        if (l) {
+            ec72_cpu_init(&cpus[l]);
+            ec72_cpu_load_words(&cpus[l], cpu->image, cpu->image_words);
+        }
+        uint16_t value = same ? 0 : (uint16_t)(l & 0xFF);
+        cpus[l].memory[param] = value;
+        ec72_cpu_invalidate(&cpus[l]);
+        ec72_simd_poke(simd, l, param, value);
+    }
+
+    printf("%d lanes x %llu instructions, %s parameters\n", lanes, (unsigned long long)budget,
+           same ? "identical" : "per-lane");
+
+    double start = now();
+    for (int l = 0; l < lanes; l++) ec72_cpu_run(&cpus[l], budget);
+    double scalar = now() - start;
+
+    start = now();
+    ec72_simd_run(simd, budget);
+    double lockstep = now() - start;
+
+    uint64_t total = 0;
+    int mismatches = 0;
+    ec72_cpu_t lane;
+    ec72_cpu_init(&lane);
+    for (int l = 0; l < lanes; l++) {
+        ec72_simd_get_lane(simd, l, &lane);
+        total += lane.retired;
+        if (!same_state(&lane, &cpus[l])) mismatches++;
+    }
+
+    printf("%-10s %8.3f s %10.1f MIPS\n", "scalar", scalar, total / scalar / 1e6);
+    printf("%-10s %8.3f s %10.1f MIPS   %s%6.2fx%s\n", "lockstep", lockstep, total / lockstep / 1e6,
+           CYAN, scalar / lockstep, RESET);
+    if (mismatches) printf("%s%d lanes differ from the scalar runs%s\n", RED, mismatches, RESET);
+    else printf("%sAll %d lanes match the scalar runs%s\n", GREEN, lanes, RESET);
+
+    for (int l = 0; l < lanes; l++) ec72_cpu_fini(&cpus[l]);
+    free(cpus);
+    ec72_simd_destroy(simd);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,128 @@
+//Copyright © Martin H. Sharp; August 2025
+// Multi-core mode with 1, 2, 4, ... host threads: every core runs the same
+// number of instructions, the runs are timed, and memory and registers of
+// every core must come out the same whatever the thread count. -w checks a
+// word of shared memory after every run.
+//
+//   smp_bench [-c cores] [-t max_threads] [-q quantum] [-n instructions_per_core] [-w addr=value] prog.bin
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ec72_cpu.h"
+#include "ec72_smp.h"
+
+#define RED     "\x1b[31m"
+#define GREEN   "\x1b[32m"
+#define CYAN    "\x1b[36m"
+#define RESET   "\x1b[0m"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool same_core(const ec72_cpu_t *a, const ec72_cpu_t *b) {
+    return a->RA == b->RA && a->RB == b->RB && a->RC == b->RC && a->RE == b->RE &&
+           a->IR == b->IR && a->PC == b->PC && a->SP == b->SP &&
+           a->ZF == b->ZF && a->NF == b->NF && a->OF == b->OF &&
+           a->status == b->status && a->retired == b->retired;
+}
+
+int main(int argc, char *argv[]) {
+    int cores = 8, max_threads = 0;
+    uint32_t quantum = EC72_SMP_DEFAULT_QUANTUM;
+    uint64_t budget = 2000000;
+    const char *path = NULL;
+    int want_addr = -1;
+    unsigned want_value = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) cores = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) max_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) quantum = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) budget = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            char *end;
+            want_addr = (int)strtol(argv[++i], &end, 0);
+            if (*end != '=' || want_addr < 0 || want_addr >= EC72_MEM_SIZE) want_addr = EC72_MEM_SIZE;
+            else want_value = (unsigned)strtoul(end + 1, NULL, 0);
+        }
+        else path = argv[i];
+    }
+    if (!path || cores <= 0 || cores > EC72_SMP_MAX_CORES || want_addr >= EC72_MEM_SIZE) {
+        fprintf(stderr, "Usage: %s [-c cores] [-t max_threads] [-q quantum] [-n instructions_per_core] [-w addr=value] prog.bin\n", argv[0]);
+        return 1;
+    }
+    if (max_threads <= 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        max_threads = online > 0 ? (int)online : 1;
+    }
+    if (max_threads > cores) max_threads = cores;
+
+    ec72_cpu_t image;
+    ec72_cpu_init(&image);
+    if (ec72_cpu_load_file(&image, path) != EC72_OK) {
+        perror(path);
+        return 1;
+    }
+
+    // The one-thread run is the reference for the others
+    ec72_cpu_t *ref = malloc((size_t)cores * sizeof(ec72_cpu_t));
+    uint16_t ref_memory[EC72_MEM_SIZE];
+    if (!ref) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    printf("%d cores x %llu instructions, quantum %u\n", cores, (unsigned long long)budget, quantum);
+    double base = 0;
+    int mismatches = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        ec72_smp_t *m = ec72_smp_create(cores, threads);
+        if (!m || !ec72_smp_set_quantum(m, quantum)) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+        ec72_smp_load(m, &image);
+
+        double start = now();
+        ec72_smp_run(m, budget);
+        double t = now() - start;
+
+        uint64_t total = 0;
+        bool same = true;
+        for (int i = 0; i < cores; i++) {
+            ec72_cpu_t *cpu = ec72_smp_core(m, i);
+            total += cpu->retired;
+            if (threads == 1) ref[i] = *cpu;
+            else if (!same_core(cpu, &ref[i])) same = false;
+        }
+        if (threads == 1) {
+            memcpy(ref_memory, ec72_smp_memory(m), sizeof(ref_memory));
+            base = t;
+        } else if (memcmp(ref_memory, ec72_smp_memory(m), sizeof(ref_memory)) != 0) {
+            same = false;
+        }
+        if (!same) mismatches++;
+        unsigned word = want_addr >= 0 ? ec72_smp_memory(m)[want_addr] : 0;
+        if (want_addr >= 0 && word != want_value) mismatches++;
+
+        printf("%3d threads %8.3f s %10.1f MIPS   %s%6.2fx%s   %llu quanta, %llu atomics%s\n",
+               ec72_smp_threads(m), t, total / t / 1e6, CYAN, base / t, RESET,
+               (unsigned long long)ec72_smp_quanta(m), (unsigned long long)ec72_smp_atomics(m),
+               same ? "" : RED "   differs from 1 thread" RESET);
+        if (want_addr >= 0 && word != want_value)
+            printf("%s    mem[%d] = %u, expected %u%s\n", RED, want_addr, word, want_value, RESET);
+        ec72_smp_destroy(m);
+    }
+    if (!mismatches) printf("%sEvery thread count gives the same result%s\n", GREEN, RESET);
+
+    free(ref);
+    ec72_cpu_fini(&image);
+    return mismatches ? 1 : 0;
+}
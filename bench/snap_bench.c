@@ -0,0 +1,126 @@
+//Copyright © Martin H. Sharp; August 2025
+// Exploration from a warmed-up state: runs a program for a number of
+// instructions, takes a snapshot, then resets to it over and over, writing
+// a different input into the parameter address and running a short burst
+// each time. Reports resets per second for every form of snapshot and
+// checks that every form reproduces the same final states.
+//
+//   snap_bench [-w warmup] [-b burst] [-r resets] [-p param_address] [-e engine] prog.bin
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "ec72_cpu.h"
+#include "ec72_snap.h"
+
+#define RED     "\x1b[31m"
+#define GREEN   "\x1b[32m"
+#define RESET   "\x1b[0m"
+
+enum { FLAT, COW, CHECKPOINT, FORMS };
+static const char *form_names[FORMS] = { "snapshot", "cow node", "checkpoint" };
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Cheap digest of the final state of every burst, compared across forms
+static uint64_t digest(const ec72_cpu_t *cpu, uint64_t h) {
+    h = (h ^ cpu->RA ^ (cpu->RB << 8) ^ ((uint64_t)cpu->PC << 16) ^ ((uint64_t)cpu->SP << 24)) * 0x100000001B3ULL;
+    h = (h ^ cpu->retired ^ ((uint64_t)cpu->status << 56)) * 0x100000001B3ULL;
+    return h;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t warmup = 1000, burst = 100, resets = 1000000;
+    uint8_t param = 0xF0;
+    ec72_engine_t engine = EC72_ENGINE_SWITCH;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) warmup = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) burst = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) resets = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) param = (uint8_t)strtol(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            if (!ec72_engine_from_name(argv[++i], &engine)) {
+                fprintf(stderr, "Unknown engine: %s\n", argv[i]);
+                return 1;
+            }
+        } else path = argv[i];
+    }
+    if (!path) {
+        fprintf(stderr, "Usage: %s [-w warmup] [-b burst] [-r resets] [-p param_address] [-e engine] prog.bin\n", argv[0]);
+        return 1;
+    }
+
+    ec72_cpu_t cpu;
+    ec72_cpu_init(&cpu);
+    ec72_cpu_set_engine(&cpu, engine);
+    if (ec72_cpu_load_file(&cpu, path) != EC72_OK) {
+        perror(path);
+        return 1;
+    }
+    ec72_cpu_run(&cpu, warmup);
+
+    ec72_snapshot_t snap;
+    ec72_snapshot_take(&cpu, &snap);
+    ec72_snaptree_t tree;
+    ec72_snaptree_init(&tree);
+    ec72_snap_node_t *root = ec72_snap_fork(&tree, NULL, &cpu);
+    uint8_t ckpt[EC72_CKPT_MAX_SIZE];
+    size_t ckpt_size = ec72_checkpoint_encode(&cpu, ckpt, sizeof(ckpt));
+    if (!root || !ckpt_size) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    printf("%s: warm-up %llu, %llu resets x %llu instructions (%s), checkpoint %zu bytes\n", path,
+           (unsigned long long)warmup, (unsigned long long)resets, (unsigned long long)burst,
+           ec72_engine_name(engine), ckpt_size);
+
+    uint64_t digests[FORMS];
+    for (int form = 0; form < FORMS; form++) {
+        uint64_t h = 0xCBF29CE484222325ULL;
+        double start = now();
+        for (uint64_t r = 0; r < resets; r++) {
+            switch (form) {
+                case FLAT: ec72_snapshot_restore(&cpu, &snap); break;
+                case COW: ec72_snap_restore(&cpu, root); break;
+                case CHECKPOINT: ec72_checkpoint_decode(&cpu, ckpt, ckpt_size); break;
+            }
+            cpu.memory[param] = (uint16_t)(r & 0xFF);
+            ec72_cpu_invalidate(&cpu);
+            ec72_cpu_run(&cpu, burst);
+            h = digest(&cpu, h);
+        }
+        double seconds = now() - start;
+        digests[form] = h;
+        printf("%-10s %8.3f s %12.0f resets/s\n", form_names[form], seconds, resets / seconds);
+    }
+
+    // Fork one child per input off the warmed-up root and keep them all:
+    // shows how much memory the shared pages save
+    ec72_snap_node_t *children[256];
+    for (int c = 0; c < 256; c++) {
+        ec72_snap_restore(&cpu, root);
+        cpu.memory[param] = (uint16_t)c;
+        ec72_cpu_invalidate(&cpu);
+        ec72_cpu_run(&cpu, burst);
+        children[c] = ec72_snap_fork(&tree, root, &cpu);
+    }
+    printf("256 forked states: %zu nodes, %zu pages (%zu without sharing)\n",
+           tree.live_nodes, tree.live_pages, tree.live_nodes * (size_t)EC72_SNAP_PAGES);
+    for (int c = 0; c < 256; c++) ec72_snap_release(&tree, children[c]);
+    ec72_snap_release(&tree, root);
+    ec72_snaptree_free(&tree);
+    ec72_cpu_fini(&cpu);
+
+    bool same = digests[COW] == digests[FLAT] && digests[CHECKPOINT] == digests[FLAT];
+    printf("%s%s%s\n", same ? GREEN : RED, same ? "All forms reproduce the same states" : "Snapshot forms disagree", RESET);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,927 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "ec72_asm.h"
+#include "ec72_isa.h"
+
+#define RED        "\x1b[31m"
+#define YELLOW     "\x1b[33m"
+#define BLUE       "\x1b[34m"
+#define MAGENTA    "\x1b[35m"
+#define CYAN       "\x1b[36m"
+#define RESETCOLOR "\x1b[0m"
+
+#define ARENA_BLOCK    (64 * 1024)
+#define OPCODE_INDEX_SIZE 128
+
+#define DEBUG_PRINT(fmt, ...) \
+    do { if (a->debug) fprintf(stderr, "%s[DEBUG] %s:%d: %s" fmt "\n", MAGENTA, __FILE__, __LINE__, RESETCOLOR, ##__VA_ARGS__); } while (0)
+
+static const struct { const char *name; Opcode_t code; } opcode_table[] = {
+    {"MOVR", OP_MOVR},      {"MOVA", OP_MOVA},      {"MOVB", OP_MOVB},
+    {"MOVC", OP_MOVC},      {"MOVE", OP_MOVE},      {"STORA", OP_STORA},
+    {"STORB", OP_STORB},    {"STORC", OP_STORC},    {"STORE", OP_STORE},
+    {"LDIMA", OP_LDIMA},    {"LDIMB", OP_LDIMB},    {"LDIMC", OP_LDIMC},
+    {"LDIME", OP_LDIME},    {"JMPN", OP_JMPN},      {"JMPZ", OP_JMPZ},
+    {"JMPO", OP_JMPO},      {"JMP", OP_JMP},        {"ADD", OP_ADD},
+    {"SUB", OP_SUB},        {"ADDR", OP_ADDR},      {"SUBR", OP_SUBR},
+    {"OUT", OP_OUT},        {"CALL", OP_CALL},      {"RET", OP_RET},
+    {"MOVA_PTRB", OP_MOVA_PTRB},        {"STORA_PTRB", OP_STORA_PTRB},
+    {"PUSH", OP_PUSH},      {"POP", OP_POP},        {"ADDSP", OP_ADDSP},
+    {"SUBSP", OP_SUBSP},    {"SSTOF", OP_SSTOF},    {"SSTUF", OP_SSTUF},
+    {"XCHG", OP_XCHG},      {"CAS", OP_CAS},        {"LDID", OP_LDID},
+    {"SBANK", OP_SBANK},    {"SMAR", OP_SMAR},      {"FLD", OP_FLD},
+    {"FST", OP_FST},        {"BCOPY", OP_BCOPY},    {"BFILL", OP_BFILL},
+    {"BCMP", OP_BCMP},      {"MUL", OP_MUL},
+    {"HLT", OP_HLT}
+};
+
+// Operands naming a label that is not defined yet; patched at the end
+typedef struct {
+    const char *name;
+    int word;           // index into the output
+    int position;       // for the diagnostic
+    int line;
+} Fixup_t;
+
+// Label names outlive the line they were read from
+typedef struct Arena_Block {
+    struct Arena_Block *next;
+    size_t used, size;
+    char data[];
+} Arena_Block_t;
+
+// Token container; tokens point into the line
+typedef struct {
+    char **tok;
+    int count, cap;
+} TokenLine_t;
+
+// State of one assembly. Labels are kept in definition order (for the
+// symbol file) plus an open-addressing hash index (slot holds table index
+// + 1, 0 = empty); a name defined twice keeps its first address.
+typedef struct {
+    ec72_asm_result_t *r;
+    bool debug;
+    bool oom;
+    size_t word_cap, label_cap, diag_cap;
+    int *word_ref;              // per word: label named by the operand (table index + 1), 0 = numeric
+    int *word_pos;              // per word: source position
+    int *label_index;
+    size_t label_index_size;
+    Fixup_t *fixups;
+    size_t fixup_count, fixup_cap;
+    TokenLine_t line;
+    int position, line_no;
+    int data_position;          // first DW line, -1 if none
+    uint8_t opcode_index[OPCODE_INDEX_SIZE];    // mnemonic hash index, slot holds table index + 1
+} Asm_t;
+
+#define ENCODE_MOVR(rd, rs) (((rd) << 4) | (rs))
+
+static uint32_t hash_name(const char *s) {
+    uint32_t h = 2166136261u;
+    while (*s) h = (h ^ (uint8_t)*s++) * 16777619u;
+    return h;
+}
+
+// Doubles a growable array; NULL (array untouched) if out of memory
+static void *grow(void *array, size_t *cap, size_t elem_size) {
+    size_t n = *cap ? *cap * 2 : 64;
+    void *grown = realloc(array, n * elem_size);
+    if (grown) *cap = n;
+    return grown;
+}
+
+static void diag(Asm_t *a, ec72_asm_error_t error, int position, int line, const char *token) {
+    ec72_asm_result_t *r = a->r;
+    if (r->diag_count == a->diag_cap) {
+        ec72_asm_diag_t *grown = grow(r->diags, &a->diag_cap, sizeof(ec72_asm_diag_t));
+        if (!grown) {
+            a->oom = true;
+            return;
+        }
+        r->diags = grown;
+    }
+    ec72_asm_diag_t *d = &r->diags[r->diag_count++];
+    d->error = error;
+    d->position = position;
+    d->line = line;
+    snprintf(d->token, sizeof(d->token), "%s", token ? token : "");
+}
+
+static char *arena_strdup(Asm_t *a, const char *s) {
+    Arena_Block_t *arena = a->r->internal;
+    size_t len = strlen(s) + 1;
+    if (!arena || arena->size - arena->used < len) {
+        size_t size = len > ARENA_BLOCK ? len : ARENA_BLOCK;
+        Arena_Block_t *block = malloc(sizeof(Arena_Block_t) + size);
+        if (!block) {
+            a->oom = true;
+            return NULL;
+        }
+        block->next = arena;
+        block->used = 0;
+        block->size = size;
+        a->r->internal = arena = block;
+    }
+    char *copy = arena->data + arena->used;
+    memcpy(copy, s, len);
+    arena->used += len;
+    return copy;
+}
+
+// Slot of name in the label index: its entry, or the empty slot it belongs in
+static size_t label_slot(const Asm_t *a, const char *name) {
+    size_t mask = a->label_index_size - 1;
+    size_t slot = hash_name(name) & mask;
+    while (a->label_index[slot] && strcmp(a->r->labels[a->label_index[slot] - 1].name, name) != 0) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Label table index + 1 of name, 0 if it is not defined (yet)
+static int find_label(const Asm_t *a, const char *name) {
+    if (!a->label_index_size) return 0;
+    return a->label_index[label_slot(a, name)];
+}
+
+static void add_label(Asm_t *a, const char *name, int addr) {
+    ec72_asm_result_t *r = a->r;
+    // Keep the index at most half full
+    if (2 * (r->label_count + 1) > a->label_index_size) {
+        size_t size = a->label_index_size ? 2 * a->label_index_size : 256;
+        int *index = calloc(size, sizeof(int));
+        if (!index) {
+            a->oom = true;
+            return;
+        }
+        free(a->label_index);
+        a->label_index = index;
+        a->label_index_size = size;
+        for (size_t l = 0; l < r->label_count; l++) {
+            size_t slot = label_slot(a, r->labels[l].name);
+            if (!a->label_index[slot]) a->label_index[slot] = (int)l + 1;
+        }
+    }
+    if (r->label_count == a->label_cap) {
+        ec72_asm_label_t *grown = grow(r->labels, &a->label_cap, sizeof(ec72_asm_label_t));
+        if (!grown) {
+            a->oom = true;
+            return;
+        }
+        r->labels = grown;
+    }
+    const char *copy = arena_strdup(a, name);
+    if (!copy) return;
+    r->labels[r->label_count].name = copy;
+    r->labels[r->label_count].address = addr;
+    r->label_count++;
+
+    size_t slot = label_slot(a, name);
+    if (!a->label_index[slot]) a->label_index[slot] = (int)r->label_count;
+}
+
+static void add_fixup(Asm_t *a, const char *name, int word) {
+    if (a->fixup_count == a->fixup_cap) {
+        Fixup_t *grown = grow(a->fixups, &a->fixup_cap, sizeof(Fixup_t));
+        if (!grown) {
+            a->oom = true;
+            return;
+        }
+        a->fixups = grown;
+    }
+    const char *copy = arena_strdup(a, name);
+    if (!copy) return;
+    a->fixups[a->fixup_count].name = copy;
+    a->fixups[a->fixup_count].word = word;
+    a->fixups[a->fixup_count].position = a->position;
+    a->fixups[a->fixup_count].line = a->line_no;
+    a->fixup_count++;
+}
+
+static void strip_comment(char *s) {
+    char *p = strchr(s, ';');
+    if (p) *p = '\0';
+}
+
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) s++;
+    char *end = s + strlen(s) - 1;
+    while (end >= s && isspace((unsigned char)*end)) end--;
+    *(end + 1) = '\0';
+    return s;
+}
+
+static bool is_separator(char c) {
+    return c == ' ' || c == '\t' || c == ',';
+}
+
+// Splits in place at spaces, tabs and commas
+static void tokenize(Asm_t *a, char *line) {
+    TokenLine_t *tl = &a->line;
+    tl->count = 0;
+    for (char *p = line; *p; ) {
+        while (is_separator(*p)) p++;
+        if (!*p) break;
+        if (tl->count == tl->cap) {
+            size_t cap = (size_t)tl->cap;
+            char **grown = grow(tl->tok, &cap, sizeof(char *));
+            if (!grown) {
+                a->oom = true;
+                return;
+            }
+            tl->tok = grown;
+            tl->cap = (int)cap;
+        }
+        tl->tok[tl->count++] = p;
+        while (*p && !is_separator(*p)) p++;
+        if (*p) *p++ = '\0';
+    }
+}
+
+// Register code, REG_NONE (with a diagnostic) if r names none
+static Register_t parse_register(Asm_t *a, const char *r) {
+    if      (strcmp(r, "RA") == 0) return REG_A;
+    else if (strcmp(r, "RB") == 0) return REG_B;
+    else if (strcmp(r, "RC") == 0) return REG_C;
+    else if (strcmp(r, "RE") == 0) return REG_E;
+    else if (strcmp(r, "SP") == 0) return REG_SP;
+
+    diag(a, EC72_ASM_INVALID_REGISTER, a->position, a->line_no, r);
+    return REG_NONE;
+}
+
+// Opcode, 0 (with a diagnostic) if unknown
+static int parse_opcode(Asm_t *a, const char *o) {
+    const uint8_t *index = a->opcode_index;
+    for (size_t slot = hash_name(o) & (OPCODE_INDEX_SIZE - 1); index[slot];
+         slot = (slot + 1) & (OPCODE_INDEX_SIZE - 1)) {
+        if (strcmp(opcode_table[index[slot] - 1].name, o) == 0)
+            return opcode_table[index[slot] - 1].code;
+    }
+    diag(a, EC72_ASM_UNKNOWN_OPCODE, a->position, a->line_no, o);
+    return 0;
+}
+
+static void emit(Asm_t *a, uint16_t word, int ref) {
+    ec72_asm_result_t *r = a->r;
+    if (r->word_count == a->word_cap) {
+        size_t cap = a->word_cap;
+        uint16_t *grown = grow(r->words, &cap, sizeof(uint16_t));
+        if (grown) r->words = grown;
+        int *refs = grown ? realloc(a->word_ref, cap * sizeof(int)) : NULL;
+        if (refs) a->word_ref = refs;
+        int *pos = refs ? realloc(a->word_pos, cap * sizeof(int)) : NULL;
+        if (!pos) {
+            a->oom = true;
+            return;
+        }
+        a->word_pos = pos;
+        a->word_cap = cap;
+    }
+    a->word_ref[r->word_count] = ref;
+    a->word_pos[r->word_count] = a->position;
+    r->words[r->word_count++] = word;
+}
+
+// "0x.." in hex, anything else in decimal
+static long parse_number(const char *arg) {
+    if (strlen(arg) > 2 && arg[0]=='0' && (arg[1]=='x'||arg[1]=='X'))
+        return strtol(arg, NULL, 16);
+    return atoi(arg);
+}
+
+// DW value: one raw 16-bit word (data, or an instruction the mnemonics
+// cannot spell); a label as value gives its address
+static void assemble_data(Asm_t *a, TokenLine_t *tl, int addr) {
+    uint16_t word = 0;
+    int ref = 0;
+    if (tl->count < 2) {
+        diag(a, EC72_ASM_MISSING_OPERAND, a->position, a->line_no, tl->tok[0]);
+    } else if (isalpha((unsigned char)tl->tok[1][0])) {
+        ref = find_label(a, tl->tok[1]);
+        if (!ref) add_fixup(a, tl->tok[1], addr);
+        else word = (uint16_t)(uint8_t)a->r->labels[ref - 1].address;
+    } else {
+        word = (uint16_t)parse_number(tl->tok[1]);
+    }
+    if (a->data_position < 0) a->data_position = a->position;
+    DEBUG_PRINT("%sDW -> word=0x%04X%s", CYAN, word, RESETCOLOR);
+    emit(a, word, ref);
+}
+
+// One non-empty line (comment stripped, trimmed)
+static void assemble_line(Asm_t *a, char *text) {
+    tokenize(a, text);
+    TokenLine_t *tl = &a->line;
+    if (tl->count == 0) return;
+    int i = a->position;
+
+    DEBUG_PRINT("%sPosition %d tokens count = %d%s", BLUE, i, tl->count, RESETCOLOR);
+    for(int t = 0; t < tl->count; t++){
+        DEBUG_PRINT("\t%stok[%d] = %s%s", BLUE, t, tl->tok[t], RESETCOLOR);
+    }
+
+    char *first = tl->tok[0];
+    size_t len = strlen(first);
+    int addr = (int)a->r->word_count;
+    if (first[len - 1] == ':') {
+        // Label lines hold nothing else; one word (2 bytes) per instruction
+        first[len - 1] = '\0';
+        add_label(a, first, addr);
+        DEBUG_PRINT("%sLabel '%s' -> Address 0x%02X(%d)%s", YELLOW, first, addr, addr, RESETCOLOR);
+        a->position++;
+        return;
+    }
+
+    char *mnemonic = tl->tok[0];
+    if (strcmp(mnemonic, "DW") == 0) {
+        assemble_data(a, tl, addr);
+        a->position++;
+        return;
+    }
+    int op = parse_opcode(a, mnemonic);
+    uint8_t operand = 0;
+    int ref = 0;
+
+    switch (ec72_operand_kind((uint8_t)op)) {
+        case EC72_ARG_INVALID:
+            if (op) diag(a, EC72_ASM_UNSUPPORTED_OPCODE, i, a->line_no, mnemonic);
+            break;
+
+        case EC72_ARG_REG:
+            if (tl->count < 2) {
+                diag(a, EC72_ASM_MISSING_REGISTER, i, a->line_no, mnemonic);
+                break;
+            }
+            operand = parse_register(a, tl->tok[1]);
+            DEBUG_PRINT("%s%s(0x%02X) register %u -> operand=0x%02X%s", CYAN, mnemonic, op, operand, operand, RESETCOLOR);
+            break;
+
+        case EC72_ARG_REG_PAIR: {
+            if (tl->count < 3) {
+                diag(a, EC72_ASM_MOVR_OPERANDS, i, a->line_no, NULL);
+                break;
+            }
+            Register_t rd = parse_register(a, tl->tok[1]);
+            Register_t rs = parse_register(a, tl->tok[2]);
+            operand = ENCODE_MOVR(rd, rs);
+            DEBUG_PRINT("%sMOVR(0x%02X) rd=%u, rs=%u -> operand=0x%02X%s", CYAN, op, rd, rs, operand, RESETCOLOR);
+            break;
+        }
+
+        case EC72_ARG_ADDR:
+        case EC72_ARG_TARGET:
+        case EC72_ARG_IMM: {
+
+            if (tl->count < 2) {
+                diag(a, EC72_ASM_MISSING_OPERAND, i, a->line_no, mnemonic);
+                break;
+            }
+
+            char *arg = tl->tok[1];
+            if (isalpha((unsigned char)arg[0])) {
+
+                ref = find_label(a, arg);
+                if (!ref) add_fixup(a, arg, addr);
+                else operand = (uint8_t)a->r->labels[ref - 1].address;
+
+            } else {
+                operand = (uint8_t)parse_number(arg);
+            }
+
+            DEBUG_PRINT("%s%s(0x%02X) -> operand=0x%02X%s", CYAN, mnemonic, op, operand, RESETCOLOR);
+            break;
+        }
+
+        case EC72_ARG_NONE:
+        case EC72_ARG_OPT_REG:
+            /* Single-word no-operand or default register operation */
+            if (op == OP_OUT && tl->count > 1)
+                operand = parse_register(a, tl->tok[1]);
+            DEBUG_PRINT("%s%s(0x%02X) -> operand=0x%02X%s", CYAN, mnemonic, op, operand, RESETCOLOR);
+            break;
+    }
+    // Lines with errors still take their word, so later addresses stay right
+    emit(a, EC72_WORD(op, operand), ref);
+    a->position++;
+}
+
+// ---------------------------------------------------------------------
+// Peephole pass (-O). Runs on the resolved words; every branch operand is
+// tracked by label (word_ref), so words can be removed and the labels laid
+// out again afterwards. Rules repeat until none of them changes anything.
+// ---------------------------------------------------------------------
+
+#define OPT_MAX_ROUNDS 16
+#define OPT_MAX_HOPS   16
+
+typedef struct {
+    Asm_t *a;
+    uint16_t *words;
+    int *ref, *pos;
+    size_t n;
+    bool *target;       // a referenced label names this word (n + 1 entries)
+    bool *dead;         // word is removed by the next compact()
+    int *work;          // scratch for the callee walk
+    bool *seen;
+} Opt_t;
+
+static bool is_branch(int op) {
+    return op == OP_JMP || op == OP_JMPN || op == OP_JMPZ || op == OP_JMPO || op == OP_CALL;
+}
+
+static bool is_memory(int op) {
+    return (op >= OP_MOVA && op <= OP_MOVE) || (op >= OP_STORA && op <= OP_STORE) || op == OP_XCHG || op == OP_CAS;
+}
+
+// Nothing after these falls through
+static bool ends_block(int op) {
+    return op == OP_JMP || op == OP_RET || op == OP_HLT;
+}
+
+static int label_address(const Opt_t *o, int ref) {
+    return o->a->r->labels[ref - 1].address;
+}
+
+// Words may only move if every address that reaches into the code is a label
+static bool opt_safe(Opt_t *o) {
+    ec72_asm_opt_t *rep = &o->a->r->opt;
+    if (o->a->data_position >= 0) {
+        // Data may be anything, including words that look like code
+        rep->skipped = "data words (DW)";
+        rep->skipped_position = o->a->data_position;
+        return false;
+    }
+    for (size_t i = 0; i < o->n; i++) {
+        int op = EC72_OPCODE(o->words[i]);
+        if (o->ref[i] && !is_branch(op)) {
+            rep->skipped = "label used as a value";
+        } else if (!o->ref[i] && (is_branch(op) || is_memory(op)) && EC72_OPERAND(o->words[i]) < o->n) {
+            rep->skipped = "numeric address inside the program";
+        } else {
+            continue;
+        }
+        rep->skipped_position = o->pos[i];
+        return false;
+    }
+    return true;
+}
+
+// Drops the dead words, moves each label to the next word that survives
+// and marks the words a referenced label lands on
+static void compact(Opt_t *o) {
+    ec72_asm_result_t *r = o->a->r;
+    size_t n = 0;
+    for (size_t i = 0; i < o->n; i++) {
+        o->work[i] = (int)n;        // new index of word i (or of the next survivor)
+        if (o->dead[i]) continue;
+        o->words[n] = o->words[i];
+        o->ref[n] = o->ref[i];
+        o->pos[n] = o->pos[i];
+        n++;
+    }
+    o->work[o->n] = (int)n;
+    for (size_t l = 0; l < r->label_count; l++) {
+        r->labels[l].address = o->work[r->labels[l].address];
+    }
+    o->n = n;
+    memset(o->dead, 0, n * sizeof(bool));
+    memset(o->target, 0, (n + 1) * sizeof(bool));
+    for (size_t i = 0; i < n; i++) {
+        if (o->ref[i]) o->target[label_address(o, o->ref[i])] = true;
+    }
+}
+
+// Branches to a JMP go straight to where that JMP goes
+static size_t thread_jumps(Opt_t *o) {
+    size_t changed = 0;
+    for (size_t i = 0; i < o->n; i++) {
+        if (!o->ref[i]) continue;
+        int ref = o->ref[i], hops = 0;
+        for (;;) {
+            int t = label_address(o, ref);
+            if ((size_t)t >= o->n || EC72_OPCODE(o->words[t]) != OP_JMP || !o->ref[t]) break;
+            if (++hops > OPT_MAX_HOPS) break;
+            ref = o->ref[t];
+        }
+        // A JMP loop has no end to thread to
+        if (hops > OPT_MAX_HOPS || ref == o->ref[i]) continue;
+        o->ref[i] = ref;
+        changed++;
+    }
+    return changed;
+}
+
+// A JMP to the word after it does nothing
+static size_t drop_jumps_to_next(Opt_t *o) {
+    size_t changed = 0;
+    for (size_t i = 0; i < o->n; i++) {
+        if (EC72_OPCODE(o->words[i]) == OP_JMP && (size_t)label_address(o, o->ref[i]) == i + 1) {
+            o->dead[i] = true;
+            changed++;
+        }
+    }
+    return changed;
+}
+
+// True if nothing reachable from start reads or moves SP itself, so the
+// code behaves the same one stack frame higher
+static bool frame_free(Opt_t *o, int start) {
+    size_t top = 0;
+    bool safe = true;
+    memset(o->seen, 0, o->n * sizeof(bool));
+    o->work[top++] = start;
+    while (top && safe) {
+        int i = o->work[--top];
+        if ((size_t)i >= o->n || o->seen[i]) continue;
+        o->seen[i] = true;
+        int op = EC72_OPCODE(o->words[i]);
+        int operand = EC72_OPERAND(o->words[i]);
+        switch (op) {
+            case OP_MOVR:
+                safe = (operand >> 4) != REG_SP && (operand & 0x0F) != REG_SP;
+                break;
+            case OP_PUSH: case OP_POP: case OP_ADDR: case OP_SUBR: case OP_MUL:
+                safe = operand != REG_SP;
+                break;
+            case OP_ADDSP: case OP_SUBSP: case OP_SSTOF: case OP_SSTUF:
+                safe = false;
+                break;
+            default:
+                break;
+        }
+        if (is_branch(op)) {
+            if (!o->ref[i]) safe = false;
+            else o->work[top++] = label_address(o, o->ref[i]);
+        }
+        if (!ends_block(op)) o->work[top++] = i + 1;
+    }
+    return safe;
+}
+
+// CALL L; RET -> JMP L: L's RET then returns straight to our caller
+static size_t tail_calls(Opt_t *o) {
+    size_t changed = 0;
+    for (size_t i = 0; i + 1 < o->n; i++) {
+        if (EC72_OPCODE(o->words[i]) != OP_CALL || EC72_OPCODE(o->words[i + 1]) != OP_RET) continue;
+        if (!frame_free(o, label_address(o, o->ref[i]))) continue;
+        o->words[i] = EC72_WORD(OP_JMP, EC72_OPERAND(o->words[i]));
+        changed++;
+    }
+    return changed;
+}
+
+// Words after JMP/RET/HLT that no referenced label leads to
+static size_t drop_unreachable(Opt_t *o) {
+    size_t changed = 0;
+    bool reached = true;
+    for (size_t i = 0; i < o->n; i++) {
+        if (o->target[i]) reached = true;
+        if (!reached) {
+            o->dead[i] = true;
+            changed++;
+            continue;
+        }
+        if (ends_block(EC72_OPCODE(o->words[i]))) reached = false;
+    }
+    return changed;
+}
+
+// LDIMx of a value the register is known to hold. Values are followed
+// through straight-line code only: a referenced label or a CALL forgets them.
+static size_t drop_reloads(Opt_t *o) {
+    size_t changed = 0;
+    int known[REG_SP + 1];
+    for (int k = 0; k <= REG_SP; k++) known[k] = -1;
+    for (size_t i = 0; i < o->n; i++) {
+        if (o->target[i]) {
+            for (int k = 0; k <= REG_SP; k++) known[k] = -1;
+        }
+        int op = EC72_OPCODE(o->words[i]);
+        int operand = EC72_OPERAND(o->words[i]);
+        switch (op) {
+            case OP_LDIMA: case OP_LDIMB: case OP_LDIMC: case OP_LDIME: {
+                int reg = REG_A + (op - OP_LDIMA);
+                if (known[reg] == operand) {
+                    o->dead[i] = true;
+                    changed++;
+                }
+                known[reg] = operand;
+                break;
+            }
+            case OP_MOVR: {
+                int dest = operand >> 4, src = operand & 0x0F;
+                if (dest >= REG_A && dest <= REG_E && src >= REG_A && src <= REG_SP)
+                    known[dest] = src == REG_SP ? -1 : known[src];
+                break;
+            }
+            case OP_MOVA: case OP_MOVA_PTRB: case OP_FLD:
+                known[REG_A] = -1;
+                break;
+            case OP_MOVB: known[REG_B] = -1; break;
+            case OP_MOVC: known[REG_C] = -1; break;
+            case OP_MOVE: known[REG_E] = -1; break;
+            case OP_ADD:
+                if (known[REG_A] >= 0) known[REG_A] = (known[REG_A] + operand) & 0xFF;
+                break;
+            case OP_SUB:
+                if (known[REG_A] >= 0) known[REG_A] = (known[REG_A] - operand) & 0xFF;
+                break;
+            case OP_ADDR: case OP_SUBR: case OP_XCHG: case OP_CAS: case OP_BCMP:
+                known[REG_A] = -1;
+                break;
+            case OP_LDID:
+                known[REG_A] = known[REG_B] = -1;
+                break;
+            case OP_MUL:
+                known[REG_A] = known[REG_E] = -1;
+                break;
+            case OP_POP:
+                if (operand <= REG_SP) known[operand] = -1;
+                break;
+            case OP_CALL: case OP_JMP: case OP_RET: case OP_HLT:
+                for (int k = 0; k <= REG_SP; k++) known[k] = -1;
+                break;
+            default:
+                break;
+        }
+    }
+    return changed;
+}
+
+// True if the flags set by word i are overwritten before anything can
+// look at them: a conditional jump, a label, a call, the end, or an
+// instruction that may stop the program with the flags on show
+static bool flags_dead_after(const Opt_t *o, size_t i) {
+    for (size_t k = i + 1; k < o->n; k++) {
+        if (o->target[k]) return false;
+        int op = EC72_OPCODE(o->words[k]);
+        int operand = EC72_OPERAND(o->words[k]);
+        switch (op) {
+            case OP_ADD: case OP_SUB: case OP_BCMP:
+                return true;
+            case OP_ADDR: case OP_SUBR: case OP_MUL:
+                return operand >= REG_A && operand <= REG_SP;
+            case OP_MOVR: case OP_MOVA: case OP_MOVB: case OP_MOVC: case OP_MOVE:
+            case OP_STORA: case OP_STORB: case OP_STORC: case OP_STORE:
+            case OP_LDIMA: case OP_LDIMB: case OP_LDIMC: case OP_LDIME:
+            case OP_MOVA_PTRB: case OP_STORA_PTRB: case OP_OUT: case OP_SSTOF: case OP_SSTUF:
+            case OP_SBANK: case OP_SMAR: case OP_FLD: case OP_FST: case OP_BCOPY: case OP_BFILL:
+                continue;
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+// ADD/SUB immediate chains become one (mod 256), ADD/SUB 0 goes, as long
+// as no one sees the flags in between
+static size_t fold_arith(Opt_t *o) {
+    size_t changed = 0;
+    for (size_t i = 0; i < o->n; i++) {
+        int op = EC72_OPCODE(o->words[i]);
+        if (op != OP_ADD && op != OP_SUB) continue;
+        int delta = op == OP_ADD ? EC72_OPERAND(o->words[i]) : -EC72_OPERAND(o->words[i]);
+        int next = i + 1 < o->n ? EC72_OPCODE(o->words[i + 1]) : 0;
+
+        if ((next == OP_ADD || next == OP_SUB) && !o->target[i + 1]) {
+            // The second one's flags are the only ones left
+            if (!flags_dead_after(o, i + 1)) continue;
+            int b = EC72_OPERAND(o->words[i + 1]);
+            int sum = (delta + (next == OP_ADD ? b : -b)) & 0xFF;
+            o->dead[i] = true;
+            if (sum == 0) o->dead[i + 1] = true;
+            else if (op == OP_SUB && next == OP_SUB) o->words[i + 1] = EC72_WORD(OP_SUB, -sum & 0xFF);
+            else o->words[i + 1] = EC72_WORD(OP_ADD, sum);
+            changed++;
+            i++;
+        } else if (delta == 0 && flags_dead_after(o, i)) {
+            o->dead[i] = true;
+            changed++;
+        }
+    }
+    return changed;
+}
+
+// Returns false only when out of memory
+static bool optimize(Asm_t *a) {
+    ec72_asm_result_t *r = a->r;
+    ec72_asm_opt_t *rep = &r->opt;
+    rep->words_before = rep->words_after = r->word_count;
+
+    Opt_t opt = { .a = a, .words = r->words, .ref = a->word_ref, .pos = a->word_pos, .n = r->word_count }, *o = &opt;
+    if (!o->n) {
+        rep->applied = true;
+        return true;
+    }
+    if (!opt_safe(o)) return true;
+
+    o->target = calloc(o->n + 1, sizeof(bool));
+    o->dead = calloc(o->n + 1, sizeof(bool));
+    o->seen = calloc(o->n + 1, sizeof(bool));
+    o->work = malloc((2 * o->n + 2) * sizeof(int));     // walk stack holds up to two entries per word
+    bool ok = o->target && o->dead && o->seen && o->work;
+    if (ok) {
+        compact(o);
+        for (int round = 0; round < OPT_MAX_ROUNDS; round++) {
+            size_t before = rep->threaded + rep->tail_calls + rep->unreachable +
+                            rep->jumps_removed + rep->loads_removed + rep->folded;
+            rep->threaded += thread_jumps(o);
+            compact(o);
+            rep->tail_calls += tail_calls(o);
+            rep->unreachable += drop_unreachable(o);
+            compact(o);
+            rep->jumps_removed += drop_jumps_to_next(o);
+            compact(o);
+            rep->loads_removed += drop_reloads(o);
+            compact(o);
+            rep->folded += fold_arith(o);
+            compact(o);
+            if (rep->threaded + rep->tail_calls + rep->unreachable +
+                rep->jumps_removed + rep->loads_removed + rep->folded == before) break;
+        }
+        // Labels have their final addresses; put them into the operands
+        for (size_t i = 0; i < o->n; i++) {
+            if (o->ref[i]) o->words[i] = EC72_WORD(EC72_OPCODE(o->words[i]), label_address(o, o->ref[i]));
+        }
+        r->word_count = rep->words_after = o->n;
+        rep->applied = true;
+        DEBUG_PRINT("%sOptimized %zu -> %zu words%s", YELLOW, rep->words_before, rep->words_after, RESETCOLOR);
+    }
+    free(o->target);
+    free(o->dead);
+    free(o->seen);
+    free(o->work);
+    return ok;
+}
+
+bool ec72_asm_assemble(const char *source, size_t len, unsigned flags, ec72_asm_result_t *r) {
+    memset(r, 0, sizeof(*r));
+    r->opt.skipped_position = -1;
+
+    Asm_t asm_state = {0}, *a = &asm_state;
+    a->r = r;
+    a->debug = (flags & EC72_ASM_DEBUG) != 0;
+    a->data_position = -1;
+    // Per call, so concurrent assemblies share nothing writable
+    for (size_t i = 0; i < sizeof(opcode_table)/sizeof(opcode_table[0]); i++) {
+        size_t slot = hash_name(opcode_table[i].name) & (OPCODE_INDEX_SIZE - 1);
+        while (a->opcode_index[slot]) slot = (slot + 1) & (OPCODE_INDEX_SIZE - 1);
+        a->opcode_index[slot] = (uint8_t)(i + 1);
+    }
+
+    // Lines are split and tokenized in a private copy
+    char *text = malloc(len + 1);
+    if (!text) {
+        diag(a, EC72_ASM_OUT_OF_MEMORY, 0, 0, NULL);
+        return false;
+    }
+    memcpy(text, source, len);
+    text[len] = '\0';
+
+    // Single pass: every line is assembled as soon as it is split off.
+    // Operands naming a label that is not defined yet get a fixup and are
+    // patched once all lines are done.
+    for (char *line = text; line && *line && !a->oom; ) {
+        char *nl = strchr(line, '\n');
+        if (nl) *nl = '\0';
+        a->line_no++;
+        strip_comment(line);
+        char *s = trim(line);
+        if (*s) assemble_line(a, s);
+        line = nl ? nl + 1 : NULL;
+    }
+    free(text);
+    free(a->line.tok);
+
+    // Forward references
+    for (size_t f = 0; f < a->fixup_count && !a->oom; f++) {
+        Fixup_t *fix = &a->fixups[f];
+        int entry = find_label(a, fix->name);
+        if (!entry) {
+            diag(a, EC72_ASM_UNDEFINED_LABEL, fix->position, fix->line, fix->name);
+            continue;
+        }
+        uint8_t v = (uint8_t)r->labels[entry - 1].address;
+        r->words[fix->word] = (r->words[fix->word] & 0xFF00) | v;
+        a->word_ref[fix->word] = entry;
+        DEBUG_PRINT("%sFixup word %d -> '%s' = 0x%02X%s", YELLOW, fix->word, fix->name, v, RESETCOLOR);
+    }
+    free(a->fixups);
+    free(a->label_index);
+
+    if (a->oom) diag(a, EC72_ASM_OUT_OF_MEMORY, a->position, a->line_no, NULL);
+    if ((flags & EC72_ASM_OPTIMIZE) && r->diag_count == 0) {
+        if (!optimize(a)) diag(a, EC72_ASM_OUT_OF_MEMORY, a->position, a->line_no, NULL);
+    }
+    free(a->word_ref);
+    free(a->word_pos);
+    return r->diag_count == 0;
+}
+
+bool ec72_asm_assemble_file(const char *path, unsigned flags, ec72_asm_result_t *r) {
+    FILE *f = fopen(path, "rb");
+    char *text = NULL;
+    size_t len = 0, cap = 0;
+    bool failed = !f;
+    while (!failed) {
+        if (len == cap) {
+            char *grown = grow(text, &cap, 1);
+            if (!grown) {
+                failed = true;
+                break;
+            }
+            text = grown;
+        }
+        size_t n = fread(text + len, 1, cap - len, f);
+        len += n;
+        if (n == 0) {
+            failed = ferror(f);
+            break;
+        }
+    }
+    if (f) fclose(f);
+
+    bool ok = false;
+    if (!failed) {
+        ok = ec72_asm_assemble(text, len, flags, r);
+    } else {
+        memset(r, 0, sizeof(*r));
+        r->diags = calloc(1, sizeof(ec72_asm_diag_t));
+        if (r->diags) {
+            r->diags[0].error = EC72_ASM_IO;
+            snprintf(r->diags[0].token, sizeof(r->diags[0].token), "%s", path);
+            r->diag_count = 1;
+        }
+    }
+    free(text);
+    return ok;
+}
+
+void ec72_asm_result_free(ec72_asm_result_t *r) {
+    for (Arena_Block_t *b = r->internal, *next; b; b = next) {
+        next = b->next;
+        free(b);
+    }
+    free(r->words);
+    free(r->labels);
+    free(r->diags);
+    memset(r, 0, sizeof(*r));
+}
+
+const char *ec72_asm_error_str(ec72_asm_error_t error) {
+    switch (error) {
+        case EC72_ASM_UNKNOWN_OPCODE: return "Unknown opcode";
+        case EC72_ASM_UNSUPPORTED_OPCODE: return "Unsupported opcode";
+        case EC72_ASM_INVALID_REGISTER: return "Invalid register";
+        case EC72_ASM_MISSING_OPERAND: return "Missing operand";
+        case EC72_ASM_MISSING_REGISTER: return "Missing register operand";
+        case EC72_ASM_MOVR_OPERANDS: return "MOVR needs two registers";
+        case EC72_ASM_UNDEFINED_LABEL: return "Undefined label";
+        case EC72_ASM_OUT_OF_MEMORY: return "Out of memory";
+        case EC72_ASM_IO: return "Cannot read source";
+        default: return "Unknown error";
+    }
+}
+
+void ec72_asm_print_opt(const ec72_asm_result_t *r, FILE *f) {
+    const ec72_asm_opt_t *o = &r->opt;
+    if (!o->applied) {
+        fprintf(f, "%sNot optimized: %s", YELLOW, o->skipped ? o->skipped : "assembly failed");
+        if (o->skipped_position >= 0) fprintf(f, " at Position %d", o->skipped_position);
+        fprintf(f, "%s\n", RESETCOLOR);
+        return;
+    }
+    size_t saved = o->words_before - o->words_after;
+    fprintf(f, "%sOptimized: %zu -> %zu instructions (%zu -> %zu bytes, -%zu)%s\n", CYAN,
+            o->words_before, o->words_after, 2 * o->words_before, 2 * o->words_after, saved, RESETCOLOR);
+    fprintf(f, "  branches threaded   %zu\n", o->threaded);
+    fprintf(f, "  tail calls          %zu\n", o->tail_calls);
+    fprintf(f, "  unreachable removed %zu\n", o->unreachable);
+    fprintf(f, "  jumps to next       %zu\n", o->jumps_removed);
+    fprintf(f, "  reloads removed     %zu\n", o->loads_removed);
+    fprintf(f, "  ADD/SUB folded      %zu\n", o->folded);
+}
+
+void ec72_asm_print_diags(const ec72_asm_result_t *r, FILE *f) {
+    for (size_t i = 0; i < r->diag_count; i++) {
+        const ec72_asm_diag_t *d = &r->diags[i];
+        const char *msg = ec72_asm_error_str(d->error);
+        if (d->error == EC72_ASM_INVALID_REGISTER)
+            fprintf(f, RED "Error: Invalid register '%s' at line %d\n" RESETCOLOR, d->token, d->position);
+        else if (d->error == EC72_ASM_IO)
+            fprintf(f, "%sError: %s '%s'%s\n", RED, msg, d->token, RESETCOLOR);
+        else if (d->token[0])
+            fprintf(f, "%sError: %s at Position %d near '%s'%s\n", RED, msg, d->position, d->token, RESETCOLOR);
+        else
+            fprintf(f, "%sError: %s at line %d%s\n", RED, msg, d->position, RESETCOLOR);
+    }
+}
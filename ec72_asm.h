@@ -0,0 +1,85 @@
+//Copyright © Martin H. Sharp; August 2025
+// EC72 assembler as a library: assembles source text held in memory into
+// program words. Nothing is printed and nothing exits; errors come back as
+// diagnostics in the result, and one call is independent of any other, so
+// threads can assemble side by side.
+#ifndef EC72_ASM_H
+#define EC72_ASM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    EC72_ASM_UNKNOWN_OPCODE = 1,
+    EC72_ASM_UNSUPPORTED_OPCODE,
+    EC72_ASM_INVALID_REGISTER,
+    EC72_ASM_MISSING_OPERAND,
+    EC72_ASM_MISSING_REGISTER,
+    EC72_ASM_MOVR_OPERANDS,     // MOVR needs two registers
+    EC72_ASM_UNDEFINED_LABEL,
+    EC72_ASM_OUT_OF_MEMORY,
+    EC72_ASM_IO                 // source file could not be read
+} ec72_asm_error_t;
+
+#define EC72_ASM_TOKEN_LEN 64
+
+typedef struct {
+    ec72_asm_error_t error;
+    int position;               // index of the non-empty source line
+    int line;                   // 1-based source line
+    char token[EC72_ASM_TOKEN_LEN];     // offending token, "" if none
+} ec72_asm_diag_t;
+
+typedef struct {
+    const char *name;
+    int address;
+} ec72_asm_label_t;
+
+// Option bits for ec72_asm_assemble
+#define EC72_ASM_DEBUG    1u    // log every token, label and operand to stderr
+#define EC72_ASM_OPTIMIZE 2u    // peephole pass after label resolution (-O)
+
+// What the peephole pass did. It only runs on programs it can prove are
+// safe to move around: no label used as a value and no numeric jump or
+// memory address pointing into the code; otherwise skipped says why.
+typedef struct {
+    bool applied;
+    const char *skipped;        // reason the pass did not run, NULL if it did
+    int skipped_position;       // source position that stopped it, -1 if none
+    size_t words_before, words_after;
+    size_t threaded;            // branches sent straight to a JMP's target
+    size_t tail_calls;          // CALL L; RET -> JMP L
+    size_t unreachable;         // words after JMP/RET/HLT that nothing reaches
+    size_t jumps_removed;       // JMP to the next instruction
+    size_t loads_removed;       // LDIMx of a value the register already holds
+    size_t folded;              // ADD/SUB merged or dropped while flags are dead
+} ec72_asm_opt_t;
+
+typedef struct {
+    uint16_t *words;
+    size_t word_count;
+    ec72_asm_label_t *labels;   // in order of definition
+    size_t label_count;
+    ec72_asm_diag_t *diags;
+    size_t diag_count;
+    ec72_asm_opt_t opt;         // filled in with EC72_ASM_OPTIMIZE
+
+    void *internal;             // storage for label names
+} ec72_asm_result_t;
+
+// Assembles len bytes of source (need not be NUL-terminated). Returns true
+// if there were no errors; the result must be freed either way. flags is a
+// mix of EC72_ASM_DEBUG and EC72_ASM_OPTIMIZE (0 for a plain assembly).
+bool ec72_asm_assemble(const char *source, size_t len, unsigned flags, ec72_asm_result_t *r);
+bool ec72_asm_assemble_file(const char *path, unsigned flags, ec72_asm_result_t *r);
+void ec72_asm_result_free(ec72_asm_result_t *r);
+
+const char *ec72_asm_error_str(ec72_asm_error_t error);
+// One line per diagnostic, worded like the command line assembler
+void ec72_asm_print_diags(const ec72_asm_result_t *r, FILE *f);
+// Before/after sizes and what each peephole rule removed
+void ec72_asm_print_opt(const ec72_asm_result_t *r, FILE *f);
+
+#endif
@@ -0,0 +1,311 @@
+//Copyright © Martin H. Sharp; August 2025
+// EC72BATCH: runs every .bin/.ec72img image (or .ec72asm source) of a directory, or
+// a number of generated programs, on all cores, one ec72_cpu_t context per
+// worker thread, and reports aggregate throughput. Sources are assembled in
+// memory by the workers; generated programs never touch the filesystem.
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "ec72_cpu.h"
+#include "ec72_asm.h"
+#include "ec72_image.h"
+
+#define RED     "\x1b[31m"
+#define GREEN   "\x1b[32m"
+#define YELLOW  "\x1b[33m"
+#define CYAN    "\x1b[36m"
+#define RESET   "\x1b[0m"
+
+#define DEFAULT_BUDGET 10000000ULL
+
+typedef struct {
+    char *path;
+    char *source;               // assembly source, NULL for an image
+    size_t source_len;
+    uint16_t words[EC72_MEM_SIZE];
+    size_t word_count;
+    uint8_t entry, stofr, stufr;
+    bool asm_failed;
+
+    // Results
+    ec72_status_t status;
+    uint64_t instructions;
+    uint64_t out_count;
+    uint32_t out_hash;          // FNV-1a over all OUT values
+} Job_t;
+
+typedef struct {
+    Job_t *jobs;
+    size_t job_count;
+    size_t next;                // shared work index
+    uint64_t budget;
+    ec72_engine_t engine;
+} Pool_t;
+
+static void record_out(void *user, uint8_t value) {
+    Job_t *job = user;
+    job->out_count++;
+    job->out_hash = (job->out_hash ^ value) * 16777619u;
+}
+
+static void *worker(void *arg) {
+    Pool_t *pool = arg;
+    ec72_cpu_t cpu;
+    ec72_cpu_init(&cpu);
+    ec72_cpu_set_engine(&cpu, pool->engine);
+
+    for (;;) {
+        size_t i = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+        if (i >= pool->job_count) break;
+        Job_t *job = &pool->jobs[i];
+
+        if (job->source) {
+            ec72_asm_result_t r;
+            job->asm_failed = !ec72_asm_assemble(job->source, job->source_len, 0, &r);
+            job->word_count = r.word_count < EC72_MEM_SIZE ? r.word_count : EC72_MEM_SIZE;
+            if (!job->asm_failed) memcpy(job->words, r.words, job->word_count * sizeof(uint16_t));
+            ec72_asm_result_free(&r);
+            if (job->asm_failed) continue;
+        }
+
+        job->out_hash = 2166136261u;
+        ec72_cpu_set_output(&cpu, record_out, job);
+        ec72_cpu_load_words(&cpu, job->words, job->word_count);
+        if (!job->source) ec72_cpu_set_start(&cpu, job->entry, job->stofr, job->stufr);
+        job->status = ec72_cpu_run(&cpu, pool->budget);
+        job->instructions = cpu.retired;
+    }
+    ec72_cpu_fini(&cpu);
+    return NULL;
+}
+
+static bool has_suffix(const char *s, const char *suffix) {
+    size_t ls = strlen(s), lx = strlen(suffix);
+    return ls >= lx && strcmp(s + ls - lx, suffix) == 0;
+}
+
+static int cmp_jobs(const void *a, const void *b) {
+    return strcmp(((const Job_t *)a)->path, ((const Job_t *)b)->path);
+}
+
+// Read all images up front so that the timed section only measures execution
+static Job_t *collect_jobs(const char *dir, size_t *count) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        perror("Error opening directory");
+        return NULL;
+    }
+    size_t cap = 64, n = 0;
+    Job_t *jobs = malloc(cap * sizeof(Job_t));
+    struct dirent *e;
+    while (jobs && (e = readdir(d)) != NULL) {
+        bool is_source = has_suffix(e->d_name, ".ec72asm");
+        if (!is_source && !has_suffix(e->d_name, ".bin") && !has_suffix(e->d_name, ".ec72img")) continue;
+        if (n == cap) {
+            cap *= 2;
+            Job_t *grown = realloc(jobs, cap * sizeof(Job_t));
+            if (!grown) { free(jobs); jobs = NULL; break; }
+            jobs = grown;
+        }
+        Job_t *job = &jobs[n];
+        memset(job, 0, sizeof(*job));
+        job->path = malloc(strlen(dir) + strlen(e->d_name) + 2);
+        sprintf(job->path, "%s/%s", dir, e->d_name);
+
+        if (is_source) {
+            FILE *f = fopen(job->path, "rb");
+            if (!f) {
+                fprintf(stderr, "%sSkipping %s: cannot open%s\n", YELLOW, job->path, RESET);
+                free(job->path);
+                continue;
+            }
+            fseek(f, 0, SEEK_END);
+            long size = ftell(f);
+            rewind(f);
+            job->source = malloc(size > 0 ? (size_t)size : 1);
+            job->source_len = job->source ? fread(job->source, 1, (size_t)(size > 0 ? size : 0), f) : 0;
+            fclose(f);
+        } else {
+            // Images and raw .bin files, mapped
+            ec72_image_t img;
+            if (!ec72_image_load(&img, job->path)) {
+                fprintf(stderr, "%sSkipping %s: %s%s\n", YELLOW, job->path, img.error ? img.error : "cannot open", RESET);
+                free(job->path);
+                continue;
+            }
+            memcpy(job->words, img.words, img.word_count * sizeof(uint16_t));
+            job->word_count = img.word_count;
+            job->entry = img.entry;
+            job->stofr = img.stofr;
+            job->stufr = img.stufr;
+            ec72_image_free(&img);
+        }
+        n++;
+    }
+    closedir(d);
+    if (jobs) qsort(jobs, n, sizeof(Job_t), cmp_jobs);
+    *count = n;
+    return jobs;
+}
+
+static uint64_t gen_state;
+static unsigned gen_next(unsigned range) {
+    gen_state ^= gen_state << 13;
+    gen_state ^= gen_state >> 7;
+    gen_state ^= gen_state << 17;
+    return (unsigned)(gen_state % range);
+}
+
+// A counted loop around a random body; always assembles and halts
+static char *generate_source(size_t index, size_t *len) {
+    size_t cap = 4096, n = 0;
+    char *src = malloc(cap);
+    if (!src) return NULL;
+#define EMIT(...) (n += (size_t)snprintf(src + n, cap - n, __VA_ARGS__))
+    EMIT("; generated program %zu\n", index);
+    EMIT("        SSTOF 128\n        LDIMA %u\n        STORA 0xF0\nLOOP:\n", 1 + gen_next(50));
+    for (unsigned k = 3 + gen_next(10); k > 0; k--) {
+        switch (gen_next(9)) {
+            case 0: EMIT("        LDIMB %u\n", gen_next(256)); break;
+            case 1: EMIT("        ADD %u\n", gen_next(256)); break;
+            case 2: EMIT("        SUB 0x%02X\n", gen_next(256)); break;
+            case 3: EMIT("        MOVR RC, RA\n        ADDR RB\n"); break;
+            case 4: EMIT("        OUT\n"); break;
+            case 5: EMIT("        PUSH RA\n        POP RB\n"); break;
+            case 6: EMIT("        CALL FUNC\n"); break;
+            case 7: EMIT("        STORA 0x%02X\n", 0xE0 + gen_next(16)); break;
+            default: EMIT("        MOVA 0x%02X\n", 0xE0 + gen_next(16)); break;
+        }
+    }
+    EMIT("        MOVA 0xF0\n        SUB 1\n        STORA 0xF0\n        JMPZ DONE\n        JMP LOOP\n");
+    EMIT("DONE:\n        HLT\nFUNC:\n        ADD 3\n        RET\n");
+#undef EMIT
+    *len = n;
+    return src;
+}
+
+static Job_t *generate_jobs(size_t count, uint64_t seed) {
+    Job_t *jobs = calloc(count, sizeof(Job_t));
+    if (!jobs) return NULL;
+    gen_state = seed ? seed : 1;
+    for (size_t i = 0; i < count; i++) {
+        jobs[i].path = malloc(32);
+        snprintf(jobs[i].path, 32, "generated-%zu", i);
+        jobs[i].source = generate_source(i, &jobs[i].source_len);
+    }
+    return jobs;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <directory>|-g count [-seed n] [-j threads] [-n max_instructions] [-e engine] [-v]\n", argv[0]);
+        return 1;
+    }
+
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    uint64_t budget = DEFAULT_BUDGET;
+    bool verbose = false;
+    ec72_engine_t engine = EC72_ENGINE_SWITCH;
+
+    const char *dir = NULL;
+    size_t generate = 0;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            generate = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            budget = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            if (!ec72_engine_from_name(argv[++i], &engine)) {
+                fprintf(stderr, "Unknown engine: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (argv[i][0] != '-' && !dir) {
+            dir = argv[i];
+        } else {
+            fprintf(stderr, "Unknown flag: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+
+    if (!dir && !generate) {
+        fprintf(stderr, "%sNo directory and no -g count given%s\n", RED, RESET);
+        return 1;
+    }
+
+    size_t job_count = generate;
+    Job_t *jobs = generate ? generate_jobs(generate, seed) : collect_jobs(dir, &job_count);
+    if (!jobs) return 1;
+    if (job_count == 0) {
+        fprintf(stderr, "%sNo .bin/.ec72img images or .ec72asm sources found in %s%s\n", RED, dir, RESET);
+        free(jobs);
+        return 1;
+    }
+    if ((size_t)threads > job_count) threads = (long)job_count;
+
+    Pool_t pool = { jobs, job_count, 0, budget, engine };
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+
+    double start = now_seconds();
+    for (long t = 0; t < threads; t++) pthread_create(&tids[t], NULL, worker, &pool);
+    for (long t = 0; t < threads; t++) pthread_join(tids[t], NULL);
+    double elapsed = now_seconds() - start;
+
+    uint64_t total_instr = 0;
+    size_t per_status[EC72_ERR_IO + 1] = {0};
+    size_t asm_failed = 0;
+    for (size_t i = 0; i < job_count; i++) {
+        Job_t *job = &jobs[i];
+        if (job->asm_failed) {
+            asm_failed++;
+            if (verbose) printf("%s: %sassembly failed%s\n", job->path, RED, RESET);
+            continue;
+        }
+        total_instr += job->instructions;
+        per_status[job->status]++;
+        if (verbose) {
+            printf("%s: %s after %llu instructions, %llu OUT (hash %08X)\n", job->path,
+                   ec72_status_str(job->status), (unsigned long long)job->instructions,
+                   (unsigned long long)job->out_count, job->out_hash);
+        }
+    }
+
+    printf("%sRan %zu programs on %ld threads (%s engine) in %.3f s%s\n", CYAN, job_count, threads,
+           ec72_engine_name(engine), elapsed, RESET);
+    for (int s = 0; s <= EC72_ERR_IO; s++) {
+        if (per_status[s]) printf("  %-16s %zu\n", ec72_status_str((ec72_status_t)s), per_status[s]);
+    }
+    if (asm_failed) printf("  %-16s %zu\n", "assembly failed", asm_failed);
+    if (elapsed > 0) {
+        printf("%s%llu instructions, %.2f MIPS, %.1f programs/s%s\n", GREEN,
+               (unsigned long long)total_instr, total_instr / elapsed / 1e6, job_count / elapsed, RESET);
+    }
+
+    for (size_t i = 0; i < job_count; i++) {
+        free(jobs[i].path);
+        free(jobs[i].source);
+    }
+    free(jobs);
+    free(tids);
+    return 0;
+}
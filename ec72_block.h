@@ -0,0 +1,85 @@
+//Copyright © Martin H. Sharp; August 2025
+// Block instructions on the host: BCOPY, BFILL and BCMP work on RE words at
+// RB and RC. Addresses wrap past 0xFF like RB does, so a range can run from
+// the top of memory into address 0. BCOPY copies as if through a buffer, so
+// overlapping ranges (in either direction) end up like memmove().
+//
+// The ranges never move SP. Checked engines fault a BCOPY/BFILL whose
+// destination covers a pushed word (SP..STUFR-1, none while SP == STUFR)
+// or runs across STOFR (ec72_block_stack_check()); BCMP only reads and is
+// never checked. With an
+// I/O bus the window addresses in a range go to the devices
+// (ec72_bus_block_copy() and friends, ec72_bus.h). The helpers below are
+// plain memory and used by every engine, so they all store the same words.
+#ifndef EC72_BLOCK_H
+#define EC72_BLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_isa.h"
+#include "ec72_cpu.h"
+
+// True if count words at start (wrapping past 0xFF) cover an address in lo..hi
+static inline bool ec72_block_covers(uint8_t start, uint8_t count, int lo, int hi) {
+    if (count == 0 || lo > hi) return false;
+    int end = start + count;
+    return (start <= hi && end > lo) || end - EC72_MEM_SIZE > lo;
+}
+
+// Destination of count words at dst against the stack: STACK_UNDERFLOW if
+// it covers SP..STUFR-1 (what is pushed; PUSH stores at --SP, so the word
+// at STUFR never is), STACK_OVERFLOW if it runs across STOFR (partly in the
+// free stack STOFR..SP-1, partly outside STOFR..STUFR-1), else EC72_OK
+static inline ec72_status_t ec72_block_stack_check(uint8_t dst, uint8_t count, uint8_t sp, uint8_t stofr, uint8_t stufr) {
+    if (ec72_block_covers(dst, count, sp, stufr - 1)) return EC72_ERR_STACK_UNDERFLOW;
+    if (ec72_block_covers(dst, count, stofr, stufr - 1) &&
+        (ec72_block_covers(dst, count, 0, stofr - 1) || ec72_block_covers(dst, count, stufr, EC72_MEM_SIZE - 1)))
+        return EC72_ERR_STACK_OVERFLOW;
+    return EC72_OK;
+}
+
+// BCOPY: memory[dst + i] = memory[src + i] for i < count, whole words
+static inline void ec72_block_copy(uint16_t *memory, uint8_t dst, uint8_t src, uint8_t count) {
+    if (dst + count <= EC72_MEM_SIZE && src + count <= EC72_MEM_SIZE) {
+        memmove(memory + dst, memory + src, count * sizeof(uint16_t));
+        return;
+    }
+    uint16_t buf[EC72_MEM_SIZE];
+    for (int i = 0; i < count; i++) buf[i] = memory[(uint8_t)(src + i)];
+    for (int i = 0; i < count; i++) memory[(uint8_t)(dst + i)] = buf[i];
+}
+
+// BFILL: memory[dst + i] = value for i < count
+static inline void ec72_block_fill(uint16_t *memory, uint8_t dst, uint8_t value, uint8_t count) {
+    int first = count < EC72_MEM_SIZE - dst ? count : EC72_MEM_SIZE - dst;
+    if (value == 0) {
+        memset(memory + dst, 0, first * sizeof(uint16_t));
+        memset(memory, 0, (count - first) * sizeof(uint16_t));
+        return;
+    }
+    for (int i = 0; i < first; i++) memory[dst + i] = value;
+    for (int i = 0; i < count - first; i++) memory[i] = value;
+}
+
+// BCMP: low byte at a minus low byte at b for the first i < count where they
+// differ, 0 if none do; *at gets that i (count if none)
+static inline int ec72_block_compare(const uint16_t *memory, uint8_t a, uint8_t b, uint8_t count, uint8_t *at) {
+    // Equal words have equal low bytes
+    if (a + count <= EC72_MEM_SIZE && b + count <= EC72_MEM_SIZE &&
+        memcmp(memory + a, memory + b, count * sizeof(uint16_t)) == 0) {
+        *at = count;
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        uint8_t x = (uint8_t)memory[(uint8_t)(a + i)], y = (uint8_t)memory[(uint8_t)(b + i)];
+        if (x != y) {
+            *at = (uint8_t)i;
+            return x - y;
+        }
+    }
+    *at = count;
+    return 0;
+}
+
+#endif
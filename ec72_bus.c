@@ -0,0 +1,174 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include "ec72_bus.h"
+#ifndef _WIN32
+    #include <unistd.h>
+#endif
+
+bool ec72_bus_init(ec72_bus_t *bus, uint8_t base) {
+    memset(bus, 0, sizeof(*bus));
+    bus->base = base;
+    bus->tick = 1;
+    bus->fifo = malloc(EC72_BUS_FIFO_SIZE);
+    if (!bus->fifo) {
+        fprintf(stderr, "Out of memory for the input FIFO\n");
+        return false;
+    }
+    return true;
+}
+
+void ec72_bus_free(ec72_bus_t *bus) {
+    free(bus->fifo);
+    bus->fifo = NULL;
+}
+
+void ec72_bus_set_input(ec72_bus_t *bus, FILE *in) {
+    bus->in = in;
+    bus->eof = false;
+}
+
+size_t ec72_bus_feed(ec72_bus_t *bus, const void *data, size_t len) {
+    if (bus->head > 0 && bus->tail + len > EC72_BUS_FIFO_SIZE) {
+        memmove(bus->fifo, bus->fifo + bus->head, bus->tail - bus->head);
+        bus->tail -= bus->head;
+        bus->head = 0;
+    }
+    if (len > EC72_BUS_FIFO_SIZE - bus->tail) len = EC72_BUS_FIFO_SIZE - bus->tail;
+    memcpy(bus->fifo + bus->tail, data, len);
+    bus->tail += len;
+    return len;
+}
+
+void ec72_bus_clear_input(ec72_bus_t *bus) {
+    bus->head = bus->tail = 0;
+    bus->eof = false;
+}
+
+void ec72_bus_set_port(ec72_bus_t *bus, ec72_out_fn port, void *user) {
+    bus->port = port;
+    bus->port_user = user;
+}
+
+void ec72_bus_set_tick(ec72_bus_t *bus, uint64_t tick) {
+    bus->tick = tick ? tick : 1;
+}
+
+void ec72_bus_reset(ec72_bus_t *bus) {
+    bus->timer_start = 0;
+    bus->counter_start = 0;
+    bus->counter_load = 0;
+}
+
+// Called with the FIFO empty. One read of whatever the source has ready
+// (a pipe or terminal returns early), so streaming input costs one system
+// call per FIFO load instead of one per byte.
+static bool refill(ec72_bus_t *bus) {
+    if (!bus->in || bus->eof) return false;
+    bus->head = bus->tail = 0;
+#ifndef _WIN32
+    ssize_t got;
+    do {
+        got = read(fileno(bus->in), bus->fifo, EC72_BUS_FIFO_SIZE);
+    } while (got < 0 && errno == EINTR);
+#else
+    long got = (long)fread(bus->fifo, 1, EC72_BUS_FIFO_SIZE, bus->in);
+#endif
+    if (got <= 0) {
+        bus->eof = true;
+        return false;
+    }
+    bus->tail = (size_t)got;
+    return true;
+}
+
+uint8_t ec72_bus_read_device(ec72_bus_t *bus, uint8_t addr, uint64_t now) {
+    switch ((uint8_t)(addr - bus->base)) {
+        case EC72_BUS_IN:
+            if (bus->head == bus->tail && !refill(bus)) return 0;
+            bus->in_bytes++;
+            return bus->fifo[bus->head++];
+        case EC72_BUS_STATUS:
+            if (bus->head < bus->tail || refill(bus)) return EC72_BUS_READY;
+            return EC72_BUS_EOF;
+        case EC72_BUS_TIMER:
+            return (uint8_t)((now - bus->timer_start) / bus->tick);
+        case EC72_BUS_COUNTER: {
+            uint64_t gone = (now - bus->counter_start) / bus->tick;
+            return gone < bus->counter_load ? (uint8_t)(bus->counter_load - gone) : 0;
+        }
+        default:
+            return 0;
+    }
+}
+
+void ec72_bus_write(ec72_bus_t *bus, uint8_t addr, uint8_t value, uint64_t now) {
+    switch ((uint8_t)(addr - bus->base)) {
+        case EC72_BUS_PORT:
+            bus->port_bytes++;
+            if (bus->port) bus->port(bus->port_user, value);
+            break;
+        case EC72_BUS_TIMER:
+            bus->timer_start = now;
+            break;
+        case EC72_BUS_COUNTER:
+            bus->counter_start = now;
+            bus->counter_load = value;
+            break;
+        default:
+            break;
+    }
+}
+
+uint64_t ec72_bus_next_change(const ec72_bus_t *bus, uint8_t addr, uint64_t now) {
+    switch ((uint8_t)(addr - bus->base)) {
+        case EC72_BUS_TIMER:
+            return bus->timer_start + ((now - bus->timer_start) / bus->tick + 1) * bus->tick;
+        case EC72_BUS_COUNTER: {
+            uint64_t gone = (now - bus->counter_start) / bus->tick;
+            if (gone >= bus->counter_load) return UINT64_MAX;
+            return bus->counter_start + (gone + 1) * bus->tick;
+        }
+        default:
+            return UINT64_MAX;
+    }
+}
+
+void ec72_bus_block_copy(ec72_bus_t *bus, uint16_t *memory, uint8_t dst, uint8_t src, uint8_t count, uint64_t now) {
+    uint16_t buf[EC72_MEM_SIZE];
+    for (int i = 0; i < count; i++) {
+        uint8_t a = (uint8_t)(src + i);
+        buf[i] = ec72_bus_hit(bus, a) ? ec72_bus_read(bus, a, now) : memory[a];
+    }
+    for (int i = 0; i < count; i++) {
+        uint8_t a = (uint8_t)(dst + i);
+        if (ec72_bus_hit(bus, a)) ec72_bus_write(bus, a, (uint8_t)buf[i], now);
+        else memory[a] = buf[i];
+    }
+}
+
+void ec72_bus_block_fill(ec72_bus_t *bus, uint16_t *memory, uint8_t dst, uint8_t value, uint8_t count, uint64_t now) {
+    for (int i = 0; i < count; i++) {
+        uint8_t a = (uint8_t)(dst + i);
+        if (ec72_bus_hit(bus, a)) ec72_bus_write(bus, a, value, now);
+        else memory[a] = value;
+    }
+}
+
+int ec72_bus_block_compare(ec72_bus_t *bus, const uint16_t *memory, uint8_t a, uint8_t b, uint8_t count, uint8_t *at, uint64_t now) {
+    for (int i = 0; i < count; i++) {
+        uint8_t p = (uint8_t)(a + i), q = (uint8_t)(b + i);
+        uint8_t x = ec72_bus_hit(bus, p) ? ec72_bus_read(bus, p, now) : (uint8_t)memory[p];
+        uint8_t y = ec72_bus_hit(bus, q) ? ec72_bus_read(bus, q, now) : (uint8_t)memory[q];
+        if (x != y) {
+            *at = (uint8_t)i;
+            return x - y;
+        }
+    }
+    *at = count;
+    return 0;
+}
@@ -0,0 +1,127 @@
+//Copyright © Martin H. Sharp; August 2025
+// Memory-mapped I/O bus. EC72_BUS_WINDOW consecutive addresses starting at a
+// configurable base are routed to devices instead of memory for the data
+// accesses (MOV*, STOR*, MOVA_PTRB, STORA_PTRB, XCHG, CAS and the block
+// instructions):
+//   base+0  IN       read: next byte of the input FIFO, 0 once it is empty
+//   base+1  STATUS   read: bit 0 a byte is ready, bit 1 end of input
+//   base+2  PORT     write: byte to the output port
+//   base+3  TIMER    read: ticks since reset or the last write; write: restart
+//   base+4  COUNTER  write: load; read: ticks left, counts down to 0
+//   base+5..7        reserved, read 0, writes ignored
+// Instruction fetch and the stack always use plain memory, and memory under
+// the window is left alone. Timer and counter are not ticked per
+// instruction: they keep the time (instruction count, or cycle count with a
+// cycle model, ec72_cycles.h) at which they were written and work out their
+// value when read.
+//
+// Without a bus the engines run exactly as before. With one, the switch
+// engine takes a separate loop, the threaded engine binds fixed addresses
+// to device or memory handlers at decode time (only the RB-indexed
+// accesses and the block ranges test the window), and the JIT calls into
+// the bus from generated code for fixed device addresses, side exits to the
+// switch interpreter when MOVA_PTRB/STORA_PTRB find RB in the window, and
+// leaves XCHG, CAS and the block instructions to that interpreter as well.
+#ifndef EC72_BUS_H
+#define EC72_BUS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "ec72_cpu.h"
+
+#define EC72_BUS_WINDOW 8
+#define EC72_BUS_DEFAULT_BASE 0xF0
+
+// Register offsets inside the window
+#define EC72_BUS_IN      0
+#define EC72_BUS_STATUS  1
+#define EC72_BUS_PORT    2
+#define EC72_BUS_TIMER   3
+#define EC72_BUS_COUNTER 4
+
+// STATUS bits
+#define EC72_BUS_READY   0x01
+#define EC72_BUS_EOF     0x02
+
+#define EC72_BUS_FIFO_SIZE (1u << 16)
+
+typedef struct ec72_bus {
+    uint8_t base;
+    uint64_t tick;              // instructions (cycles) per timer/counter tick, >= 1
+
+    // Input FIFO: bytes fifo[head..tail), refilled in one read from in
+    // when it runs dry
+    FILE *in;                   // NULL: only what ec72_bus_feed() queued
+    uint8_t *fifo;
+    size_t head, tail;
+    bool eof;
+
+    ec72_out_fn port;           // NULL: PORT writes are discarded
+    void *port_user;
+
+    uint64_t timer_start;       // instruction count of the last restart
+    uint64_t counter_start;
+    uint8_t counter_load;
+
+    uint64_t in_bytes, port_bytes;
+} ec72_bus_t;
+
+// Returns false if the FIFO cannot be allocated
+bool ec72_bus_init(ec72_bus_t *bus, uint8_t base);
+void ec72_bus_free(ec72_bus_t *bus);
+
+void ec72_bus_set_input(ec72_bus_t *bus, FILE *in);
+// Queue bytes behind the current input; returns how many fit
+size_t ec72_bus_feed(ec72_bus_t *bus, const void *data, size_t len);
+// Drop what is queued; the source set by ec72_bus_set_input() stays
+void ec72_bus_clear_input(ec72_bus_t *bus);
+void ec72_bus_set_port(ec72_bus_t *bus, ec72_out_fn port, void *user);
+void ec72_bus_set_tick(ec72_bus_t *bus, uint64_t tick);
+// Timer and counter back to 0 (ec72_cpu_reset() does this); input stays
+void ec72_bus_reset(ec72_bus_t *bus);
+
+static inline bool ec72_bus_hit(const ec72_bus_t *bus, uint8_t addr) {
+    return (uint8_t)(addr - bus->base) < EC72_BUS_WINDOW;
+}
+
+// Device access at time now; addr must be inside the window
+uint8_t ec72_bus_read_device(ec72_bus_t *bus, uint8_t addr, uint64_t now);
+void ec72_bus_write(ec72_bus_t *bus, uint8_t addr, uint8_t value, uint64_t now);
+
+// Reads from a FIFO that holds data are handled inline
+static inline uint8_t ec72_bus_read(ec72_bus_t *bus, uint8_t addr, uint64_t now) {
+    if (bus->head < bus->tail) {
+        uint8_t reg = (uint8_t)(addr - bus->base);
+        if (reg == EC72_BUS_IN) {
+            bus->in_bytes++;
+            return bus->fifo[bus->head++];
+        }
+        if (reg == EC72_BUS_STATUS) return EC72_BUS_READY;
+    }
+    return ec72_bus_read_device(bus, addr, now);
+}
+
+// Block instructions (ec72_block.h) with a range that reaches the window:
+// word by word in range order, window addresses to the devices (a read gives
+// the byte zero-extended), the rest to memory. BCOPY reads its whole source
+// before it stores, BCMP stops reading at the first difference.
+static inline bool ec72_bus_block_hit(const ec72_bus_t *bus, uint8_t start, uint8_t count) {
+    return count && ((uint8_t)(bus->base - start) < count || ec72_bus_hit(bus, start));
+}
+void ec72_bus_block_copy(ec72_bus_t *bus, uint16_t *memory, uint8_t dst, uint8_t src, uint8_t count, uint64_t now);
+void ec72_bus_block_fill(ec72_bus_t *bus, uint16_t *memory, uint8_t dst, uint8_t value, uint8_t count, uint64_t now);
+int ec72_bus_block_compare(ec72_bus_t *bus, const uint16_t *memory, uint8_t a, uint8_t b, uint8_t count, uint8_t *at, uint64_t now);
+
+// First timestamp from now on at which a read of addr may return something
+// else than at now (UINT64_MAX: never). Only TIMER and COUNTER move by
+// themselves; IN changes by being read.
+uint64_t ec72_bus_next_change(const ec72_bus_t *bus, uint8_t addr, uint64_t now);
+
+// NULL detaches. bus->base may be changed between runs.
+static inline void ec72_cpu_attach_bus(ec72_cpu_t *cpu, ec72_bus_t *bus) {
+    cpu->bus = bus;
+}
+
+#endif
@@ -0,0 +1,668 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_cpu.h"
+#include "ec72_engine.h"
+#include "ec72_trace.h"
+#include "ec72_prof.h"
+#include "ec72_image.h"
+#include "ec72_bus.h"
+#include "ec72_cycles.h"
+#include "ec72_gdb.h"
+#include "ec72_journal.h"
+#include "ec72_fuzz.h"
+#include "ec72_xmem.h"
+
+// ANSI escape codes for colors
+    #define RED     "\x1b[31m"
+    #define GREEN   "\x1b[32m"
+    #define YELLOW  "\x1b[33m"
+    #define BLUE    "\x1b[34m"
+    #define MAGENTA "\x1b[35m"
+    #define CYAN    "\x1b[36m"
+    #define RESET   "\x1b[0m"
+
+void ec72_cpu_init(ec72_cpu_t *cpu) {
+    memset(cpu, 0, sizeof(*cpu));
+    cpu->cores = 1;
+    cpu->image_stufr = MEM_SIZE - 1;
+    ec72_cpu_reset(cpu);
+}
+
+ec72_cpu_t *ec72_cpu_create(void) {
+    ec72_cpu_t *cpu = malloc(sizeof(ec72_cpu_t));
+    if (cpu) ec72_cpu_init(cpu);
+    return cpu;
+}
+
+void ec72_cpu_fini(ec72_cpu_t *cpu) {
+    ec72_jit_free(cpu->jit);
+    cpu->jit = NULL;
+}
+
+void ec72_cpu_destroy(ec72_cpu_t *cpu) {
+    if (!cpu) return;
+    ec72_cpu_fini(cpu);
+    free(cpu);
+}
+
+void ec72_cpu_reset(ec72_cpu_t *cpu) {
+    memset(cpu->memory, 0, sizeof(cpu->memory));
+    memcpy(cpu->memory, cpu->image, cpu->image_words * sizeof(uint16_t));
+    cpu->RA = cpu->RB = cpu->RC = cpu->RE = 0;
+    cpu->IR = 0;
+    cpu->PC = cpu->image_entry;
+    cpu->MAR = 0;
+    cpu->BANK = 0;
+    cpu->STOFR = cpu->image_stofr;
+    cpu->STUFR = cpu->image_stufr;
+    cpu->SP = cpu->STUFR;
+    cpu->ZF = cpu->NF = cpu->OF = false;
+    cpu->status = EC72_OK;
+    cpu->retired = 0;
+    cpu->cycles = 0;
+    cpu->verified = false;
+    if (cpu->bus) ec72_bus_reset(cpu->bus);
+    if (cpu->journal) ec72_journal_cut(cpu->journal);
+    ec72_mem_changed(cpu);
+}
+
+ec72_status_t ec72_cpu_load_words(ec72_cpu_t *cpu, const uint16_t *words, size_t count) {
+    if (count > MEM_SIZE) count = MEM_SIZE;
+    memset(cpu->image, 0, sizeof(cpu->image));
+    memcpy(cpu->image, words, count * sizeof(uint16_t));
+    cpu->image_words = count;
+    cpu->image_entry = 0;
+    cpu->image_stofr = 0;
+    cpu->image_stufr = MEM_SIZE - 1;
+    ec72_cpu_reset(cpu);
+    return EC72_OK;
+}
+
+void ec72_cpu_set_start(ec72_cpu_t *cpu, uint8_t entry, uint8_t stofr, uint8_t stufr) {
+    cpu->image_entry = entry;
+    cpu->image_stofr = stofr;
+    cpu->image_stufr = stufr;
+    ec72_cpu_reset(cpu);
+}
+
+ec72_status_t ec72_cpu_load_file(ec72_cpu_t *cpu, const char *filename) {
+    ec72_image_t img;
+    if (!ec72_image_load(&img, filename)) return EC72_ERR_IO;
+    ec72_status_t s = ec72_cpu_load_image(cpu, &img);
+    ec72_image_free(&img);
+    return s;
+}
+
+void ec72_cpu_set_output(ec72_cpu_t *cpu, ec72_out_fn out, void *user) {
+    cpu->out = out;
+    cpu->out_user = user;
+}
+
+void ec72_cpu_set_engine(ec72_cpu_t *cpu, ec72_engine_t engine) {
+    cpu->engine = engine;
+}
+
+static const char *engine_names[] = { "switch", "threaded", "jit", "lazy" };
+
+bool ec72_engine_from_name(const char *name, ec72_engine_t *engine) {
+    for (size_t i = 0; i < sizeof(engine_names)/sizeof(engine_names[0]); i++) {
+        if (strcmp(engine_names[i], name) == 0) {
+            *engine = (ec72_engine_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *ec72_engine_name(ec72_engine_t engine) {
+    if ((size_t)engine < sizeof(engine_names)/sizeof(engine_names[0])) return engine_names[engine];
+    return "unknown";
+}
+
+void ec72_cpu_invalidate(ec72_cpu_t *cpu) {
+    cpu->verified = false;
+    ec72_mem_changed(cpu);
+}
+
+// Faults leave PC pointing behind the offending instruction (IR holds it)
+#define FAULT(s) do { cpu->status = (s); return (s); } while (0)
+
+// Data accesses; only the io loop tests the bus window. Devices count time
+// in cycles when there is a cycle model, in instructions otherwise.
+#define NOW (timed ? cpu->cycles : cpu->retired)
+#define LOAD(a) ((io && ec72_bus_hit(cpu->bus, (a))) ? ec72_bus_read(cpu->bus, (a), NOW) : (uint8_t)memory[a])
+#define STORE(a, v) do {                                                    \
+        if (io && ec72_bus_hit(cpu->bus, (a))) ec72_bus_write(cpu->bus, (a), (v), NOW); \
+        else memory[a] = (v);                                               \
+    } while (0)
+#define RETIRE() do {                                                       \
+        cpu->retired++;                                                     \
+        if (timed) cpu->cycles += cpu->cycle_model->cost[opcode];           \
+    } while (0)
+
+// debug, checked, io and timed are constants in the fast loops, so the
+// plain loop carries no per-instruction DEBUG test, the verified loop
+// (checked false) no stack bound tests, only the bus loop (io) the window
+// tests and only the cycle-counted loop (timed) the cycle count
+static EC72_ALWAYS_INLINE ec72_status_t execute_instruction(ec72_cpu_t *cpu, const bool debug, const bool checked, const bool io, const bool timed) {
+    uint16_t IR = cpu->IR = cpu->memory[cpu->PC++];
+    uint8_t opcode = (IR >> 8) & 0xFF;
+    uint8_t operand = IR & 0xFF;
+    uint16_t *memory = cpu->memory;
+
+    if (debug){
+        printf("%sPC=%02X IR=%04X STOFR=%d STUFR=%d %sOPCODE=%02X OPERAND=%02X %sRA=%d RB=%d RC=%d RE=%d %sZF=%d NF=%d OF=%d %sSP= %d%s\n",
+           MAGENTA, cpu->PC-1, IR, cpu->STOFR, cpu->STUFR, GREEN, opcode, operand, CYAN,
+           cpu->RA, cpu->RB, cpu->RC, cpu->RE, YELLOW, cpu->ZF, cpu->NF, cpu->OF, BLUE, cpu->SP, RESET);
+    }
+
+    switch(opcode) {
+
+        case OP_MOVR: {
+            uint8_t dest = (operand >> 4) & 0x0F;
+            uint8_t src = operand & 0x0F;
+            uint8_t* d = get_register(cpu, dest);
+            uint8_t* s = get_register(cpu, src);
+            if (d && s) *d = *s;
+            break;
+        }
+        case OP_MOVA: cpu->RA = LOAD(operand); break;
+        case OP_MOVB: cpu->RB = LOAD(operand); break;
+        case OP_MOVC: cpu->RC = LOAD(operand); break;
+        case OP_MOVE: cpu->RE = LOAD(operand); break;
+        case OP_STORA: STORE(operand, cpu->RA); break;
+        case OP_STORB: STORE(operand, cpu->RB); break;
+        case OP_STORC: STORE(operand, cpu->RC); break;
+        case OP_STORE: STORE(operand, cpu->RE); break;
+        case OP_LDIMA: cpu->RA = operand; break;
+        case OP_LDIMB: cpu->RB = operand; break;
+        case OP_LDIMC: cpu->RC = operand; break;
+        case OP_LDIME: cpu->RE = operand; break;
+        case OP_JMPN: if (cpu->NF) cpu->PC = operand; break;
+        case OP_JMPZ: if (cpu->ZF) cpu->PC = operand; break;
+        case OP_JMPO: if (cpu->OF) cpu->PC = operand; break;
+        case OP_JMP: cpu->PC = operand; break;
+        case OP_ADD: alu_add(cpu, operand); break;
+        case OP_SUB: alu_sub(cpu, operand); break;
+        case OP_ADDR: {
+            uint8_t *reg = get_register(cpu, operand);
+            if (!reg) FAULT(EC72_ERR_ILLEGAL_OPERAND);
+            alu_add(cpu, *reg);
+            break;
+        }
+        case OP_SUBR: {
+            uint8_t *reg = get_register(cpu, operand);
+            if (!reg) FAULT(EC72_ERR_ILLEGAL_OPERAND);
+            alu_sub(cpu, *reg);
+            break;
+        }
+        case OP_CALL: {
+            if ( checked && ((cpu->SP == cpu->STOFR) || (cpu->SP == 0)) ) FAULT(EC72_ERR_STACK_OVERFLOW);
+            uint16_t v = (uint16_t)(cpu->PC & (MEM_SIZE-1));        // only store low byte into stack cell
+            memory[--cpu->SP] = v;
+            if (debug) printf("  [CALL] push return=0x%02X at mem[%s%u%s]\n", (uint8_t)v, BLUE, cpu->SP, RESET);
+            cpu->PC = operand;
+            break;
+        }
+        case OP_RET: {
+            if (checked && cpu->SP == MEM_SIZE-1) FAULT(EC72_ERR_STACK_UNDERFLOW);
+            uint16_t v = memory[cpu->SP++];
+            cpu->PC = (uint8_t)(v & (MEM_SIZE-1));
+            if (debug) printf("  [RET] popped return=0x%02X from mem[%s%u%s]\n", (uint8_t)(v & 0xFF), BLUE, cpu->SP-1, RESET);
+            break;
+        }
+        case OP_MOVA_PTRB: {
+            cpu->RA = LOAD(cpu->RB); // load low byte of memory[RB]
+            break;
+        }
+        case OP_STORA_PTRB: {
+            STORE(cpu->RB, cpu->RA);
+            break;
+        }
+        case OP_PUSH: {
+            uint8_t *reg = get_register(cpu, operand);
+            if (!reg) FAULT(EC72_ERR_ILLEGAL_OPERAND);
+            if ( checked && ((cpu->SP == cpu->STOFR) || (cpu->SP == 0)) ) FAULT(EC72_ERR_STACK_OVERFLOW);
+            uint16_t v = (uint16_t)(*reg & (MEM_SIZE-1));
+            memory[--cpu->SP] = v;
+            if (debug) printf("  [PUSH] push 0x%02X into mem[%s%u%s]\n", (uint8_t)v, BLUE, cpu->SP, RESET);
+            break;
+        }
+        case OP_POP: {
+            uint8_t *reg = get_register(cpu, operand);
+            if (!reg) FAULT(EC72_ERR_ILLEGAL_OPERAND);
+            if ( checked && ((cpu->SP == cpu->STUFR ) || (cpu->SP == (MEM_SIZE -1) )) ) FAULT(EC72_ERR_STACK_UNDERFLOW);
+            uint16_t v = memory[cpu->SP++];
+            *reg = (uint8_t)(v & (MEM_SIZE-1));
+            if (debug) printf("  [POP] pop 0x%02X from mem[%s%u%s]\n", (uint8_t)(v & 0xFF), BLUE, cpu->SP-1, RESET);
+            break;
+        }
+        case OP_ADDSP:{
+            if ( checked && ((cpu->SP == cpu->STUFR ) || (cpu->SP == (MEM_SIZE -1) )) ) FAULT(EC72_ERR_STACK_UNDERFLOW);
+            cpu->SP += operand;
+            break;
+        }
+        case OP_SUBSP:{
+            if ( checked && ((cpu->SP == cpu->STOFR) || (cpu->SP == 0)) ) FAULT(EC72_ERR_STACK_OVERFLOW);
+            cpu->SP -= operand;
+            break;
+        }
+        case OP_OUT: if (cpu->out) cpu->out(cpu->out_user, cpu->RA); break;
+        case OP_SSTOF: cpu->STOFR = operand; break; // Set STack OverFlow
+        case OP_SSTUF:{// Set STack UnderFlow
+            cpu->STUFR = operand;
+            cpu->SP = operand;
+            break;
+        };
+        // Atomic for the other cores of an SMP system (ec72_smp.h), which
+        // runs them one at a time after stopping the core in front of them
+        case OP_XCHG: {
+            if (cpu->atomic_stop) { cpu->PC--; return EC72_SYNC; }
+            uint8_t v = LOAD(operand);
+            STORE(operand, cpu->RA);
+            cpu->RA = v;
+            break;
+        }
+        case OP_CAS: {
+            if (cpu->atomic_stop) { cpu->PC--; return EC72_SYNC; }
+            uint8_t v = LOAD(operand);
+            bool swap = v == cpu->RA;
+            if (swap) STORE(operand, cpu->RB);
+            else cpu->RA = v;
+            update_flags(cpu, !swap);   // ZF: swapped
+            break;
+        }
+        case OP_LDID: cpu->RA = cpu->core_id; cpu->RB = cpu->cores; break;
+        // Extended memory (ec72_xmem.h) at BANK:MAR
+        case OP_SBANK: cpu->BANK = operand; break;
+        case OP_SMAR: cpu->MAR = (uint16_t)(cpu->RB << 8 | cpu->RC); break;
+        case OP_FLD: cpu->RA = ec72_far_load(cpu, operand); break;
+        case OP_FST: ec72_far_store(cpu, cpu->RA, operand); break;
+        // Block instructions (ec72_block.h): RE words at RB (and RC); the
+        // destination is checked against the stack like PUSH
+        case OP_BCOPY: {
+            ec72_status_t bad = checked ? ec72_block_stack_check(cpu->RB, cpu->RE, cpu->SP, cpu->STOFR, cpu->STUFR) : EC72_OK;
+            if (bad != EC72_OK) FAULT(bad);
+            if (io && (ec72_bus_block_hit(cpu->bus, cpu->RB, cpu->RE) || ec72_bus_block_hit(cpu->bus, cpu->RC, cpu->RE)))
+                ec72_bus_block_copy(cpu->bus, memory, cpu->RB, cpu->RC, cpu->RE, NOW);
+            else ec72_block_copy(memory, cpu->RB, cpu->RC, cpu->RE);
+            if (debug) printf("  [BCOPY] %u words from mem[%s%u%s] to mem[%s%u%s]\n", cpu->RE, BLUE, cpu->RC, RESET, BLUE, cpu->RB, RESET);
+            break;
+        }
+        case OP_BFILL: {
+            ec72_status_t bad = checked ? ec72_block_stack_check(cpu->RB, cpu->RE, cpu->SP, cpu->STOFR, cpu->STUFR) : EC72_OK;
+            if (bad != EC72_OK) FAULT(bad);
+            if (io && ec72_bus_block_hit(cpu->bus, cpu->RB, cpu->RE))
+                ec72_bus_block_fill(cpu->bus, memory, cpu->RB, cpu->RA, cpu->RE, NOW);
+            else ec72_block_fill(memory, cpu->RB, cpu->RA, cpu->RE);
+            if (debug) printf("  [BFILL] %u words of 0x%02X into mem[%s%u%s]\n", cpu->RE, cpu->RA, BLUE, cpu->RB, RESET);
+            break;
+        }
+        case OP_BCMP:
+            if (io) alu_bcmp_io(cpu, cpu->bus, NOW);
+            else alu_bcmp(cpu);
+            break;
+        case OP_MUL: {
+            uint8_t *reg = get_register(cpu, operand);
+            if (!reg) FAULT(EC72_ERR_ILLEGAL_OPERAND);
+            alu_mul(cpu, *reg);
+            break;
+        }
+        case OP_HLT: RETIRE(); FAULT(EC72_HALTED);
+        default: FAULT(EC72_ERR_UNKNOWN_OPCODE);
+    }
+    RETIRE();
+    return EC72_OK;
+}
+
+#undef NOW
+#undef LOAD
+#undef STORE
+#undef RETIRE
+
+ec72_status_t ec72_switch_step(ec72_cpu_t *cpu) {
+    return execute_instruction(cpu, false, true, cpu->bus != NULL, cpu->cycle_model != NULL);
+}
+
+ec72_status_t ec72_switch_run(ec72_cpu_t *cpu, uint64_t max_instructions) {
+    ec72_status_t s = EC72_OK;
+    if (cpu->bus) {
+        for (uint64_t n = 0; n < max_instructions; n++) {
+            s = execute_instruction(cpu, false, true, true, false);
+            if (s != EC72_OK) break;
+        }
+    } else if (cpu->verified) {
+        for (uint64_t n = 0; n < max_instructions; n++) {
+            s = execute_instruction(cpu, false, false, false, false);
+            if (s != EC72_OK) break;
+        }
+    } else {
+        for (uint64_t n = 0; n < max_instructions; n++) {
+            s = execute_instruction(cpu, false, true, false, false);
+            if (s != EC72_OK) break;
+        }
+    }
+    ec72_mem_changed(cpu);
+    return s;
+}
+
+static ec72_status_t run_debug(ec72_cpu_t *cpu, uint64_t max_instructions) {
+    ec72_status_t s = EC72_OK;
+    for (uint64_t n = 0; n < max_instructions; n++) {
+        s = execute_instruction(cpu, true, true, cpu->bus != NULL, cpu->cycle_model != NULL);
+        if (s != EC72_OK) break;
+    }
+    ec72_mem_changed(cpu);
+    return s;
+}
+
+static ec72_status_t run_traced(ec72_cpu_t *cpu, uint64_t max_instructions) {
+    ec72_trace_t *t = cpu->trace;
+    ec72_status_t s = EC72_OK;
+    for (uint64_t n = 0; n < max_instructions; n++) {
+        if (ec72_trace_wants(t, cpu->PC, cpu->memory[cpu->PC])) {
+            ec72_trace_rec_t *r = ec72_trace_begin(t, cpu);
+            s = execute_instruction(cpu, false, true, cpu->bus != NULL, cpu->cycle_model != NULL);
+            ec72_trace_end(r, cpu, s);
+        } else {
+            s = execute_instruction(cpu, false, true, cpu->bus != NULL, cpu->cycle_model != NULL);
+        }
+        if (s != EC72_OK) break;
+    }
+    ec72_mem_changed(cpu);
+    return s;
+}
+
+static ec72_status_t run_profiled(ec72_cpu_t *cpu, uint64_t max_instructions) {
+    ec72_prof_t *p = cpu->prof;
+    ec72_status_t s = EC72_OK;
+    for (uint64_t n = 0; n < max_instructions; n++) {
+        uint8_t pc = cpu->PC;
+        uint16_t ir = cpu->memory[pc];
+        ec72_prof_count(p, pc);
+        s = execute_instruction(cpu, false, true, cpu->bus != NULL, cpu->cycle_model != NULL);
+        ec72_prof_flow(p, cpu, pc, ir, s);
+        if (s != EC72_OK) break;
+    }
+    ec72_mem_changed(cpu);
+    return s;
+}
+
+// Idle loop detector (ec72_cycles.h): armed by a taken backward jump over
+// a body that only loads, computes and jumps; disarmed when control leaves
+// the body. Device reads in the iteration are noted with their timestamp.
+typedef struct {
+    bool armed;
+    uint8_t head, end;
+    uint8_t RA, RB, RC, RE, SP;
+    bool ZF, NF, OF;
+    uint64_t retired, cycles, in_bytes;
+    int reads;
+    uint8_t read_addr[EC72_IDLE_MAX_LOOP];
+    uint64_t read_at[EC72_IDLE_MAX_LOOP];
+} Idle_probe_t;
+
+static bool idle_body(const ec72_cpu_t *cpu, uint8_t head, uint8_t end) {
+    for (int a = head; a <= end; a++) {
+        switch (EC72_OPCODE(cpu->memory[a])) {
+            case OP_MOVR: case OP_MOVA: case OP_MOVB: case OP_MOVC: case OP_MOVE:
+            case OP_LDIMA: case OP_LDIMB: case OP_LDIMC: case OP_LDIME:
+            case OP_JMPN: case OP_JMPZ: case OP_JMPO: case OP_JMP:
+            case OP_ADD: case OP_SUB: case OP_ADDR: case OP_SUBR: case OP_MOVA_PTRB:
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+static void idle_arm(Idle_probe_t *p, const ec72_cpu_t *cpu, uint8_t head, uint8_t end) {
+    p->armed = idle_body(cpu, head, end);
+    p->head = head;
+    p->end = end;
+    p->RA = cpu->RA; p->RB = cpu->RB; p->RC = cpu->RC; p->RE = cpu->RE; p->SP = cpu->SP;
+    p->ZF = cpu->ZF; p->NF = cpu->NF; p->OF = cpu->OF;
+    p->retired = cpu->retired;
+    p->cycles = cpu->cycles;
+    p->in_bytes = cpu->bus ? cpu->bus->in_bytes : 0;
+    p->reads = 0;
+}
+
+// Before each instruction while armed
+static void idle_note(Idle_probe_t *p, const ec72_cpu_t *cpu) {
+    if (cpu->PC < p->head || cpu->PC > p->end) {
+        p->armed = false;
+        return;
+    }
+    if (!cpu->bus) return;
+    uint16_t IR = cpu->memory[cpu->PC];
+    uint8_t op = EC72_OPCODE(IR);
+    uint8_t addr = op == OP_MOVA_PTRB ? cpu->RB : EC72_OPERAND(IR);
+    if ((op < OP_MOVA || op > OP_MOVE) && op != OP_MOVA_PTRB) return;
+    if (!ec72_bus_hit(cpu->bus, addr)) return;
+    if (p->reads == EC72_IDLE_MAX_LOOP) {
+        p->armed = false;
+        return;
+    }
+    p->read_addr[p->reads] = addr;
+    p->read_at[p->reads++] = cpu->cycles;
+}
+
+// After a taken backward jump from end to head: if the last iteration left
+// the state where it found it, skip as many identical iterations as the
+// devices and the budget allow. Returns the instructions skipped.
+static uint64_t idle_check(Idle_probe_t *p, ec72_cpu_t *cpu, uint8_t end, uint64_t left) {
+    uint8_t head = cpu->PC;
+    ec72_cycles_t *c = cpu->cycle_model;
+    uint64_t skipped = 0;
+    if (p->armed && p->head == head && p->end == end &&
+        p->RA == cpu->RA && p->RB == cpu->RB && p->RC == cpu->RC && p->RE == cpu->RE && p->SP == cpu->SP &&
+        p->ZF == cpu->ZF && p->NF == cpu->NF && p->OF == cpu->OF &&
+        (!cpu->bus || p->in_bytes == cpu->bus->in_bytes)) {
+        uint64_t len = cpu->retired - p->retired;
+        uint64_t cost = cpu->cycles - p->cycles;
+        uint64_t k = left / len;
+        if (cost) {
+            if (k > (UINT64_MAX - cpu->cycles) / cost) k = (UINT64_MAX - cpu->cycles) / cost;
+            // The same read k iterations later must still see the same value
+            for (int i = 0; i < p->reads; i++) {
+                uint64_t change = ec72_bus_next_change(cpu->bus, p->read_addr[i], p->read_at[i]);
+                uint64_t fit = (change - 1 - p->read_at[i]) / cost;
+                if (fit < k) k = fit;
+            }
+        }
+        if (k) {
+            skipped = k * len;
+            cpu->retired += skipped;
+            cpu->cycles += k * cost;
+            c->idle_skips++;
+            c->skipped_instructions += skipped;
+            c->skipped_cycles += k * cost;
+        }
+    }
+    idle_arm(p, cpu, head, end);
+    return skipped;
+}
+
+// Cycle-counted run (ec72_cycles.h)
+static ec72_status_t run_timed(ec72_cpu_t *cpu, uint64_t max_instructions) {
+    bool fast_forward = cpu->cycle_model->fast_forward;
+    Idle_probe_t probe = {0};
+    ec72_status_t s = EC72_OK;
+    for (uint64_t n = 0; n < max_instructions; ) {
+        uint8_t pc = cpu->PC;
+        uint16_t IR = cpu->memory[pc];
+        if (probe.armed) idle_note(&probe, cpu);
+        if (cpu->bus) s = execute_instruction(cpu, false, true, true, true);
+        else s = execute_instruction(cpu, false, true, false, true);
+        n++;
+        if (s != EC72_OK) break;
+        uint8_t op = EC72_OPCODE(IR);
+        if (fast_forward && op >= OP_JMPN && op <= OP_JMP && cpu->PC == EC72_OPERAND(IR) &&
+            cpu->PC <= pc && pc - cpu->PC < EC72_IDLE_MAX_LOOP) {
+            n += idle_check(&probe, cpu, pc, max_instructions - n);
+        }
+    }
+    ec72_mem_changed(cpu);
+    return s;
+}
+
+// Breakpoints and watchpoints (ec72_gdb.h); the only loop that tests them.
+// Journals too when there is a journal.
+static ec72_status_t run_stoppable(ec72_cpu_t *cpu, uint64_t max_instructions) {
+    ec72_dbg_t *d = cpu->dbg;
+    ec72_journal_t *j = cpu->journal;
+    ec72_status_t s = EC72_OK;
+    d->stop = EC72_STOP_NONE;
+    for (uint64_t n = 0; n < max_instructions; n++) {
+        if (ec72_dbg_bit(d->bp, cpu->PC) && !d->resuming) {
+            d->stop = EC72_STOP_BREAK;
+            d->stop_addr = cpu->PC;
+            break;
+        }
+        d->resuming = false;
+        ec72_access_t a = { -1, -1, -1, 0 };
+        if (d->wp_count) ec72_dbg_access(cpu, &a);
+        if (j) ec72_journal_prepare(j, cpu);
+        s = execute_instruction(cpu, cpu->debug, true, cpu->bus != NULL, cpu->cycle_model != NULL);
+        if (j) ec72_journal_commit(j, ec72_journal_put(ec72_journal_cursor(j), cpu, s), 1);
+        if (s != EC72_OK) break;
+        int hit = ec72_dbg_find(d->wp_write, a.write, a.len);
+        if (hit >= 0) {
+            d->stop = EC72_STOP_WATCH_WRITE;
+            d->stop_addr = (uint8_t)hit;
+            break;
+        }
+        hit = ec72_dbg_find(d->wp_read, a.read, a.len);
+        if (hit < 0) hit = ec72_dbg_find(d->wp_read, a.read2, a.len);
+        if (hit >= 0) {
+            d->stop = EC72_STOP_WATCH_READ;
+            d->stop_addr = (uint8_t)hit;
+            break;
+        }
+    }
+    ec72_mem_changed(cpu);
+    return s;
+}
+
+// Time-travel journal (ec72_journal.h): a delta per instruction
+static EC72_ALWAYS_INLINE ec72_status_t journal_loop(ec72_cpu_t *cpu, uint64_t max_instructions, const bool plain) {
+    ec72_journal_t *j = cpu->journal;
+    ec72_status_t s = EC72_OK;
+    for (uint64_t n = 0; n < max_instructions && s == EC72_OK; ) {
+        uint64_t batch = ec72_journal_prepare(j, cpu);
+        if (batch > max_instructions - n) batch = max_instructions - n;
+        uint8_t *p = ec72_journal_cursor(j);
+        uint32_t done = 0;
+        while (done < batch) {
+            if (plain) s = execute_instruction(cpu, false, true, false, false);
+            else s = execute_instruction(cpu, cpu->debug, true, cpu->bus != NULL, cpu->cycle_model != NULL);
+            p = ec72_journal_put(p, cpu, s);
+            done++;
+            if (s != EC72_OK) break;
+        }
+        ec72_journal_commit(j, p, done);
+        n += done;
+    }
+    ec72_mem_changed(cpu);
+    return s;
+}
+
+static ec72_status_t run_journaled(ec72_cpu_t *cpu, uint64_t max_instructions) {
+    if (cpu->debug || cpu->bus || cpu->cycle_model) return journal_loop(cpu, max_instructions, false);
+    return journal_loop(cpu, max_instructions, true);
+}
+
+// Edge coverage for the fuzzer (ec72_fuzz.h)
+static ec72_status_t run_covered(ec72_cpu_t *cpu, uint64_t max_instructions) {
+    ec72_cov_t *c = cpu->cov;
+    ec72_status_t s = EC72_OK;
+    for (uint64_t n = 0; n < max_instructions; n++) {
+        uint8_t pc = cpu->PC;
+        uint8_t op = EC72_OPCODE(cpu->memory[pc]);
+        s = execute_instruction(cpu, false, true, cpu->bus != NULL, cpu->cycle_model != NULL);
+        if (s != EC72_OK) break;
+        if (ec72_cov_is_branch(op)) ec72_cov_edge(c, pc, cpu->PC);
+    }
+    ec72_mem_changed(cpu);
+    return s;
+}
+
+static bool stoppable(const ec72_cpu_t *cpu) {
+    return cpu->dbg && (cpu->dbg->bp_count || cpu->dbg->wp_count);
+}
+
+ec72_status_t ec72_cpu_step(ec72_cpu_t *cpu) {
+    if (cpu->status != EC72_OK) return cpu->status;
+    if (stoppable(cpu)) return run_stoppable(cpu, 1);
+    if (cpu->journal) return run_journaled(cpu, 1);
+    if (cpu->debug) return run_debug(cpu, 1);
+    if (cpu->trace) return run_traced(cpu, 1);
+    if (cpu->prof) return run_profiled(cpu, 1);
+    if (cpu->cov) return run_covered(cpu, 1);
+    ec72_status_t s = execute_instruction(cpu, false, true, cpu->bus != NULL, cpu->cycle_model != NULL);
+    ec72_mem_changed(cpu);
+    return s;
+}
+
+ec72_status_t ec72_cpu_run(ec72_cpu_t *cpu, uint64_t max_instructions) {
+    if (cpu->status != EC72_OK) return cpu->status;
+    if (stoppable(cpu)) return run_stoppable(cpu, max_instructions);
+    if (cpu->journal) return run_journaled(cpu, max_instructions);
+    if (cpu->debug) return run_debug(cpu, max_instructions);
+    if (cpu->trace) return run_traced(cpu, max_instructions);
+    if (cpu->prof) return run_profiled(cpu, max_instructions);
+    if (cpu->cov) return run_covered(cpu, max_instructions);
+    if (cpu->cycle_model) return run_timed(cpu, max_instructions);
+
+    switch (cpu->engine) {
+        case EC72_ENGINE_THREADED: return ec72_threaded_run(cpu, max_instructions);
+        case EC72_ENGINE_JIT: return ec72_jit_run(cpu, max_instructions);
+        case EC72_ENGINE_LAZY: return ec72_lazy_run(cpu, max_instructions);
+        default: return ec72_switch_run(cpu, max_instructions);
+    }
+}
+
+const char *ec72_status_str(ec72_status_t status) {
+    switch (status) {
+        case EC72_OK: return "running";
+        case EC72_HALTED: return "halted";
+        case EC72_ERR_STACK_OVERFLOW: return "stack overflow";
+        case EC72_ERR_STACK_UNDERFLOW: return "stack underflow";
+        case EC72_ERR_UNKNOWN_OPCODE: return "unknown opcode";
+        case EC72_ERR_ILLEGAL_OPERAND: return "illegal operand";
+        case EC72_ERR_IO: return "i/o error";
+        case EC72_SYNC: return "at an atomic instruction";
+        default: return "invalid status";
+    }
+}
+
+static void print_status(const ec72_cpu_t *cpu, FILE *f, const char *red, const char *yellow, const char *reset) {
+    switch (cpu->status) {
+        case EC72_OK: break;
+        case EC72_HALTED: fprintf(f, "%sProgramm Halted Execution%s\n", yellow, reset); break;
+        case EC72_ERR_STACK_OVERFLOW: fprintf(f, "%sStack overflow%s\n", red, reset); break;
+        case EC72_ERR_STACK_UNDERFLOW: fprintf(f, "%sStack underflow%s\n", red, reset); break;
+        case EC72_ERR_UNKNOWN_OPCODE:
+            fprintf(f, "%sUnknown opcode: 0x%02X%s\n", red, EC72_OPCODE(cpu->IR), reset);
+            break;
+        case EC72_ERR_ILLEGAL_OPERAND:
+            fprintf(f, "%sIllegal register operand for opcode 0x%02X: 0x%02X%s\n", red,
+                    EC72_OPCODE(cpu->IR), EC72_OPERAND(cpu->IR), reset);
+            break;
+        default: fprintf(f, "%sError: %s%s\n", red, ec72_status_str(cpu->status), reset); break;
+    }
+}
+
+void ec72_cpu_print_status(const ec72_cpu_t *cpu, FILE *f) {
+    print_status(cpu, f, RED, YELLOW, RESET);
+}
+
+void ec72_cpu_print_status_plain(const ec72_cpu_t *cpu, FILE *f) {
+    print_status(cpu, f, "", "", "");
+}
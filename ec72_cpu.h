@@ -0,0 +1,165 @@
+//Copyright © Martin H. Sharp; August 2025
+// Reentrant EC72 CPU context: every emulator instance owns its own memory,
+// registers and flags, so any number of them can run side by side in one
+// process (one context per thread, no shared state).
+#ifndef EC72_CPU_H
+#define EC72_CPU_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "ec72_isa.h"
+
+// Result of step/run. Everything from EC72_ERR_STACK_OVERFLOW to EC72_ERR_IO
+// is a fault; the context keeps its status until ec72_cpu_reset() is called.
+typedef enum {
+    EC72_OK = 0,                // still running (instruction budget used up)
+    EC72_HALTED,                // HLT executed
+    EC72_ERR_STACK_OVERFLOW,
+    EC72_ERR_STACK_UNDERFLOW,
+    EC72_ERR_UNKNOWN_OPCODE,
+    EC72_ERR_ILLEGAL_OPERAND,   // register operand that does not exist
+    EC72_ERR_IO,                // program image could not be loaded
+    EC72_SYNC                   // SMP core only (ec72_smp.h): stopped in front of XCHG/CAS, not kept as status
+} ec72_status_t;
+
+// Called for every OUT instruction with the value of RA
+typedef void (*ec72_out_fn)(void *user, uint8_t value);
+
+// Execution engines, selectable at runtime. All of them produce identical
+// results; the switch interpreter is the reference.
+typedef enum {
+    EC72_ENGINE_SWITCH = 0,     // fetch/decode/switch per instruction
+    EC72_ENGINE_THREADED,       // predecoded handlers, computed-goto dispatch
+    EC72_ENGINE_JIT,            // x86-64 basic-block translation (threaded elsewhere)
+    EC72_ENGINE_LAZY            // switch loop with an indexed register file, flags derived at the jumps
+} ec72_engine_t;
+
+struct ec72_jit;
+struct ec72_trace;
+struct ec72_prof;
+struct ec72_bus;
+struct ec72_cycles;
+struct ec72_dbg;
+struct ec72_journal;
+struct ec72_cov;
+struct ec72_xmem;
+
+// One predecoded memory word (threaded engine)
+typedef struct {
+    const void *handler;        // label of the instruction's handler
+    uint8_t *reg;               // resolved register operand / MOVR destination
+    uint8_t *src;               // MOVR source
+    uint16_t word;              // instruction word the entry was decoded from
+} ec72_decoded_t;
+
+typedef struct ec72_cpu {
+    uint16_t memory[EC72_MEM_SIZE];
+
+    // Registers
+    uint8_t RA, RB, RC, RE;
+    uint16_t IR;    // Instruction Register
+    uint8_t PC;     // Program Counter
+    uint16_t MAR;   // Memory Address Register: far address inside the bank (SMAR, FLD, FST)
+    uint8_t BANK;   // Bank register: extended memory bank (SBANK, ec72_xmem.h)
+    uint8_t STOFR;  // STack OverFlow Register
+    uint8_t STUFR;  // STack UnderFlow Register
+    uint8_t SP;
+
+    // Flags
+    bool ZF, NF, OF;
+
+    // Core-ID register, read by LDID: this core's number and the core count
+    // (0 and 1 outside of SMP)
+    uint8_t core_id, cores;
+    bool atomic_stop;           // SMP core: XCHG/CAS return EC72_SYNC instead of executing
+
+    ec72_status_t status;
+    uint64_t retired;           // instructions executed since reset
+    uint64_t cycles;            // cycles since reset, counted with a cycle model only
+
+    // Program image, copied back into memory by ec72_cpu_reset()
+    uint16_t image[EC72_MEM_SIZE];
+    size_t image_words;
+    uint8_t image_entry;        // PC, STOFR and STUFR (= SP) after a reset
+    uint8_t image_stofr, image_stufr;
+
+    ec72_out_fn out;            // NULL: OUT is discarded
+    void *out_user;
+    bool debug;                 // per-instruction register dump on stdout (switch engine only)
+    struct ec72_trace *trace;   // binary trace (ec72_trace.h), NULL: off; switch engine only
+    struct ec72_prof *prof;     // profiler (ec72_prof.h), NULL: off; switch engine only
+    struct ec72_bus *bus;       // memory-mapped I/O (ec72_bus.h), NULL: none
+    struct ec72_xmem *xmem;     // extended memory (ec72_xmem.h), NULL: none
+    struct ec72_cycles *cycle_model;    // cycle costs (ec72_cycles.h), NULL: off; switch engine only
+    struct ec72_dbg *dbg;       // breakpoints and watchpoints (ec72_gdb.h), NULL: none
+    struct ec72_journal *journal;   // time-travel journal (ec72_journal.h), NULL: off; switch engine only
+    struct ec72_cov *cov;       // edge coverage (ec72_fuzz.h), NULL: off; switch engine only
+    ec72_engine_t engine;
+    // Set by ec72_cpu_verify() (ec72_verify.h): the engines leave out the
+    // stack checks and the invalidation of decoded code on stores
+    bool verified;
+
+    // Bumped whenever memory may have changed behind an engine's back
+    uint32_t mem_epoch;
+
+    // Threaded engine state; entries are decoded lazily and invalidated by
+    // stores, so self-modifying code behaves exactly like in the switch loop
+    ec72_decoded_t decoded[EC72_MEM_SIZE];
+    uint32_t decoded_epoch;
+    const struct ec72_cpu *decoded_for;
+    bool decoded_verified;      // verified mode the entries were decoded for
+    const struct ec72_bus *decoded_bus;     // bus window the entries were bound to
+    uint8_t decoded_bus_base;
+
+    // JIT translation cache, allocated on first use; freed by ec72_cpu_fini()
+    struct ec72_jit *jit;
+} ec72_cpu_t;
+
+// Run until the program halts or faults
+#define EC72_RUN_FOREVER UINT64_MAX
+
+// Initialize a caller-owned context (power-on state, empty memory)
+void ec72_cpu_init(ec72_cpu_t *cpu);
+ec72_cpu_t *ec72_cpu_create(void);
+// Release engine resources of a context set up with ec72_cpu_init()
+void ec72_cpu_fini(ec72_cpu_t *cpu);
+void ec72_cpu_destroy(ec72_cpu_t *cpu);
+
+// Back to power-on register state with memory restored from the loaded
+// image; ends verified mode
+void ec72_cpu_reset(ec72_cpu_t *cpu);
+
+// Load a program image and reset. Words beyond EC72_MEM_SIZE are ignored.
+ec72_status_t ec72_cpu_load_words(ec72_cpu_t *cpu, const uint16_t *words, size_t count);
+// Image file (ec72_image.h) or raw .bin
+ec72_status_t ec72_cpu_load_file(ec72_cpu_t *cpu, const char *filename);
+// Entry point and stack bounds used by every following reset, then reset;
+// ec72_cpu_load_words() puts back the defaults (0, 0, 255)
+void ec72_cpu_set_start(ec72_cpu_t *cpu, uint8_t entry, uint8_t stofr, uint8_t stufr);
+
+void ec72_cpu_set_output(ec72_cpu_t *cpu, ec72_out_fn out, void *user);
+
+void ec72_cpu_set_engine(ec72_cpu_t *cpu, ec72_engine_t engine);
+// Parse an engine name ("switch", "threaded", "jit", "lazy"); returns false if unknown
+bool ec72_engine_from_name(const char *name, ec72_engine_t *engine);
+const char *ec72_engine_name(ec72_engine_t engine);
+
+// Call after writing cpu->memory directly; ends verified mode
+void ec72_cpu_invalidate(ec72_cpu_t *cpu);
+
+// Execute one instruction (always on the reference interpreter) / at most
+// max_instructions instructions on the selected engine.
+// Returns EC72_OK while the program can continue.
+ec72_status_t ec72_cpu_step(ec72_cpu_t *cpu);
+ec72_status_t ec72_cpu_run(ec72_cpu_t *cpu, uint64_t max_instructions);
+
+const char *ec72_status_str(ec72_status_t status);
+
+// Print the emulator's message for a final status (halt banner or error)
+void ec72_cpu_print_status(const ec72_cpu_t *cpu, FILE *f);
+// Same message without ANSI color codes
+void ec72_cpu_print_status_plain(const ec72_cpu_t *cpu, FILE *f);
+
+#endif
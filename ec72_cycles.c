@@ -0,0 +1,87 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include "ec72_cycles.h"
+
+void ec72_cycles_init(ec72_cycles_t *c) {
+    memset(c, 0, sizeof(*c));
+    for (int op = 0; op < 256; op++) c->cost[op] = 1;
+    c->fast_forward = true;
+}
+
+static bool same_name(const char *a, const char *b) {
+    for (; *a && *b; a++, b++) {
+        if (toupper((unsigned char)*a) != toupper((unsigned char)*b)) return false;
+    }
+    return *a == *b;
+}
+
+static bool opcode_from_name(const char *name, int *op) {
+    if (name[0] == '0' && (name[1] == 'x' || name[1] == 'X')) {
+        char *end;
+        long v = strtol(name, &end, 16);
+        if (*end || v < 0 || v > 0xFF) return false;
+        *op = (int)v;
+        return true;
+    }
+    for (int i = 0; i < 256; i++) {
+        const char *n = ec72_opcode_name((uint8_t)i);
+        if (n && same_name(n, name)) {
+            *op = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ec72_cycles_load(ec72_cycles_t *c, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror("Error opening cycle table");
+        return false;
+    }
+
+    char line[256];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        char *comment = strpbrk(line, ";#");
+        if (comment) *comment = '\0';
+        char name[64];
+        unsigned long cycles;
+        char rest;
+        int fields = sscanf(line, "%63s %lu %c", name, &cycles, &rest);
+        if (fields <= 0) continue;
+        int op;
+        if (fields != 2 || cycles > UINT32_MAX) {
+            fprintf(stderr, "%s:%d: expected \"MNEMONIC cycles\"\n", path, line_no);
+            fclose(f);
+            return false;
+        }
+        if (same_name(name, "default")) {
+            for (int i = 0; i < 256; i++) c->cost[i] = (uint32_t)cycles;
+        } else if (opcode_from_name(name, &op)) {
+            c->cost[op] = (uint32_t)cycles;
+        } else {
+            fprintf(stderr, "%s:%d: unknown opcode '%s'\n", path, line_no, name);
+            fclose(f);
+            return false;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+void ec72_cycles_print(const ec72_cycles_t *c, const ec72_cpu_t *cpu, FILE *f) {
+    fprintf(f, "Cycles: %llu (%llu instructions)", (unsigned long long)cpu->cycles, (unsigned long long)cpu->retired);
+    if (c->idle_skips) {
+        fprintf(f, ", %llu idle loop fast-forwards skipped %llu instructions / %llu cycles",
+                (unsigned long long)c->idle_skips, (unsigned long long)c->skipped_instructions,
+                (unsigned long long)c->skipped_cycles);
+    }
+    fputc('\n', f);
+}
@@ -0,0 +1,48 @@
+//Copyright © Martin H. Sharp; August 2025
+// Cycle accounting: a cost per opcode and a cycle counter (cpu->cycles).
+// With a model attached, runs go through the reference interpreter, the I/O
+// bus (ec72_bus.h) counts time in cycles instead of instructions, and idle
+// loops are fast-forwarded:
+//
+// A short backward loop without stores, stack or OUT that comes back to its
+// head with the same registers and flags (SP included), and consumed no
+// input on the way, repeats identically until a device it reads changes its
+// value. The loop is skipped forward whole iterations at a time up to the
+// next TIMER/COUNTER tick it can see, or to the end of the instruction
+// budget, adding exactly the instructions and cycles the iterations would
+// have taken. JMP to itself is the one-instruction case.
+//
+// Cycle table file: one "MNEMONIC cycles" (or "0xNN cycles") per line,
+// "default cycles" sets every opcode, ';' or '#' starts a comment.
+#ifndef EC72_CYCLES_H
+#define EC72_CYCLES_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "ec72_cpu.h"
+
+#define EC72_IDLE_MAX_LOOP 16   // instructions in a loop the detector looks at
+
+typedef struct ec72_cycles {
+    uint32_t cost[256];         // per opcode; a faulting instruction costs nothing
+    bool fast_forward;          // skip idle loops (default on)
+
+    uint64_t idle_skips;        // fast-forwards taken
+    uint64_t skipped_instructions, skipped_cycles;
+} ec72_cycles_t;
+
+// One cycle per opcode, fast-forward on
+void ec72_cycles_init(ec72_cycles_t *c);
+// Read a cycle table over the current costs; prints the first bad line
+bool ec72_cycles_load(ec72_cycles_t *c, const char *path);
+
+// NULL detaches; cpu->cycles keeps counting from where it is
+static inline void ec72_cpu_set_cycles(ec72_cpu_t *cpu, ec72_cycles_t *c) {
+    cpu->cycle_model = c;
+}
+
+// "cycles N (M instructions), idle loops skipped ..." line
+void ec72_cycles_print(const ec72_cycles_t *c, const ec72_cpu_t *cpu, FILE *f);
+
+#endif
@@ -0,0 +1,103 @@
+//Copyright © Martin H. Sharp; August 2025
+// Internal interface between ec72_cpu.c and the execution engines.
+// Not part of the public API.
+#ifndef EC72_ENGINE_H
+#define EC72_ENGINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ec72_cpu.h"
+#include "ec72_block.h"
+#include "ec72_bus.h"
+
+#define MEM_SIZE EC72_MEM_SIZE
+
+// For interpreter loops specialised on a constant argument
+#if defined(__GNUC__)
+    #define EC72_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+    #define EC72_ALWAYS_INLINE inline
+#endif
+
+// ALU helpers, shared so that every engine computes identical flags
+static inline void update_flags(ec72_cpu_t *cpu, int result) {
+    cpu->ZF = (result == 0);
+    cpu->NF = (result < 0);
+    cpu->OF = (result > 255 || result < 0);
+}
+
+static inline void alu_add(ec72_cpu_t *cpu, uint8_t value) {
+    int result = cpu->RA + value;
+    update_flags(cpu, result);
+    cpu->RA = (uint8_t)(result & 0xFF);
+}
+
+static inline void alu_sub(ec72_cpu_t *cpu, uint8_t value) {
+    int result = cpu->RA - value;
+    update_flags(cpu, result);
+    cpu->RA = (uint8_t)(result & 0xFF);
+}
+
+// MUL: RE:RA = RA * value, flags of the whole product (OF: it needed RE)
+static inline void alu_mul(ec72_cpu_t *cpu, uint8_t value) {
+    int result = cpu->RA * value;
+    update_flags(cpu, result);
+    cpu->RA = (uint8_t)result;
+    cpu->RE = (uint8_t)(result >> 8);
+}
+
+// BCMP: RA = index of the first difference, flags as SUB of its two bytes
+static inline void alu_bcmp(ec72_cpu_t *cpu) {
+    uint8_t at;
+    int result = ec72_block_compare(cpu->memory, cpu->RB, cpu->RC, cpu->RE, &at);
+    update_flags(cpu, result);
+    cpu->RA = at;
+}
+
+// BCMP with an I/O bus: a range that reaches the window reads the devices
+static inline void alu_bcmp_io(ec72_cpu_t *cpu, ec72_bus_t *bus, uint64_t now) {
+    if (!ec72_bus_block_hit(bus, cpu->RB, cpu->RE) && !ec72_bus_block_hit(bus, cpu->RC, cpu->RE)) {
+        alu_bcmp(cpu);
+        return;
+    }
+    uint8_t at;
+    int result = ec72_bus_block_compare(bus, cpu->memory, cpu->RB, cpu->RC, cpu->RE, &at, now);
+    update_flags(cpu, result);
+    cpu->RA = at;
+}
+
+static inline uint8_t *get_register(ec72_cpu_t *cpu, uint8_t code) {
+    switch(code) {
+        case REG_A: return &cpu->RA;
+        case REG_B: return &cpu->RB;
+        case REG_C: return &cpu->RC;
+        case REG_E: return &cpu->RE;
+        case REG_SP: return &cpu->SP;
+        default: return NULL;
+    }
+}
+
+// Engines that cache anything derived from memory compare their own epoch
+// against cpu->mem_epoch on entry; ec72_mem_changed() forces a resync.
+static inline void ec72_mem_changed(ec72_cpu_t *cpu) {
+    cpu->mem_epoch++;
+}
+
+// Reference switch interpreter (ec72_cpu.c); ec72_switch_step() leaves
+// mem_epoch alone so callers can track the written address themselves
+ec72_status_t ec72_switch_step(ec72_cpu_t *cpu);
+ec72_status_t ec72_switch_run(ec72_cpu_t *cpu, uint64_t max_instructions);
+
+// Predecoded threaded-code interpreter (ec72_threaded.c)
+ec72_status_t ec72_threaded_run(ec72_cpu_t *cpu, uint64_t max_instructions);
+
+// Switch loop with lazily derived flags (ec72_lazy.c); falls back to the
+// switch interpreter with an I/O bus
+ec72_status_t ec72_lazy_run(ec72_cpu_t *cpu, uint64_t max_instructions);
+
+// x86-64 basic-block JIT (ec72_jit.c); falls back to the threaded engine
+// on hosts where it cannot generate code
+ec72_status_t ec72_jit_run(ec72_cpu_t *cpu, uint64_t max_instructions);
+void ec72_jit_free(struct ec72_jit *jit);
+
+#endif
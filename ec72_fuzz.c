@@ -0,0 +1,241 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_fuzz.h"
+#include "ec72_bus.h"
+
+void ec72_cov_init(ec72_cov_t *c) {
+    memset(c->hits, 0, sizeof(c->hits));
+    c->touched_count = 0;
+}
+
+void ec72_cov_map_init(ec72_cov_map_t *m) {
+    memset(m, 0, sizeof(*m));
+}
+
+// Hit count -> bucket bit
+static uint8_t bucket(uint8_t hits) {
+    if (hits <= 3) return (uint8_t)(1u << (hits - 1));
+    if (hits <= 7) return 0x08;
+    if (hits <= 15) return 0x10;
+    if (hits <= 31) return 0x20;
+    if (hits <= 127) return 0x40;
+    return 0x80;
+}
+
+uint32_t ec72_cov_merge(ec72_cov_t *c, ec72_cov_map_t *m) {
+    uint32_t fresh = 0;
+    for (uint32_t i = 0; i < c->touched_count; i++) {
+        uint16_t e = c->touched[i];
+        uint8_t b = bucket(c->hits[e]);
+        c->hits[e] = 0;
+        // Most runs find nothing new: test before the atomic
+        if (__atomic_load_n(&m->seen[e], __ATOMIC_RELAXED) & b) continue;
+        uint8_t old = __atomic_fetch_or(&m->seen[e], b, __ATOMIC_RELAXED);
+        if (old & b) continue;
+        fresh++;
+        if (!old) __atomic_fetch_add(&m->edges, 1, __ATOMIC_RELAXED);
+    }
+    c->touched_count = 0;
+    return fresh;
+}
+
+void ec72_cov_discard(ec72_cov_t *c) {
+    for (uint32_t i = 0; i < c->touched_count; i++) c->hits[c->touched[i]] = 0;
+    c->touched_count = 0;
+}
+
+static const uint8_t interesting_bytes[] = { 0x00, 0x01, 0x02, 0x0F, 0x10, 0x7F, 0x80, 0xFE, 0xFF };
+
+size_t ec72_fuzz_mutate(const ec72_fuzz_layout_t *l, uint8_t *buf, size_t len,
+                        const uint8_t *splice, size_t splice_len, uint64_t *rng) {
+    size_t range = (size_t)l->words * 2;
+    unsigned edits = 1 + ec72_fuzz_below(rng, 8);
+    for (unsigned k = 0; k < edits; k++) {
+        size_t pos = len ? ec72_fuzz_below(rng, (uint32_t)len) : 0;
+        switch (ec72_fuzz_below(rng, 9)) {
+            case 0:
+                if (len) buf[pos] ^= (uint8_t)(1u << ec72_fuzz_below(rng, 8));
+                break;
+            case 1:
+                if (len) buf[pos] = interesting_bytes[ec72_fuzz_below(rng, sizeof(interesting_bytes))];
+                break;
+            case 2:
+                if (len) buf[pos] += (uint8_t)(ec72_fuzz_below(rng, 33) - 16);
+                break;
+            case 3:
+                if (len) buf[pos] = (uint8_t)ec72_fuzz_rand(rng);
+                break;
+            case 4:
+                // A word of the range becomes an instruction
+                if (range) {
+                    size_t w = ec72_fuzz_below(rng, l->words) * 2;
+                    uint8_t op = (uint8_t)(1 + ec72_fuzz_below(rng, OP_MUL));
+                    if (ec72_fuzz_below(rng, 16) == 0) op = OP_HLT;
+                    buf[w] = (uint8_t)ec72_fuzz_rand(rng);
+                    buf[w + 1] = op;
+                }
+                break;
+            case 5:
+                // Copy a block inside the input
+                if (len > 1) {
+                    size_t from = ec72_fuzz_below(rng, (uint32_t)len);
+                    size_t n = 1 + ec72_fuzz_below(rng, (uint32_t)(len - (from > pos ? from : pos)));
+                    memmove(buf + pos, buf + from, n);
+                }
+                break;
+            case 6:
+                // Insert bytes into the bus part
+                if (l->io && len < l->max_len) {
+                    size_t at = range + ec72_fuzz_below(rng, (uint32_t)(len - range + 1));
+                    size_t n = 1 + ec72_fuzz_below(rng, 8);
+                    if (n > l->max_len - len) n = l->max_len - len;
+                    memmove(buf + at + n, buf + at, len - at);
+                    for (size_t i = 0; i < n; i++) buf[at + i] = (uint8_t)ec72_fuzz_rand(rng);
+                    len += n;
+                }
+                break;
+            case 7:
+                // Delete bytes from the bus part
+                if (l->io && len > range) {
+                    size_t at = range + ec72_fuzz_below(rng, (uint32_t)(len - range));
+                    size_t n = 1 + ec72_fuzz_below(rng, (uint32_t)(len - at < 8 ? len - at : 8));
+                    memmove(buf + at, buf + at + n, len - at - n);
+                    len -= n;
+                }
+                break;
+            default:
+                // Cross over: the rest of the input from the other one
+                if (splice && splice_len > pos) {
+                    size_t n = splice_len - pos;
+                    if (!l->io && pos + n > range) n = range - pos;
+                    memcpy(buf + pos, splice + pos, n);
+                    if (pos + n > len) len = pos + n;
+                }
+                break;
+        }
+    }
+    return len;
+}
+
+void ec72_fuzz_apply(const ec72_fuzz_layout_t *l, ec72_cpu_t *cpu, struct ec72_bus *bus,
+                     const uint8_t *buf, size_t len) {
+    size_t range = (size_t)l->words * 2;
+    for (size_t i = 0; i < l->words && 2 * i + 1 < len; i++) {
+        cpu->memory[(uint8_t)(l->addr + i)] = (uint16_t)(buf[2 * i] | (buf[2 * i + 1] << 8));
+    }
+    ec72_cpu_invalidate(cpu);
+    if (l->io && bus) {
+        ec72_bus_clear_input(bus);
+        if (len > range) ec72_bus_feed(bus, buf + range, len - range);
+    }
+}
+
+void ec72_fuzz_random_program(ec72_fuzz_program_t *p, uint64_t *rng) {
+    memset(p, 0, sizeof(*p));
+    unsigned code = 16 + ec72_fuzz_below(rng, 200);
+    p->entry = 0;
+    p->stufr = (uint8_t)(0xFF - ec72_fuzz_below(rng, 8));
+    p->stofr = (uint8_t)(p->stufr - 16 - ec72_fuzz_below(rng, 32));
+
+    for (unsigned a = 0; a < code; a++) {
+        uint8_t op = (uint8_t)(1 + ec72_fuzz_below(rng, OP_MUL));
+        // Fewer pops than pushes, or most runs end in an underflow
+        if ((op == OP_RET || op == OP_POP) && ec72_fuzz_below(rng, 2)) op = OP_PUSH;
+        uint8_t operand = (uint8_t)ec72_fuzz_rand(rng);
+        switch (ec72_operand_kind(op)) {
+            case EC72_ARG_REG:
+                operand = (uint8_t)(REG_A + ec72_fuzz_below(rng, 5));
+                break;
+            case EC72_ARG_REG_PAIR:
+                operand = (uint8_t)((REG_A + ec72_fuzz_below(rng, 5)) << 4 | (REG_A + ec72_fuzz_below(rng, 5)));
+                break;
+            case EC72_ARG_TARGET:
+                operand = (uint8_t)ec72_fuzz_below(rng, code);
+                break;
+            default:
+                break;
+        }
+        // Stack bounds that keep some room, most of the time
+        if (op == OP_SSTOF && ec72_fuzz_below(rng, 4)) operand = p->stofr;
+        if (op == OP_SSTUF && ec72_fuzz_below(rng, 4)) operand = p->stufr;
+        if (op == OP_ADDSP || op == OP_SUBSP) operand &= 3;
+        // Faults and halts, rarely
+        if (ec72_fuzz_below(rng, 64) == 0) op = OP_HLT;
+        if (ec72_fuzz_below(rng, 256) == 0) op = (uint8_t)ec72_fuzz_rand(rng);
+        if (ec72_fuzz_below(rng, 128) == 0) operand = (uint8_t)ec72_fuzz_rand(rng);
+        p->words[a] = EC72_WORD(op, operand);
+    }
+    // Falling off the end starts over
+    p->words[code - 1] = EC72_WORD(OP_JMP, 0);
+    // Data behind the code, addressed by the loads, stores and RB
+    for (unsigned a = code; a < EC72_MEM_SIZE; a++) {
+        p->words[a] = (uint16_t)ec72_fuzz_below(rng, 4 * EC72_MEM_SIZE);
+    }
+}
+
+typedef struct {
+    uint64_t count;
+    uint32_t hash;              // FNV-1a over the values
+} Out_t;
+
+static void record_out(void *user, uint8_t value) {
+    Out_t *o = user;
+    o->count++;
+    o->hash = (o->hash ^ value) * 16777619u;
+}
+
+bool ec72_fuzz_compare(ec72_cpu_t *a, ec72_cpu_t *b, const ec72_fuzz_program_t *p,
+                       uint64_t budget, uint64_t *rng, char *why, size_t size) {
+    Out_t out_a = { 0, 2166136261u }, out_b = { 0, 2166136261u };
+    ec72_cpu_t *both[2] = { a, b };
+    Out_t *outs[2] = { &out_a, &out_b };
+    for (int i = 0; i < 2; i++) {
+        ec72_cpu_load_words(both[i], p->words, EC72_MEM_SIZE);
+        ec72_cpu_set_start(both[i], p->entry, p->stofr, p->stufr);
+        ec72_cpu_set_output(both[i], record_out, outs[i]);
+    }
+
+    ec72_status_t sa = ec72_cpu_run(a, budget);
+    ec72_status_t sb = EC72_OK;
+    uint64_t left = budget;
+    unsigned pieces = 1 + ec72_fuzz_below(rng, 3);
+    while (left && sb == EC72_OK) {
+        uint64_t n = --pieces ? 1 + ec72_fuzz_below(rng, (uint32_t)(left < UINT32_MAX ? left : UINT32_MAX)) : left;
+        sb = ec72_cpu_run(b, n);
+        left -= n;
+    }
+    ec72_cpu_set_output(a, NULL, NULL);
+    ec72_cpu_set_output(b, NULL, NULL);
+
+#define DIFFER(field)                                                       \
+    if (a->field != b->field) {                                             \
+        snprintf(why, size, "%s: %llu vs %llu", #field,                     \
+                 (unsigned long long)a->field, (unsigned long long)b->field); \
+        return false;                                                       \
+    }
+    if (sa != sb) {
+        snprintf(why, size, "status: %s vs %s", ec72_status_str(sa), ec72_status_str(sb));
+        return false;
+    }
+    DIFFER(retired)
+    DIFFER(PC) DIFFER(IR) DIFFER(RA) DIFFER(RB) DIFFER(RC) DIFFER(RE)
+    DIFFER(SP) DIFFER(STOFR) DIFFER(STUFR) DIFFER(MAR) DIFFER(BANK)
+    DIFFER(ZF) DIFFER(NF) DIFFER(OF)
+#undef DIFFER
+    for (int i = 0; i < EC72_MEM_SIZE; i++) {
+        if (a->memory[i] != b->memory[i]) {
+            snprintf(why, size, "memory[0x%02X]: 0x%04X vs 0x%04X", i, a->memory[i], b->memory[i]);
+            return false;
+        }
+    }
+    if (out_a.count != out_b.count || out_a.hash != out_b.hash) {
+        snprintf(why, size, "OUT: %llu values (hash %08X) vs %llu (hash %08X)",
+                 (unsigned long long)out_a.count, out_a.hash, (unsigned long long)out_b.count, out_b.hash);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,123 @@
+//Copyright © Martin H. Sharp; August 2025
+// Coverage-guided fuzzing and differential testing support.
+//
+// Coverage is the set of control-flow edges a run took: every JMPN, JMPZ,
+// JMPO, JMP, CALL and RET adds the edge (address of the instruction, PC
+// after it), taken or not. With 256 addresses that is exactly 65536 edges,
+// so the map needs no hashing. Per edge the run's hit count is classed into
+// AFL-style buckets (1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+); a run is
+// interesting when it reaches an edge or a bucket no earlier run did.
+//
+// Recording uses a separate loop of the reference interpreter that runs
+// while cpu->cov is set; without it, runs take the normal engines.
+//
+// The global map is shared by any number of threads, each with its own
+// ec72_cov_t: merging only uses atomic ORs.
+#ifndef EC72_FUZZ_H
+#define EC72_FUZZ_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "ec72_cpu.h"
+
+#define EC72_COV_EDGES (EC72_MEM_SIZE * EC72_MEM_SIZE)
+
+// Per-run edge counts of one context
+typedef struct ec72_cov {
+    uint8_t hits[EC72_COV_EDGES];       // saturating at 255
+    uint16_t touched[EC72_COV_EDGES];   // edges with hits != 0, in first-hit order
+    uint32_t touched_count;
+} ec72_cov_t;
+
+// Edges and buckets seen by all runs so far
+typedef struct {
+    uint8_t seen[EC72_COV_EDGES];       // bucket bits per edge
+    uint32_t edges;                     // edges with at least one bucket
+} ec72_cov_map_t;
+
+void ec72_cov_init(ec72_cov_t *c);
+void ec72_cov_map_init(ec72_cov_map_t *m);
+
+// NULL detaches
+static inline void ec72_cpu_set_cov(ec72_cpu_t *cpu, ec72_cov_t *c) {
+    cpu->cov = c;
+}
+
+static inline bool ec72_cov_is_branch(uint8_t op) {
+    return (op >= OP_JMPN && op <= OP_JMP) || op == OP_CALL || op == OP_RET;
+}
+
+static inline void ec72_cov_edge(ec72_cov_t *c, uint8_t from, uint8_t to) {
+    uint16_t e = (uint16_t)(from << 8 | to);
+    if (c->hits[e] == 0) c->touched[c->touched_count++] = e;
+    if (c->hits[e] != 255) c->hits[e]++;
+}
+
+// Folds the run into m and clears c for the next run. Returns how many
+// (edge, bucket) pairs were new to m.
+uint32_t ec72_cov_merge(ec72_cov_t *c, ec72_cov_map_t *m);
+// Clears c without looking at it
+void ec72_cov_discard(ec72_cov_t *c);
+
+// ---------------------------------------------------------------------------
+// Inputs and mutation
+
+// xorshift64*; the state must not be 0
+static inline uint64_t ec72_fuzz_rand(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static inline uint32_t ec72_fuzz_below(uint64_t *state, uint32_t n) {
+    return (uint32_t)((ec72_fuzz_rand(state) >> 32) % n);
+}
+
+// One input of a program: words for the fuzzed memory range, then the
+// bytes queued on the bus input
+typedef struct {
+    uint8_t addr, words;                // fuzzed range memory[addr .. addr+words)
+    bool io;                            // bytes after the range go to the bus
+    size_t max_len;                     // longest input (range bytes + bus bytes)
+} ec72_fuzz_layout_t;
+
+// A few stacked random edits of buf (len bytes, capacity l->max_len): bit
+// flips, interesting bytes and words, small additions, and for the bus part
+// inserts and deletes. splice (may be NULL) is another input to cross
+// over with. Returns the new length.
+size_t ec72_fuzz_mutate(const ec72_fuzz_layout_t *l, uint8_t *buf, size_t len,
+                        const uint8_t *splice, size_t splice_len, uint64_t *rng);
+
+// Puts an input in place after ec72_cpu_reset(): the range words into
+// memory and the rest onto bus (may be NULL without l->io), replacing what
+// was queued before
+void ec72_fuzz_apply(const ec72_fuzz_layout_t *l, ec72_cpu_t *cpu, struct ec72_bus *bus,
+                     const uint8_t *buf, size_t len);
+
+// ---------------------------------------------------------------------------
+// Differential testing
+
+// Random program with the stack bounds it starts with: mostly valid
+// instructions with valid register operands, jumps inside the program and
+// some data words, so runs get far before they fault
+typedef struct {
+    uint16_t words[EC72_MEM_SIZE];
+    uint8_t entry, stofr, stufr;
+} ec72_fuzz_program_t;
+
+void ec72_fuzz_random_program(ec72_fuzz_program_t *p, uint64_t *rng);
+
+// Loads p into a and b (engines as set on them), runs a for budget
+// instructions in one go and b for the same in 1-3 pieces (rng picks the
+// split), and compares status, retired count, registers, flags, memory and
+// what OUT printed. Returns false and describes the first difference in
+// why (size bytes) when they disagree.
+bool ec72_fuzz_compare(ec72_cpu_t *a, ec72_cpu_t *b, const ec72_fuzz_program_t *p,
+                       uint64_t budget, uint64_t *rng, char *why, size_t size);
+
+#endif
@@ -0,0 +1,623 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdarg.h>
+#include "ec72_gdb.h"
+#include "ec72_journal.h"
+#ifndef _WIN32
+    #include <unistd.h>
+    #include <errno.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+#endif
+
+#define RUN_CHUNK (1u << 20)    // instructions between checks for ^C while continuing
+
+void ec72_dbg_init(ec72_dbg_t *d) {
+    memset(d, 0, sizeof(*d));
+}
+
+static bool set_bit(uint32_t *map, uint8_t addr, bool on) {
+    bool was = ec72_dbg_bit(map, addr);
+    if (on) map[addr >> 5] |= 1u << (addr & 31);
+    else map[addr >> 5] &= ~(1u << (addr & 31));
+    return was != on;
+}
+
+bool ec72_dbg_set_break(ec72_dbg_t *d, uint8_t addr, bool on) {
+    if (!set_bit(d->bp, addr, on)) return false;
+    if (on) d->bp_count++;
+    else d->bp_count--;
+    return true;
+}
+
+bool ec72_dbg_set_watch(ec72_dbg_t *d, uint8_t addr, bool read, bool write, bool on) {
+    bool changed = false;
+    if (read) changed |= set_bit(d->wp_read, addr, on);
+    if (write) changed |= set_bit(d->wp_write, addr, on);
+    d->wp_count = 0;
+    for (int a = 0; a < EC72_MEM_SIZE; a++) {
+        if (ec72_dbg_bit(d->wp_read, (uint8_t)a) || ec72_dbg_bit(d->wp_write, (uint8_t)a)) d->wp_count++;
+    }
+    return changed;
+}
+
+void ec72_dbg_access(const ec72_cpu_t *cpu, ec72_access_t *a) {
+    uint16_t IR = cpu->memory[cpu->PC];
+    uint8_t operand = EC72_OPERAND(IR);
+    a->read = a->read2 = a->write = -1;
+    a->len = 1;
+    switch (EC72_OPCODE(IR)) {
+        case OP_MOVA: case OP_MOVB: case OP_MOVC: case OP_MOVE: a->read = operand; break;
+        case OP_STORA: case OP_STORB: case OP_STORC: case OP_STORE: a->write = operand; break;
+        case OP_XCHG: case OP_CAS: a->read = a->write = operand; break;
+        case OP_MOVA_PTRB: a->read = cpu->RB; break;
+        case OP_STORA_PTRB: a->write = cpu->RB; break;
+        case OP_PUSH: case OP_CALL: a->write = (uint8_t)(cpu->SP - 1); break;
+        case OP_POP: case OP_RET: a->read = cpu->SP; break;
+        case OP_BCOPY: a->read = cpu->RC; a->write = cpu->RB; a->len = cpu->RE; break;
+        case OP_BFILL: a->write = cpu->RB; a->len = cpu->RE; break;
+        case OP_BCMP: a->read = cpu->RB; a->read2 = cpu->RC; a->len = cpu->RE; break;
+        default: break;
+    }
+}
+
+int ec72_dbg_find(const uint32_t *map, int addr, int len) {
+    if (addr < 0) return -1;
+    for (int i = 0; i < len; i++) {
+        if (ec72_dbg_bit(map, (uint8_t)(addr + i))) return (uint8_t)(addr + i);
+    }
+    return -1;
+}
+
+#ifndef _WIN32
+
+bool ec72_gdb_listen(ec72_gdb_t *g, const char *where) {
+    memset(g, 0, sizeof(*g));
+    g->listen_fd = g->fd = -1;
+    ec72_dbg_init(&g->dbg);
+
+    int fd;
+    if (strchr(where, '/')) {
+        struct sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        if (strlen(where) >= sizeof(sa.sun_path)) {
+            fprintf(stderr, "Socket path too long: %s\n", where);
+            return false;
+        }
+        strcpy(sa.sun_path, where);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            perror("socket");
+            return false;
+        }
+        unlink(where);
+        if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+            perror("Error binding debugger socket");
+            close(fd);
+            return false;
+        }
+        g->unix_path = malloc(strlen(where) + 1);
+        if (g->unix_path) strcpy(g->unix_path, where);
+    } else {
+        const char *colon = strrchr(where, ':');
+        long port = strtol(colon ? colon + 1 : where, NULL, 10);
+        if (port <= 0 || port > 65535) {
+            fprintf(stderr, "Invalid debugger port: %s\n", where);
+            return false;
+        }
+        struct sockaddr_in sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons((uint16_t)port);
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);       // never reachable from other hosts
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            perror("socket");
+            return false;
+        }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+            perror("Error binding debugger port");
+            close(fd);
+            return false;
+        }
+    }
+    if (listen(fd, 1) < 0) {
+        perror("listen");
+        close(fd);
+        return false;
+    }
+    g->listen_fd = fd;
+    return true;
+}
+
+void ec72_gdb_close(ec72_gdb_t *g) {
+    if (g->fd >= 0) close(g->fd);
+    if (g->listen_fd >= 0) close(g->listen_fd);
+    g->fd = g->listen_fd = -1;
+    if (g->unix_path) {
+        unlink(g->unix_path);
+        free(g->unix_path);
+        g->unix_path = NULL;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Packet layer
+
+// Next received byte, -1 when the connection is gone
+static int get_byte(ec72_gdb_t *g) {
+    if (g->in_pos == g->in_len) {
+        ssize_t got;
+        do {
+            got = recv(g->fd, g->in, sizeof(g->in), 0);
+        } while (got < 0 && errno == EINTR);
+        if (got <= 0) return -1;
+        g->in_pos = 0;
+        g->in_len = (size_t)got;
+    }
+    return (unsigned char)g->in[g->in_pos++];
+}
+
+static bool send_all(ec72_gdb_t *g, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t sent = send(g->fd, data, len, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        data += sent;
+        len -= (size_t)sent;
+    }
+    return true;
+}
+
+static bool reply(ec72_gdb_t *g, const char *fmt, ...) {
+    char body[2048];
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(body, sizeof(body), fmt, ap);
+    va_end(ap);
+    if (len < 0 || (size_t)len >= sizeof(body)) len = 0;
+
+    char packet[sizeof(body) + 4];
+    uint8_t sum = 0;
+    for (int i = 0; i < len; i++) sum += (uint8_t)body[i];
+    int n = snprintf(packet, sizeof(packet), "$%.*s#%02x", len, body, sum);
+    return send_all(g, packet, (size_t)n);
+}
+
+// One command into buf (without $ and checksum); false when the connection
+// is gone. Acks, stray ^C and packets with a bad checksum are skipped.
+static bool read_packet(ec72_gdb_t *g, char *buf, size_t size) {
+    for (;;) {
+        int c;
+        do {
+            c = get_byte(g);
+            if (c < 0) return false;
+        } while (c != '$');
+
+        size_t len = 0;
+        uint8_t sum = 0;
+        while ((c = get_byte(g)) != '#') {
+            if (c < 0) return false;
+            sum += (uint8_t)c;
+            if (len + 1 < size) buf[len++] = (char)c;
+        }
+        buf[len] = '\0';
+        char hex[3] = { 0, 0, 0 };
+        for (int i = 0; i < 2; i++) {
+            if ((c = get_byte(g)) < 0) return false;
+            hex[i] = (char)c;
+        }
+        if (!g->no_ack) {
+            bool ok = (uint8_t)strtoul(hex, NULL, 16) == sum;
+            if (!send_all(g, ok ? "+" : "-", 1)) return false;
+            if (!ok) continue;
+        }
+        return true;
+    }
+}
+
+// ^C from the debugger while the program runs
+static bool interrupted(ec72_gdb_t *g) {
+    for (size_t i = g->in_pos; i < g->in_len; i++) {
+        if (g->in[i] == 0x03) {
+            g->in_pos = i + 1;
+            return true;
+        }
+    }
+    struct pollfd p = { .fd = g->fd, .events = POLLIN };
+    if (poll(&p, 1, 0) <= 0) return false;
+    int c = get_byte(g);
+    return c == 0x03 || c < 0;
+}
+
+// ---------------------------------------------------------------------------
+// Commands
+
+#define REG_COUNT 11
+
+static unsigned reg_size(int r) {
+    return r >= 9 ? 2 : 1;
+}
+
+static uint16_t reg_get(const ec72_cpu_t *cpu, int r) {
+    switch (r) {
+        case 0: return cpu->RA;
+        case 1: return cpu->RB;
+        case 2: return cpu->RC;
+        case 3: return cpu->RE;
+        case 4: return cpu->SP;
+        case 5: return cpu->PC;
+        case 6: return cpu->STOFR;
+        case 7: return cpu->STUFR;
+        case 8: return (uint16_t)(cpu->ZF | (cpu->NF << 1) | (cpu->OF << 2));
+        case 9: return cpu->IR;
+        default: return cpu->MAR;
+    }
+}
+
+static void reg_set(ec72_cpu_t *cpu, int r, uint16_t v) {
+    switch (r) {
+        case 0: cpu->RA = (uint8_t)v; break;
+        case 1: cpu->RB = (uint8_t)v; break;
+        case 2: cpu->RC = (uint8_t)v; break;
+        case 3: cpu->RE = (uint8_t)v; break;
+        case 4: cpu->SP = (uint8_t)v; break;
+        case 5: cpu->PC = (uint8_t)v; break;
+        case 6: cpu->STOFR = (uint8_t)v; break;
+        case 7: cpu->STUFR = (uint8_t)v; break;
+        case 8: cpu->ZF = v & 1; cpu->NF = (v >> 1) & 1; cpu->OF = (v >> 2) & 1; break;
+        case 9: cpu->IR = v; break;
+        default: cpu->MAR = v; break;
+    }
+}
+
+static char *put_hex(char *p, uint16_t v, unsigned bytes) {
+    for (unsigned i = 0; i < bytes; i++) p += sprintf(p, "%02x", (v >> (8 * i)) & 0xFF);
+    return p;
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Little-endian value of bytes hex bytes at *p; false if malformed
+static bool get_hex(const char **p, unsigned bytes, uint16_t *v) {
+    *v = 0;
+    for (unsigned i = 0; i < bytes; i++) {
+        int hi = hex_digit((*p)[0]), lo = hi < 0 ? -1 : hex_digit((*p)[1]);
+        if (lo < 0) return false;
+        *v |= (uint16_t)((hi << 4 | lo) << (8 * i));
+        *p += 2;
+    }
+    return true;
+}
+
+// Byte view of memory: word w at 2w (low) and 2w+1
+static uint8_t mem_byte(const ec72_cpu_t *cpu, unsigned a) {
+    uint16_t w = cpu->memory[a >> 1];
+    return (a & 1) ? (uint8_t)(w >> 8) : (uint8_t)w;
+}
+
+static void mem_set_byte(ec72_cpu_t *cpu, unsigned a, uint8_t v) {
+    uint16_t *w = &cpu->memory[a >> 1];
+    *w = (a & 1) ? (uint16_t)((*w & 0x00FF) | (v << 8)) : (uint16_t)((*w & 0xFF00) | v);
+}
+
+// Registers or memory written by the debugger
+static void changed(ec72_cpu_t *cpu) {
+    ec72_cpu_invalidate(cpu);
+    if (cpu->journal) ec72_journal_cut(cpu->journal);
+}
+
+static bool stop_reply(ec72_gdb_t *g, const ec72_cpu_t *cpu, ec72_status_t s) {
+    switch (s) {
+        case EC72_HALTED: return reply(g, "W00");
+        case EC72_ERR_STACK_OVERFLOW: case EC72_ERR_STACK_UNDERFLOW: return reply(g, "S0b");
+        case EC72_OK: break;
+        default: return reply(g, "S04");
+    }
+    switch (g->dbg.stop) {
+        case EC72_STOP_BREAK: return reply(g, "T05swbreak:;");
+        case EC72_STOP_WATCH_WRITE: return reply(g, "T05watch:%x;", 2u * g->dbg.stop_addr);
+        case EC72_STOP_WATCH_READ: return reply(g, "T05rwatch:%x;", 2u * g->dbg.stop_addr);
+        default: return reply(g, "S05");
+    }
+    (void)cpu;
+}
+
+// s/c [addr]
+static bool resume(ec72_gdb_t *g, ec72_cpu_t *cpu, const char *args, bool step) {
+    if (*args) {
+        cpu->PC = (uint8_t)(strtoul(args, NULL, 16) >> 1);
+        changed(cpu);
+    }
+    g->dbg.resuming = true;
+    g->dbg.stop = EC72_STOP_NONE;
+    ec72_status_t s = cpu->status;
+
+    // After going back, forward first replays the journal; the program only
+    // runs again from its newest position
+    ec72_journal_t *j = cpu->journal;
+    if (j && j->pos < j->end) {
+        if (step) ec72_journal_seek(j, cpu, j->pos + 1);
+        else ec72_journal_replay(j, cpu, &g->dbg);
+        s = cpu->status;
+        if (step || g->dbg.stop != EC72_STOP_NONE || s != EC72_OK) {
+            g->dbg.resuming = false;
+            return stop_reply(g, cpu, s);
+        }
+    }
+    if (step) {
+        s = ec72_cpu_step(cpu);
+    } else {
+        while (s == EC72_OK) {
+            s = ec72_cpu_run(cpu, RUN_CHUNK);
+            if (s != EC72_OK || g->dbg.stop != EC72_STOP_NONE) break;
+            if (interrupted(g)) return reply(g, "S02");
+        }
+    }
+    g->dbg.resuming = false;
+    return stop_reply(g, cpu, s);
+}
+
+// bs/bc: reverse step and continue over the journal
+static bool reverse(ec72_gdb_t *g, ec72_cpu_t *cpu, bool step) {
+    ec72_journal_t *j = cpu->journal;
+    if (!j) return reply(g, "E01");
+    g->dbg.stop = EC72_STOP_NONE;
+    if (j->pos == ec72_journal_first(j)) return reply(g, "T05replaylog:begin;");
+    if (step) {
+        ec72_journal_seek(j, cpu, j->pos - 1);
+        return reply(g, "S05");
+    }
+    if (ec72_journal_reverse(j, cpu, &g->dbg) == EC72_STOP_NONE) return reply(g, "T05replaylog:begin;");
+    return stop_reply(g, cpu, EC72_OK);
+}
+
+// Z/z type,addr,kind
+static bool point(ec72_gdb_t *g, const char *args, bool on) {
+    char *end;
+    long type = strtol(args, &end, 16);
+    if (*end != ',') return reply(g, "E01");
+    unsigned long addr = strtoul(end + 1, &end, 16);
+    unsigned long len = *end == ',' ? strtoul(end + 1, NULL, 16) : 1;
+    if (addr >= 2 * EC72_MEM_SIZE) return reply(g, "E01");
+    if (len == 0) len = 1;
+    uint8_t first = (uint8_t)(addr >> 1);
+    unsigned last = (unsigned)((addr + len - 1) >> 1);
+    if (last >= EC72_MEM_SIZE) last = EC72_MEM_SIZE - 1;
+
+    switch (type) {
+        case 0: case 1:
+            ec72_dbg_set_break(&g->dbg, first, on);
+            break;
+        case 2: case 3: case 4:
+            for (unsigned a = first; a <= last; a++) {
+                ec72_dbg_set_watch(&g->dbg, (uint8_t)a, type != 2, type != 3, on);
+            }
+            break;
+        default:
+            return reply(g, "");
+    }
+    return reply(g, "OK");
+}
+
+// monitor commands (qRcmd) for the journal; the answer is hex-encoded text
+static bool monitor(ec72_gdb_t *g, ec72_cpu_t *cpu, const char *hex) {
+    char line[256], text[256];
+    size_t len = 0;
+    uint16_t v;
+    while (len + 1 < sizeof(line) && get_hex(&hex, 1, &v)) line[len++] = (char)v;
+    line[len] = '\0';
+
+    ec72_journal_t *j = cpu->journal;
+    unsigned long long n;
+    if (!j) {
+        snprintf(text, sizeof(text), "No journal (start EC72CPU with -journal)\n");
+    } else if (sscanf(line, "goto %llu", &n) == 1) {
+        bool ok = ec72_journal_seek_time(j, cpu, n);
+        snprintf(text, sizeof(text), "%sposition %llu, %s %llu\n", ok ? "" : "not recorded; ",
+                 (unsigned long long)j->pos, j->timed ? "cycle" : "instruction",
+                 (unsigned long long)(j->timed ? cpu->cycles : cpu->retired));
+    } else if (sscanf(line, "pos %llu", &n) == 1) {
+        bool ok = ec72_journal_seek(j, cpu, n);
+        snprintf(text, sizeof(text), "%sposition %llu\n", ok ? "" : "not recorded; ", (unsigned long long)j->pos);
+    } else if (sscanf(line, "lastwrite %llx", &n) == 1 && n < EC72_MEM_SIZE) {
+        bool ok = ec72_journal_last_write(j, cpu, (uint8_t)n);
+        snprintf(text, sizeof(text), ok ? "position %llu, PC=%02X\n" : "no write of 0x%02llX recorded\n",
+                 ok ? (unsigned long long)j->pos : n, cpu->PC);
+    } else {
+        snprintf(text, sizeof(text), "journal: positions %llu-%llu, at %llu, %zu bytes\n"
+                 "commands: goto <cycle>, pos <position>, lastwrite <hex word address>\n",
+                 (unsigned long long)ec72_journal_first(j), (unsigned long long)j->end,
+                 (unsigned long long)j->pos, ec72_journal_bytes(j));
+    }
+
+    char out[2 * sizeof(text) + 1], *p = out;
+    for (const char *t = text; *t; t++) p = put_hex(p, (uint8_t)*t, 1);
+    *p = '\0';
+    return reply(g, "%s", out);
+}
+
+static bool query(ec72_gdb_t *g, ec72_cpu_t *cpu, const char *q) {
+    if (strncmp(q, "qSupported", 10) == 0) {
+        return reply(g, "PacketSize=1000;QStartNoAckMode+;swbreak+%s",
+                     cpu->journal ? ";ReverseStep+;ReverseContinue+" : "");
+    }
+    if (strncmp(q, "qRcmd,", 6) == 0) return monitor(g, cpu, q + 6);
+    if (strcmp(q, "QStartNoAckMode") == 0) {
+        bool ok = reply(g, "OK");
+        g->no_ack = true;
+        return ok;
+    }
+    if (strcmp(q, "qAttached") == 0) return reply(g, "1");
+    if (strcmp(q, "qC") == 0) return reply(g, "QC1");
+    if (strcmp(q, "qfThreadInfo") == 0) return reply(g, "m1");
+    if (strcmp(q, "qsThreadInfo") == 0) return reply(g, "l");
+    return reply(g, "");
+}
+
+ec72_gdb_end_t ec72_gdb_serve(ec72_gdb_t *g, ec72_cpu_t *cpu) {
+    do {
+        g->fd = accept(g->listen_fd, NULL, NULL);
+    } while (g->fd < 0 && errno == EINTR);
+    if (g->fd < 0) {
+        perror("accept");
+        return EC72_GDB_DETACHED;
+    }
+    if (!g->unix_path) {
+        int one = 1;
+        setsockopt(g->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    ec72_cpu_set_dbg(cpu, &g->dbg);
+
+    ec72_gdb_end_t end = EC72_GDB_DETACHED;
+    static char cmd[4096];
+    char out[2 * 2 * EC72_MEM_SIZE + 64];
+    bool alive = true;
+    while (alive && read_packet(g, cmd, sizeof(cmd))) {
+        const char *args = cmd + 1;
+        switch (cmd[0]) {
+            case '?':
+                alive = cpu->status == EC72_OK ? reply(g, "S05") : stop_reply(g, cpu, cpu->status);
+                break;
+            case 'g': {
+                char *p = out;
+                for (int r = 0; r < REG_COUNT; r++) p = put_hex(p, reg_get(cpu, r), reg_size(r));
+                alive = reply(g, "%s", out);
+                break;
+            }
+            case 'G': {
+                uint16_t v[REG_COUNT];
+                bool ok = true;
+                for (int r = 0; r < REG_COUNT && ok; r++) ok = get_hex(&args, reg_size(r), &v[r]);
+                if (ok) {
+                    for (int r = 0; r < REG_COUNT; r++) reg_set(cpu, r, v[r]);
+                    changed(cpu);
+                }
+                alive = reply(g, ok ? "OK" : "E01");
+                break;
+            }
+            case 'p': {
+                unsigned long r = strtoul(args, NULL, 16);
+                if (r >= REG_COUNT) {
+                    alive = reply(g, "E01");
+                    break;
+                }
+                put_hex(out, reg_get(cpu, (int)r), reg_size((int)r));
+                alive = reply(g, "%s", out);
+                break;
+            }
+            case 'P': {
+                char *eq;
+                unsigned long r = strtoul(args, &eq, 16);
+                uint16_t v;
+                const char *val = eq + 1;
+                if (*eq != '=' || r >= REG_COUNT || !get_hex(&val, reg_size((int)r), &v)) {
+                    alive = reply(g, "E01");
+                    break;
+                }
+                reg_set(cpu, (int)r, v);
+                changed(cpu);
+                alive = reply(g, "OK");
+                break;
+            }
+            case 'm': {
+                char *comma;
+                unsigned long addr = strtoul(args, &comma, 16);
+                unsigned long len = strtoul(comma + 1, NULL, 16);
+                if (*comma != ',' || addr >= 2 * EC72_MEM_SIZE) {
+                    alive = reply(g, "E01");
+                    break;
+                }
+                if (len > 2 * EC72_MEM_SIZE - addr) len = 2 * EC72_MEM_SIZE - addr;
+                char *p = out;
+                for (unsigned long i = 0; i < len; i++) p = put_hex(p, mem_byte(cpu, (unsigned)(addr + i)), 1);
+                *p = '\0';
+                alive = reply(g, "%s", out);
+                break;
+            }
+            case 'M': {
+                char *comma, *colon;
+                unsigned long addr = strtoul(args, &comma, 16);
+                unsigned long len = strtoul(comma + 1, &colon, 16);
+                if (*comma != ',' || *colon != ':' || addr + len > 2 * EC72_MEM_SIZE) {
+                    alive = reply(g, "E01");
+                    break;
+                }
+                const char *data = colon + 1;
+                bool ok = true;
+                for (unsigned long i = 0; i < len && ok; i++) {
+                    uint16_t v;
+                    ok = get_hex(&data, 1, &v);
+                    if (ok) mem_set_byte(cpu, (unsigned)(addr + i), (uint8_t)v);
+                }
+                changed(cpu);
+                alive = reply(g, ok ? "OK" : "E01");
+                break;
+            }
+            case 's': alive = resume(g, cpu, args, true); break;
+            case 'c': alive = resume(g, cpu, args, false); break;
+            case 'Z': alive = point(g, args, true); break;
+            case 'z': alive = point(g, args, false); break;
+            case 'H': case 'T': alive = reply(g, "OK"); break;
+            case 'q': case 'Q': alive = query(g, cpu, cmd); break;
+            case 'b':
+                if (cmd[1] == 's' || cmd[1] == 'c') alive = reverse(g, cpu, cmd[1] == 's');
+                else alive = reply(g, "");
+                break;
+            case 'D':
+                reply(g, "OK");
+                alive = false;
+                break;
+            case 'k':
+                end = EC72_GDB_KILLED;
+                alive = false;
+                break;
+            default:
+                alive = reply(g, "");
+                break;
+        }
+    }
+
+    ec72_cpu_set_dbg(cpu, NULL);
+    close(g->fd);
+    g->fd = -1;
+    return end;
+}
+
+#else
+
+// Sockets are only implemented for POSIX hosts
+bool ec72_gdb_listen(ec72_gdb_t *g, const char *where) {
+    memset(g, 0, sizeof(*g));
+    g->listen_fd = g->fd = -1;
+    fprintf(stderr, "The debugger stub is not available on this platform (%s)\n", where);
+    return false;
+}
+
+ec72_gdb_end_t ec72_gdb_serve(ec72_gdb_t *g, ec72_cpu_t *cpu) {
+    (void)g;
+    (void)cpu;
+    return EC72_GDB_DETACHED;
+}
+
+void ec72_gdb_close(ec72_gdb_t *g) {
+    (void)g;
+}
+
+#endif
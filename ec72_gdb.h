@@ -0,0 +1,92 @@
+//Copyright © Martin H. Sharp; August 2025
+// Breakpoints, watchpoints and a GDB Remote Serial Protocol stub.
+//
+// Breakpoints and watchpoints are bitmaps over the 256 addresses. They are
+// only tested by a separate loop of the reference interpreter that runs
+// while cpu->dbg is set and holds at least one of them; without that, runs
+// take the normal engines with no debug test at all.
+//
+// The stub listens on a TCP port of 127.0.0.1 ("1234", "localhost:1234")
+// or on a Unix socket (any name with a '/'). Packets:
+//   ?  g G  p P  m M  s c  Z0-Z4 z0-z4  D k  qSupported qAttached qC H
+// and, with a journal attached (ec72_journal.h), bs bc and the monitor
+// commands (qRcmd) goto, pos and lastwrite.
+// Registers in g/p order (little endian): RA RB RC RE SP PC STOFR STUFR
+// FLAGS (ZF | NF << 1 | OF << 2) one byte each, then IR and MAR two bytes
+// each. Memory is the 256 words as 512 bytes, word w at byte addresses 2w
+// (low byte) and 2w+1; breakpoints and watchpoints take those addresses too.
+// Stop replies: T05 with swbreak/watch/rwatch, S02 after ^C, W00 on
+// HLT, S0B on stack faults, S04 on unknown opcodes and illegal operands.
+#ifndef EC72_GDB_H
+#define EC72_GDB_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "ec72_cpu.h"
+
+typedef enum {
+    EC72_STOP_NONE = 0,
+    EC72_STOP_BREAK,            // PC reached a breakpoint, instruction not executed
+    EC72_STOP_WATCH_WRITE,      // instruction wrote a watched address, stop_addr
+    EC72_STOP_WATCH_READ        // instruction read a watched address
+} ec72_stop_t;
+
+typedef struct ec72_dbg {
+    uint32_t bp[EC72_MEM_SIZE / 32];
+    uint32_t wp_read[EC72_MEM_SIZE / 32];
+    uint32_t wp_write[EC72_MEM_SIZE / 32];
+    unsigned bp_count, wp_count;
+    bool resuming;              // next instruction leaves a breakpoint, do not stop on it
+    ec72_stop_t stop;           // why the last run returned EC72_OK early
+    uint8_t stop_addr;
+} ec72_dbg_t;
+
+static inline bool ec72_dbg_bit(const uint32_t *map, uint8_t addr) {
+    return (map[addr >> 5] >> (addr & 31)) & 1;
+}
+
+void ec72_dbg_init(ec72_dbg_t *d);
+// Returns false if the point was already set / not set
+bool ec72_dbg_set_break(ec72_dbg_t *d, uint8_t addr, bool on);
+bool ec72_dbg_set_watch(ec72_dbg_t *d, uint8_t addr, bool read, bool write, bool on);
+
+// Breakpoints stop runs of cpu until detached (NULL)
+static inline void ec72_cpu_set_dbg(ec72_cpu_t *cpu, ec72_dbg_t *d) {
+    cpu->dbg = d;
+}
+
+// Memory the next instruction reads and writes: len cells (wrapping past
+// 0xFF) from each of read, read2 and write, -1 for none. One cell except for
+// the block instructions; only BCMP has a read2.
+typedef struct {
+    int read, read2, write;
+    int len;
+} ec72_access_t;
+
+void ec72_dbg_access(const ec72_cpu_t *cpu, ec72_access_t *a);
+// First address of map among the len cells from addr; -1 if none or addr is -1
+int ec72_dbg_find(const uint32_t *map, int addr, int len);
+
+typedef enum {
+    EC72_GDB_DETACHED,          // D, or the debugger went away: keep running
+    EC72_GDB_KILLED             // k
+} ec72_gdb_end_t;
+
+typedef struct {
+    int listen_fd, fd;
+    char *unix_path;            // removed again by ec72_gdb_close()
+    bool no_ack;
+    ec72_dbg_t dbg;
+    char in[4096];              // received bytes, in[in_pos..in_len) not parsed yet
+    size_t in_pos, in_len;
+} ec72_gdb_t;
+
+// Returns false (and prints the reason) if the socket cannot be opened
+bool ec72_gdb_listen(ec72_gdb_t *g, const char *where);
+// Waits for the debugger, then answers it until it detaches or kills
+ec72_gdb_end_t ec72_gdb_serve(ec72_gdb_t *g, ec72_cpu_t *cpu);
+void ec72_gdb_close(ec72_gdb_t *g);
+
+#endif
@@ -0,0 +1,313 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_image.h"
+#include "ec72_isa.h"
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+// ANSI escape codes for colors
+#define CYAN    "\x1b[36m"
+#define RESET   "\x1b[0m"
+
+// Largest file: header, words, symbols (address, length, 255 name bytes), code map
+#define IMG_MAX_FILE (EC72_IMG_HEADER + 3 * EC72_MEM_SIZE + 0xFFFF * 257)
+// Files up to this size are read, larger ones mapped
+#define IMG_READ_LIMIT (16 * 1024)
+
+void ec72_image_init(ec72_image_t *img) {
+    memset(img, 0, sizeof(*img));
+    img->stufr = EC72_MEM_SIZE - 1;
+}
+
+void ec72_image_free(ec72_image_t *img) {
+    ec72_symtab_free(&img->symbols);
+}
+
+void ec72_image_build_code_map(ec72_image_t *img) {
+    uint8_t work[EC72_MEM_SIZE];
+    int top = 0;
+    memset(img->code_map, 0, sizeof(img->code_map));
+    img->has_code_map = true;
+    work[top++] = img->entry;
+    img->code_map[img->entry] = EC72_IMG_CODE | EC72_IMG_LEADER;
+    while (top > 0) {
+        uint8_t pc = work[--top];
+        uint16_t ir = pc < img->word_count ? img->words[pc] : 0;
+        uint8_t op = EC72_OPCODE(ir), operand = EC72_OPERAND(ir);
+        uint8_t next = (uint8_t)(pc + 1);
+        uint8_t succ[2];
+        int n = 0;
+        if (!ec72_opcode_name(op)) continue;    // faults here
+        switch (op) {
+            case OP_JMP:
+                succ[n++] = operand;
+                img->code_map[operand] |= EC72_IMG_LEADER;
+                break;
+            case OP_JMPN: case OP_JMPZ: case OP_JMPO: case OP_CALL:
+                succ[n++] = operand;
+                succ[n++] = next;       // fall-through / return site
+                img->code_map[operand] |= EC72_IMG_LEADER;
+                img->code_map[next] |= EC72_IMG_LEADER;
+                break;
+            case OP_RET: case OP_HLT: break;
+            default: succ[n++] = next; break;
+        }
+        for (int i = 0; i < n; i++) {
+            if (!(img->code_map[succ[i]] & EC72_IMG_CODE)) {
+                img->code_map[succ[i]] |= EC72_IMG_CODE;
+                work[top++] = succ[i];
+            }
+        }
+    }
+}
+
+// CRC-32 (IEEE), four bits per lookup
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t n) {
+    static const uint32_t nibble[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    while (n--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ nibble[crc & 0x0F];
+        crc = (crc >> 4) ^ nibble[crc & 0x0F];
+    }
+    return crc;
+}
+
+// Checksum of a whole file with its CRC field read as 0
+static uint32_t image_crc(const uint8_t *buf, size_t size) {
+    static const uint8_t zero[4] = {0};
+    uint32_t crc = crc32_update(0xFFFFFFFFu, buf, 24);
+    crc = crc32_update(crc, zero, 4);
+    crc = crc32_update(crc, buf + 28, size - 28);
+    return ~crc;
+}
+
+static bool host_big_endian(void) {
+    const uint16_t one = 1;
+    return *(const uint8_t *)&one == 0;
+}
+
+static void put16(uint8_t *p, uint16_t v, bool be) {
+    p[be ? 1 : 0] = (uint8_t)v;
+    p[be ? 0 : 1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v, bool be) {
+    put16(p + (be ? 2 : 0), (uint16_t)v, be);
+    put16(p + (be ? 0 : 2), (uint16_t)(v >> 16), be);
+}
+
+static uint16_t get16(const uint8_t *p, bool be) {
+    return be ? (uint16_t)((p[0] << 8) | p[1]) : (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p, bool be) {
+    return be ? ((uint32_t)get16(p, be) << 16) | get16(p + 2, be)
+              : ((uint32_t)get16(p + 2, be) << 16) | get16(p, be);
+}
+
+static size_t symbol_name_len(const ec72_sym_t *sym) {
+    size_t len = strlen(sym->name);
+    return len > 0xFF ? 0xFF : len;
+}
+
+size_t ec72_image_size(const ec72_image_t *img) {
+    size_t size = EC72_IMG_HEADER + 2 * img->word_count;
+    for (size_t i = 0; i < img->symbols.count && i < 0xFFFF; i++) size += 2 + symbol_name_len(&img->symbols.syms[i]);
+    if (img->has_code_map) size += img->word_count;
+    return size;
+}
+
+size_t ec72_image_encode(const ec72_image_t *img, uint8_t *buf, size_t size) {
+    size_t total = ec72_image_size(img);
+    if (size < total || img->word_count > EC72_MEM_SIZE) return 0;
+    bool be = img->big_endian;
+    size_t symbols = img->symbols.count < 0xFFFF ? img->symbols.count : 0xFFFF;
+
+    memset(buf, 0, EC72_IMG_HEADER);
+    memcpy(buf, EC72_IMG_MAGIC, sizeof(EC72_IMG_MAGIC));
+    buf[8] = EC72_IMG_VERSION;
+    buf[9] = be ? 'B' : 'L';
+    put16(buf + 10, img->has_code_map ? EC72_IMG_HAS_CODE_MAP : 0, be);
+    buf[12] = img->entry;
+    buf[13] = img->stofr;
+    buf[14] = img->stufr;
+    put16(buf + 16, (uint16_t)img->word_count, be);
+    put16(buf + 18, (uint16_t)symbols, be);
+
+    uint8_t *p = buf + EC72_IMG_HEADER;
+    for (size_t i = 0; i < img->word_count; i++, p += 2) put16(p, img->words[i], be);
+    uint8_t *sym_start = p;
+    for (size_t i = 0; i < symbols; i++) {
+        const ec72_sym_t *sym = &img->symbols.syms[i];
+        size_t len = symbol_name_len(sym);
+        *p++ = sym->address;
+        *p++ = (uint8_t)len;
+        memcpy(p, sym->name, len);
+        p += len;
+    }
+    put32(buf + 20, (uint32_t)(p - sym_start), be);
+    if (img->has_code_map) {
+        memcpy(p, img->code_map, img->word_count);
+        p += img->word_count;
+    }
+    put32(buf + 24, image_crc(buf, total), be);
+    return total;
+}
+
+static bool decode_fail(ec72_image_t *img, const char *error) {
+    ec72_image_free(img);
+    ec72_image_init(img);
+    img->error = error;
+    return false;
+}
+
+bool ec72_image_decode(ec72_image_t *img, const uint8_t *buf, size_t size) {
+    ec72_image_init(img);
+
+    // No magic: a raw .bin of host-order words
+    if (size < sizeof(EC72_IMG_MAGIC) || memcmp(buf, EC72_IMG_MAGIC, sizeof(EC72_IMG_MAGIC)) != 0) {
+        img->raw = true;
+        img->word_count = size / 2 < EC72_MEM_SIZE ? size / 2 : EC72_MEM_SIZE;
+        memcpy(img->words, buf, img->word_count * 2);
+        return true;
+    }
+
+    if (size < EC72_IMG_HEADER) return decode_fail(img, "truncated image");
+    if (buf[8] != EC72_IMG_VERSION) return decode_fail(img, "unsupported image version");
+    if (buf[9] != 'L' && buf[9] != 'B') return decode_fail(img, "unknown byte order");
+    bool be = img->big_endian = buf[9] == 'B';
+    uint16_t flags = get16(buf + 10, be);
+    img->entry = buf[12];
+    img->stofr = buf[13];
+    img->stufr = buf[14];
+    img->word_count = get16(buf + 16, be);
+    size_t symbols = get16(buf + 18, be);
+    size_t sym_bytes = get32(buf + 20, be);
+    img->has_code_map = flags & EC72_IMG_HAS_CODE_MAP;
+
+    if (img->word_count > EC72_MEM_SIZE) return decode_fail(img, "more words than memory");
+    size_t total = EC72_IMG_HEADER + 2 * img->word_count + sym_bytes + (img->has_code_map ? img->word_count : 0);
+    if (sym_bytes > size || total > size) return decode_fail(img, "truncated image");
+    if (get32(buf + 24, be) != image_crc(buf, total)) return decode_fail(img, "checksum mismatch");
+
+    const uint8_t *p = buf + EC72_IMG_HEADER;
+    if (be == host_big_endian()) {
+        // File order is host order
+        memcpy(img->words, p, img->word_count * 2);
+    } else {
+        for (size_t i = 0; i < img->word_count; i++) img->words[i] = get16(p + 2 * i, be);
+    }
+    p += 2 * img->word_count;
+
+    const uint8_t *sym_end = p + sym_bytes;
+    for (size_t i = 0; i < symbols; i++) {
+        if (sym_end - p < 2 || sym_end - p - 2 < p[1]) return decode_fail(img, "truncated symbol table");
+        char name[EC72_SYM_NAME_LEN];
+        size_t len = p[1] < sizeof(name) - 1 ? p[1] : sizeof(name) - 1;
+        memcpy(name, p + 2, len);
+        name[len] = '\0';
+        if (!ec72_symtab_add(&img->symbols, name, p[0])) return decode_fail(img, "out of memory");
+        p += 2 + p[1];
+    }
+    ec72_symtab_sort(&img->symbols);
+    p = sym_end;
+
+    if (img->has_code_map) memcpy(img->code_map, p, img->word_count);
+    return true;
+}
+
+bool ec72_image_save(const ec72_image_t *img, const char *path) {
+    size_t size = ec72_image_size(img);
+    uint8_t *buf = malloc(size);
+    if (!buf) {
+        fprintf(stderr, "Out of memory writing image %s\n", path);
+        return false;
+    }
+    size_t n = ec72_image_encode(img, buf, size);
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror("Error opening image file");
+        free(buf);
+        return false;
+    }
+    bool ok = n && fwrite(buf, 1, n, f) == n;
+    if (fclose(f) != 0) ok = false;
+    if (!ok) fprintf(stderr, "Error writing image file %s\n", path);
+    free(buf);
+    return ok;
+}
+
+bool ec72_image_load(ec72_image_t *img, const char *path) {
+    ec72_image_init(img);
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size == 0) {
+        close(fd);
+        return true;        // an empty .bin: no words
+    }
+    if (size > IMG_MAX_FILE) size = IMG_MAX_FILE;
+    // Mapping costs more than it saves below a few pages; a plain .bin is
+    // at most 512 bytes
+    if (size <= IMG_READ_LIMIT) {
+        uint8_t buf[IMG_READ_LIMIT];
+        ssize_t n = read(fd, buf, size);
+        close(fd);
+        return n >= 0 && ec72_image_decode(img, buf, (size_t)n);
+    }
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+    bool ok = ec72_image_decode(img, map, size);
+    munmap(map, size);
+    return ok;
+#else
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    if (size < 0) size = 0;
+    if ((size_t)size > IMG_MAX_FILE) size = IMG_MAX_FILE;
+    uint8_t *buf = malloc(size ? (size_t)size : 1);
+    if (!buf) {
+        fclose(f);
+        img->error = "out of memory";
+        return false;
+    }
+    size_t n = fread(buf, 1, (size_t)size, f);
+    fclose(f);
+    bool ok = ec72_image_decode(img, buf, n);
+    free(buf);
+    return ok;
+#endif
+}
+
+ec72_status_t ec72_cpu_load_image(ec72_cpu_t *cpu, const ec72_image_t *img) {
+    ec72_cpu_load_words(cpu, img->words, img->word_count);
+    if (!img->raw) ec72_cpu_set_start(cpu, img->entry, img->stofr, img->stufr);
+    if (cpu->debug) {
+        printf("%sLoaded %zu instructions into memory%s\n", CYAN, img->word_count, RESET);
+    }
+    return EC72_OK;
+}
@@ -0,0 +1,69 @@
+//Copyright © Martin H. Sharp; August 2025
+// EC72 program images. A raw .bin is nothing but host-order words; an image
+// file carries the words in a stated byte order together with the entry
+// point, the initial stack bounds, the labels, a CRC-32 and optionally a
+// predecoded code map, so it loads the same on every host. Loading maps the
+// file and accepts both forms.
+//
+//   0  magic "EC72IMG\0"         16 word count (u16)
+//   8  version (u8)              18 symbol count (u16)
+//   9  byte order 'L' or 'B'     20 symbol bytes (u32)
+//  10  flags (u16)               24 CRC-32 of the file, this field as 0
+//  12  entry, STOFR, STUFR, 0    28 reserved (u32)
+//  32  words, then per symbol: address, name length, name;
+//      then one code map byte per word if EC72_IMG_HAS_CODE_MAP
+//
+// Multi-byte fields and words are in the byte order named at offset 9.
+#ifndef EC72_IMAGE_H
+#define EC72_IMAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "ec72_cpu.h"
+#include "ec72_sym.h"
+
+#define EC72_IMG_MAGIC   "EC72IMG"
+#define EC72_IMG_VERSION 1
+#define EC72_IMG_HEADER  32
+
+#define EC72_IMG_HAS_CODE_MAP 0x0001   // header flag
+
+// Code map bits, one byte per word
+#define EC72_IMG_CODE   0x01    // reached as an instruction from the entry point
+#define EC72_IMG_LEADER 0x02    // starts a basic block (entry, jump/call target, after a branch)
+
+typedef struct {
+    uint16_t words[EC72_MEM_SIZE];
+    size_t word_count;
+    uint8_t entry;              // PC after reset
+    uint8_t stofr, stufr;       // stack bounds after reset (SP = STUFR)
+    bool raw;                   // read from a headerless .bin
+    bool big_endian;            // byte order of the file
+    ec72_symtab_t symbols;
+    bool has_code_map;
+    uint8_t code_map[EC72_MEM_SIZE];
+    const char *error;          // why the last load failed, NULL: see errno
+} ec72_image_t;
+
+// Empty image with the power-on defaults (entry 0, STOFR 0, STUFR 255)
+void ec72_image_init(ec72_image_t *img);
+void ec72_image_free(ec72_image_t *img);
+
+// Follows every static path from the entry point and fills the code map
+void ec72_image_build_code_map(ec72_image_t *img);
+
+// Encoded size, and encoding into buf; returns 0 if buf is too small
+size_t ec72_image_size(const ec72_image_t *img);
+size_t ec72_image_encode(const ec72_image_t *img, uint8_t *buf, size_t size);
+// Image file contents, or (without the magic) raw host-order words
+bool ec72_image_decode(ec72_image_t *img, const uint8_t *buf, size_t size);
+
+bool ec72_image_save(const ec72_image_t *img, const char *path);
+// Replaces img; false with img->error set (or errno) on failure
+bool ec72_image_load(ec72_image_t *img, const char *path);
+
+// Image words into cpu; entry point and stack bounds apply at every reset
+ec72_status_t ec72_cpu_load_image(ec72_cpu_t *cpu, const ec72_image_t *img);
+
+#endif
@@ -0,0 +1,92 @@
+//Copyright © Martin H. Sharp; August 2025
+// Shared definitions of the EC72 instruction set (see custom_ISA_DOKU.txt)
+#ifndef EC72_ISA_H
+#define EC72_ISA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Memory: 256 addresses, each 16-bit (instruction)
+#define EC72_MEM_SIZE 256
+
+// Register codes
+typedef enum {
+    REG_NONE = 0, REG_A, REG_B,
+    REG_C, REG_E, REG_SP
+} Register_t;
+
+// Opcodes
+typedef enum {
+    OP_MOVR = 0x01,
+    OP_MOVA,        OP_MOVB,        OP_MOVC,    OP_MOVE,
+    OP_STORA,       OP_STORB,       OP_STORC,   OP_STORE,
+    OP_LDIMA,       OP_LDIMB,       OP_LDIMC,   OP_LDIME,
+    OP_JMPN,        OP_JMPZ,        OP_JMPO,    OP_JMP,
+    OP_ADD,         OP_SUB,         OP_ADDR,    OP_SUBR,
+    OP_OUT,         OP_CALL,        OP_RET,     OP_MOVA_PTRB,
+    OP_STORA_PTRB,  OP_PUSH,        OP_POP,     OP_ADDSP,
+    OP_SUBSP,       OP_SSTOF,       OP_SSTUF,   OP_XCHG,
+    OP_CAS,         OP_LDID,        OP_SBANK,   OP_SMAR,
+    OP_FLD,         OP_FST,         OP_BCOPY,   OP_BFILL,
+    OP_BCMP,        OP_MUL,         OP_HLT = 0xFF
+} Opcode_t;
+
+// Instruction format: [ OPCODE ][ OPERAND ]
+#define EC72_OPCODE(ir)  ((uint8_t)(((ir) >> 8) & 0xFF))
+#define EC72_OPERAND(ir) ((uint8_t)((ir) & 0xFF))
+#define EC72_WORD(op, operand) ((uint16_t)(((uint16_t)(op) << 8) | (uint8_t)(operand)))
+
+// Mnemonic of an opcode, NULL if the opcode does not exist
+static inline const char *ec72_opcode_name(uint8_t op) {
+    static const char *const names[] = {
+        NULL,       "MOVR",     "MOVA",     "MOVB",     "MOVC",     "MOVE",
+        "STORA",    "STORB",    "STORC",    "STORE",    "LDIMA",    "LDIMB",
+        "LDIMC",    "LDIME",    "JMPN",     "JMPZ",     "JMPO",     "JMP",
+        "ADD",      "SUB",      "ADDR",     "SUBR",     "OUT",      "CALL",
+        "RET",      "MOVA_PTRB", "STORA_PTRB", "PUSH",  "POP",      "ADDSP",
+        "SUBSP",    "SSTOF",    "SSTUF",    "XCHG",     "CAS",      "LDID",
+        "SBANK",    "SMAR",     "FLD",      "FST",      "BCOPY",    "BFILL",
+        "BCMP",     "MUL"
+    };
+    if (op == OP_HLT) return "HLT";
+    return op < sizeof(names)/sizeof(names[0]) ? names[op] : NULL;
+}
+
+// What the operand byte of an instruction means; the assembler parses and
+// the disassembler prints operands by this
+typedef enum {
+    EC72_ARG_INVALID = 0,       // opcode does not exist
+    EC72_ARG_NONE,              // operand unused (written as 0)
+    EC72_ARG_REG,               // register code
+    EC72_ARG_REG_PAIR,          // MOVR: destination in the high, source in the low nibble
+    EC72_ARG_OPT_REG,           // OUT: register code or 0, may be left out
+    EC72_ARG_ADDR,              // memory address
+    EC72_ARG_TARGET,            // code address (jump/call)
+    EC72_ARG_IMM                // immediate value
+} ec72_arg_t;
+
+static inline ec72_arg_t ec72_operand_kind(uint8_t op) {
+    switch (op) {
+        case OP_MOVR: return EC72_ARG_REG_PAIR;
+        case OP_PUSH: case OP_POP: case OP_ADDR: case OP_SUBR: case OP_MUL: return EC72_ARG_REG;
+        case OP_OUT: return EC72_ARG_OPT_REG;
+        case OP_MOVA: case OP_MOVB: case OP_MOVC: case OP_MOVE:
+        case OP_STORA: case OP_STORB: case OP_STORC: case OP_STORE:
+        case OP_XCHG: case OP_CAS: return EC72_ARG_ADDR;
+        case OP_JMPN: case OP_JMPZ: case OP_JMPO: case OP_JMP: case OP_CALL: return EC72_ARG_TARGET;
+        case OP_LDIMA: case OP_LDIMB: case OP_LDIMC: case OP_LDIME:
+        case OP_ADD: case OP_SUB: case OP_ADDSP: case OP_SUBSP:
+        case OP_SSTOF: case OP_SSTUF: case OP_SBANK: case OP_FLD: case OP_FST: return EC72_ARG_IMM;
+        case OP_RET: case OP_MOVA_PTRB: case OP_STORA_PTRB: case OP_LDID: case OP_SMAR:
+        case OP_BCOPY: case OP_BFILL: case OP_BCMP: case OP_HLT: return EC72_ARG_NONE;
+        default: return EC72_ARG_INVALID;
+    }
+}
+
+// Register name of a code, NULL for REG_NONE and codes that do not exist
+static inline const char *ec72_register_name(uint8_t reg) {
+    static const char *const names[] = { NULL, "RA", "RB", "RC", "RE", "SP" };
+    return reg < sizeof(names)/sizeof(names[0]) ? names[reg] : NULL;
+}
+
+#endif
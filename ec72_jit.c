@@ -0,0 +1,812 @@
+//Copyright © Martin H. Sharp; August 2025
+// x86-64 basic-block JIT.
+//
+// A block runs from its start PC up to and including the first
+// JMP/JMPZ/JMPN/JMPO/CALL/RET/HLT (or MAX_BLOCK instructions, or the end of
+// memory). Blocks are cached by start PC and chained directly: an exit to a
+// static target starts out as a jump to a stub that returns to the runtime,
+// which translates the target and patches the jump. RET looks up its target
+// in the block table from generated code.
+//
+// The code buffer is never writable and executable at once: it is RX while
+// generated code runs and RW only while blocks are translated or patched.
+//
+// Host register allocation while inside generated code:
+//   ebx RA, r12d RB, r13d RC, r14d RE, edi SP (always zero-extended 0..255)
+//   esi  last ALU result; ZF/NF/OF are derived from it on demand, which is
+//        exact because update_flags() is a pure function of that result
+//   rbp  remaining instruction budget, r15 cpu, r9 jit state, r8 code map
+//   r10d address of the last instruction of the previous block (for IR)
+//
+// Everything the generated code does not handle itself leaves through a side
+// exit *before* the instruction, with the unused budget refunded, and the
+// runtime executes that single instruction with the reference interpreter:
+// OUT, XCHG/CAS/LDID, SBANK/SMAR/FLD/FST, the block instructions and MUL,
+// unknown opcodes, invalid register
+// operands, failing stack checks (so overflow/underflow faults are produced
+// by the reference code) and stores that hit an address covered by a
+// translated block. The latter flush the translation cache before the store
+// is performed. Programs in
+// verified mode (ec72_verify.h) are translated without the stack checks and
+// the code map tests on stores. With an I/O bus (ec72_bus.h) loads and
+// stores of device addresses call into the bus from generated code, and
+// MOVA_PTRB/STORA_PTRB side exit when RB points into the window.
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ec72_cpu.h"
+#include "ec72_engine.h"
+#include "ec72_bus.h"
+
+#if defined(__x86_64__) && !defined(_WIN32)
+
+#include <sys/mman.h>
+
+#define JIT_CODE_SIZE   (1u << 20)
+#define MAX_BLOCK       64
+#define BLOCK_RESERVE   (MAX_BLOCK * 96 + 256)    // worst-case bytes per block
+#define COOLDOWN_MIN    256u
+#define COOLDOWN_MAX    (1u << 20)
+
+// Reasons for leaving generated code (jit->reason)
+enum {
+    EXIT_INTERP = 1,    // interpret the instruction at PC, then continue
+    EXIT_BUDGET,        // not enough budget left for the block at PC
+    EXIT_CHAIN,         // static target PC not translated yet; patch jit->patch
+    EXIT_DISPATCH,      // dynamic (RET) target PC not translated yet
+    EXIT_HALT           // HLT retired, PC points behind it
+};
+
+typedef struct ec72_jit {
+    // Addressed from generated code through r9; block_entry must stay first
+    uint8_t *block_entry[EC72_MEM_SIZE];
+    uint8_t code_map[EC72_MEM_SIZE];        // address is part of a translated block
+    uint64_t budget;
+    int32_t flags;
+    uint32_t reason;
+    int32_t last_pc;
+    uint8_t *patch;
+
+    // Runtime side
+    uint8_t *code;                          // JIT_CODE_SIZE bytes, RW or RX
+    bool writable;                          // code is mapped RW, else RX
+    uint8_t *blocks;                        // first byte after the fixed stubs
+    uint8_t *cursor;
+    uint8_t *exit_stub;
+    void (*enter)(ec72_cpu_t *cpu, struct ec72_jit *jit, void *entry);
+    uint32_t epoch;
+    const ec72_cpu_t *owner;
+    uint32_t generation;                    // bumped by every flush
+    uint32_t smc_flushes;
+    uint64_t cooldown;                      // instructions to interpret before re-entering
+    uint16_t code_word[EC72_MEM_SIZE];      // word each code_map address was translated from
+    bool verified;                          // blocks were translated for verified mode
+    const ec72_bus_t *bus;                  // bus window the blocks were translated for
+    uint8_t bus_base;
+    uint64_t run_base;                      // cpu->retired + budget at enter
+} ec72_jit_t;
+
+// ---------------------------------------------------------------------------
+// Minimal x86-64 encoder. Memory operands always use a 32-bit displacement.
+
+enum { RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+enum { CC_O = 0, CC_B = 2, CC_AE = 3, CC_E = 4, CC_NE = 5, CC_BE = 6, CC_A = 7, CC_S = 8, CC_NS = 9 };
+enum { ALU_ADD = 0, ALU_OR = 1, ALU_AND = 4, ALU_SUB = 5, ALU_CMP = 7 };
+
+#define NO_INDEX (-1)
+
+static inline void emit8(uint8_t **p, uint8_t v) { *(*p)++ = v; }
+static inline void emit32(uint8_t **p, uint32_t v) { memcpy(*p, &v, 4); *p += 4; }
+static inline void emit64(uint8_t **p, uint64_t v) { memcpy(*p, &v, 8); *p += 8; }
+
+// REX prefix; force for byte access to spl/bpl/sil/dil
+static void rex(uint8_t **p, int w, int reg, int index, int base, bool force) {
+    uint8_t r = 0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((index >= 0 && (index & 8)) ? 2 : 0) | ((base & 8) ? 1 : 0);
+    if (r != 0x40 || force) emit8(p, r);
+}
+
+static void modrm_mem(uint8_t **p, int reg, int base, int index, int scale, int32_t disp) {
+    if (index == NO_INDEX && (base & 7) != RSP) {
+        emit8(p, 0x80 | ((reg & 7) << 3) | (base & 7));
+    } else {
+        int ss = scale == 8 ? 3 : scale == 4 ? 2 : scale == 2 ? 1 : 0;
+        emit8(p, 0x84 | ((reg & 7) << 3));
+        emit8(p, (uint8_t)((ss << 6) | ((index == NO_INDEX ? RSP : index) & 7) << 3 | (base & 7)));
+    }
+    emit32(p, (uint32_t)disp);
+}
+
+// op reg, [base + index*scale + disp]  (or the reverse direction, per opcode)
+static void op_mem(uint8_t **p, bool p66, int w, const uint8_t *opc, int oplen,
+                   int reg, int base, int index, int scale, int32_t disp, bool byte_reg) {
+    if (p66) emit8(p, 0x66);
+    rex(p, w, reg, index, base, byte_reg && reg >= RSP && reg <= RDI);
+    for (int i = 0; i < oplen; i++) emit8(p, opc[i]);
+    modrm_mem(p, reg, base, index, scale, disp);
+}
+
+static void op_rr(uint8_t **p, int w, uint8_t opc, int reg, int rm) {
+    rex(p, w, reg, NO_INDEX, rm, false);
+    emit8(p, opc);
+    emit8(p, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+static void mov_rr32(uint8_t **p, int dst, int src) { op_rr(p, 0, 0x89, src, dst); }
+static void mov_rr64(uint8_t **p, int dst, int src) { op_rr(p, 1, 0x89, src, dst); }
+
+static void mov_ri32(uint8_t **p, int dst, uint32_t imm) {
+    rex(p, 0, 0, NO_INDEX, dst, false);
+    emit8(p, 0xB8 | (dst & 7));
+    emit32(p, imm);
+}
+
+static void mov_ri64(uint8_t **p, int dst, uint64_t imm) {
+    rex(p, 1, 0, NO_INDEX, dst, false);
+    emit8(p, 0xB8 | (dst & 7));
+    emit64(p, imm);
+}
+
+static void call_r(uint8_t **p, int r) {
+    rex(p, 0, 0, NO_INDEX, r, false);
+    emit8(p, 0xFF);
+    emit8(p, 0xD0 | (r & 7));
+}
+
+static void alu_ri32(uint8_t **p, int w, int ext, int dst, int32_t imm) {
+    rex(p, w, 0, NO_INDEX, dst, false);
+    emit8(p, 0x81);
+    emit8(p, 0xC0 | (ext << 3) | (dst & 7));
+    emit32(p, (uint32_t)imm);
+}
+
+// add/sub/cmp/test r/m32, r32
+static void alu_rr32(uint8_t **p, uint8_t opc, int dst, int src) { op_rr(p, 0, opc, src, dst); }
+#define ADD_RR 0x01
+#define SUB_RR 0x29
+#define CMP_RR 0x39
+#define TEST_RR 0x85
+
+static void movzx_load8(uint8_t **p, int dst, int base, int index, int scale, int32_t disp) {
+    static const uint8_t opc[] = { 0x0F, 0xB6 };
+    op_mem(p, false, 0, opc, 2, dst, base, index, scale, disp, false);
+}
+
+static void store16(uint8_t **p, int src, int base, int index, int scale, int32_t disp) {
+    static const uint8_t opc[] = { 0x89 };
+    op_mem(p, true, 0, opc, 1, src, base, index, scale, disp, false);
+}
+
+static void store8(uint8_t **p, int src, int base, int32_t disp) {
+    static const uint8_t opc[] = { 0x88 };
+    op_mem(p, false, 0, opc, 1, src, base, NO_INDEX, 1, disp, true);
+}
+
+static void store8_imm(uint8_t **p, int base, int32_t disp, uint8_t imm) {
+    static const uint8_t opc[] = { 0xC6 };
+    op_mem(p, false, 0, opc, 1, 0, base, NO_INDEX, 1, disp, false);
+    emit8(p, imm);
+}
+
+static void cmp8_mem_imm(uint8_t **p, int base, int index, int32_t disp, uint8_t imm) {
+    static const uint8_t opc[] = { 0x80 };
+    op_mem(p, false, 0, opc, 1, ALU_CMP, base, index, 1, disp, false);
+    emit8(p, imm);
+}
+
+static void store32(uint8_t **p, int w, int src, int base, int32_t disp) {
+    static const uint8_t opc[] = { 0x89 };
+    op_mem(p, false, w, opc, 1, src, base, NO_INDEX, 1, disp, false);
+}
+
+static void load32(uint8_t **p, int w, int dst, int base, int index, int scale, int32_t disp) {
+    static const uint8_t opc[] = { 0x8B };
+    op_mem(p, false, w, opc, 1, dst, base, index, scale, disp, false);
+}
+
+static void lea32(uint8_t **p, int dst, int base, int32_t disp) {
+    static const uint8_t opc[] = { 0x8D };
+    op_mem(p, false, 0, opc, 1, dst, base, NO_INDEX, 1, disp, false);
+}
+
+static void push_r(uint8_t **p, int r) { rex(p, 0, 0, NO_INDEX, r, false); emit8(p, 0x50 | (r & 7)); }
+static void pop_r(uint8_t **p, int r) { rex(p, 0, 0, NO_INDEX, r, false); emit8(p, 0x58 | (r & 7)); }
+
+// jcc/jmp rel32; returns the position of the displacement for patching
+static uint8_t *jcc32(uint8_t **p, int cc) { emit8(p, 0x0F); emit8(p, 0x80 | cc); uint8_t *d = *p; emit32(p, 0); return d; }
+static uint8_t *jmp32(uint8_t **p) { emit8(p, 0xE9); uint8_t *d = *p; emit32(p, 0); return d; }
+static void set_rel32(uint8_t *disp, const uint8_t *target) {
+    int32_t rel = (int32_t)(target - (disp + 4));
+    memcpy(disp, &rel, 4);
+}
+
+// ---------------------------------------------------------------------------
+
+#define CPU(field) ((int32_t)offsetof(ec72_cpu_t, field))
+#define JIT(field) ((int32_t)offsetof(ec72_jit_t, field))
+#define MEMW(addr) (CPU(memory) + 2 * (int32_t)(addr))
+
+static int host_reg(uint8_t code) {
+    switch (code) {
+        case REG_A: return RBX;
+        case REG_B: return R12;
+        case REG_C: return R13;
+        case REG_E: return R14;
+        case REG_SP: return RDI;
+        default: return -1;
+    }
+}
+
+static void emit_runtime(ec72_jit_t *jit) {
+    uint8_t *p = jit->code;
+
+    // void enter(cpu = rdi, jit = rsi, entry = rdx)
+    jit->enter = (void (*)(ec72_cpu_t *, ec72_jit_t *, void *))p;
+    push_r(&p, RBX); push_r(&p, RBP); push_r(&p, R12); push_r(&p, R13); push_r(&p, R14); push_r(&p, R15);
+    alu_ri32(&p, 1, ALU_SUB, RSP, 8);
+    mov_rr64(&p, R15, RDI);
+    mov_rr64(&p, R9, RSI);
+    {
+        static const uint8_t lea[] = { 0x8D };
+        op_mem(&p, false, 1, lea, 1, R8, R9, NO_INDEX, 1, JIT(code_map), false);
+    }
+    movzx_load8(&p, RBX, R15, NO_INDEX, 1, CPU(RA));
+    movzx_load8(&p, R12, R15, NO_INDEX, 1, CPU(RB));
+    movzx_load8(&p, R13, R15, NO_INDEX, 1, CPU(RC));
+    movzx_load8(&p, R14, R15, NO_INDEX, 1, CPU(RE));
+    movzx_load8(&p, RDI, R15, NO_INDEX, 1, CPU(SP));
+    load32(&p, 0, RSI, R9, NO_INDEX, 1, JIT(flags));
+    load32(&p, 1, RBP, R9, NO_INDEX, 1, JIT(budget));
+    mov_ri32(&p, R10, 0xFFFFFFFFu);
+    emit8(&p, 0xFF); emit8(&p, 0xE2);                       // jmp rdx
+
+    // Common exit: eax = PC, ecx = reason, rdx = chain slot
+    jit->exit_stub = p;
+    store8(&p, RBX, R15, CPU(RA));
+    store8(&p, R12, R15, CPU(RB));
+    store8(&p, R13, R15, CPU(RC));
+    store8(&p, R14, R15, CPU(RE));
+    store8(&p, RDI, R15, CPU(SP));
+    store8(&p, RAX, R15, CPU(PC));
+    store32(&p, 0, RSI, R9, JIT(flags));
+    store32(&p, 0, RCX, R9, JIT(reason));
+    store32(&p, 1, RDX, R9, JIT(patch));
+    store32(&p, 1, RBP, R9, JIT(budget));
+    store32(&p, 0, R10, R9, JIT(last_pc));
+    alu_ri32(&p, 1, ALU_ADD, RSP, 8);
+    pop_r(&p, R15); pop_r(&p, R14); pop_r(&p, R13); pop_r(&p, R12); pop_r(&p, RBP); pop_r(&p, RBX);
+    emit8(&p, 0xC3);
+
+    jit->blocks = jit->cursor = p;
+}
+
+// Switches the code buffer between RW and RX; false if mprotect() fails
+static bool code_writable(ec72_jit_t *jit, bool writable) {
+    if (jit->writable == writable) return true;
+    if (mprotect(jit->code, JIT_CODE_SIZE, writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) != 0) return false;
+    jit->writable = writable;
+    return true;
+}
+
+static void flush(ec72_jit_t *jit) {
+    memset(jit->block_entry, 0, sizeof(jit->block_entry));
+    memset(jit->code_map, 0, sizeof(jit->code_map));
+    jit->cursor = jit->blocks;
+    jit->generation++;
+}
+
+// Pending jumps of the block being translated, resolved once its stubs exist
+typedef struct {
+    uint8_t *disp;
+    int kind;           // 0: side exit before instruction k, 1: budget, 2: chain
+    int k;
+    uint8_t target;
+} Fixup_t;
+
+typedef struct {
+    ec72_jit_t *jit;
+    uint8_t *p;
+    uint8_t start;
+    int len;
+    Fixup_t fix[MAX_BLOCK * 4 + 8];
+    int nfix;
+} Block_t;
+
+static void side_exit_if(Block_t *b, int cc, int k) {
+    Fixup_t *f = &b->fix[b->nfix++];
+    f->disp = jcc32(&b->p, cc);
+    f->kind = 0;
+    f->k = k;
+}
+
+// Jump to the translated target if it exists, otherwise through a chain stub
+static void chain_to(Block_t *b, uint8_t target) {
+    uint8_t *disp = jmp32(&b->p);
+    uint8_t *entry = b->jit->block_entry[target];
+    if (entry) {
+        set_rel32(disp, entry);
+        return;
+    }
+    Fixup_t *f = &b->fix[b->nfix++];
+    f->disp = disp;
+    f->kind = 2;
+    f->target = target;
+}
+
+// SP == STOFR || SP == 0  ->  side exit (the interpreter raises the fault)
+static void check_overflow(Block_t *b, int k) {
+    if (b->jit->verified) return;
+    movzx_load8(&b->p, RAX, R15, NO_INDEX, 1, CPU(STOFR));
+    alu_rr32(&b->p, CMP_RR, RDI, RAX);
+    side_exit_if(b, CC_E, k);
+    alu_rr32(&b->p, TEST_RR, RDI, RDI);
+    side_exit_if(b, CC_E, k);
+}
+
+// SP == STUFR || SP == MEM_SIZE-1
+static void check_underflow(Block_t *b, int k) {
+    if (b->jit->verified) return;
+    movzx_load8(&b->p, RAX, R15, NO_INDEX, 1, CPU(STUFR));
+    alu_rr32(&b->p, CMP_RR, RDI, RAX);
+    side_exit_if(b, CC_E, k);
+    alu_ri32(&b->p, 0, ALU_CMP, RDI, MEM_SIZE - 1);
+    side_exit_if(b, CC_E, k);
+}
+
+// (uint8_t)(RB - base) < EC72_BUS_WINDOW  ->  side exit to the device access
+static void check_bus(Block_t *b, int k) {
+    if (!b->jit->bus) return;
+    lea32(&b->p, RAX, R12, -(int32_t)b->jit->bus->base);
+    alu_ri32(&b->p, 0, ALU_AND, RAX, 0xFF);
+    alu_ri32(&b->p, 0, ALU_CMP, RAX, EC72_BUS_WINDOW);
+    side_exit_if(b, CC_B, k);
+}
+
+// Device accesses from generated code. The block charged all of its
+// instructions up front, so the ones from this one to the end (back) are
+// still missing from the count.
+static uint32_t bus_load(ec72_cpu_t *cpu, uint32_t addr, uint64_t budget, uint32_t back) {
+    return ec72_bus_read(cpu->bus, (uint8_t)addr, cpu->jit->run_base - budget - back);
+}
+
+static void bus_store(ec72_cpu_t *cpu, uint32_t addr, uint64_t budget, uint32_t back, uint32_t value) {
+    ec72_bus_write(cpu->bus, (uint8_t)addr, (uint8_t)value, cpu->jit->run_base - budget - back);
+}
+
+// Call fn(cpu, addr, budget, back[, value]) with the caller-saved state
+// kept; rsp is 16-byte aligned inside blocks. dst receives the result.
+static void emit_bus_call(Block_t *b, const void *fn, uint8_t addr, int k, int value_reg, int dst) {
+    push_r(&b->p, RDI); push_r(&b->p, RSI); push_r(&b->p, R8); push_r(&b->p, R9); push_r(&b->p, R10);
+    alu_ri32(&b->p, 1, ALU_SUB, RSP, 8);
+    if (value_reg >= 0) mov_rr32(&b->p, R8, value_reg);
+    mov_rr64(&b->p, RDI, R15);
+    mov_ri32(&b->p, RSI, addr);
+    mov_rr64(&b->p, RDX, RBP);
+    mov_ri32(&b->p, RCX, (uint32_t)(b->len - k));
+    mov_ri64(&b->p, RAX, (uint64_t)(uintptr_t)fn);
+    call_r(&b->p, RAX);
+    alu_ri32(&b->p, 1, ALU_ADD, RSP, 8);
+    pop_r(&b->p, R10); pop_r(&b->p, R9); pop_r(&b->p, R8); pop_r(&b->p, RSI); pop_r(&b->p, RDI);
+    if (dst >= 0) mov_rr32(&b->p, dst, RAX);
+}
+
+// value in src_reg pushed to memory[--SP]; side exit if that cell holds code
+static void emit_push(Block_t *b, int src_reg, int k) {
+    lea32(&b->p, RAX, RDI, -1);
+    if (!b->jit->verified) {
+        cmp8_mem_imm(&b->p, R8, RAX, 0, 0);
+        side_exit_if(b, CC_NE, k);
+    }
+    mov_rr32(&b->p, RDI, RAX);
+    store16(&b->p, src_reg, R15, RDI, 2, CPU(memory));
+}
+
+static bool is_terminator(uint8_t op) {
+    return op == OP_JMP || op == OP_JMPZ || op == OP_JMPN || op == OP_JMPO ||
+           op == OP_CALL || op == OP_RET || op == OP_HLT;
+}
+
+// Instructions left to the interpreter (they end the block in front of them)
+static bool translatable(uint16_t IR) {
+    uint8_t op = EC72_OPCODE(IR), operand = EC72_OPERAND(IR);
+    switch (op) {
+        case OP_ADDR: case OP_SUBR: case OP_PUSH: case OP_POP:
+            return host_reg(operand) >= 0;
+        case OP_OUT:
+            return false;
+        default:
+            return (op >= OP_MOVR && op <= OP_SSTUF) || op == OP_HLT;
+    }
+}
+
+static void emit_alu(Block_t *b, int ext_or_rr, bool reg_operand, int src, uint8_t imm) {
+    mov_rr32(&b->p, RSI, RBX);
+    if (reg_operand) alu_rr32(&b->p, (uint8_t)ext_or_rr, RSI, src);
+    else alu_ri32(&b->p, 0, ext_or_rr, RSI, imm);
+    mov_rr32(&b->p, RBX, RSI);
+    alu_ri32(&b->p, 0, ALU_AND, RBX, 0xFF);
+}
+
+static void emit_cond_jump(Block_t *b, int cc_taken, uint8_t target, uint8_t next) {
+    // jcc over the taken slot when the branch is not taken
+    emit8(&b->p, 0x70 | (cc_taken ^ 1));
+    emit8(&b->p, 5);
+    chain_to(b, target);
+    chain_to(b, next);
+}
+
+static uint8_t *compile_block(ec72_jit_t *jit, ec72_cpu_t *cpu, uint8_t start) {
+    const uint16_t *memory = cpu->memory;
+
+    // Scan the block
+    int len = 0;
+    bool ends_in_terminator = false;
+    for (int pc = start; len < MAX_BLOCK && pc < MEM_SIZE; pc++) {
+        uint16_t IR = memory[pc];
+        if (!translatable(IR)) break;
+        len++;
+        if (is_terminator(EC72_OPCODE(IR))) { ends_in_terminator = true; break; }
+    }
+    if (len == 0) return NULL;
+
+    if (jit->cursor + BLOCK_RESERVE > jit->code + JIT_CODE_SIZE) flush(jit);
+
+    Block_t *b = malloc(sizeof(Block_t));
+    if (!b) return NULL;
+    b->jit = jit;
+    b->p = jit->cursor;
+    b->start = start;
+    b->len = len;
+    b->nfix = 0;
+    uint8_t *entry = b->p;
+
+    // Budget: the whole block is charged up front, side exits refund
+    alu_ri32(&b->p, 1, ALU_CMP, RBP, len);
+    {
+        Fixup_t *f = &b->fix[b->nfix++];
+        f->disp = jcc32(&b->p, CC_B);
+        f->kind = 1;
+    }
+    alu_ri32(&b->p, 1, ALU_SUB, RBP, len);
+
+    for (int k = 0; k < len; k++) {
+        uint8_t pc = (uint8_t)(start + k);
+        uint16_t IR = memory[pc];
+        uint8_t op = EC72_OPCODE(IR), operand = EC72_OPERAND(IR);
+        uint8_t next = (uint8_t)(pc + 1);
+
+        if (is_terminator(op)) mov_ri32(&b->p, R10, pc);
+
+        switch (op) {
+            case OP_MOVR: {
+                int d = host_reg((operand >> 4) & 0x0F), s = host_reg(operand & 0x0F);
+                if (d >= 0 && s >= 0 && d != s) mov_rr32(&b->p, d, s);
+                break;
+            }
+            case OP_MOVA: case OP_MOVB: case OP_MOVC: case OP_MOVE: {
+                static const int dst[] = { RBX, R12, R13, R14 };
+                if (jit->bus && ec72_bus_hit(jit->bus, operand)) emit_bus_call(b, (const void *)bus_load, operand, k, -1, dst[op - OP_MOVA]);
+                else movzx_load8(&b->p, dst[op - OP_MOVA], R15, NO_INDEX, 1, MEMW(operand));
+                break;
+            }
+            case OP_STORA: case OP_STORB: case OP_STORC: case OP_STORE: {
+                static const int src[] = { RBX, R12, R13, R14 };
+                if (jit->bus && ec72_bus_hit(jit->bus, operand)) {
+                    emit_bus_call(b, (const void *)bus_store, operand, k, src[op - OP_STORA], -1);
+                    break;
+                }
+                if (!jit->verified) {
+                    cmp8_mem_imm(&b->p, R8, NO_INDEX, operand, 0);
+                    side_exit_if(b, CC_NE, k);
+                }
+                store16(&b->p, src[op - OP_STORA], R15, NO_INDEX, 1, MEMW(operand));
+                break;
+            }
+            case OP_LDIMA: mov_ri32(&b->p, RBX, operand); break;
+            case OP_LDIMB: mov_ri32(&b->p, R12, operand); break;
+            case OP_LDIMC: mov_ri32(&b->p, R13, operand); break;
+            case OP_LDIME: mov_ri32(&b->p, R14, operand); break;
+            case OP_ADD: emit_alu(b, ALU_ADD, false, 0, operand); break;
+            case OP_SUB: emit_alu(b, ALU_SUB, false, 0, operand); break;
+            case OP_ADDR: emit_alu(b, ADD_RR, true, host_reg(operand), 0); break;
+            case OP_SUBR: emit_alu(b, SUB_RR, true, host_reg(operand), 0); break;
+            case OP_MOVA_PTRB:
+                check_bus(b, k);
+                movzx_load8(&b->p, RBX, R15, R12, 2, CPU(memory));
+                break;
+            case OP_STORA_PTRB:
+                check_bus(b, k);
+                cmp8_mem_imm(&b->p, R8, R12, 0, 0);
+                side_exit_if(b, CC_NE, k);
+                store16(&b->p, RBX, R15, R12, 2, CPU(memory));
+                break;
+            case OP_PUSH:
+                check_overflow(b, k);
+                mov_rr32(&b->p, RCX, host_reg(operand));   // PUSH SP pushes the old SP
+                emit_push(b, RCX, k);
+                break;
+            case OP_POP:
+                check_underflow(b, k);
+                movzx_load8(&b->p, RAX, R15, RDI, 2, CPU(memory));
+                alu_ri32(&b->p, 0, ALU_ADD, RDI, 1);
+                mov_rr32(&b->p, host_reg(operand), RAX);
+                break;
+            case OP_ADDSP:
+                check_underflow(b, k);
+                alu_ri32(&b->p, 0, ALU_ADD, RDI, operand);
+                alu_ri32(&b->p, 0, ALU_AND, RDI, 0xFF);
+                break;
+            case OP_SUBSP:
+                check_overflow(b, k);
+                alu_ri32(&b->p, 0, ALU_SUB, RDI, operand);
+                alu_ri32(&b->p, 0, ALU_AND, RDI, 0xFF);
+                break;
+            case OP_SSTOF: store8_imm(&b->p, R15, CPU(STOFR), operand); break;
+            case OP_SSTUF:
+                store8_imm(&b->p, R15, CPU(STUFR), operand);
+                mov_ri32(&b->p, RDI, operand);
+                break;
+            case OP_JMP: chain_to(b, operand); break;
+            case OP_JMPZ:
+                alu_rr32(&b->p, TEST_RR, RSI, RSI);
+                emit_cond_jump(b, CC_E, operand, next);
+                break;
+            case OP_JMPN:
+                alu_rr32(&b->p, TEST_RR, RSI, RSI);
+                emit_cond_jump(b, CC_S, operand, next);
+                break;
+            case OP_JMPO:
+                alu_ri32(&b->p, 0, ALU_CMP, RSI, 255);
+                emit_cond_jump(b, CC_A, operand, next);
+                break;
+            case OP_CALL:
+                check_overflow(b, k);
+                mov_ri32(&b->p, RCX, next);
+                emit_push(b, RCX, k);
+                chain_to(b, operand);
+                break;
+            case OP_RET:
+                if (!jit->verified) {
+                    alu_ri32(&b->p, 0, ALU_CMP, RDI, MEM_SIZE - 1);
+                    side_exit_if(b, CC_E, k);
+                }
+                movzx_load8(&b->p, RAX, R15, RDI, 2, CPU(memory));
+                alu_ri32(&b->p, 0, ALU_ADD, RDI, 1);
+                load32(&b->p, 1, RCX, R9, RAX, 8, JIT(block_entry));
+                op_rr(&b->p, 1, TEST_RR, RCX, RCX);
+                emit8(&b->p, 0x74); emit8(&b->p, 2);        // jz miss
+                emit8(&b->p, 0xFF); emit8(&b->p, 0xE1);     // jmp rcx
+                mov_ri32(&b->p, RCX, EXIT_DISPATCH);        // miss: eax already holds PC
+                set_rel32(jmp32(&b->p), jit->exit_stub);
+                break;
+            case OP_HLT:
+                mov_ri32(&b->p, RAX, next);
+                mov_ri32(&b->p, RCX, EXIT_HALT);
+                set_rel32(jmp32(&b->p), jit->exit_stub);
+                break;
+        }
+    }
+
+    // Block ended without a terminator: fall through, or hand the
+    // untranslatable instruction at the end to the interpreter
+    if (!ends_in_terminator) {
+        uint8_t after = (uint8_t)(start + len);
+        mov_ri32(&b->p, R10, (uint8_t)(after - 1));
+        if (after != 0 && !translatable(memory[after])) {
+            mov_ri32(&b->p, RAX, after);
+            mov_ri32(&b->p, RCX, EXIT_INTERP);
+            set_rel32(jmp32(&b->p), jit->exit_stub);
+        } else {
+            chain_to(b, after);
+        }
+    }
+
+    // Out-of-line stubs
+    uint8_t *side_stub[MAX_BLOCK];
+    memset(side_stub, 0, sizeof(side_stub));
+    uint8_t *budget_stub = NULL;
+    for (int i = 0; i < b->nfix; i++) {
+        Fixup_t *f = &b->fix[i];
+        uint8_t *target;
+        if (f->kind == 0) {
+            if (!side_stub[f->k]) {
+                side_stub[f->k] = b->p;
+                alu_ri32(&b->p, 1, ALU_ADD, RBP, len - f->k);
+                mov_ri32(&b->p, RAX, (uint8_t)(start + f->k));
+                mov_ri32(&b->p, RCX, EXIT_INTERP);
+                set_rel32(jmp32(&b->p), jit->exit_stub);
+            }
+            target = side_stub[f->k];
+        } else if (f->kind == 1) {
+            if (!budget_stub) {
+                budget_stub = b->p;
+                mov_ri32(&b->p, RAX, start);
+                mov_ri32(&b->p, RCX, EXIT_BUDGET);
+                set_rel32(jmp32(&b->p), jit->exit_stub);
+            }
+            target = budget_stub;
+        } else {
+            if (f->target == start) {
+                target = entry;
+            } else {
+                target = b->p;
+                mov_ri32(&b->p, RAX, f->target);
+                mov_ri32(&b->p, RCX, EXIT_CHAIN);
+                mov_ri64(&b->p, RDX, (uint64_t)(uintptr_t)(f->disp));
+                set_rel32(jmp32(&b->p), jit->exit_stub);
+            }
+        }
+        set_rel32(f->disp, target);
+    }
+
+    jit->cursor = b->p;
+    for (int k = 0; k < len; k++) {
+        jit->code_map[(uint8_t)(start + k)] = 1;
+        jit->code_word[(uint8_t)(start + k)] = memory[(uint8_t)(start + k)];
+    }
+    jit->block_entry[start] = entry;
+    free(b);
+    return entry;
+}
+
+static ec72_jit_t *jit_get(ec72_cpu_t *cpu) {
+    if (cpu->jit) return cpu->jit;
+    ec72_jit_t *jit = calloc(1, sizeof(ec72_jit_t));
+    if (!jit) return NULL;
+    void *code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        free(jit);
+        return NULL;
+    }
+    jit->code = code;
+    jit->writable = true;
+    emit_runtime(jit);
+    if (!code_writable(jit, false)) {
+        munmap(code, JIT_CODE_SIZE);
+        free(jit);
+        return NULL;
+    }
+    jit->epoch = cpu->mem_epoch - 1;
+    cpu->jit = jit;
+    return jit;
+}
+
+void ec72_jit_free(ec72_jit_t *jit) {
+    if (!jit) return;
+    munmap(jit->code, JIT_CODE_SIZE);
+    free(jit);
+}
+
+// Flags as the last ALU result; INT32_MIN if no result produces them
+static int32_t flags_to_result(const ec72_cpu_t *cpu) {
+    if (cpu->ZF && !cpu->NF && !cpu->OF) return 0;
+    if (!cpu->ZF && cpu->NF && cpu->OF) return -1;
+    if (!cpu->ZF && !cpu->NF && cpu->OF) return 256;
+    if (!cpu->ZF && !cpu->NF && !cpu->OF) return 1;
+    return INT32_MIN;
+}
+
+// Translations stay valid as long as every translated word is unchanged
+// (the word behind a block only decides between side exit and chaining,
+// and both stay correct)
+static bool code_unchanged(const ec72_jit_t *jit, const ec72_cpu_t *cpu) {
+    for (int a = 0; a < MEM_SIZE; a++) {
+        if (jit->code_map[a] && jit->code_word[a] != cpu->memory[a]) return false;
+    }
+    return true;
+}
+
+// One reference-interpreter step, which also runs the block instructions
+// with their stack checks; drops the translations if it wrote code
+static ec72_status_t interp_one(ec72_jit_t *jit, ec72_cpu_t *cpu) {
+    uint16_t IR = cpu->memory[cpu->PC];
+    int written = -1, count = 1;
+    switch (EC72_OPCODE(IR)) {
+        case OP_STORA: case OP_STORB: case OP_STORC: case OP_STORE:
+        case OP_XCHG: case OP_CAS: written = EC72_OPERAND(IR); break;
+        case OP_STORA_PTRB: written = cpu->RB; break;
+        case OP_PUSH: case OP_CALL: written = (uint8_t)(cpu->SP - 1); break;
+        case OP_BCOPY: case OP_BFILL: written = cpu->RB; count = cpu->RE; break;
+    }
+    ec72_status_t s = ec72_switch_step(cpu);
+    bool code = false;
+    for (int i = 0; written >= 0 && i < count; i++) code |= jit->code_map[(uint8_t)(written + i)] != 0;
+    if (code) {
+        flush(jit);
+        if (jit->smc_flushes < 31) jit->smc_flushes++;
+        uint64_t c = (uint64_t)COOLDOWN_MIN << (jit->smc_flushes - 1);
+        jit->cooldown = c > COOLDOWN_MAX ? COOLDOWN_MAX : c;
+    }
+    return s;
+}
+
+ec72_status_t ec72_jit_run(ec72_cpu_t *cpu, uint64_t max_instructions) {
+    ec72_jit_t *jit = jit_get(cpu);
+    if (!jit) return ec72_threaded_run(cpu, max_instructions);
+    if (jit->owner != cpu || jit->verified != cpu->verified || jit->bus != cpu->bus ||
+        (cpu->bus && jit->bus_base != cpu->bus->base) ||
+        (jit->epoch != cpu->mem_epoch && !code_unchanged(jit, cpu))) {
+        flush(jit);
+        jit->owner = cpu;
+        jit->verified = cpu->verified;
+        jit->bus = cpu->bus;
+        if (cpu->bus) jit->bus_base = cpu->bus->base;
+    }
+
+    uint64_t left = max_instructions;
+    uint64_t interp = 0;            // instructions to interpret before re-entering
+    ec72_status_t status = EC72_OK;
+
+    while (left > 0 && status == EC72_OK) {
+        if (jit->cooldown) {
+            interp = jit->cooldown;
+            jit->cooldown = 0;
+        }
+        int32_t flags = flags_to_result(cpu);
+        uint8_t *entry = NULL;
+        if (interp == 0 && flags != INT32_MIN) {
+            entry = jit->block_entry[cpu->PC];
+            if (!entry && code_writable(jit, true)) entry = compile_block(jit, cpu, cpu->PC);
+        }
+        if (!entry || !code_writable(jit, false)) {
+            status = interp_one(jit, cpu);
+            left--;
+            if (interp) interp--;
+            continue;
+        }
+
+        jit->flags = flags;
+        jit->budget = left;
+        jit->run_base = cpu->retired + left;
+        jit->enter(cpu, jit, entry);
+        cpu->retired += left - jit->budget;
+        left = jit->budget;
+        cpu->ZF = (jit->flags == 0);
+        cpu->NF = (jit->flags < 0);
+        cpu->OF = (jit->flags > 255 || jit->flags < 0);
+        if (jit->last_pc >= 0) cpu->IR = cpu->memory[jit->last_pc];
+
+        switch (jit->reason) {
+            case EXIT_HALT:
+                cpu->IR = cpu->memory[(uint8_t)(cpu->PC - 1)];
+                cpu->status = status = EC72_HALTED;
+                break;
+            case EXIT_INTERP:
+                interp = 1;
+                break;
+            case EXIT_BUDGET:
+                interp = left;      // fewer instructions left than the block holds
+                break;
+            case EXIT_CHAIN: {
+                uint32_t gen = jit->generation;
+                uint8_t *slot = jit->patch;
+                if (!code_writable(jit, true)) break;
+                uint8_t *target = jit->block_entry[cpu->PC];
+                if (!target) target = compile_block(jit, cpu, cpu->PC);
+                if (target && gen == jit->generation) set_rel32(slot, target);
+                break;
+            }
+            case EXIT_DISPATCH:
+                break;
+        }
+    }
+
+    ec72_mem_changed(cpu);
+    jit->epoch = cpu->mem_epoch;
+    return status;
+}
+
+#else
+
+void ec72_jit_free(struct ec72_jit *jit) {
+    (void)jit;
+}
+
+// No code generator for this host
+ec72_status_t ec72_jit_run(ec72_cpu_t *cpu, uint64_t max_instructions) {
+    return ec72_threaded_run(cpu, max_instructions);
+}
+
+#endif
@@ -0,0 +1,450 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_journal.h"
+#include "ec72_cycles.h"
+#include "ec72_engine.h"
+
+// Ring bytes reserved per delta when the budget is split between snapshots
+// and deltas (typical deltas take 2-3)
+#define BYTES_PER_DELTA 4
+
+typedef struct {
+    uint8_t mask, ext;
+    uint8_t RA, RB, RC, RE, SP, PC, flags;
+    uint8_t addr;
+    uint16_t word;
+    uint8_t STOFR, STUFR, status;
+    uint8_t BANK;
+    uint16_t MAR;
+    uint8_t block_addr, block_len;
+    uint8_t bus_base, bus_bytes[EC72_BUS_WINDOW];
+} Delta_t;
+
+#define RA EC72_JOURNAL_RA
+#define RB EC72_JOURNAL_RB
+#define RC EC72_JOURNAL_RC
+#define RE EC72_JOURNAL_RE
+#define SP EC72_JOURNAL_SP
+#define PC EC72_JOURNAL_PC
+#define FLAGS EC72_JOURNAL_FLAGS
+
+const uint16_t ec72_journal_effect[256] = {
+    [OP_MOVR] = EC72_JOURNAL_DEST_HIGH,
+    [OP_MOVA] = RA, [OP_MOVB] = RB, [OP_MOVC] = RC, [OP_MOVE] = RE,
+    [OP_STORA] = EC72_JOURNAL_STORES_OPERAND, [OP_STORB] = EC72_JOURNAL_STORES_OPERAND,
+    [OP_STORC] = EC72_JOURNAL_STORES_OPERAND, [OP_STORE] = EC72_JOURNAL_STORES_OPERAND,
+    [OP_LDIMA] = RA, [OP_LDIMB] = RB, [OP_LDIMC] = RC, [OP_LDIME] = RE,
+    [OP_JMPN] = PC, [OP_JMPZ] = PC, [OP_JMPO] = PC, [OP_JMP] = PC,
+    [OP_ADD] = RA | FLAGS, [OP_SUB] = RA | FLAGS, [OP_ADDR] = RA | FLAGS, [OP_SUBR] = RA | FLAGS,
+    [OP_CALL] = SP | PC | EC72_JOURNAL_STORES_SP, [OP_RET] = SP | PC,
+    [OP_MOVA_PTRB] = RA, [OP_STORA_PTRB] = EC72_JOURNAL_STORES_RB,
+    [OP_PUSH] = SP | EC72_JOURNAL_STORES_SP, [OP_POP] = SP | EC72_JOURNAL_DEST_LOW,
+    [OP_ADDSP] = SP, [OP_SUBSP] = SP,
+    [OP_SSTOF] = EC72_JOURNAL_EXT, [OP_SSTUF] = SP | EC72_JOURNAL_EXT,
+    [OP_XCHG] = RA | EC72_JOURNAL_STORES_OPERAND, [OP_CAS] = RA | FLAGS | EC72_JOURNAL_STORES_OPERAND,
+    [OP_LDID] = RA | RB,
+    [OP_SBANK] = EC72_JOURNAL_EXT_FAR, [OP_SMAR] = EC72_JOURNAL_EXT_FAR,
+    [OP_FLD] = RA | EC72_JOURNAL_EXT_FAR, [OP_FST] = EC72_JOURNAL_EXT_FAR,
+    [OP_BCOPY] = EC72_JOURNAL_EXT_BLOCK, [OP_BFILL] = EC72_JOURNAL_EXT_BLOCK,
+    [OP_BCMP] = RA | FLAGS, [OP_MUL] = RA | RE | FLAGS,
+};
+
+const uint8_t ec72_journal_reg_bit[16] = {
+    [REG_A] = RA, [REG_B] = RB, [REG_C] = RC, [REG_E] = RE, [REG_SP] = SP,
+};
+
+#undef RA
+#undef RB
+#undef RC
+#undef RE
+#undef SP
+#undef PC
+#undef FLAGS
+
+bool ec72_journal_init(ec72_journal_t *j, size_t budget, uint32_t interval) {
+    memset(j, 0, sizeof(*j));
+    if (interval == 0) interval = EC72_JOURNAL_DEFAULT_INTERVAL;
+    size_t per_seg = sizeof(ec72_journal_seg_t) + (size_t)interval * BYTES_PER_DELTA;
+    size_t seg_cap = budget / per_seg;
+    if (seg_cap < 2) seg_cap = 2;
+    if (budget < seg_cap * sizeof(ec72_journal_seg_t) + 64 * EC72_JOURNAL_MAX_DELTA) {
+        fprintf(stderr, "Journal budget of %zu bytes is too small\n", budget);
+        return false;
+    }
+
+    j->ring_size = budget - seg_cap * sizeof(ec72_journal_seg_t);
+    j->ring = malloc(j->ring_size);
+    j->segs = malloc(seg_cap * sizeof(ec72_journal_seg_t));
+    if (!j->ring || !j->segs) {
+        fprintf(stderr, "Out of memory for the journal\n");
+        ec72_journal_free(j);
+        return false;
+    }
+    j->seg_cap = seg_cap;
+    j->interval = interval;
+    j->cut = true;
+    return true;
+}
+
+void ec72_journal_free(ec72_journal_t *j) {
+    free(j->ring);
+    free(j->segs);
+    memset(j, 0, sizeof(*j));
+}
+
+void ec72_cpu_set_journal(ec72_cpu_t *cpu, ec72_journal_t *j) {
+    cpu->journal = j;
+    if (!j) return;
+    const ec72_cycles_t *model = cpu->cycle_model;
+    for (int op = 0; op < 256; op++) j->cost[op] = model ? model->cost[op] : 0;
+    j->timed = model != NULL;
+    j->cut = true;
+}
+
+size_t ec72_journal_bytes(const ec72_journal_t *j) {
+    return j->ring_size + j->seg_cap * sizeof(ec72_journal_seg_t);
+}
+
+static ec72_journal_seg_t *seg_at(const ec72_journal_t *j, size_t i) {
+    return &j->segs[(j->seg_first + i) % j->seg_cap];
+}
+
+uint64_t ec72_journal_first(const ec72_journal_t *j) {
+    return j->seg_count ? seg_at(j, 0)->pos : j->end;
+}
+
+// ---------------------------------------------------------------------------
+// Recording
+
+static void drop_oldest(ec72_journal_t *j) {
+    j->seg_first = (j->seg_first + 1) % j->seg_cap;
+    j->seg_count--;
+    j->dropped_segments++;
+}
+
+// Snapshot of the current state starts a segment at end; an empty last
+// segment is reused
+static void open_segment(ec72_journal_t *j, const ec72_cpu_t *cpu) {
+    ec72_journal_seg_t *last = j->seg_count ? seg_at(j, j->seg_count - 1) : NULL;
+    if (!last || last->count > 0) {
+        if (j->seg_count == j->seg_cap) drop_oldest(j);
+        j->seg_count++;
+        last = seg_at(j, j->seg_count - 1);
+        last->offset = j->write;
+    }
+    ec72_snapshot_take(cpu, &last->state);
+    last->pos = j->end;
+    last->count = 0;
+    j->cut = false;
+}
+
+// At least one delta fits at write without reaching the oldest segment
+static void ensure_room(ec72_journal_t *j, const ec72_cpu_t *cpu) {
+    for (;;) {
+        ec72_journal_seg_t *last = seg_at(j, j->seg_count - 1);
+        if (j->seg_count == 1 && last->count == 0) {
+            j->write = last->offset = 0;
+            j->room = j->ring_size;
+            return;
+        }
+        size_t tail = seg_at(j, 0)->offset;
+        if (j->write >= tail) {
+            if (j->ring_size - j->write > EC72_JOURNAL_MAX_DELTA) {
+                j->room = j->ring_size - j->write;
+                return;
+            }
+            if (tail > EC72_JOURNAL_MAX_DELTA) {
+                if (j->write < j->ring_size) j->ring[j->write] = EC72_JOURNAL_WRAP;
+                j->write = 0;
+                j->room = tail;
+                return;
+            }
+        } else if (tail - j->write > EC72_JOURNAL_MAX_DELTA) {
+            j->room = tail - j->write;
+            return;
+        }
+        // Full: the oldest segment goes, the current state stays reachable
+        if (j->seg_count == 1) open_segment(j, cpu);
+        drop_oldest(j);
+    }
+}
+
+// Positions after pos go; cursor points at the delta that was at pos
+static void truncate_at_pos(ec72_journal_t *j) {
+    ec72_journal_seg_t *seg = seg_at(j, j->cursor_seg);
+    seg->count = (uint32_t)(j->pos - seg->pos);
+    j->seg_count = j->cursor_seg + 1;
+    j->write = j->cursor;
+    j->end = j->pos;
+}
+
+uint32_t ec72_journal_prepare(ec72_journal_t *j, const ec72_cpu_t *cpu) {
+    if (j->pos != j->end) truncate_at_pos(j);
+    if (j->cut || j->seg_count == 0 || seg_at(j, j->seg_count - 1)->count >= j->interval) {
+        open_segment(j, cpu);
+    }
+    ensure_room(j, cpu);
+    j->last = seg_at(j, j->seg_count - 1);
+    j->left = j->interval - j->last->count;
+    size_t fit = j->room / EC72_JOURNAL_MAX_DELTA;
+    return fit < j->left ? (uint32_t)fit : j->left;
+}
+
+void ec72_journal_cut(ec72_journal_t *j) {
+    if (j->pos != j->end) truncate_at_pos(j);
+    j->cut = true;
+}
+
+// ---------------------------------------------------------------------------
+// Replaying
+
+static size_t decode(const ec72_journal_t *j, size_t off, Delta_t *d) {
+    if (off >= j->ring_size || j->ring[off] == EC72_JOURNAL_WRAP) off = 0;
+    const uint8_t *p = j->ring + off;
+    d->mask = *p++;
+    d->ext = 0;
+    if (d->mask == EC72_JOURNAL_ESCAPE) {
+        d->mask = *p++;
+        d->ext = *p++;
+    }
+    if (d->mask & EC72_JOURNAL_RA) d->RA = *p++;
+    if (d->mask & EC72_JOURNAL_RB) d->RB = *p++;
+    if (d->mask & EC72_JOURNAL_RC) d->RC = *p++;
+    if (d->mask & EC72_JOURNAL_RE) d->RE = *p++;
+    if (d->mask & EC72_JOURNAL_SP) d->SP = *p++;
+    if (d->mask & EC72_JOURNAL_PC) d->PC = *p++;
+    if (d->mask & EC72_JOURNAL_FLAGS) d->flags = *p++;
+    if (d->mask & EC72_JOURNAL_STORE) {
+        d->addr = p[0];
+        d->word = (uint16_t)(p[1] | (p[2] << 8));
+        p += 3;
+    }
+    if (d->ext & EC72_JOURNAL_STOFR) d->STOFR = *p++;
+    if (d->ext & EC72_JOURNAL_STUFR) d->STUFR = *p++;
+    if (d->ext & EC72_JOURNAL_STATUS) d->status = *p++;
+    if (d->ext & EC72_JOURNAL_FAR) {
+        d->BANK = p[0];
+        d->MAR = (uint16_t)(p[1] | (p[2] << 8));
+        p += 3;
+    }
+    if (d->ext & EC72_JOURNAL_BLOCK) {
+        d->block_addr = p[0];
+        d->block_len = p[1];
+        p += 2;
+    }
+    if (d->ext & EC72_JOURNAL_BUS) {
+        d->bus_base = *p++;
+        memcpy(d->bus_bytes, p, EC72_BUS_WINDOW);
+        p += EC72_BUS_WINDOW;
+    }
+    return (size_t)(p - j->ring);
+}
+
+// Block store that reached the bus window, as ec72_bus_block_copy() and
+// ec72_bus_block_fill() did it: window reads from the delta, window stores
+// dropped
+static void block_io(ec72_cpu_t *cpu, const Delta_t *d) {
+    uint16_t buf[EC72_MEM_SIZE];
+    bool copy = EC72_OPCODE(cpu->IR) == OP_BCOPY;
+    for (int i = 0; i < cpu->RE; i++) {
+        uint8_t a = (uint8_t)(cpu->RC + i), reg = (uint8_t)(a - d->bus_base);
+        buf[i] = !copy ? cpu->RA : reg < EC72_BUS_WINDOW ? d->bus_bytes[reg] : cpu->memory[a];
+    }
+    for (int i = 0; i < cpu->RE; i++) {
+        uint8_t a = (uint8_t)(cpu->RB + i);
+        if ((uint8_t)(a - d->bus_base) >= EC72_BUS_WINDOW) cpu->memory[a] = buf[i];
+    }
+}
+
+static void apply(const ec72_journal_t *j, ec72_cpu_t *cpu, const Delta_t *d) {
+    uint16_t IR = cpu->IR = cpu->memory[cpu->PC++];
+    // Registers are still the ones the block store ran with
+    if (d->ext & EC72_JOURNAL_BUS) {
+        block_io(cpu, d);
+    } else if (d->ext & EC72_JOURNAL_BLOCK) {
+        if (EC72_OPCODE(IR) == OP_BCOPY) ec72_block_copy(cpu->memory, cpu->RB, cpu->RC, cpu->RE);
+        else ec72_block_fill(cpu->memory, cpu->RB, cpu->RA, cpu->RE);
+    }
+    if (d->mask & EC72_JOURNAL_RA) cpu->RA = d->RA;
+    if (d->mask & EC72_JOURNAL_RB) cpu->RB = d->RB;
+    if (d->mask & EC72_JOURNAL_RC) cpu->RC = d->RC;
+    if (d->mask & EC72_JOURNAL_RE) cpu->RE = d->RE;
+    if (d->mask & EC72_JOURNAL_SP) cpu->SP = d->SP;
+    if (d->mask & EC72_JOURNAL_PC) cpu->PC = d->PC;
+    if (d->mask & EC72_JOURNAL_FLAGS) {
+        cpu->ZF = d->flags & 1;
+        cpu->NF = (d->flags >> 1) & 1;
+        cpu->OF = (d->flags >> 2) & 1;
+    }
+    if (d->mask & EC72_JOURNAL_STORE) cpu->memory[d->addr] = d->word;
+    if (d->ext & EC72_JOURNAL_STOFR) cpu->STOFR = d->STOFR;
+    if (d->ext & EC72_JOURNAL_STUFR) cpu->STUFR = d->STUFR;
+    if (d->ext & EC72_JOURNAL_FAR) {
+        cpu->BANK = d->BANK;
+        cpu->MAR = d->MAR;
+    }
+    ec72_status_t s = (d->ext & EC72_JOURNAL_STATUS) ? (ec72_status_t)d->status : EC72_OK;
+    cpu->status = s;
+    if (s == EC72_OK || s == EC72_HALTED) {
+        cpu->retired++;
+        cpu->cycles += j->cost[EC72_OPCODE(IR)];
+    }
+}
+
+static void restore_seg(ec72_journal_t *j, ec72_cpu_t *cpu, size_t i) {
+    ec72_journal_seg_t *seg = seg_at(j, i);
+    ec72_snapshot_restore(cpu, &seg->state);
+    j->pos = seg->pos;
+    j->cursor = seg->offset;
+    j->cursor_seg = i;
+}
+
+// One recorded instruction forward; pos < end
+static void forward(ec72_journal_t *j, ec72_cpu_t *cpu, Delta_t *d) {
+    ec72_journal_seg_t *seg = seg_at(j, j->cursor_seg);
+    while (j->pos == seg->pos + seg->count) {
+        // The next segment starts from its own snapshot (it may follow a cut)
+        restore_seg(j, cpu, j->cursor_seg + 1);
+        seg = seg_at(j, j->cursor_seg);
+    }
+    j->cursor = decode(j, j->cursor, d);
+    apply(j, cpu, d);
+    j->pos++;
+}
+
+// Last segment starting at or before pos
+static size_t find_seg(const ec72_journal_t *j, uint64_t pos) {
+    size_t lo = 0, hi = j->seg_count - 1;
+    while (lo < hi) {
+        size_t mid = (lo + hi + 1) / 2;
+        if (seg_at(j, mid)->pos <= pos) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+bool ec72_journal_seek(ec72_journal_t *j, ec72_cpu_t *cpu, uint64_t pos) {
+    if (j->seg_count == 0 || pos < ec72_journal_first(j) || pos > j->end) return false;
+    if (pos == j->pos) return true;
+    size_t i = find_seg(j, pos);
+    // Forward inside the cursor's segment continues from the cursor
+    if (!(j->pos < j->end && pos > j->pos && i == j->cursor_seg)) restore_seg(j, cpu, i);
+    Delta_t d;
+    while (j->pos < pos) forward(j, cpu, &d);
+    ec72_mem_changed(cpu);
+    return true;
+}
+
+static uint64_t time_of(const ec72_journal_t *j, const ec72_cpu_t *cpu) {
+    return j->timed ? cpu->cycles : cpu->retired;
+}
+
+bool ec72_journal_seek_time(ec72_journal_t *j, ec72_cpu_t *cpu, uint64_t time) {
+    if (j->seg_count == 0) return false;
+    // Time restarts after a reset: the newest segment that began before time
+    size_t i = j->seg_count;
+    while (i-- > 0) {
+        const ec72_regs_t *r = &seg_at(j, i)->state.regs;
+        if ((j->timed ? r->cycles : r->retired) < time) break;
+    }
+    if (i == (size_t)-1) {
+        ec72_journal_seek(j, cpu, ec72_journal_first(j));
+        return time_of(j, cpu) >= time;
+    }
+    restore_seg(j, cpu, i);
+    Delta_t d;
+    while (time_of(j, cpu) < time && j->pos < j->end) forward(j, cpu, &d);
+    ec72_mem_changed(cpu);
+    return time_of(j, cpu) >= time || j->pos == j->end;
+}
+
+// Address of wp the delta's instruction stored to, -1 if none
+static int watched_store(const Delta_t *d, const uint32_t *wp) {
+    if (d->mask & EC72_JOURNAL_STORE) return ec72_dbg_bit(wp, d->addr) ? d->addr : -1;
+    if (d->ext & EC72_JOURNAL_BLOCK) return ec72_dbg_find(wp, d->block_addr, d->block_len);
+    return -1;
+}
+
+// Latest position before `before` where PC is at a breakpoint of bp, or whose
+// instruction stores to an address of wp
+static bool find_back(const ec72_journal_t *j, uint64_t before, const uint32_t *bp, const uint32_t *wp,
+                      uint64_t *found, ec72_stop_t *why, uint8_t *addr) {
+    for (size_t i = j->seg_count; i-- > 0; ) {
+        const ec72_journal_seg_t *seg = seg_at(j, i);
+        if (seg->pos >= before) continue;
+        uint64_t n = before - seg->pos;
+        if (n > seg->count) n = seg->count;
+        bool hit = false;
+        uint8_t pc = seg->state.regs.PC;
+        size_t off = seg->offset;
+        for (uint64_t k = 0; k < n; k++) {
+            Delta_t d;
+            off = decode(j, off, &d);
+            int w = wp ? watched_store(&d, wp) : -1;
+            if (w >= 0) {
+                hit = true;
+                *found = seg->pos + k;
+                *why = EC72_STOP_WATCH_WRITE;
+                *addr = (uint8_t)w;
+            } else if (bp && ec72_dbg_bit(bp, pc)) {
+                hit = true;
+                *found = seg->pos + k;
+                *why = EC72_STOP_BREAK;
+                *addr = pc;
+            }
+            pc = (d.mask & EC72_JOURNAL_PC) ? d.PC : (uint8_t)(pc + 1);
+        }
+        if (hit) return true;
+    }
+    return false;
+}
+
+bool ec72_journal_last_write(ec72_journal_t *j, ec72_cpu_t *cpu, uint8_t addr) {
+    uint32_t map[EC72_MEM_SIZE / 32] = { 0 };
+    map[addr >> 5] = 1u << (addr & 31);
+    uint64_t found;
+    ec72_stop_t why;
+    uint8_t at;
+    if (!find_back(j, j->pos, NULL, map, &found, &why, &at)) return false;
+    return ec72_journal_seek(j, cpu, found);
+}
+
+ec72_stop_t ec72_journal_reverse(ec72_journal_t *j, ec72_cpu_t *cpu, ec72_dbg_t *d) {
+    uint64_t found;
+    ec72_stop_t why = EC72_STOP_NONE;
+    uint8_t at = 0;
+    if (find_back(j, j->pos, d->bp_count ? d->bp : NULL, d->wp_count ? d->wp_write : NULL, &found, &why, &at)) {
+        ec72_journal_seek(j, cpu, found);
+    } else {
+        ec72_journal_seek(j, cpu, ec72_journal_first(j));
+        why = EC72_STOP_NONE;
+    }
+    d->stop = why;
+    d->stop_addr = at;
+    return why;
+}
+
+ec72_stop_t ec72_journal_replay(ec72_journal_t *j, ec72_cpu_t *cpu, ec72_dbg_t *d) {
+    d->stop = EC72_STOP_NONE;
+    Delta_t delta;
+    while (j->pos < j->end) {
+        forward(j, cpu, &delta);
+        int w = d->wp_count ? watched_store(&delta, d->wp_write) : -1;
+        if (w >= 0) {
+            d->stop = EC72_STOP_WATCH_WRITE;
+            d->stop_addr = (uint8_t)w;
+            break;
+        }
+        if (d->bp_count && ec72_dbg_bit(d->bp, cpu->PC)) {
+            d->stop = EC72_STOP_BREAK;
+            d->stop_addr = cpu->PC;
+            break;
+        }
+    }
+    ec72_mem_changed(cpu);
+    return d->stop;
+}
@@ -0,0 +1,273 @@
+//Copyright © Martin H. Sharp; August 2025
+// Execution journal for time travel: every instruction run while a journal
+// is attached leaves a delta of what it changed, and every interval
+// instructions a full snapshot starts a new segment. Any recorded position
+// is reached by restoring the segment's snapshot and applying its deltas,
+// so stepping back costs at most interval delta applications.
+//
+// Positions count the instructions recorded since ec72_journal_init()
+// (faulting ones included). Memory is bounded by the budget given there:
+// once it is used up, the oldest segments are dropped.
+//
+// Delta (forward, applied to the state before the instruction):
+//   mask byte, or 0xFF mask ext when something rare changed
+//   mask  0x01 RA  0x02 RB  0x04 RC  0x08 RE  0x10 SP   one byte each
+//         0x20 PC (jumps, CALL, RET)  0x40 flags (ZF | NF << 1 | OF << 2)
+//         0x80 stored word: address, then the word (little endian)
+//   ext   0x01 STOFR  0x02 STUFR  0x04 status   one byte each, after the above
+//         0x08 BANK, then MAR (little endian)
+//         0x10 block store (BCOPY, BFILL): RB, RE; the words are not in the
+//              delta, replaying runs the store again on the state before
+//         0x20 with 0x10, a block store that reached the I/O bus window:
+//              the window base, then the EC72_BUS_WINDOW bytes BCOPY read
+//              from it (0 where it read none); replaying stores the rest
+// IR, retired and cycles follow from the instruction itself. A mask byte of
+// 0xFE (no instruction changes RB, RC and RE at once) wraps to offset 0.
+//
+// The I/O bus and extended memory (ec72_xmem.h) are not journaled: going
+// back restores memory and registers (BANK and MAR included), not the input
+// already read, the output written or what FST stored. Reads are not recorded
+// either, so reverse runs stop at breakpoints and write watchpoints only.
+#ifndef EC72_JOURNAL_H
+#define EC72_JOURNAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "ec72_cpu.h"
+#include "ec72_snap.h"
+#include "ec72_bus.h"
+#include "ec72_gdb.h"
+
+#define EC72_JOURNAL_DEFAULT_BUDGET   (64u << 20)
+#define EC72_JOURNAL_DEFAULT_INTERVAL 4096u
+
+#define EC72_JOURNAL_MAX_DELTA 24   // bytes ec72_journal_end() stores; a delta takes at most 20
+#define EC72_JOURNAL_ESCAPE    0xFF
+#define EC72_JOURNAL_WRAP      0xFE
+
+#define EC72_JOURNAL_RA     0x01
+#define EC72_JOURNAL_RB     0x02
+#define EC72_JOURNAL_RC     0x04
+#define EC72_JOURNAL_RE     0x08
+#define EC72_JOURNAL_SP     0x10
+#define EC72_JOURNAL_PC     0x20
+#define EC72_JOURNAL_FLAGS  0x40
+#define EC72_JOURNAL_STORE  0x80
+
+#define EC72_JOURNAL_STOFR  0x01
+#define EC72_JOURNAL_STUFR  0x02
+#define EC72_JOURNAL_STATUS 0x04
+#define EC72_JOURNAL_FAR    0x08
+#define EC72_JOURNAL_BLOCK  0x10
+#define EC72_JOURNAL_BUS    0x20
+
+typedef struct {
+    ec72_snapshot_t state;      // state at pos
+    uint64_t pos;
+    size_t offset;              // ring offset of the first delta
+    uint32_t count;             // deltas in the segment
+} ec72_journal_seg_t;
+
+typedef struct ec72_journal {
+    uint8_t *ring;
+    size_t ring_size;
+    size_t write;               // next delta goes here
+    size_t room;                // bytes free at write before the oldest segment or the end
+
+    ec72_journal_seg_t *segs;   // ring of segments, oldest at first
+    size_t seg_cap, seg_first, seg_count;
+    uint32_t interval;
+    ec72_journal_seg_t *last;   // segment being recorded, set by ec72_journal_prepare()
+    uint32_t left;              // deltas until the next segment is due
+    bool cut;                   // state changed outside of a run: next delta opens a segment
+
+    uint64_t pos;               // position of the cpu state
+    uint64_t end;               // newest recorded position
+    size_t cursor;              // ring offset of the delta at pos, when pos < end
+    size_t cursor_seg;          // segment index (from first) cursor is in
+
+    uint32_t cost[256];         // cycle costs of the model the journal was started with
+    bool timed;                 // recorded with a cycle model
+    uint64_t dropped_segments;
+} ec72_journal_t;
+
+// budget: bytes for snapshots and deltas together. Returns false if it
+// cannot be allocated or holds less than two segments' snapshots.
+bool ec72_journal_init(ec72_journal_t *j, size_t budget, uint32_t interval);
+void ec72_journal_free(ec72_journal_t *j);
+
+// Recording starts at the current state; NULL detaches. The cycle table in
+// use is copied now, so keep it unchanged while the journal is attached.
+void ec72_cpu_set_journal(ec72_cpu_t *cpu, ec72_journal_t *j);
+
+// The state was changed outside of a run (reset, debugger writes): the
+// history before stays reachable, later positions are dropped
+void ec72_journal_cut(ec72_journal_t *j);
+
+// Oldest reachable position
+uint64_t ec72_journal_first(const ec72_journal_t *j);
+
+// Moves cpu to a recorded position; false if it is not in the journal
+bool ec72_journal_seek(ec72_journal_t *j, ec72_cpu_t *cpu, uint64_t pos);
+// First recorded position at which cpu->cycles (cpu->retired without a cycle
+// model) has reached time, or the newest one
+bool ec72_journal_seek_time(ec72_journal_t *j, ec72_cpu_t *cpu, uint64_t time);
+// Moves back to just before the latest earlier instruction that stored to
+// addr; false (cpu unchanged) if there is none in the journal
+bool ec72_journal_last_write(ec72_journal_t *j, ec72_cpu_t *cpu, uint8_t addr);
+// Reverse continue: back to the latest earlier position at a breakpoint of
+// d or just before a store to a write watchpoint, else the oldest position.
+// Returns the stop (EC72_STOP_NONE at the start of the journal).
+ec72_stop_t ec72_journal_reverse(ec72_journal_t *j, ec72_cpu_t *cpu, ec72_dbg_t *d);
+// Replay of recorded positions after pos up to a point of d (or the end),
+// without executing anything
+ec72_stop_t ec72_journal_replay(ec72_journal_t *j, ec72_cpu_t *cpu, ec72_dbg_t *d);
+
+// Bytes in use (ring and snapshots)
+size_t ec72_journal_bytes(const ec72_journal_t *j);
+
+// ---------------------------------------------------------------------------
+// Recording, used by the reference interpreter. The loop keeps the write
+// pointer in a local and settles with the journal once per batch:
+//
+//   uint32_t batch = ec72_journal_prepare(j, cpu);
+//   uint8_t *p = ec72_journal_cursor(j);
+//   up to batch times: execute; p = ec72_journal_put(p, cpu, s);
+//   ec72_journal_commit(j, p, executed);
+
+#if defined(__GNUC__)
+    #define EC72_JOURNAL_INLINE inline __attribute__((always_inline))
+#else
+    #define EC72_JOURNAL_INLINE inline
+#endif
+
+// Drops positions after pos (a run from the past forks the timeline), opens
+// a segment if due and makes room. Returns how many deltas fit before the
+// next call is needed (at least 1).
+uint32_t ec72_journal_prepare(ec72_journal_t *j, const ec72_cpu_t *cpu);
+
+static inline uint8_t *ec72_journal_cursor(ec72_journal_t *j) {
+    return j->ring + j->write;
+}
+
+static inline void ec72_journal_commit(ec72_journal_t *j, uint8_t *p, uint32_t count) {
+    size_t len = (size_t)(p - (j->ring + j->write));
+    j->write += len;
+    j->room -= len;
+    j->last->count += count;
+    j->left -= count;
+    j->end += count;
+    j->pos = j->end;
+}
+
+static inline uint8_t ec72_journal_flags(const ec72_cpu_t *cpu) {
+    return (uint8_t)(cpu->ZF | (cpu->NF << 1) | (cpu->OF << 2));
+}
+
+// What an opcode may change, from the opcode alone: mask bits in the low
+// byte, how it stores and the rare changes above
+#define EC72_JOURNAL_STORES_OPERAND 0x0100  // memory[operand]
+#define EC72_JOURNAL_STORES_RB      0x0200  // memory[RB]
+#define EC72_JOURNAL_STORES_SP      0x0300  // memory[SP] after the push
+#define EC72_JOURNAL_STORES         0x0300
+#define EC72_JOURNAL_DEST_HIGH      0x0400  // register in the operand's high nibble (MOVR)
+#define EC72_JOURNAL_DEST_LOW       0x0800  // register in the operand (POP)
+#define EC72_JOURNAL_EXT            0x1000  // STOFR or STUFR (SSTOF, SSTUF)
+#define EC72_JOURNAL_EXT_FAR        0x2000  // BANK or MAR (SBANK, SMAR, FLD, FST)
+#define EC72_JOURNAL_EXT_BLOCK      0x4000  // RE words at RB (BCOPY, BFILL)
+extern const uint16_t ec72_journal_effect[256];
+// Mask bit of a register code, 0 for codes that name none
+extern const uint8_t ec72_journal_reg_bit[16];
+
+// Block store just executed that reached the bus window: BCOPY read from it
+// or either stored into it
+static inline bool ec72_journal_block_io(const ec72_cpu_t *cpu) {
+    return ec72_bus_block_hit(cpu->bus, cpu->RB, cpu->RE) ||
+           (EC72_OPCODE(cpu->IR) == OP_BCOPY && ec72_bus_block_hit(cpu->bus, cpu->RC, cpu->RE));
+}
+
+// Delta of the instruction just executed at p; returns the end of it. The
+// fields come from the opcode's effect rather than from comparing the state
+// before and after, so a delta also holds a register the instruction wrote
+// with its old value (and a jump that was not taken its PC). That costs a
+// byte now and then but no capture of the old state and no compare per
+// register, which is most of what the journal adds to a run.
+static EC72_JOURNAL_INLINE uint8_t *ec72_journal_put(uint8_t *p, const ec72_cpu_t *cpu, ec72_status_t s) {
+    const uint16_t IR = cpu->IR;
+    unsigned effect = ec72_journal_effect[EC72_OPCODE(IR)];
+    unsigned mask = effect & 0x7F, ext = 0;
+    if (effect & EC72_JOURNAL_DEST_HIGH) mask |= ec72_journal_reg_bit[(EC72_OPERAND(IR) >> 4) & 0x0F];
+    if (effect & EC72_JOURNAL_DEST_LOW) mask |= ec72_journal_reg_bit[EC72_OPERAND(IR) & 0x0F];
+
+    uint8_t *q = p + 1;
+    if (s != EC72_OK || (effect & (EC72_JOURNAL_EXT | EC72_JOURNAL_EXT_FAR | EC72_JOURNAL_EXT_BLOCK))) {
+        ext = EC72_JOURNAL_STOFR | EC72_JOURNAL_STUFR;
+        if (effect & EC72_JOURNAL_EXT_FAR) ext |= EC72_JOURNAL_FAR;
+        if (s != EC72_OK) {
+            // Whatever the instruction got to before it faulted; a block
+            // store that faults has stored nothing
+            ext |= EC72_JOURNAL_STATUS | EC72_JOURNAL_FAR;
+            mask = 0x7F;
+            effect = 0;
+        } else if (effect & EC72_JOURNAL_EXT_BLOCK) {
+            ext |= EC72_JOURNAL_BLOCK;
+            if (cpu->bus && ec72_journal_block_io(cpu)) ext |= EC72_JOURNAL_BUS;
+        }
+        q = p + 3;
+    }
+    // Every register is written and only kept when in the mask
+    *q = cpu->RA; q += mask & 1;
+    *q = cpu->RB; q += (mask >> 1) & 1;
+    *q = cpu->RC; q += (mask >> 2) & 1;
+    *q = cpu->RE; q += (mask >> 3) & 1;
+    *q = cpu->SP; q += (mask >> 4) & 1;
+    *q = cpu->PC; q += (mask >> 5) & 1;
+    *q = ec72_journal_flags(cpu); q += (mask >> 6) & 1;
+    if (effect & EC72_JOURNAL_STORES) {
+        unsigned kind = effect & EC72_JOURNAL_STORES;
+        uint8_t addr = kind == EC72_JOURNAL_STORES_OPERAND ? EC72_OPERAND(IR) :
+                       kind == EC72_JOURNAL_STORES_RB ? cpu->RB : cpu->SP;
+        uint16_t w = cpu->memory[addr];
+        q[0] = addr;
+        q[1] = (uint8_t)w;
+        q[2] = (uint8_t)(w >> 8);
+        q += 3;
+        mask |= EC72_JOURNAL_STORE;
+    }
+    if (ext) {
+        *q++ = cpu->STOFR;
+        *q++ = cpu->STUFR;
+        if (ext & EC72_JOURNAL_STATUS) *q++ = (uint8_t)s;
+        if (ext & EC72_JOURNAL_FAR) {
+            q[0] = cpu->BANK;
+            q[1] = (uint8_t)cpu->MAR;
+            q[2] = (uint8_t)(cpu->MAR >> 8);
+            q += 3;
+        }
+        if (ext & EC72_JOURNAL_BLOCK) {
+            q[0] = cpu->RB;
+            q[1] = cpu->RE;
+            q += 2;
+        }
+        if (ext & EC72_JOURNAL_BUS) {
+            // What BCOPY read from a window register is in memory where it
+            // went, unless that is in the window too
+            uint8_t base = cpu->bus->base;
+            *q++ = base;
+            for (int k = 0; k < EC72_BUS_WINDOW; k++) {
+                uint8_t i = (uint8_t)(base + k - cpu->RC), dst = (uint8_t)(cpu->RB + i);
+                bool read = EC72_OPCODE(IR) == OP_BCOPY && i < cpu->RE && !ec72_bus_hit(cpu->bus, dst);
+                *q++ = read ? (uint8_t)cpu->memory[dst] : 0;
+            }
+        }
+        p[0] = EC72_JOURNAL_ESCAPE;
+        p[1] = (uint8_t)mask;
+        p[2] = (uint8_t)ext;
+    } else {
+        p[0] = (uint8_t)mask;
+    }
+    return q;
+}
+
+#endif
@@ -0,0 +1,197 @@
+//Copyright © Martin H. Sharp; August 2025
+// Lazy-flag interpreter: the switch loop with the register file in one local
+// array indexed by register code (MOVR, ADDR, SUBR, MUL, PUSH and POP index
+// it directly instead of going through get_register()) and without ZF, NF
+// and OF. The instructions that set flags only keep their untruncated
+// result; JMPZ, JMPN and JMPO derive their flag from it, and the three flags
+// are written back once when the run ends. update_flags() is a function of
+// that result alone, so the flags are bit-exact with the switch interpreter.
+//
+// With an I/O bus the run goes to the switch interpreter, as do flags set by
+// hand (debugger, checkpoint) that no ALU result produces.
+#include <stdint.h>
+#include <stdbool.h>
+#include "ec72_cpu.h"
+#include "ec72_engine.h"
+#include "ec72_xmem.h"
+
+// code names RA, RB, RC, RE or SP
+#define IS_REG(code) ((uint8_t)((code) - REG_A) <= REG_SP - REG_A)
+
+// An ALU result that gives the context's flags; false if there is none
+static bool result_of_flags(const ec72_cpu_t *cpu, int *result) {
+    if (cpu->ZF) *result = 0;
+    else if (cpu->NF) *result = -1;
+    else if (cpu->OF) *result = 256;
+    else *result = 1;
+    return cpu->ZF == (*result == 0) && cpu->NF == (*result < 0) && cpu->OF == (*result > 255 || *result < 0);
+}
+
+// ZF, NF, OF of the last result
+#define ZF() (res == 0)
+#define NF() (res < 0)
+#define OF() ((unsigned)res > 255)
+
+#define FAULT(x) do { s = (x); goto out; } while (0)
+
+static EC72_ALWAYS_INLINE ec72_status_t lazy_loop(ec72_cpu_t *cpu, uint64_t max_instructions, int res, const bool checked) {
+    // Indexed by register code; slots 0 and 6..15 are never used and only
+    // exist so that any 4-bit code stays inside the array
+    uint8_t r[16];
+    r[REG_A] = cpu->RA;
+    r[REG_B] = cpu->RB;
+    r[REG_C] = cpu->RC;
+    r[REG_E] = cpu->RE;
+    r[REG_SP] = cpu->SP;
+    uint8_t pc = cpu->PC, stofr = cpu->STOFR, stufr = cpu->STUFR;
+    uint16_t ir = cpu->IR;
+    uint16_t *memory = cpu->memory;
+    ec72_status_t s = EC72_OK;
+    uint64_t left = max_instructions;
+
+    for (; left; left--) {
+        ir = memory[pc++];
+        uint8_t operand = (uint8_t)ir;
+        switch (ir >> 8) {
+            case OP_MOVR: {
+                uint8_t dest = operand >> 4, src = operand & 0x0F;
+                if (IS_REG(dest) && IS_REG(src)) r[dest] = r[src];
+                break;
+            }
+            case OP_MOVA: r[REG_A] = (uint8_t)memory[operand]; break;
+            case OP_MOVB: r[REG_B] = (uint8_t)memory[operand]; break;
+            case OP_MOVC: r[REG_C] = (uint8_t)memory[operand]; break;
+            case OP_MOVE: r[REG_E] = (uint8_t)memory[operand]; break;
+            case OP_STORA: memory[operand] = r[REG_A]; break;
+            case OP_STORB: memory[operand] = r[REG_B]; break;
+            case OP_STORC: memory[operand] = r[REG_C]; break;
+            case OP_STORE: memory[operand] = r[REG_E]; break;
+            case OP_LDIMA: r[REG_A] = operand; break;
+            case OP_LDIMB: r[REG_B] = operand; break;
+            case OP_LDIMC: r[REG_C] = operand; break;
+            case OP_LDIME: r[REG_E] = operand; break;
+            case OP_JMPN: if (NF()) pc = operand; break;
+            case OP_JMPZ: if (ZF()) pc = operand; break;
+            case OP_JMPO: if (OF()) pc = operand; break;
+            case OP_JMP: pc = operand; break;
+            case OP_ADD: res = r[REG_A] + operand; r[REG_A] = (uint8_t)res; break;
+            case OP_SUB: res = r[REG_A] - operand; r[REG_A] = (uint8_t)res; break;
+            case OP_ADDR:
+                if (!IS_REG(operand)) FAULT(EC72_ERR_ILLEGAL_OPERAND);
+                res = r[REG_A] + r[operand];
+                r[REG_A] = (uint8_t)res;
+                break;
+            case OP_SUBR:
+                if (!IS_REG(operand)) FAULT(EC72_ERR_ILLEGAL_OPERAND);
+                res = r[REG_A] - r[operand];
+                r[REG_A] = (uint8_t)res;
+                break;
+            case OP_CALL:
+                if (checked && (r[REG_SP] == stofr || r[REG_SP] == 0)) FAULT(EC72_ERR_STACK_OVERFLOW);
+                memory[--r[REG_SP]] = pc;
+                pc = operand;
+                break;
+            case OP_RET:
+                if (checked && r[REG_SP] == MEM_SIZE-1) FAULT(EC72_ERR_STACK_UNDERFLOW);
+                pc = (uint8_t)memory[r[REG_SP]++];
+                break;
+            case OP_MOVA_PTRB: r[REG_A] = (uint8_t)memory[r[REG_B]]; break;
+            case OP_STORA_PTRB: memory[r[REG_B]] = r[REG_A]; break;
+            case OP_PUSH: {
+                if (!IS_REG(operand)) FAULT(EC72_ERR_ILLEGAL_OPERAND);
+                if (checked && (r[REG_SP] == stofr || r[REG_SP] == 0)) FAULT(EC72_ERR_STACK_OVERFLOW);
+                uint8_t v = r[operand];
+                memory[--r[REG_SP]] = v;
+                break;
+            }
+            case OP_POP: {
+                if (!IS_REG(operand)) FAULT(EC72_ERR_ILLEGAL_OPERAND);
+                if (checked && (r[REG_SP] == stufr || r[REG_SP] == MEM_SIZE-1)) FAULT(EC72_ERR_STACK_UNDERFLOW);
+                uint8_t v = (uint8_t)memory[r[REG_SP]++];
+                r[operand] = v;
+                break;
+            }
+            case OP_ADDSP:
+                if (checked && (r[REG_SP] == stufr || r[REG_SP] == MEM_SIZE-1)) FAULT(EC72_ERR_STACK_UNDERFLOW);
+                r[REG_SP] += operand;
+                break;
+            case OP_SUBSP:
+                if (checked && (r[REG_SP] == stofr || r[REG_SP] == 0)) FAULT(EC72_ERR_STACK_OVERFLOW);
+                r[REG_SP] -= operand;
+                break;
+            case OP_OUT: if (cpu->out) cpu->out(cpu->out_user, r[REG_A]); break;
+            case OP_SSTOF: stofr = operand; break;
+            case OP_SSTUF: stufr = r[REG_SP] = operand; break;
+            case OP_XCHG: {
+                if (cpu->atomic_stop) { pc--; s = EC72_SYNC; goto out; }
+                uint8_t v = (uint8_t)memory[operand];
+                memory[operand] = r[REG_A];
+                r[REG_A] = v;
+                break;
+            }
+            case OP_CAS: {
+                if (cpu->atomic_stop) { pc--; s = EC72_SYNC; goto out; }
+                uint8_t v = (uint8_t)memory[operand];
+                bool swap = v == r[REG_A];
+                if (swap) memory[operand] = r[REG_B];
+                else r[REG_A] = v;
+                res = !swap;
+                break;
+            }
+            case OP_LDID: r[REG_A] = cpu->core_id; r[REG_B] = cpu->cores; break;
+            case OP_SBANK: cpu->BANK = operand; break;
+            case OP_SMAR: cpu->MAR = (uint16_t)(r[REG_B] << 8 | r[REG_C]); break;
+            case OP_FLD: r[REG_A] = ec72_far_load(cpu, operand); break;
+            case OP_FST: ec72_far_store(cpu, r[REG_A], operand); break;
+            case OP_BCOPY: case OP_BFILL: {
+                ec72_status_t bad = checked ? ec72_block_stack_check(r[REG_B], r[REG_E], r[REG_SP], stofr, stufr) : EC72_OK;
+                if (bad != EC72_OK) FAULT(bad);
+                if (ir >> 8 == OP_BCOPY) ec72_block_copy(memory, r[REG_B], r[REG_C], r[REG_E]);
+                else ec72_block_fill(memory, r[REG_B], r[REG_A], r[REG_E]);
+                break;
+            }
+            case OP_BCMP: {
+                uint8_t at;
+                res = ec72_block_compare(memory, r[REG_B], r[REG_C], r[REG_E], &at);
+                r[REG_A] = at;
+                break;
+            }
+            case OP_MUL:
+                if (!IS_REG(operand)) FAULT(EC72_ERR_ILLEGAL_OPERAND);
+                res = r[REG_A] * r[operand];
+                r[REG_A] = (uint8_t)res;
+                r[REG_E] = (uint8_t)(res >> 8);
+                break;
+            case OP_HLT: left--; FAULT(EC72_HALTED);
+            default: FAULT(EC72_ERR_UNKNOWN_OPCODE);
+        }
+    }
+
+out:
+    cpu->RA = r[REG_A];
+    cpu->RB = r[REG_B];
+    cpu->RC = r[REG_C];
+    cpu->RE = r[REG_E];
+    cpu->SP = r[REG_SP];
+    cpu->PC = pc;
+    cpu->IR = ir;
+    cpu->STOFR = stofr;
+    cpu->STUFR = stufr;
+    update_flags(cpu, res);
+    cpu->retired += max_instructions - left;
+    if (s != EC72_OK && s != EC72_SYNC) cpu->status = s;
+    ec72_mem_changed(cpu);
+    return s;
+}
+
+#undef ZF
+#undef NF
+#undef OF
+#undef FAULT
+
+ec72_status_t ec72_lazy_run(ec72_cpu_t *cpu, uint64_t max_instructions) {
+    int res;
+    if (cpu->bus || !result_of_flags(cpu, &res)) return ec72_switch_run(cpu, max_instructions);
+    if (cpu->verified) return lazy_loop(cpu, max_instructions, res, false);
+    return lazy_loop(cpu, max_instructions, res, true);
+}
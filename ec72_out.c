@@ -0,0 +1,123 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_out.h"
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <fcntl.h>
+    #define popen  _popen
+    #define pclose _pclose
+#endif
+
+#define GREEN   "\x1b[32m"
+#define RESET   "\x1b[0m"
+
+static const char *mode_names[] = { "color", "dec", "raw" };
+
+bool ec72_out_mode_from_name(const char *name, ec72_out_mode_t *mode) {
+    for (size_t i = 0; i < sizeof(mode_names)/sizeof(mode_names[0]); i++) {
+        if (strcmp(mode_names[i], name) == 0) {
+            *mode = (ec72_out_mode_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ec72_out_open(ec72_out_t *out, ec72_out_mode_t mode, const char *target, size_t buffer_size) {
+    memset(out, 0, sizeof(*out));
+    out->mode = mode;
+
+    if (!target || strcmp(target, "-") == 0) {
+        out->f = stdout;
+    } else if (target[0] == '|') {
+        // popen() has no binary mode (glibc rejects "wb"); raw bytes only
+        // need it set on Windows
+        out->f = popen(target + 1, "w");
+#ifdef _WIN32
+        if (out->f && mode == EC72_OUT_RAW) _setmode(_fileno(out->f), _O_BINARY);
+#endif
+        out->is_pipe = out->owns_file = true;
+    } else {
+        out->f = fopen(target, mode == EC72_OUT_RAW ? "wb" : "w");
+        out->owns_file = true;
+    }
+    if (!out->f) {
+        perror("Error opening output");
+        return false;
+    }
+
+    if (buffer_size) {
+        out->buf = malloc(buffer_size);
+        if (!out->buf) {
+            ec72_out_close(out);
+            return false;
+        }
+        out->cap = buffer_size;
+    }
+
+    for (int v = 0; v < 256; v++) {
+        int n = 0;
+        if (mode == EC72_OUT_COLOR) n = sprintf(out->text[v], "%sOUT: %d%s\n", GREEN, v, RESET);
+        else if (mode == EC72_OUT_DEC) n = sprintf(out->text[v], "%d\n", v);
+        out->text_len[v] = (uint8_t)n;
+    }
+    return true;
+}
+
+static void write_through(ec72_out_t *out, const void *data, size_t n) {
+    if (fwrite(data, 1, n, out->f) != n) out->failed = true;
+}
+
+void ec72_out_flush(ec72_out_t *out) {
+    if (out->len) {
+        write_through(out, out->buf, out->len);
+        out->len = 0;
+    }
+    if (fflush(out->f) != 0) out->failed = true;
+}
+
+void ec72_out_put(void *user, uint8_t value) {
+    ec72_out_t *out = user;
+    const void *data;
+    size_t n;
+    if (out->mode == EC72_OUT_RAW) {
+        data = &value;
+        n = 1;
+    } else {
+        data = out->text[value];
+        n = out->text_len[value];
+    }
+    out->count++;
+
+    if (!out->cap) {
+        write_through(out, data, n);
+        return;
+    }
+    if (out->len + n > out->cap) {
+        write_through(out, out->buf, out->len);
+        out->len = 0;
+    }
+    memcpy(out->buf + out->len, data, n);
+    out->len += n;
+}
+
+bool ec72_out_close(ec72_out_t *out) {
+    if (out->f) {
+        ec72_out_flush(out);
+        if (out->is_pipe) {
+            if (pclose(out->f) != 0) out->failed = true;
+        } else if (out->owns_file) {
+            if (fclose(out->f) != 0) out->failed = true;
+        }
+        out->f = NULL;
+    }
+    free(out->buf);
+    out->buf = NULL;
+    out->cap = out->len = 0;
+    return !out->failed;
+}
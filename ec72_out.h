@@ -0,0 +1,56 @@
+//Copyright © Martin H. Sharp; August 2025
+// Buffered output channel for the OUT instruction. Values are formatted from
+// precomputed tables into a large user-space buffer that is written out when
+// it fills up and on ec72_out_flush() (the emulator flushes on HLT and on
+// errors), instead of one printf per OUT.
+#ifndef EC72_OUT_H
+#define EC72_OUT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "ec72_cpu.h"
+
+typedef enum {
+    EC72_OUT_COLOR = 0,     // "OUT: 72" in green, as EC72CPU always printed it
+    EC72_OUT_DEC,           // "72\n", no escape codes
+    EC72_OUT_RAW            // one byte per OUT
+} ec72_out_mode_t;
+
+#define EC72_OUT_DEFAULT_BUFFER (1u << 16)
+
+typedef struct ec72_out {
+    ec72_out_mode_t mode;
+    FILE *f;
+    bool owns_file;
+    bool is_pipe;
+    char *buf;
+    size_t len, cap;        // cap 0: write through on every OUT
+    uint64_t count;         // values written
+    bool failed;            // a write to the target failed
+
+    // Preformatted text for every byte value (not used in raw mode)
+    char text[256][24];
+    uint8_t text_len[256];
+} ec72_out_t;
+
+// target: NULL or "-" for stdout, "|command" for a pipe into command,
+// anything else is a file (or FIFO) path. buffer_size 0 disables buffering.
+// Returns false (and prints the reason) if the target cannot be opened.
+bool ec72_out_open(ec72_out_t *out, ec72_out_mode_t mode, const char *target, size_t buffer_size);
+void ec72_out_flush(ec72_out_t *out);
+// Flushes and closes the target; returns false if any write failed
+bool ec72_out_close(ec72_out_t *out);
+
+// ec72_out_fn for ec72_cpu_set_output(); user is the ec72_out_t
+void ec72_out_put(void *user, uint8_t value);
+
+static inline void ec72_cpu_attach_output(ec72_cpu_t *cpu, ec72_out_t *out) {
+    ec72_cpu_set_output(cpu, ec72_out_put, out);
+}
+
+// Parse "color", "dec" or "raw"
+bool ec72_out_mode_from_name(const char *name, ec72_out_mode_t *mode);
+
+#endif
@@ -0,0 +1,200 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_prof.h"
+
+#define INITIAL_NODES 1024
+
+bool ec72_prof_init(ec72_prof_t *p, uint8_t entry) {
+    memset(p, 0, sizeof(*p));
+    p->nodes = calloc(INITIAL_NODES, sizeof(ec72_prof_node_t));
+    if (!p->nodes) return false;
+    p->node_count = 1;
+    p->nodes[0].func = entry;
+    p->nodes[0].calls = 1;
+    return true;
+}
+
+void ec72_prof_free(ec72_prof_t *p) {
+    free(p->nodes);
+    p->nodes = NULL;
+}
+
+// Child of parent for func, created on first call
+static uint32_t child(ec72_prof_t *p, uint32_t parent, uint8_t func) {
+    for (uint32_t c = p->nodes[parent].first_child; c; c = p->nodes[c].next_sibling) {
+        if (p->nodes[c].func == func) return c;
+    }
+    if (p->node_count == EC72_PROF_MAX_NODES) return parent;
+
+    // Grow by doubling; node_count is a power of two whenever it is full
+    if (p->node_count >= INITIAL_NODES && (p->node_count & (p->node_count - 1)) == 0) {
+        ec72_prof_node_t *grown = realloc(p->nodes, 2 * (size_t)p->node_count * sizeof(ec72_prof_node_t));
+        if (!grown) return parent;
+        p->nodes = grown;
+    }
+    uint32_t c = p->node_count++;
+    memset(&p->nodes[c], 0, sizeof(p->nodes[c]));
+    p->nodes[c].parent = parent;
+    p->nodes[c].func = func;
+    p->nodes[c].next_sibling = p->nodes[parent].first_child;
+    p->nodes[parent].first_child = c;
+    return c;
+}
+
+void ec72_prof_call(ec72_prof_t *p, uint8_t target, uint8_t ret) {
+    if (p->depth == EC72_PROF_MAX_DEPTH) {
+        p->lost++;
+        return;
+    }
+    p->ret_addr[p->depth] = ret;
+    p->caller[p->depth++] = p->cur;
+    p->cur = child(p, p->cur, target);
+    p->nodes[p->cur].calls++;
+}
+
+void ec72_prof_ret(ec72_prof_t *p, uint8_t ret) {
+    if (p->lost) {
+        p->lost--;
+        return;
+    }
+    // Normally the top frame; frames above a match were left without RET.
+    // A RET that matches no CALL (computed jump via PUSH/RET) is no return.
+    for (uint32_t d = p->depth; d > 0; d--) {
+        if (p->ret_addr[d - 1] == ret) {
+            p->depth = d - 1;
+            p->cur = p->caller[d - 1];
+            return;
+        }
+    }
+}
+
+static const char *func_name(const ec72_symtab_t *syms, uint8_t func, char *buf, size_t size) {
+    return ec72_symtab_format(syms, func, buf, size);
+}
+
+static void format_instruction(uint16_t word, char *buf, size_t size) {
+    const char *name = ec72_opcode_name(EC72_OPCODE(word));
+    uint8_t operand = EC72_OPERAND(word);
+    if (!name) snprintf(buf, size, "?? 0x%04X", word);
+    else if (operand) snprintf(buf, size, "%s 0x%02X", name, operand);
+    else snprintf(buf, size, "%s", name);
+}
+
+static const uint64_t *sort_key;
+
+static int by_key_desc(const void *a, const void *b) {
+    uint64_t x = sort_key[*(const uint16_t *)a], y = sort_key[*(const uint16_t *)b];
+    if (x != y) return x < y ? 1 : -1;
+    return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+void ec72_prof_report(const ec72_prof_t *p, const ec72_cpu_t *cpu, const ec72_symtab_t *syms, FILE *f) {
+    char where[80], insn[32];
+    uint64_t total = 0;
+    for (int a = 0; a < EC72_MEM_SIZE; a++) total += p->exec[a];
+    double pct = total ? 100.0 / (double)total : 0.0;
+
+    fprintf(f, "EC72 profile: %llu instructions\n\n", (unsigned long long)total);
+
+    // Hot addresses
+    uint16_t order[EC72_MEM_SIZE];
+    int n = 0;
+    for (int a = 0; a < EC72_MEM_SIZE; a++) {
+        if (p->exec[a]) order[n++] = (uint16_t)a;
+    }
+    sort_key = p->exec;
+    qsort(order, (size_t)n, sizeof(order[0]), by_key_desc);
+
+    fprintf(f, "%-14s %7s  %-4s %-24s %-18s %s\n", "count", "%", "addr", "location", "instruction", "taken / not taken");
+    for (int i = 0; i < n; i++) {
+        uint8_t a = (uint8_t)order[i];
+        format_instruction(cpu->memory[a], insn, sizeof(insn));
+        fprintf(f, "%-14llu %6.2f%%  0x%02X %-24s ", (unsigned long long)p->exec[a], p->exec[a] * pct,
+                a, ec72_symtab_format(syms, a, where, sizeof(where)));
+        if (p->taken[a] || p->not_taken[a]) {
+            fprintf(f, "%-18s %llu / %llu\n", insn, (unsigned long long)p->taken[a], (unsigned long long)p->not_taken[a]);
+        } else {
+            fprintf(f, "%s\n", insn);
+        }
+    }
+
+    // Inclusive counts per call path; children are always created after
+    // their parent, so one backward sweep adds every subtree up
+    uint64_t *inclusive = malloc(p->node_count * sizeof(uint64_t));
+    uint64_t (*edges)[EC72_MEM_SIZE] = calloc(EC72_MEM_SIZE, sizeof(*edges));
+    if (!inclusive || !edges) {
+        free(inclusive);
+        free(edges);
+        return;
+    }
+    for (uint32_t i = 0; i < p->node_count; i++) inclusive[i] = p->nodes[i].self;
+    for (uint32_t i = p->node_count - 1; i > 0; i--) inclusive[p->nodes[i].parent] += inclusive[i];
+
+    uint64_t f_self[EC72_MEM_SIZE] = {0}, f_incl[EC72_MEM_SIZE] = {0}, f_calls[EC72_MEM_SIZE] = {0};
+    bool seen[EC72_MEM_SIZE] = {false};
+    for (uint32_t i = 0; i < p->node_count; i++) {
+        const ec72_prof_node_t *node = &p->nodes[i];
+        seen[node->func] = true;
+        f_self[node->func] += node->self;
+        f_calls[node->func] += node->calls;
+        if (i) edges[p->nodes[node->parent].func][node->func] += node->calls;
+
+        // Recursive paths count only at their outermost frame
+        bool outermost = true;
+        for (uint32_t a = i; a != 0 && outermost; ) {
+            a = p->nodes[a].parent;
+            if (p->nodes[a].func == node->func) outermost = false;
+        }
+        if (outermost) f_incl[node->func] += inclusive[i];
+    }
+
+    n = 0;
+    for (int a = 0; a < EC72_MEM_SIZE; a++) {
+        if (seen[a]) order[n++] = (uint16_t)a;
+    }
+    sort_key = f_incl;
+    qsort(order, (size_t)n, sizeof(order[0]), by_key_desc);
+
+    fprintf(f, "\n%-24s %14s %7s %14s %7s %10s\n", "function", "total", "%", "self", "%", "calls");
+    for (int i = 0; i < n; i++) {
+        uint8_t a = (uint8_t)order[i];
+        fprintf(f, "%-24s %14llu %6.2f%% %14llu %6.2f%% %10llu\n", func_name(syms, a, where, sizeof(where)),
+                (unsigned long long)f_incl[a], f_incl[a] * pct, (unsigned long long)f_self[a], f_self[a] * pct,
+                (unsigned long long)f_calls[a]);
+    }
+
+    fprintf(f, "\n%-24s    %-24s %10s\n", "caller", "callee", "calls");
+    for (int from = 0; from < EC72_MEM_SIZE; from++) {
+        for (int to = 0; to < EC72_MEM_SIZE; to++) {
+            if (!edges[from][to]) continue;
+            char callee[80];
+            fprintf(f, "%-24s -> %-24s %10llu\n", func_name(syms, (uint8_t)from, where, sizeof(where)),
+                    func_name(syms, (uint8_t)to, callee, sizeof(callee)), (unsigned long long)edges[from][to]);
+        }
+    }
+
+    free(inclusive);
+    free(edges);
+}
+
+void ec72_prof_write_folded(const ec72_prof_t *p, const ec72_symtab_t *syms, FILE *f) {
+    uint32_t path[EC72_PROF_MAX_DEPTH + 1];
+    char name[80];
+    for (uint32_t i = 0; i < p->node_count; i++) {
+        if (!p->nodes[i].self) continue;
+        int len = 0;
+        for (uint32_t a = i; ; a = p->nodes[a].parent) {
+            path[len++] = a;
+            if (a == 0) break;
+        }
+        while (len > 0) {
+            fputs(func_name(syms, p->nodes[path[--len]].func, name, sizeof(name)), f);
+            if (len) fputc(';', f);
+        }
+        fprintf(f, " %llu\n", (unsigned long long)p->nodes[i].self);
+    }
+}
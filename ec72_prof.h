@@ -0,0 +1,79 @@
+//Copyright © Martin H. Sharp; August 2025
+// Instruction profiler: execution count per address, taken/not-taken counts
+// of the conditional jumps and a call tree built by shadowing the return
+// addresses that CALL pushes and RET pops from memory[SP].
+#ifndef EC72_PROF_H
+#define EC72_PROF_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "ec72_cpu.h"
+#include "ec72_sym.h"
+
+#define EC72_PROF_MAX_DEPTH 256         // deeper calls are charged to the deepest frame
+#define EC72_PROF_MAX_NODES (1u << 16)  // distinct call paths
+
+// One call path: function entry address reached from parent
+typedef struct {
+    uint32_t parent;
+    uint32_t first_child, next_sibling;     // 0: none (node 0 is the root)
+    uint8_t func;
+    uint64_t self;                          // instructions executed in this path
+    uint64_t calls;
+} ec72_prof_node_t;
+
+typedef struct ec72_prof {
+    uint64_t exec[EC72_MEM_SIZE];
+    uint64_t taken[EC72_MEM_SIZE];
+    uint64_t not_taken[EC72_MEM_SIZE];
+
+    ec72_prof_node_t *nodes;
+    uint32_t node_count;
+    uint32_t cur;                           // node of the running function
+
+    // Shadow call stack: return address pushed by each CALL and the node
+    // that was current before it
+    uint8_t ret_addr[EC72_PROF_MAX_DEPTH];
+    uint32_t caller[EC72_PROF_MAX_DEPTH];
+    uint32_t depth, lost;                   // lost: CALLs beyond MAX_DEPTH
+} ec72_prof_t;
+
+// Returns false if memory for the call tree cannot be allocated
+bool ec72_prof_init(ec72_prof_t *p, uint8_t entry);
+void ec72_prof_free(ec72_prof_t *p);
+
+static inline void ec72_cpu_set_prof(ec72_cpu_t *cpu, ec72_prof_t *p) {
+    cpu->prof = p;
+}
+
+// Slow path of ec72_prof_flow()
+void ec72_prof_call(ec72_prof_t *p, uint8_t target, uint8_t ret);
+void ec72_prof_ret(ec72_prof_t *p, uint8_t ret);
+
+// Per instruction, before it executes
+static inline void ec72_prof_count(ec72_prof_t *p, uint8_t pc) {
+    p->exec[pc]++;
+    p->nodes[p->cur].self++;
+}
+
+// After an instruction fetched from pc ran with status s
+static inline void ec72_prof_flow(ec72_prof_t *p, const ec72_cpu_t *cpu, uint8_t pc, uint16_t ir, ec72_status_t s) {
+    if (s != EC72_OK) return;
+    switch (EC72_OPCODE(ir)) {
+        // Jumps leave the flags alone, so they still show the decision
+        case OP_JMPN: if (cpu->NF) p->taken[pc]++; else p->not_taken[pc]++; break;
+        case OP_JMPZ: if (cpu->ZF) p->taken[pc]++; else p->not_taken[pc]++; break;
+        case OP_JMPO: if (cpu->OF) p->taken[pc]++; else p->not_taken[pc]++; break;
+        case OP_CALL: ec72_prof_call(p, EC72_OPERAND(ir), (uint8_t)cpu->memory[cpu->SP]); break;
+        case OP_RET: ec72_prof_ret(p, cpu->PC); break;
+        default: break;
+    }
+}
+
+// Text report: hot addresses, functions, call edges. syms may be NULL.
+void ec72_prof_report(const ec72_prof_t *p, const ec72_cpu_t *cpu, const ec72_symtab_t *syms, FILE *f);
+// Collapsed stacks ("main;ADDOP 1234" per line) for flamegraph tools
+void ec72_prof_write_folded(const ec72_prof_t *p, const ec72_symtab_t *syms, FILE *f);
+
+#endif
@@ -0,0 +1,619 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_simd.h"
+#include "ec72_engine.h"
+
+#define W EC72_SIMD_WIDTH
+
+// One vector block of lanes. Flags are stored as lane masks (0x00/0xFF);
+// memory word a of lane l is hi[a][l] << 8 | lo[a][l].
+typedef struct {
+    uint8_t RA[W], RB[W], RC[W], RE[W], SP[W], PC[W], STOFR[W], STUFR[W];
+    uint8_t ZF[W], NF[W], OF[W];
+    uint8_t IRL[W], IRH[W];
+    uint8_t MARL[W], MARH[W], BANK[W];
+    uint8_t live[W];            // 0xFF: lane exists and its status is EC72_OK
+    uint8_t ticks[W];           // retired but not yet added to retired[]
+    uint8_t lo[EC72_MEM_SIZE][W];
+    uint8_t hi[EC72_MEM_SIZE][W];
+    uint8_t status[W];
+    uint64_t retired[W];
+} Block_t;
+
+struct ec72_simd {
+    int lanes;
+    int block_count;
+    Block_t *blocks;            // 32-byte aligned
+    void *alloc;
+
+    uint16_t image[EC72_MEM_SIZE];
+    size_t image_words;
+
+    ec72_simd_out_fn out;
+    void *out_user;
+};
+
+ec72_simd_t *ec72_simd_create(int lanes) {
+    if (lanes <= 0) return NULL;
+    ec72_simd_t *s = calloc(1, sizeof(ec72_simd_t));
+    if (!s) return NULL;
+    s->lanes = lanes;
+    s->block_count = (lanes + W - 1) / W;
+    s->alloc = malloc((size_t)s->block_count * sizeof(Block_t) + 31);
+    if (!s->alloc) {
+        free(s);
+        return NULL;
+    }
+    s->blocks = (Block_t *)(((uintptr_t)s->alloc + 31) & ~(uintptr_t)31);
+    ec72_simd_reset(s);
+    return s;
+}
+
+void ec72_simd_destroy(ec72_simd_t *s) {
+    if (!s) return;
+    free(s->alloc);
+    free(s);
+}
+
+int ec72_simd_lanes(const ec72_simd_t *s) {
+    return s->lanes;
+}
+
+void ec72_simd_load_words(ec72_simd_t *s, const uint16_t *words, size_t count) {
+    if (count > EC72_MEM_SIZE) count = EC72_MEM_SIZE;
+    memset(s->image, 0, sizeof(s->image));
+    memcpy(s->image, words, count * sizeof(uint16_t));
+    s->image_words = count;
+    ec72_simd_reset(s);
+}
+
+void ec72_simd_reset(ec72_simd_t *s) {
+    for (int k = 0; k < s->block_count; k++) {
+        Block_t *b = &s->blocks[k];
+        memset(b, 0, sizeof(*b));
+        for (int a = 0; a < EC72_MEM_SIZE; a++) {
+            memset(b->lo[a], s->image[a] & 0xFF, W);
+            memset(b->hi[a], s->image[a] >> 8, W);
+        }
+        memset(b->STUFR, MEM_SIZE - 1, W);
+        memset(b->SP, MEM_SIZE - 1, W);
+        for (int l = 0; l < W; l++) {
+            b->live[l] = (k * W + l < s->lanes) ? 0xFF : 0x00;
+        }
+    }
+}
+
+void ec72_simd_set_output(ec72_simd_t *s, ec72_simd_out_fn out, void *user) {
+    s->out = out;
+    s->out_user = user;
+}
+
+void ec72_simd_poke(ec72_simd_t *s, int lane, uint8_t address, uint16_t value) {
+    Block_t *b = &s->blocks[lane / W];
+    b->lo[address][lane % W] = (uint8_t)(value & 0xFF);
+    b->hi[address][lane % W] = (uint8_t)(value >> 8);
+}
+
+uint16_t ec72_simd_peek(const ec72_simd_t *s, int lane, uint8_t address) {
+    const Block_t *b = &s->blocks[lane / W];
+    return (uint16_t)(b->hi[address][lane % W] << 8 | b->lo[address][lane % W]);
+}
+
+void ec72_simd_get_lane(const ec72_simd_t *s, int lane, ec72_cpu_t *cpu) {
+    const Block_t *b = &s->blocks[lane / W];
+    int l = lane % W;
+    for (int a = 0; a < EC72_MEM_SIZE; a++) {
+        cpu->memory[a] = (uint16_t)(b->hi[a][l] << 8 | b->lo[a][l]);
+    }
+    cpu->RA = b->RA[l];
+    cpu->RB = b->RB[l];
+    cpu->RC = b->RC[l];
+    cpu->RE = b->RE[l];
+    cpu->IR = (uint16_t)(b->IRH[l] << 8 | b->IRL[l]);
+    cpu->PC = b->PC[l];
+    cpu->MAR = (uint16_t)(b->MARH[l] << 8 | b->MARL[l]);
+    cpu->BANK = b->BANK[l];
+    cpu->STOFR = b->STOFR[l];
+    cpu->STUFR = b->STUFR[l];
+    cpu->SP = b->SP[l];
+    cpu->ZF = b->ZF[l] != 0;
+    cpu->NF = b->NF[l] != 0;
+    cpu->OF = b->OF[l] != 0;
+    cpu->status = (ec72_status_t)b->status[l];
+    cpu->retired = b->retired[l] + b->ticks[l];
+    ec72_mem_changed(cpu);
+}
+
+void ec72_simd_set_lane(ec72_simd_t *s, int lane, const ec72_cpu_t *cpu) {
+    Block_t *b = &s->blocks[lane / W];
+    int l = lane % W;
+    for (int a = 0; a < EC72_MEM_SIZE; a++) {
+        b->lo[a][l] = (uint8_t)(cpu->memory[a] & 0xFF);
+        b->hi[a][l] = (uint8_t)(cpu->memory[a] >> 8);
+    }
+    b->RA[l] = cpu->RA;
+    b->RB[l] = cpu->RB;
+    b->RC[l] = cpu->RC;
+    b->RE[l] = cpu->RE;
+    b->IRL[l] = (uint8_t)(cpu->IR & 0xFF);
+    b->IRH[l] = (uint8_t)(cpu->IR >> 8);
+    b->PC[l] = cpu->PC;
+    b->MARL[l] = (uint8_t)(cpu->MAR & 0xFF);
+    b->MARH[l] = (uint8_t)(cpu->MAR >> 8);
+    b->BANK[l] = cpu->BANK;
+    b->STOFR[l] = cpu->STOFR;
+    b->STUFR[l] = cpu->STUFR;
+    b->SP[l] = cpu->SP;
+    b->ZF[l] = cpu->ZF ? 0xFF : 0x00;
+    b->NF[l] = cpu->NF ? 0xFF : 0x00;
+    b->OF[l] = cpu->OF ? 0xFF : 0x00;
+    b->status[l] = (uint8_t)cpu->status;
+    b->retired[l] = cpu->retired;
+    b->ticks[l] = 0;
+    b->live[l] = cpu->status == EC72_OK ? 0xFF : 0x00;
+}
+
+ec72_status_t ec72_simd_lane_status(const ec72_simd_t *s, int lane) {
+    return (ec72_status_t)s->blocks[lane / W].status[lane % W];
+}
+
+#if defined(__GNUC__)
+
+// Built for AVX2 and for baseline SSE2, picked at load time
+#if defined(__x86_64__) && defined(__linux__) && !defined(__clang__)
+    #define SIMD_KERNEL __attribute__((target_clones("avx2", "default")))
+#else
+    #define SIMD_KERNEL
+#endif
+
+// All helpers taking vectors are always inlined, so the warning about the
+// AVX calling convention does not apply. The note gcc prints about it
+// ignores this pragma; the makefile builds this file with -Wno-psabi.
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+typedef uint8_t v32 __attribute__((vector_size(W), may_alias));
+typedef uint64_t v4q __attribute__((vector_size(W), may_alias));
+
+#define V(field) (*(v32 *)(field))
+
+static EC72_ALWAYS_INLINE v32 splat(uint8_t x) {
+    return (v32){0} + x;
+}
+
+static EC72_ALWAYS_INLINE bool any(v32 m) {
+    v4q q = (v4q)m;
+    return (q[0] | q[1] | q[2] | q[3]) != 0;
+}
+
+static EC72_ALWAYS_INLINE int first_lane(v32 m) {
+    v4q q = (v4q)m;
+    for (int i = 0; i < 4; i++) {
+        if (q[i]) return i * 8 + __builtin_ctzll(q[i]) / 8;
+    }
+    return -1;
+}
+
+// Per lane: m ? a : b
+static EC72_ALWAYS_INLINE v32 sel(v32 m, v32 a, v32 b) {
+    return (m & a) | (~m & b);
+}
+
+static uint8_t *lane_register(Block_t *b, uint8_t code) {
+    switch (code) {
+        case REG_A: return b->RA;
+        case REG_B: return b->RB;
+        case REG_C: return b->RC;
+        case REG_E: return b->RE;
+        case REG_SP: return b->SP;
+        default: return NULL;
+    }
+}
+
+// Faulting lanes stop and do not retire the instruction
+static void fault(Block_t *b, const uint8_t *mask, ec72_status_t status) {
+    for (int l = 0; l < W; l++) {
+        if (!mask[l]) continue;
+        b->status[l] = (uint8_t)status;
+        b->live[l] = 0;
+        b->ticks[l]--;
+    }
+}
+
+#define FAULT_LANES(F, status) do { v32 f_ = (F); fault(b, (const uint8_t *)&f_, (status)); } while (0)
+
+// memory[addr] & 0xFF per lane; one row when all lanes use the same address
+static EC72_ALWAYS_INLINE v32 load_lanes(const Block_t *b, v32 M, v32 addr) {
+    uint8_t a0 = addr[first_lane(M)];
+    if (!any(M & (v32)(addr != splat(a0)))) return V(b->lo[a0]);
+    v32 r = {0};
+    for (int l = 0; l < W; l++) {
+        if (M[l]) r[l] = b->lo[addr[l]][l];
+    }
+    return r;
+}
+
+// memory[addr] = value (a zero-extended byte) per lane
+static EC72_ALWAYS_INLINE void store_lanes(Block_t *b, v32 M, v32 addr, v32 value) {
+    uint8_t a0 = addr[first_lane(M)];
+    if (!any(M & (v32)(addr != splat(a0)))) {
+        V(b->lo[a0]) = sel(M, value, V(b->lo[a0]));
+        V(b->hi[a0]) &= ~M;
+        return;
+    }
+    for (int l = 0; l < W; l++) {
+        if (!M[l]) continue;
+        b->lo[addr[l]][l] = value[l];
+        b->hi[addr[l]][l] = 0;
+    }
+}
+
+// True if every lane of M has the same value in x
+static EC72_ALWAYS_INLINE bool uniform(v32 M, v32 x) {
+    return !any(M & (v32)(x != splat(x[first_lane(M)])));
+}
+
+// BCOPY (fill false) or BFILL in the lanes of M. When the lanes agree on
+// RB, RC and RE whole rows are copied through a buffer (ranges may overlap
+// and wrap), else each lane goes on its own.
+static EC72_ALWAYS_INLINE void block_lanes(Block_t *b, v32 M, bool fill) {
+    if (uniform(M, V(b->RB)) && uniform(M, V(b->RC)) && uniform(M, V(b->RE))) {
+        int l0 = first_lane(M);
+        uint8_t dst = b->RB[l0], src = b->RC[l0], count = b->RE[l0];
+        if (fill) {
+            for (int i = 0; i < count; i++) {
+                uint8_t a = (uint8_t)(dst + i);
+                V(b->lo[a]) = sel(M, V(b->RA), V(b->lo[a]));
+                V(b->hi[a]) &= ~M;
+            }
+            return;
+        }
+        v32 lo[EC72_MEM_SIZE], hi[EC72_MEM_SIZE];
+        for (int i = 0; i < count; i++) {
+            lo[i] = V(b->lo[(uint8_t)(src + i)]);
+            hi[i] = V(b->hi[(uint8_t)(src + i)]);
+        }
+        for (int i = 0; i < count; i++) {
+            uint8_t a = (uint8_t)(dst + i);
+            V(b->lo[a]) = sel(M, lo[i], V(b->lo[a]));
+            V(b->hi[a]) = sel(M, hi[i], V(b->hi[a]));
+        }
+        return;
+    }
+    for (int l = 0; l < W; l++) {
+        if (!M[l]) continue;
+        uint8_t dst = b->RB[l], src = b->RC[l], count = b->RE[l];
+        uint8_t lo[EC72_MEM_SIZE], hi[EC72_MEM_SIZE];
+        for (int i = 0; i < count; i++) {
+            lo[i] = fill ? b->RA[l] : b->lo[(uint8_t)(src + i)][l];
+            hi[i] = fill ? 0 : b->hi[(uint8_t)(src + i)][l];
+        }
+        for (int i = 0; i < count; i++) {
+            b->lo[(uint8_t)(dst + i)][l] = lo[i];
+            b->hi[(uint8_t)(dst + i)][l] = hi[i];
+        }
+    }
+}
+
+// BANK:MAR += step in the lanes of M (after FLD/FST)
+static EC72_ALWAYS_INLINE void far_advance(Block_t *b, v32 M, v32 step) {
+    v32 lo = V(b->MARL), r = lo + step;
+    v32 c = M & (v32)(r < lo);
+    v32 hi = V(b->MARH);
+    V(b->MARL) = sel(M, r, lo);
+    V(b->MARH) = hi - c;                // c is 0xFF (-1) in the lanes that carry
+    V(b->BANK) -= c & (v32)(hi == splat(0xFF));
+}
+
+// Same flag rules as alu_add()/alu_sub() on the untruncated result:
+// a + v is zero only without carry and never negative; a - v is negative
+// (and out of range) exactly when it borrows
+#define ALU_ADD(value) do {                                             \
+        v32 a_ = V(b->RA), v_ = (value), r_ = a_ + v_;                  \
+        v32 c_ = (v32)(r_ < a_);                                        \
+        V(b->RA) = sel(M, r_, a_);                                      \
+        V(b->ZF) = sel(M, (v32)(r_ == zero) & ~c_, V(b->ZF));           \
+        V(b->NF) &= ~M;                                                 \
+        V(b->OF) = sel(M, c_, V(b->OF));                                \
+    } while (0)
+
+#define ALU_SUB(value) do {                                             \
+        v32 a_ = V(b->RA), v_ = (value);                                \
+        v32 bw_ = (v32)(a_ < v_);                                       \
+        V(b->RA) = sel(M, a_ - v_, a_);                                 \
+        V(b->ZF) = sel(M, (v32)(a_ == v_), V(b->ZF));                   \
+        V(b->NF) = sel(M, bw_, V(b->NF));                               \
+        V(b->OF) = sel(M, bw_, V(b->OF));                               \
+    } while (0)
+
+SIMD_KERNEL
+static void run_block(ec72_simd_t *s, Block_t *b, int base, uint64_t max) {
+    const v32 zero = {0};
+    uint64_t target[W];
+    for (int l = 0; l < W; l++) {
+        target[l] = b->retired[l] > UINT64_MAX - max ? UINT64_MAX : b->retired[l] + max;
+    }
+
+    for (;;) {
+        // Settle the byte tick counters; a burst is short enough that no
+        // counter wraps and no lane overshoots its budget
+        uint64_t burst = 255;
+        v32 active = V(b->live);
+        for (int l = 0; l < W; l++) {
+            b->retired[l] += b->ticks[l];
+            b->ticks[l] = 0;
+            if (!b->live[l]) continue;
+            uint64_t left = target[l] - b->retired[l];
+            if (left == 0) active[l] = 0;
+            else if (left < burst) burst = left;
+        }
+        if (!any(active)) return;
+
+        for (; burst > 0 && any(active); burst--) {
+            // Group: active lanes at one PC. On divergence the lowest PC
+            // goes first so lanes meet again at loop heads.
+            int first = first_lane(active);
+            uint8_t pc = b->PC[first];
+            v32 M = active & (v32)(V(b->PC) == splat(pc));
+            if (any(M ^ active)) {
+                for (int l = 0; l < W; l++) {
+                    if (active[l] && b->PC[l] < pc) pc = b->PC[l];
+                }
+                M = active & (v32)(V(b->PC) == splat(pc));
+                first = first_lane(M);
+            }
+
+            // Lanes whose memory holds a different word here wait for a later group
+            uint8_t op = b->hi[pc][first], operand = b->lo[pc][first];
+            M &= (v32)(V(b->lo[pc]) == splat(operand)) & (v32)(V(b->hi[pc]) == splat(op));
+
+            V(b->IRL) = sel(M, splat(operand), V(b->IRL));
+            V(b->IRH) = sel(M, splat(op), V(b->IRH));
+            V(b->PC) = sel(M, splat((uint8_t)(pc + 1)), V(b->PC));
+            V(b->ticks) -= M;
+            const v32 imm = splat(operand);
+
+            switch (op) {
+                case OP_MOVR: {
+                    uint8_t *d = lane_register(b, (operand >> 4) & 0x0F);
+                    uint8_t *r = lane_register(b, operand & 0x0F);
+                    if (d && r) V(d) = sel(M, V(r), V(d));
+                    break;
+                }
+                case OP_MOVA: V(b->RA) = sel(M, V(b->lo[operand]), V(b->RA)); break;
+                case OP_MOVB: V(b->RB) = sel(M, V(b->lo[operand]), V(b->RB)); break;
+                case OP_MOVC: V(b->RC) = sel(M, V(b->lo[operand]), V(b->RC)); break;
+                case OP_MOVE: V(b->RE) = sel(M, V(b->lo[operand]), V(b->RE)); break;
+                case OP_STORA: store_lanes(b, M, imm, V(b->RA)); break;
+                case OP_STORB: store_lanes(b, M, imm, V(b->RB)); break;
+                case OP_STORC: store_lanes(b, M, imm, V(b->RC)); break;
+                case OP_STORE: store_lanes(b, M, imm, V(b->RE)); break;
+                case OP_LDIMA: V(b->RA) = sel(M, imm, V(b->RA)); break;
+                case OP_LDIMB: V(b->RB) = sel(M, imm, V(b->RB)); break;
+                case OP_LDIMC: V(b->RC) = sel(M, imm, V(b->RC)); break;
+                case OP_LDIME: V(b->RE) = sel(M, imm, V(b->RE)); break;
+                case OP_JMPN: V(b->PC) = sel(M & V(b->NF), imm, V(b->PC)); break;
+                case OP_JMPZ: V(b->PC) = sel(M & V(b->ZF), imm, V(b->PC)); break;
+                case OP_JMPO: V(b->PC) = sel(M & V(b->OF), imm, V(b->PC)); break;
+                case OP_JMP: V(b->PC) = sel(M, imm, V(b->PC)); break;
+                case OP_ADD: ALU_ADD(imm); break;
+                case OP_SUB: ALU_SUB(imm); break;
+                case OP_ADDR: {
+                    uint8_t *r = lane_register(b, operand);
+                    if (!r) { FAULT_LANES(M, EC72_ERR_ILLEGAL_OPERAND); break; }
+                    ALU_ADD(V(r));
+                    break;
+                }
+                case OP_SUBR: {
+                    uint8_t *r = lane_register(b, operand);
+                    if (!r) { FAULT_LANES(M, EC72_ERR_ILLEGAL_OPERAND); break; }
+                    ALU_SUB(V(r));
+                    break;
+                }
+                case OP_OUT:
+                    if (!s->out) break;
+                    for (int l = 0; l < W; l++) {
+                        if (M[l]) s->out(s->out_user, base + l, b->RA[l]);
+                    }
+                    break;
+                case OP_CALL: {
+                    v32 sp = V(b->SP);
+                    v32 F = M & ((v32)(sp == V(b->STOFR)) | (v32)(sp == zero));
+                    if (any(F)) { FAULT_LANES(F, EC72_ERR_STACK_OVERFLOW); M &= ~F; }
+                    if (!any(M)) break;
+                    sp = sel(M, sp - 1, sp);
+                    V(b->SP) = sp;
+                    store_lanes(b, M, sp, splat((uint8_t)(pc + 1)));
+                    V(b->PC) = sel(M, imm, V(b->PC));
+                    break;
+                }
+                case OP_RET: {
+                    v32 sp = V(b->SP);
+                    v32 F = M & (v32)(sp == splat(MEM_SIZE - 1));
+                    if (any(F)) { FAULT_LANES(F, EC72_ERR_STACK_UNDERFLOW); M &= ~F; }
+                    if (!any(M)) break;
+                    V(b->PC) = sel(M, load_lanes(b, M, sp), V(b->PC));
+                    V(b->SP) = sel(M, sp + 1, sp);
+                    break;
+                }
+                case OP_MOVA_PTRB: V(b->RA) = sel(M, load_lanes(b, M, V(b->RB)), V(b->RA)); break;
+                case OP_STORA_PTRB: store_lanes(b, M, V(b->RB), V(b->RA)); break;
+                case OP_PUSH: {
+                    uint8_t *r = lane_register(b, operand);
+                    if (!r) { FAULT_LANES(M, EC72_ERR_ILLEGAL_OPERAND); break; }
+                    v32 sp = V(b->SP);
+                    v32 F = M & ((v32)(sp == V(b->STOFR)) | (v32)(sp == zero));
+                    if (any(F)) { FAULT_LANES(F, EC72_ERR_STACK_OVERFLOW); M &= ~F; }
+                    if (!any(M)) break;
+                    v32 value = V(r);           // PUSH SP pushes the old SP
+                    sp = sel(M, sp - 1, sp);
+                    V(b->SP) = sp;
+                    store_lanes(b, M, sp, value);
+                    break;
+                }
+                case OP_POP: {
+                    uint8_t *r = lane_register(b, operand);
+                    if (!r) { FAULT_LANES(M, EC72_ERR_ILLEGAL_OPERAND); break; }
+                    v32 sp = V(b->SP);
+                    v32 F = M & ((v32)(sp == V(b->STUFR)) | (v32)(sp == splat(MEM_SIZE - 1)));
+                    if (any(F)) { FAULT_LANES(F, EC72_ERR_STACK_UNDERFLOW); M &= ~F; }
+                    if (!any(M)) break;
+                    v32 value = load_lanes(b, M, sp);
+                    V(b->SP) = sel(M, sp + 1, sp);
+                    V(r) = sel(M, value, V(r));     // after SP: POP SP loads SP
+                    break;
+                }
+                case OP_ADDSP: {
+                    v32 sp = V(b->SP);
+                    v32 F = M & ((v32)(sp == V(b->STUFR)) | (v32)(sp == splat(MEM_SIZE - 1)));
+                    if (any(F)) { FAULT_LANES(F, EC72_ERR_STACK_UNDERFLOW); M &= ~F; }
+                    V(b->SP) = sel(M, sp + imm, sp);
+                    break;
+                }
+                case OP_SUBSP: {
+                    v32 sp = V(b->SP);
+                    v32 F = M & ((v32)(sp == V(b->STOFR)) | (v32)(sp == zero));
+                    if (any(F)) { FAULT_LANES(F, EC72_ERR_STACK_OVERFLOW); M &= ~F; }
+                    V(b->SP) = sel(M, sp - imm, sp);
+                    break;
+                }
+                case OP_SSTOF: V(b->STOFR) = sel(M, imm, V(b->STOFR)); break;
+                case OP_SSTUF:
+                    V(b->STUFR) = sel(M, imm, V(b->STUFR));
+                    V(b->SP) = sel(M, imm, V(b->SP));
+                    break;
+                // Every lane is a machine of its own: core 0 of 1
+                case OP_XCHG: {
+                    v32 v = V(b->lo[operand]);
+                    store_lanes(b, M, imm, V(b->RA));
+                    V(b->RA) = sel(M, v, V(b->RA));
+                    break;
+                }
+                case OP_CAS: {
+                    v32 v = V(b->lo[operand]);
+                    v32 S = M & (v32)(v == V(b->RA));
+                    if (any(S)) store_lanes(b, S, imm, V(b->RB));
+                    V(b->RA) = sel(M & ~S, v, V(b->RA));
+                    V(b->ZF) = sel(M, S, V(b->ZF));
+                    V(b->NF) &= ~M;
+                    V(b->OF) &= ~M;
+                    break;
+                }
+                case OP_LDID:
+                    V(b->RA) &= ~M;
+                    V(b->RB) = sel(M, splat(1), V(b->RB));
+                    break;
+                // Lanes have no extended memory: FLD reads 0, FST is dropped
+                case OP_SBANK: V(b->BANK) = sel(M, imm, V(b->BANK)); break;
+                case OP_SMAR:
+                    V(b->MARH) = sel(M, V(b->RB), V(b->MARH));
+                    V(b->MARL) = sel(M, V(b->RC), V(b->MARL));
+                    break;
+                case OP_FLD:
+                    V(b->RA) &= ~M;
+                    far_advance(b, M, imm);
+                    break;
+                case OP_FST: far_advance(b, M, imm); break;
+                // Stack bound checks lane by lane, as ec72_block_stack_check()
+                case OP_BCOPY: case OP_BFILL: {
+                    v32 U = zero, F = zero;
+                    for (int l = 0; l < W; l++) {
+                        if (!M[l]) continue;
+                        ec72_status_t bad = ec72_block_stack_check(b->RB[l], b->RE[l], b->SP[l], b->STOFR[l], b->STUFR[l]);
+                        if (bad == EC72_ERR_STACK_UNDERFLOW) U[l] = 0xFF;
+                        else if (bad == EC72_ERR_STACK_OVERFLOW) F[l] = 0xFF;
+                    }
+                    if (any(U)) { FAULT_LANES(U, EC72_ERR_STACK_UNDERFLOW); M &= ~U; }
+                    if (any(F)) { FAULT_LANES(F, EC72_ERR_STACK_OVERFLOW); M &= ~F; }
+                    if (any(M)) block_lanes(b, M, op == OP_BFILL);
+                    break;
+                }
+                // Same results as alu_bcmp()/alu_mul(), lane by lane
+                case OP_BCMP:
+                    for (int l = 0; l < W; l++) {
+                        if (!M[l]) continue;
+                        uint8_t at = b->RE[l];
+                        int r = 0;
+                        for (int i = 0; i < b->RE[l]; i++) {
+                            uint8_t x = b->lo[(uint8_t)(b->RB[l] + i)][l], y = b->lo[(uint8_t)(b->RC[l] + i)][l];
+                            if (x != y) { at = (uint8_t)i; r = x - y; break; }
+                        }
+                        b->RA[l] = at;
+                        b->ZF[l] = r == 0 ? 0xFF : 0x00;
+                        b->NF[l] = b->OF[l] = r < 0 ? 0xFF : 0x00;
+                    }
+                    break;
+                case OP_MUL: {
+                    uint8_t *r = lane_register(b, operand);
+                    if (!r) { FAULT_LANES(M, EC72_ERR_ILLEGAL_OPERAND); break; }
+                    for (int l = 0; l < W; l++) {
+                        if (!M[l]) continue;
+                        int p = b->RA[l] * r[l];
+                        b->RA[l] = (uint8_t)p;
+                        b->RE[l] = (uint8_t)(p >> 8);
+                        b->ZF[l] = p == 0 ? 0xFF : 0x00;
+                        b->NF[l] = 0x00;
+                        b->OF[l] = p > 255 ? 0xFF : 0x00;
+                    }
+                    break;
+                }
+                case OP_HLT:
+                    for (int l = 0; l < W; l++) {
+                        if (M[l]) b->status[l] = EC72_HALTED;
+                    }
+                    V(b->live) &= ~M;
+                    break;
+                default:
+                    FAULT_LANES(M, EC72_ERR_UNKNOWN_OPCODE);
+                    break;
+            }
+            active &= V(b->live);
+        }
+    }
+}
+
+#else
+
+// Without vector extensions every lane runs on the switch interpreter
+typedef struct {
+    ec72_simd_t *s;
+    int lane;
+} LaneOut_t;
+
+static void lane_out(void *user, uint8_t value) {
+    LaneOut_t *o = user;
+    o->s->out(o->s->out_user, o->lane, value);
+}
+
+static void run_block(ec72_simd_t *s, Block_t *b, int base, uint64_t max) {
+    (void)b;
+    ec72_cpu_t *cpu = malloc(sizeof(ec72_cpu_t));
+    if (!cpu) return;
+    for (int l = 0; l < W && base + l < s->lanes; l++) {
+        if (ec72_simd_lane_status(s, base + l) != EC72_OK) continue;
+        ec72_cpu_init(cpu);
+        ec72_simd_get_lane(s, base + l, cpu);
+        LaneOut_t o = { s, base + l };
+        if (s->out) ec72_cpu_set_output(cpu, lane_out, &o);
+        ec72_switch_run(cpu, max);
+        ec72_simd_set_lane(s, base + l, cpu);
+    }
+    free(cpu);
+}
+
+#endif
+
+int ec72_simd_run(ec72_simd_t *s, uint64_t max_instructions) {
+    int running = 0;
+    for (int k = 0; k < s->block_count; k++) {
+        Block_t *b = &s->blocks[k];
+        run_block(s, b, k * W, max_instructions);
+        for (int l = 0; l < W && k * W + l < s->lanes; l++) {
+            if (b->status[l] == EC72_OK) running++;
+        }
+    }
+    return running;
+}
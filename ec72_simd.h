@@ -0,0 +1,50 @@
+//Copyright © Martin H. Sharp; August 2025
+// Lockstep engine for parameter sweeps: N instances of one program kept in
+// structure-of-arrays form (one byte per lane for every register, two byte
+// planes per memory word) and executed 32 lanes at a time with vector
+// instructions (AVX2 where the CPU has it, SSE2 otherwise). Lanes that
+// disagree on PC or on the fetched instruction word are masked out and run
+// as their own group; every lane produces exactly the state the switch
+// interpreter would. Lanes have no extended memory (ec72_xmem.h).
+#ifndef EC72_SIMD_H
+#define EC72_SIMD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "ec72_cpu.h"
+
+#define EC72_SIMD_WIDTH 32      // lanes per vector block
+
+typedef struct ec72_simd ec72_simd_t;
+
+// Called for every OUT of a lane; lanes are reported in ascending order
+// within one lockstep instruction
+typedef void (*ec72_simd_out_fn)(void *user, int lane, uint8_t value);
+
+ec72_simd_t *ec72_simd_create(int lanes);
+void ec72_simd_destroy(ec72_simd_t *s);
+int ec72_simd_lanes(const ec72_simd_t *s);
+
+// Same image in every lane, then reset
+void ec72_simd_load_words(ec72_simd_t *s, const uint16_t *words, size_t count);
+// Every lane back to power-on state with memory restored from the image
+void ec72_simd_reset(ec72_simd_t *s);
+
+void ec72_simd_set_output(ec72_simd_t *s, ec72_simd_out_fn out, void *user);
+
+// Per-lane memory, e.g. the swept parameter
+void ec72_simd_poke(ec72_simd_t *s, int lane, uint8_t address, uint16_t value);
+uint16_t ec72_simd_peek(const ec72_simd_t *s, int lane, uint8_t address);
+
+// Copy a lane out of / into a scalar context (registers, flags, memory,
+// status, retired). Import only touches the architectural state.
+void ec72_simd_get_lane(const ec72_simd_t *s, int lane, ec72_cpu_t *cpu);
+void ec72_simd_set_lane(ec72_simd_t *s, int lane, const ec72_cpu_t *cpu);
+ec72_status_t ec72_simd_lane_status(const ec72_simd_t *s, int lane);
+
+// Every lane executes at most max_instructions more instructions.
+// Returns the number of lanes that can still continue (status EC72_OK).
+int ec72_simd_run(ec72_simd_t *s, uint64_t max_instructions);
+
+#endif
@@ -0,0 +1,333 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "ec72_smp.h"
+#include "ec72_engine.h"
+
+typedef struct {
+    uint8_t *out;               // OUT values of the quantum, at most one per instruction
+    size_t out_len;
+    uint64_t left;              // budget of the current ec72_smp_run()
+    ec72_status_t last;         // how the core's last quantum ended
+    bool ran;                   // the core ran in this quantum
+} Core_t;
+
+typedef struct {
+    ec72_smp_t *m;
+    int index;
+} Worker_t;
+
+struct ec72_smp {
+    int count, threads;
+    ec72_cpu_t *cores;
+    Core_t *state;
+    uint16_t memory[EC72_MEM_SIZE];     // shared memory
+    uint16_t start[EC72_MEM_SIZE];      // shared memory when the quantum started
+    uint8_t image_stofr, image_stufr;   // stack bounds of the loaded image
+    uint8_t stack_words;                // ec72_smp_split_stack(), 0: every core gets the image's
+    uint32_t quantum;
+    ec72_smp_out_fn out;
+    void *out_user;
+    uint64_t quanta, atomics;
+
+    // Host threads 1..threads-1; the caller of ec72_smp_run() is thread 0
+    pthread_t *workers;
+    Worker_t *worker_args;
+    int started;
+    pthread_mutex_t startup;            // held until the barriers know how many threads there are
+    pthread_barrier_t go, done;
+    bool quit;
+};
+
+static void core_out(void *user, uint8_t value) {
+    Core_t *c = user;
+    c->out[c->out_len++] = value;
+}
+
+// The shared memory into the core's copy, if they differ
+static void pull(const ec72_smp_t *m, ec72_cpu_t *cpu) {
+    if (memcmp(cpu->memory, m->memory, sizeof(m->memory)) == 0) return;
+    memcpy(cpu->memory, m->memory, sizeof(m->memory));
+    ec72_mem_changed(cpu);
+}
+
+static void run_core(ec72_smp_t *m, int i) {
+    ec72_cpu_t *cpu = &m->cores[i];
+    Core_t *c = &m->state[i];
+    c->ran = cpu->status == EC72_OK && c->left > 0;
+    if (!c->ran) return;
+    pull(m, cpu);
+    uint64_t before = cpu->retired;
+    c->last = ec72_cpu_run(cpu, c->left < m->quantum ? c->left : m->quantum);
+    c->left -= cpu->retired - before;
+}
+
+// Cores are dealt out round robin; which thread runs a core does not matter
+static void run_share(ec72_smp_t *m, int thread) {
+    for (int i = thread; i < m->count; i += m->threads) run_core(m, i);
+}
+
+static void *worker(void *arg) {
+    Worker_t *w = arg;
+    ec72_smp_t *m = w->m;
+    pthread_mutex_lock(&m->startup);
+    pthread_mutex_unlock(&m->startup);
+    for (;;) {
+        pthread_barrier_wait(&m->go);
+        if (m->quit) break;
+        run_share(m, w->index);
+        pthread_barrier_wait(&m->done);
+    }
+    return NULL;
+}
+
+static void stop_workers(ec72_smp_t *m) {
+    if (!m->workers) return;
+    m->quit = true;
+    pthread_barrier_wait(&m->go);
+    for (int t = 0; t < m->started; t++) pthread_join(m->workers[t], NULL);
+    pthread_barrier_destroy(&m->go);
+    pthread_barrier_destroy(&m->done);
+    pthread_mutex_destroy(&m->startup);
+    free(m->workers);
+    free(m->worker_args);
+    m->workers = NULL;
+}
+
+ec72_smp_t *ec72_smp_create(int cores, int threads) {
+    if (cores <= 0 || cores > EC72_SMP_MAX_CORES) return NULL;
+    if (threads <= 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (int)online : 1;
+    }
+    if (threads > cores) threads = cores;
+
+    ec72_smp_t *m = calloc(1, sizeof(ec72_smp_t));
+    if (!m) return NULL;
+    m->count = cores;
+    m->threads = threads;
+    m->cores = malloc((size_t)cores * sizeof(ec72_cpu_t));
+    m->state = calloc((size_t)cores, sizeof(Core_t));
+    if (!m->cores || !m->state || !ec72_smp_set_quantum(m, EC72_SMP_DEFAULT_QUANTUM)) {
+        free(m->cores);
+        m->cores = NULL;
+        ec72_smp_destroy(m);
+        return NULL;
+    }
+    for (int i = 0; i < cores; i++) {
+        ec72_cpu_t *cpu = &m->cores[i];
+        ec72_cpu_init(cpu);
+        cpu->core_id = (uint8_t)i;
+        cpu->cores = (uint8_t)cores;
+        cpu->atomic_stop = true;
+        ec72_cpu_set_output(cpu, core_out, &m->state[i]);
+    }
+    m->image_stufr = MEM_SIZE - 1;
+    ec72_smp_reset(m);
+
+    if (threads > 1) {
+        m->workers = malloc((size_t)(threads - 1) * sizeof(pthread_t));
+        m->worker_args = malloc((size_t)(threads - 1) * sizeof(Worker_t));
+        if (!m->workers || !m->worker_args) {
+            free(m->workers);
+            free(m->worker_args);
+            m->workers = NULL;
+            ec72_smp_destroy(m);
+            return NULL;
+        }
+        // Threads that cannot be started leave their cores to the others
+        pthread_mutex_init(&m->startup, NULL);
+        pthread_mutex_lock(&m->startup);
+        for (int t = 1; t < threads; t++) {
+            m->worker_args[t - 1] = (Worker_t){ m, t };
+            if (pthread_create(&m->workers[t - 1], NULL, worker, &m->worker_args[t - 1]) != 0) break;
+            m->started = t;
+        }
+        m->threads = m->started + 1;
+        pthread_barrier_init(&m->go, NULL, (unsigned)m->threads);
+        pthread_barrier_init(&m->done, NULL, (unsigned)m->threads);
+        pthread_mutex_unlock(&m->startup);
+    }
+    return m;
+}
+
+void ec72_smp_destroy(ec72_smp_t *m) {
+    if (!m) return;
+    stop_workers(m);
+    if (m->cores) {
+        for (int i = 0; i < m->count; i++) ec72_cpu_fini(&m->cores[i]);
+    }
+    if (m->state) {
+        for (int i = 0; i < m->count; i++) free(m->state[i].out);
+    }
+    free(m->cores);
+    free(m->state);
+    free(m);
+}
+
+int ec72_smp_cores(const ec72_smp_t *m) {
+    return m->count;
+}
+
+int ec72_smp_threads(const ec72_smp_t *m) {
+    return m->threads;
+}
+
+bool ec72_smp_set_quantum(ec72_smp_t *m, uint32_t quantum) {
+    if (quantum == 0) quantum = 1;
+    for (int i = 0; i < m->count; i++) {
+        uint8_t *out = realloc(m->state[i].out, quantum);
+        if (!out) return false;
+        m->state[i].out = out;
+    }
+    m->quantum = quantum;
+    return true;
+}
+
+void ec72_smp_set_engine(ec72_smp_t *m, ec72_engine_t engine) {
+    for (int i = 0; i < m->count; i++) ec72_cpu_set_engine(&m->cores[i], engine);
+}
+
+void ec72_smp_set_output(ec72_smp_t *m, ec72_smp_out_fn out, void *user) {
+    m->out = out;
+    m->out_user = user;
+}
+
+static void set_starts(ec72_smp_t *m) {
+    for (int i = 0; i < m->count; i++) {
+        ec72_cpu_t *cpu = &m->cores[i];
+        uint8_t stofr = m->image_stofr, stufr = m->image_stufr;
+        if (m->stack_words) {
+            stufr = (uint8_t)(stufr - i * m->stack_words);
+            stofr = (uint8_t)(stufr - m->stack_words);
+        }
+        cpu->image_stofr = stofr;
+        cpu->image_stufr = stufr;
+    }
+}
+
+void ec72_smp_load(ec72_smp_t *m, const ec72_cpu_t *cpu) {
+    for (int i = 0; i < m->count; i++) {
+        ec72_cpu_t *core = &m->cores[i];
+        ec72_cpu_load_words(core, cpu->image, cpu->image_words);
+        core->image_entry = cpu->image_entry;
+    }
+    m->image_stofr = cpu->image_stofr;
+    m->image_stufr = cpu->image_stufr;
+    set_starts(m);
+    ec72_smp_reset(m);
+}
+
+bool ec72_smp_split_stack(ec72_smp_t *m, uint8_t words) {
+    if (!words || (size_t)words * m->count > m->image_stufr) return false;
+    m->stack_words = words;
+    set_starts(m);
+    ec72_smp_reset(m);
+    return true;
+}
+
+void ec72_smp_reset(ec72_smp_t *m) {
+    for (int i = 0; i < m->count; i++) {
+        ec72_cpu_reset(&m->cores[i]);
+        m->state[i].out_len = 0;
+        m->state[i].left = 0;
+        m->state[i].last = EC72_OK;
+    }
+    memcpy(m->memory, m->cores[0].memory, sizeof(m->memory));
+    m->quanta = m->atomics = 0;
+}
+
+static bool running(const ec72_smp_t *m) {
+    for (int i = 0; i < m->count; i++) {
+        if (m->cores[i].status == EC72_OK && m->state[i].left > 0) return true;
+    }
+    return false;
+}
+
+// Words the core changed since the quantum started; later cores win
+static void write_back(ec72_smp_t *m, const ec72_cpu_t *cpu) {
+    for (int a = 0; a < EC72_MEM_SIZE; a++) {
+        m->memory[a] = cpu->memory[a] != m->start[a] ? cpu->memory[a] : m->memory[a];
+    }
+}
+
+int ec72_smp_run(ec72_smp_t *m, uint64_t max_instructions) {
+    for (int i = 0; i < m->count; i++) m->state[i].left = max_instructions;
+
+    while (running(m)) {
+        memcpy(m->start, m->memory, sizeof(m->memory));
+        if (m->threads > 1) {
+            pthread_barrier_wait(&m->go);
+            run_share(m, 0);
+            pthread_barrier_wait(&m->done);
+        } else {
+            run_share(m, 0);
+        }
+
+        for (int i = 0; i < m->count; i++) {
+            if (m->state[i].ran) write_back(m, &m->cores[i]);
+        }
+
+        // The atomics the cores stopped at, one at a time on the shared memory
+        for (int i = 0; i < m->count; i++) {
+            ec72_cpu_t *cpu = &m->cores[i];
+            Core_t *c = &m->state[i];
+            if (!c->ran || c->last != EC72_SYNC) continue;
+            pull(m, cpu);
+            uint64_t before = cpu->retired;
+            cpu->atomic_stop = false;
+            c->last = ec72_cpu_step(cpu);
+            cpu->atomic_stop = true;
+            c->left -= cpu->retired - before;
+            memcpy(m->memory, cpu->memory, sizeof(m->memory));
+            m->atomics++;
+        }
+
+        if (m->out) {
+            for (int i = 0; i < m->count; i++) {
+                Core_t *c = &m->state[i];
+                for (size_t k = 0; k < c->out_len; k++) m->out(m->out_user, i, c->out[k]);
+            }
+        }
+        for (int i = 0; i < m->count; i++) m->state[i].out_len = 0;
+        m->quanta++;
+    }
+
+    int live = 0;
+    for (int i = 0; i < m->count; i++) {
+        pull(m, &m->cores[i]);
+        if (m->cores[i].status == EC72_OK) live++;
+    }
+    return live;
+}
+
+ec72_cpu_t *ec72_smp_core(ec72_smp_t *m, int core) {
+    return &m->cores[core];
+}
+
+const uint16_t *ec72_smp_memory(const ec72_smp_t *m) {
+    return m->memory;
+}
+
+ec72_status_t ec72_smp_status(const ec72_smp_t *m) {
+    bool halted = true;
+    for (int i = 0; i < m->count; i++) {
+        ec72_status_t s = m->cores[i].status;
+        if (s != EC72_OK && s != EC72_HALTED) return s;
+        if (s != EC72_HALTED) halted = false;
+    }
+    return halted ? EC72_HALTED : EC72_OK;
+}
+
+uint64_t ec72_smp_quanta(const ec72_smp_t *m) {
+    return m->quanta;
+}
+
+uint64_t ec72_smp_atomics(const ec72_smp_t *m) {
+    return m->atomics;
+}
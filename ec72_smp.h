@@ -0,0 +1,73 @@
+//Copyright © Martin H. Sharp; August 2025
+// Multi-core EC72: N cores share one memory image. Each core is an
+// ec72_cpu_t of its own (registers, flags, PC, stack window set with
+// SSTOF/SSTUF, engine) with its number in the core-ID register (LDID).
+//
+// Cores run in quanta. In a quantum every core executes up to quantum
+// instructions on a private copy of the shared memory, the cores spread over
+// host threads. At the end the words each core changed are written back in
+// core order (a word changed by several cores keeps the highest core's
+// value), so stores become visible to the other cores at the next quantum.
+// XCHG and CAS end a core's quantum in front of them; after the write-back
+// they run one at a time in core order directly on the shared memory, which
+// makes them atomic across cores. What a core prints is buffered and passed
+// on in core order after each quantum.
+//
+// Nothing depends on the host's timing: the same program, core count and
+// quantum give the same memory, registers and output with any number of
+// threads.
+//
+// Cores have no I/O bus, extended memory, journal, debugger, trace or
+// profiler.
+#ifndef EC72_SMP_H
+#define EC72_SMP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "ec72_cpu.h"
+
+#define EC72_SMP_MAX_CORES 64
+#define EC72_SMP_DEFAULT_QUANTUM 1000u
+
+typedef struct ec72_smp ec72_smp_t;
+
+// Called for every OUT of a core, cores in ascending order within a quantum
+typedef void (*ec72_smp_out_fn)(void *user, int core, uint8_t value);
+
+// threads: host threads, 0 for one per online CPU; never more than cores
+ec72_smp_t *ec72_smp_create(int cores, int threads);
+void ec72_smp_destroy(ec72_smp_t *m);
+int ec72_smp_cores(const ec72_smp_t *m);
+int ec72_smp_threads(const ec72_smp_t *m);
+
+// Instructions per core and quantum (at least 1); false (unchanged) if the
+// output buffers cannot grow to it
+bool ec72_smp_set_quantum(ec72_smp_t *m, uint32_t quantum);
+void ec72_smp_set_engine(ec72_smp_t *m, ec72_engine_t engine);
+void ec72_smp_set_output(ec72_smp_t *m, ec72_smp_out_fn out, void *user);
+
+// Image, entry point and stack bounds of cpu (as loaded with
+// ec72_cpu_load_*) for every core, then reset
+void ec72_smp_load(ec72_smp_t *m, const ec72_cpu_t *cpu);
+// Stack windows of words cells each, stacked downwards from the image's
+// STUFR: core i starts with STUFR = stufr - i * words, STOFR = STUFR - words.
+// Applies from the next reset on. False if they do not fit below STUFR.
+bool ec72_smp_split_stack(ec72_smp_t *m, uint8_t words);
+// Every core back to its start state, shared memory back to the image
+void ec72_smp_reset(ec72_smp_t *m);
+
+// Every core executes at most max_instructions more instructions.
+// Returns the number of cores that can still continue.
+int ec72_smp_run(ec72_smp_t *m, uint64_t max_instructions);
+
+// A core's context; its memory is the shared memory as of the last quantum
+ec72_cpu_t *ec72_smp_core(ec72_smp_t *m, int core);
+const uint16_t *ec72_smp_memory(const ec72_smp_t *m);
+// Fault of the lowest core that faulted, else EC72_HALTED once every core
+// halted, else EC72_OK
+ec72_status_t ec72_smp_status(const ec72_smp_t *m);
+uint64_t ec72_smp_quanta(const ec72_smp_t *m);
+uint64_t ec72_smp_atomics(const ec72_smp_t *m);
+
+#endif
@@ -0,0 +1,320 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_snap.h"
+#include "ec72_engine.h"
+
+// Nodes and pages allocated per pool refill
+#define POOL_CHUNK 256
+
+void ec72_regs_save(const ec72_cpu_t *cpu, ec72_regs_t *regs) {
+    regs->RA = cpu->RA;
+    regs->RB = cpu->RB;
+    regs->RC = cpu->RC;
+    regs->RE = cpu->RE;
+    regs->IR = cpu->IR;
+    regs->PC = cpu->PC;
+    regs->MAR = cpu->MAR;
+    regs->BANK = cpu->BANK;
+    regs->STOFR = cpu->STOFR;
+    regs->STUFR = cpu->STUFR;
+    regs->SP = cpu->SP;
+    regs->ZF = cpu->ZF;
+    regs->NF = cpu->NF;
+    regs->OF = cpu->OF;
+    regs->status = cpu->status;
+    regs->retired = cpu->retired;
+    regs->cycles = cpu->cycles;
+}
+
+void ec72_regs_load(ec72_cpu_t *cpu, const ec72_regs_t *regs) {
+    cpu->RA = regs->RA;
+    cpu->RB = regs->RB;
+    cpu->RC = regs->RC;
+    cpu->RE = regs->RE;
+    cpu->IR = regs->IR;
+    cpu->PC = regs->PC;
+    cpu->MAR = regs->MAR;
+    cpu->BANK = regs->BANK;
+    cpu->STOFR = regs->STOFR;
+    cpu->STUFR = regs->STUFR;
+    cpu->SP = regs->SP;
+    cpu->ZF = regs->ZF;
+    cpu->NF = regs->NF;
+    cpu->OF = regs->OF;
+    cpu->status = regs->status;
+    cpu->retired = regs->retired;
+    cpu->cycles = regs->cycles;
+    cpu->verified = false;      // the proof was for the state it started from
+}
+
+void ec72_snapshot_take(const ec72_cpu_t *cpu, ec72_snapshot_t *snap) {
+    ec72_regs_save(cpu, &snap->regs);
+    memcpy(snap->memory, cpu->memory, sizeof(snap->memory));
+}
+
+void ec72_snapshot_restore(ec72_cpu_t *cpu, const ec72_snapshot_t *snap) {
+    ec72_regs_load(cpu, &snap->regs);
+    // Untouched memory leaves the engines' caches alone
+    if (memcmp(cpu->memory, snap->memory, sizeof(cpu->memory)) != 0) {
+        memcpy(cpu->memory, snap->memory, sizeof(cpu->memory));
+        ec72_mem_changed(cpu);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Copy-on-write tree
+
+void ec72_snaptree_init(ec72_snaptree_t *t) {
+    memset(t, 0, sizeof(*t));
+}
+
+void ec72_snaptree_free(ec72_snaptree_t *t) {
+    for (size_t i = 0; i < t->block_count; i++) free(t->blocks[i]);
+    free(t->blocks);
+    memset(t, 0, sizeof(*t));
+}
+
+static void *pool_block(ec72_snaptree_t *t, size_t size) {
+    if (t->block_count == t->block_cap) {
+        size_t cap = t->block_cap ? 2 * t->block_cap : 16;
+        void **grown = realloc(t->blocks, cap * sizeof(void *));
+        if (!grown) return NULL;
+        t->blocks = grown;
+        t->block_cap = cap;
+    }
+    void *block = malloc(size * POOL_CHUNK);
+    if (block) t->blocks[t->block_count++] = block;
+    return block;
+}
+
+static ec72_snap_page_t *page_alloc(ec72_snaptree_t *t) {
+    if (!t->free_pages) {
+        ec72_snap_page_t *block = pool_block(t, sizeof(ec72_snap_page_t));
+        if (!block) return NULL;
+        for (int i = 0; i < POOL_CHUNK; i++) {
+            block[i].next_free = t->free_pages;
+            t->free_pages = &block[i];
+        }
+    }
+    ec72_snap_page_t *page = t->free_pages;
+    t->free_pages = page->next_free;
+    page->refs = 1;
+    t->live_pages++;
+    return page;
+}
+
+static void page_release(ec72_snaptree_t *t, ec72_snap_page_t *page) {
+    if (--page->refs) return;
+    page->next_free = t->free_pages;
+    t->free_pages = page;
+    t->live_pages--;
+}
+
+static ec72_snap_node_t *node_alloc(ec72_snaptree_t *t) {
+    if (!t->free_nodes) {
+        ec72_snap_node_t *block = pool_block(t, sizeof(ec72_snap_node_t));
+        if (!block) return NULL;
+        for (int i = 0; i < POOL_CHUNK; i++) {
+            block[i].next_free = t->free_nodes;
+            t->free_nodes = &block[i];
+        }
+    }
+    ec72_snap_node_t *node = t->free_nodes;
+    t->free_nodes = node->next_free;
+    t->live_nodes++;
+    return node;
+}
+
+ec72_snap_node_t *ec72_snap_fork(ec72_snaptree_t *t, ec72_snap_node_t *parent, const ec72_cpu_t *cpu) {
+    ec72_snap_node_t *node = node_alloc(t);
+    if (!node) return NULL;
+    node->parent = parent;
+    node->refs = 1;
+    node->depth = parent ? parent->depth + 1 : 0;
+    ec72_regs_save(cpu, &node->regs);
+
+    for (int p = 0; p < EC72_SNAP_PAGES; p++) {
+        const uint16_t *words = &cpu->memory[p * EC72_SNAP_PAGE_WORDS];
+        ec72_snap_page_t *shared = parent ? parent->pages[p] : NULL;
+        if (shared && memcmp(shared->words, words, sizeof(shared->words)) == 0) {
+            shared->refs++;
+            node->pages[p] = shared;
+            continue;
+        }
+        ec72_snap_page_t *page = page_alloc(t);
+        if (!page) {
+            while (p-- > 0) page_release(t, node->pages[p]);
+            node->next_free = t->free_nodes;
+            t->free_nodes = node;
+            t->live_nodes--;
+            return NULL;
+        }
+        memcpy(page->words, words, sizeof(page->words));
+        node->pages[p] = page;
+    }
+    if (parent) parent->refs++;
+    return node;
+}
+
+void ec72_snap_retain(ec72_snap_node_t *node) {
+    node->refs++;
+}
+
+void ec72_snap_release(ec72_snaptree_t *t, ec72_snap_node_t *node) {
+    // Iterative, so releasing the leaf of a deep chain needs no deep recursion
+    while (node && --node->refs == 0) {
+        ec72_snap_node_t *parent = node->parent;
+        for (int p = 0; p < EC72_SNAP_PAGES; p++) page_release(t, node->pages[p]);
+        node->next_free = t->free_nodes;
+        t->free_nodes = node;
+        t->live_nodes--;
+        node = parent;
+    }
+}
+
+void ec72_snap_restore(ec72_cpu_t *cpu, const ec72_snap_node_t *node) {
+    ec72_regs_load(cpu, &node->regs);
+    bool changed = false;
+    for (int p = 0; p < EC72_SNAP_PAGES; p++) {
+        uint16_t *words = &cpu->memory[p * EC72_SNAP_PAGE_WORDS];
+        if (memcmp(words, node->pages[p]->words, sizeof(node->pages[p]->words)) != 0) {
+            memcpy(words, node->pages[p]->words, sizeof(node->pages[p]->words));
+            changed = true;
+        }
+    }
+    if (changed) ec72_mem_changed(cpu);
+}
+
+// ---------------------------------------------------------------------------
+// Checkpoint files
+//
+//   0  magic "EC72CKP\0"      12 PC SP STOFR STUFR RA RB RC RE
+//   8  version (u16)          20 flags (ZF | NF << 1 | OF << 2), status
+//  10  BANK, reserved         22 IR, MAR, image_words (u16 each)
+//                             28 retired (u64)
+//  36  image: bitmap[32] + non-zero words, then memory the same way
+
+#define CKPT_HEADER 36
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint8_t *put_words(uint8_t *p, const uint16_t *words) {
+    uint8_t *bitmap = p;
+    memset(bitmap, 0, EC72_MEM_SIZE / 8);
+    p += EC72_MEM_SIZE / 8;
+    for (int a = 0; a < EC72_MEM_SIZE; a++) {
+        if (!words[a]) continue;
+        bitmap[a >> 3] |= (uint8_t)(1u << (a & 7));
+        put16(p, words[a]);
+        p += 2;
+    }
+    return p;
+}
+
+static const uint8_t *get_words(const uint8_t *p, const uint8_t *end, uint16_t *words) {
+    if (end - p < EC72_MEM_SIZE / 8) return NULL;
+    const uint8_t *bitmap = p;
+    p += EC72_MEM_SIZE / 8;
+    for (int a = 0; a < EC72_MEM_SIZE; a++) {
+        words[a] = 0;
+        if (!(bitmap[a >> 3] & (1u << (a & 7)))) continue;
+        if (end - p < 2) return NULL;
+        words[a] = get16(p);
+        p += 2;
+    }
+    return p;
+}
+
+size_t ec72_checkpoint_encode(const ec72_cpu_t *cpu, uint8_t *buf, size_t size) {
+    if (size < EC72_CKPT_MAX_SIZE) return 0;
+    memset(buf, 0, CKPT_HEADER);
+    memcpy(buf, EC72_CKPT_MAGIC, sizeof(EC72_CKPT_MAGIC));
+    put16(buf + 8, EC72_CKPT_VERSION);
+    uint8_t *r = buf + 12;
+    r[0] = cpu->PC; r[1] = cpu->SP; r[2] = cpu->STOFR; r[3] = cpu->STUFR;
+    r[4] = cpu->RA; r[5] = cpu->RB; r[6] = cpu->RC;    r[7] = cpu->RE;
+    buf[20] = (uint8_t)(cpu->ZF | (cpu->NF << 1) | (cpu->OF << 2));
+    buf[21] = (uint8_t)cpu->status;
+    put16(buf + 22, cpu->IR);
+    put16(buf + 24, cpu->MAR);
+    buf[10] = cpu->BANK;
+    put16(buf + 26, (uint16_t)cpu->image_words);
+    for (int i = 0; i < 8; i++) buf[28 + i] = (uint8_t)(cpu->retired >> (8 * i));
+
+    uint8_t *p = put_words(buf + CKPT_HEADER, cpu->image);
+    p = put_words(p, cpu->memory);
+    return (size_t)(p - buf);
+}
+
+bool ec72_checkpoint_decode(ec72_cpu_t *cpu, const uint8_t *buf, size_t size) {
+    if (size < CKPT_HEADER || memcmp(buf, EC72_CKPT_MAGIC, sizeof(EC72_CKPT_MAGIC)) != 0) return false;
+    if (get16(buf + 8) != EC72_CKPT_VERSION) return false;
+    size_t image_words = get16(buf + 26);
+    if (image_words > EC72_MEM_SIZE || buf[21] > EC72_ERR_IO) return false;
+
+    uint16_t image[EC72_MEM_SIZE], memory[EC72_MEM_SIZE];
+    const uint8_t *end = buf + size;
+    const uint8_t *p = get_words(buf + CKPT_HEADER, end, image);
+    if (!p || !get_words(p, end, memory)) return false;
+
+    ec72_cpu_load_words(cpu, image, image_words);
+    memcpy(cpu->memory, memory, sizeof(memory));
+    const uint8_t *r = buf + 12;
+    cpu->PC = r[0]; cpu->SP = r[1]; cpu->STOFR = r[2]; cpu->STUFR = r[3];
+    cpu->RA = r[4]; cpu->RB = r[5]; cpu->RC = r[6];    cpu->RE = r[7];
+    cpu->ZF = buf[20] & 1;
+    cpu->NF = (buf[20] >> 1) & 1;
+    cpu->OF = (buf[20] >> 2) & 1;
+    cpu->status = (ec72_status_t)buf[21];
+    cpu->IR = get16(buf + 22);
+    cpu->MAR = get16(buf + 24);
+    cpu->BANK = buf[10];
+    cpu->retired = 0;
+    for (int i = 0; i < 8; i++) cpu->retired |= (uint64_t)buf[28 + i] << (8 * i);
+    ec72_mem_changed(cpu);
+    return true;
+}
+
+bool ec72_checkpoint_save(const ec72_cpu_t *cpu, const char *path) {
+    uint8_t buf[EC72_CKPT_MAX_SIZE];
+    size_t n = ec72_checkpoint_encode(cpu, buf, sizeof(buf));
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror("Error opening checkpoint file");
+        return false;
+    }
+    bool ok = fwrite(buf, 1, n, f) == n;
+    if (fclose(f) != 0) ok = false;
+    if (!ok) fprintf(stderr, "Error writing checkpoint file %s\n", path);
+    return ok;
+}
+
+ec72_status_t ec72_checkpoint_load(ec72_cpu_t *cpu, const char *path) {
+    uint8_t buf[EC72_CKPT_MAX_SIZE];
+    FILE *f = fopen(path, "rb");
+    if (!f) return EC72_ERR_IO;
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    return ec72_checkpoint_decode(cpu, buf, n) ? EC72_OK : EC72_ERR_IO;
+}
+
+bool ec72_checkpoint_probe(const char *path) {
+    char magic[sizeof(EC72_CKPT_MAGIC)];
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    bool match = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+                 memcmp(magic, EC72_CKPT_MAGIC, sizeof(magic)) == 0;
+    fclose(f);
+    return match;
+}
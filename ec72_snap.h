@@ -0,0 +1,107 @@
+//Copyright © Martin H. Sharp; August 2025
+// Machine-state snapshots. The whole architectural state of an EC72 is 256
+// memory words and a few registers, so a snapshot is a plain copy and a
+// restore is a memcpy (engines keep their translations when the restored
+// code is unchanged).
+//
+// Three forms:
+//   ec72_snapshot_t   flat copy, for resetting to a warmed-up state in a loop
+//   ec72_snap_node_t  node of a copy-on-write tree: memory is held in pages
+//                     shared with the parent node until they differ
+//   checkpoint file   compact on-disk form of state and program image
+#ifndef EC72_SNAP_H
+#define EC72_SNAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "ec72_cpu.h"
+
+// Registers, flags and run state
+typedef struct {
+    uint8_t RA, RB, RC, RE;
+    uint16_t IR;
+    uint8_t PC;
+    uint16_t MAR;
+    uint8_t BANK;
+    uint8_t STOFR, STUFR, SP;
+    bool ZF, NF, OF;
+    ec72_status_t status;
+    uint64_t retired;
+    uint64_t cycles;
+} ec72_regs_t;
+
+typedef struct {
+    ec72_regs_t regs;
+    uint16_t memory[EC72_MEM_SIZE];
+} ec72_snapshot_t;
+
+void ec72_regs_save(const ec72_cpu_t *cpu, ec72_regs_t *regs);
+void ec72_regs_load(ec72_cpu_t *cpu, const ec72_regs_t *regs);
+
+void ec72_snapshot_take(const ec72_cpu_t *cpu, ec72_snapshot_t *snap);
+void ec72_snapshot_restore(ec72_cpu_t *cpu, const ec72_snapshot_t *snap);
+
+// ---------------------------------------------------------------------------
+// Copy-on-write snapshot tree
+
+#define EC72_SNAP_PAGE_WORDS 16
+#define EC72_SNAP_PAGES      (EC72_MEM_SIZE / EC72_SNAP_PAGE_WORDS)
+
+typedef struct ec72_snap_page {
+    uint32_t refs;
+    struct ec72_snap_page *next_free;
+    uint16_t words[EC72_SNAP_PAGE_WORDS];
+} ec72_snap_page_t;
+
+typedef struct ec72_snap_node {
+    struct ec72_snap_node *parent;      // NULL for a root
+    struct ec72_snap_node *next_free;
+    uint32_t refs;                      // handles held by the caller + children
+    uint32_t depth;
+    ec72_regs_t regs;
+    ec72_snap_page_t *pages[EC72_SNAP_PAGES];
+} ec72_snap_node_t;
+
+// Pools for nodes and pages; nothing is returned to malloc before
+// ec72_snaptree_free()
+typedef struct {
+    ec72_snap_node_t *free_nodes;
+    ec72_snap_page_t *free_pages;
+    void **blocks;
+    size_t block_count, block_cap;
+    size_t live_nodes, live_pages;
+} ec72_snaptree_t;
+
+void ec72_snaptree_init(ec72_snaptree_t *t);
+void ec72_snaptree_free(ec72_snaptree_t *t);
+
+// Snapshot of cpu as a child of parent (NULL: new root). Pages equal to the
+// parent's are shared. Returns NULL if out of memory; the caller owns one
+// reference to the new node.
+ec72_snap_node_t *ec72_snap_fork(ec72_snaptree_t *t, ec72_snap_node_t *parent, const ec72_cpu_t *cpu);
+void ec72_snap_retain(ec72_snap_node_t *node);
+// Drops one reference; the node and any ancestors nobody else holds are freed
+void ec72_snap_release(ec72_snaptree_t *t, ec72_snap_node_t *node);
+void ec72_snap_restore(ec72_cpu_t *cpu, const ec72_snap_node_t *node);
+
+// ---------------------------------------------------------------------------
+// Checkpoint files: header, registers, then program image and memory each as
+// a 32-byte bitmap of non-zero words followed by those words. Everything is
+// little-endian, independent of the host.
+
+#define EC72_CKPT_MAGIC    "EC72CKP"
+#define EC72_CKPT_VERSION  1
+#define EC72_CKPT_MAX_SIZE (64 + 2 * (EC72_MEM_SIZE / 8 + EC72_MEM_SIZE * 2))
+
+// Returns the encoded size (at most EC72_CKPT_MAX_SIZE), 0 if buf is too small
+size_t ec72_checkpoint_encode(const ec72_cpu_t *cpu, uint8_t *buf, size_t size);
+// Replaces image and state of cpu; false if buf is no valid checkpoint
+bool ec72_checkpoint_decode(ec72_cpu_t *cpu, const uint8_t *buf, size_t size);
+
+bool ec72_checkpoint_save(const ec72_cpu_t *cpu, const char *path);
+ec72_status_t ec72_checkpoint_load(ec72_cpu_t *cpu, const char *path);
+// File starts with the checkpoint magic
+bool ec72_checkpoint_probe(const char *path);
+
+#endif
@@ -0,0 +1,105 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_sym.h"
+
+bool ec72_symtab_add(ec72_symtab_t *tab, const char *name, uint8_t address) {
+    if (tab->count == tab->cap) {
+        size_t cap = tab->cap ? tab->cap * 2 : 64;
+        ec72_sym_t *grown = realloc(tab->syms, cap * sizeof(ec72_sym_t));
+        if (!grown) return false;
+        tab->syms = grown;
+        tab->cap = cap;
+    }
+    ec72_sym_t *sym = &tab->syms[tab->count++];
+    snprintf(sym->name, sizeof(sym->name), "%s", name);
+    sym->address = address;
+    return true;
+}
+
+void ec72_symtab_sort(ec72_symtab_t *tab) {
+    // Stable insertion sort: labels sharing an address keep their file
+    // order, and the assembler's output is already sorted
+    for (size_t i = 1; i < tab->count; i++) {
+        ec72_sym_t sym = tab->syms[i];
+        size_t j = i;
+        while (j > 0 && tab->syms[j - 1].address > sym.address) {
+            tab->syms[j] = tab->syms[j - 1];
+            j--;
+        }
+        tab->syms[j] = sym;
+    }
+}
+
+bool ec72_symtab_load(ec72_symtab_t *tab, const char *path) {
+    tab->syms = NULL;
+    tab->count = tab->cap = 0;
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror("Error opening symbol file");
+        return false;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned address;
+        char name[EC72_SYM_NAME_LEN];
+        if (line[0] == ';' || sscanf(line, "%x %63s", &address, name) != 2 || address > 0xFF) continue;
+        if (!ec72_symtab_add(tab, name, (uint8_t)address)) {
+            fclose(f);
+            ec72_symtab_free(tab);
+            return false;
+        }
+    }
+    fclose(f);
+    ec72_symtab_sort(tab);
+    return true;
+}
+
+void ec72_symtab_free(ec72_symtab_t *tab) {
+    free(tab->syms);
+    tab->syms = NULL;
+    tab->count = tab->cap = 0;
+}
+
+// Index of the first symbol with an address above address
+static size_t upper_bound(const ec72_symtab_t *tab, uint8_t address) {
+    size_t lo = 0, hi = tab->count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (tab->syms[mid].address <= address) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+const char *ec72_symtab_at(const ec72_symtab_t *tab, uint8_t address) {
+    uint8_t offset;
+    const char *name = ec72_symtab_lookup(tab, address, &offset);
+    return (name && offset == 0) ? name : NULL;
+}
+
+const char *ec72_symtab_lookup(const ec72_symtab_t *tab, uint8_t address, uint8_t *offset) {
+    if (!tab || tab->count == 0) return NULL;
+    size_t i = upper_bound(tab, address);
+    if (i == 0) return NULL;
+
+    // First of several labels on the same address
+    uint8_t found = tab->syms[i - 1].address;
+    while (i > 1 && tab->syms[i - 2].address == found) i--;
+    *offset = (uint8_t)(address - found);
+    return tab->syms[i - 1].name;
+}
+
+const char *ec72_symtab_format(const ec72_symtab_t *tab, uint8_t address, char *buf, size_t size) {
+    uint8_t offset;
+    const char *name = ec72_symtab_lookup(tab, address, &offset);
+    if (!name) snprintf(buf, size, "0x%02X", address);
+    else if (offset == 0) snprintf(buf, size, "%s", name);
+    else snprintf(buf, size, "%s+%u", name, offset);
+    return buf;
+}
@@ -0,0 +1,41 @@
+//Copyright © Martin H. Sharp; August 2025
+// Symbol files written by `EC72ASM -s`: one "ADDR NAME" line per label,
+// address in hex, in source order. Lines starting with ';' are comments.
+#ifndef EC72_SYM_H
+#define EC72_SYM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define EC72_SYM_NAME_LEN 64
+
+typedef struct {
+    char name[EC72_SYM_NAME_LEN];
+    uint8_t address;
+} ec72_sym_t;
+
+typedef struct {
+    ec72_sym_t *syms;           // sorted by address
+    size_t count, cap;
+} ec72_symtab_t;
+
+// Returns false (and prints the reason) if the file cannot be read
+bool ec72_symtab_load(ec72_symtab_t *tab, const char *path);
+void ec72_symtab_free(ec72_symtab_t *tab);
+
+// Building a table in memory: add in any order (names longer than
+// EC72_SYM_NAME_LEN - 1 are cut), then sort once; false if out of memory
+bool ec72_symtab_add(ec72_symtab_t *tab, const char *name, uint8_t address);
+void ec72_symtab_sort(ec72_symtab_t *tab);
+
+// Label at exactly address, or NULL
+const char *ec72_symtab_at(const ec72_symtab_t *tab, uint8_t address);
+// Closest label at or below address, or NULL; *offset is the distance to it
+const char *ec72_symtab_lookup(const ec72_symtab_t *tab, uint8_t address, uint8_t *offset);
+
+// Formats address as "LABEL", "LABEL+n" or "0xNN" into buf
+const char *ec72_symtab_format(const ec72_symtab_t *tab, uint8_t address, char *buf, size_t size);
+
+#endif
@@ -0,0 +1,349 @@
+//Copyright © Martin H. Sharp; August 2025
+// Threaded-code engine: every memory word is decoded once into a handler
+// address plus resolved register pointers, and instructions dispatch with
+// computed goto instead of fetch/split/switch. Decoding is lazy; every store
+// resets the target entry to the decode stub, so code that rewrites itself
+// (including CALL/PUSH into a stack that overlaps code) sees the new word.
+// In verified mode (ec72_verify.h) the stack handlers skip their bound
+// checks and stores leave the decoded entries alone. With an I/O bus
+// (ec72_bus.h) MOV*/STOR* are bound to device or memory handlers when they
+// are decoded, so only the RB-indexed accesses test the window at run time.
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_cpu.h"
+#include "ec72_engine.h"
+#include "ec72_bus.h"
+#include "ec72_xmem.h"
+
+#if defined(__GNUC__)
+
+ec72_status_t ec72_threaded_run(ec72_cpu_t *cpu, uint64_t max_instructions) {
+    // Every entry starts as op_unknown and the opcodes override it
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverride-init"
+    static const void *const handlers[256] = {
+        [0 ... 255]      = &&op_unknown,
+        [OP_MOVR]        = &&op_movr,
+        [OP_MOVA]        = &&op_mova,       [OP_MOVB]  = &&op_movb,
+        [OP_MOVC]        = &&op_movc,       [OP_MOVE]  = &&op_move,
+        [OP_STORA]       = &&op_stora,      [OP_STORB] = &&op_storb,
+        [OP_STORC]       = &&op_storc,      [OP_STORE] = &&op_store,
+        [OP_LDIMA]       = &&op_ldima,      [OP_LDIMB] = &&op_ldimb,
+        [OP_LDIMC]       = &&op_ldimc,      [OP_LDIME] = &&op_ldime,
+        [OP_JMPN]        = &&op_jmpn,       [OP_JMPZ]  = &&op_jmpz,
+        [OP_JMPO]        = &&op_jmpo,       [OP_JMP]   = &&op_jmp,
+        [OP_ADD]         = &&op_add,        [OP_SUB]   = &&op_sub,
+        [OP_ADDR]        = &&op_addr,       [OP_SUBR]  = &&op_subr,
+        [OP_OUT]         = &&op_out,        [OP_CALL]  = &&op_call,
+        [OP_RET]         = &&op_ret,        [OP_MOVA_PTRB]  = &&op_mova_ptrb,
+        [OP_STORA_PTRB]  = &&op_stora_ptrb, [OP_PUSH]  = &&op_push,
+        [OP_POP]         = &&op_pop,        [OP_ADDSP] = &&op_addsp,
+        [OP_SUBSP]       = &&op_subsp,      [OP_SSTOF] = &&op_sstof,
+        [OP_SSTUF]       = &&op_sstuf,      [OP_XCHG]  = &&op_xchg,
+        [OP_CAS]         = &&op_cas,        [OP_LDID]  = &&op_ldid,
+        [OP_SBANK]       = &&op_sbank,      [OP_SMAR]  = &&op_smar,
+        [OP_FLD]         = &&op_fld,        [OP_FST]   = &&op_fst,
+        [OP_BCOPY]       = &&op_bcopy,      [OP_BFILL] = &&op_bfill,
+        [OP_BCMP]        = &&op_bcmp,       [OP_MUL]   = &&op_mul,
+        [OP_HLT]         = &&op_hlt,
+    };
+    // Verified mode: same table with the checked handlers swapped out
+    static const void *const verified_handlers[256] = {
+        [0 ... 255]      = &&op_unknown,
+        [OP_MOVR]        = &&op_movr,
+        [OP_MOVA]        = &&op_mova,       [OP_MOVB]  = &&op_movb,
+        [OP_MOVC]        = &&op_movc,       [OP_MOVE]  = &&op_move,
+        [OP_STORA]       = &&op_stora_v,    [OP_STORB] = &&op_storb_v,
+        [OP_STORC]       = &&op_storc_v,    [OP_STORE] = &&op_store_v,
+        [OP_LDIMA]       = &&op_ldima,      [OP_LDIMB] = &&op_ldimb,
+        [OP_LDIMC]       = &&op_ldimc,      [OP_LDIME] = &&op_ldime,
+        [OP_JMPN]        = &&op_jmpn,       [OP_JMPZ]  = &&op_jmpz,
+        [OP_JMPO]        = &&op_jmpo,       [OP_JMP]   = &&op_jmp,
+        [OP_ADD]         = &&op_add,        [OP_SUB]   = &&op_sub,
+        [OP_ADDR]        = &&op_addr,       [OP_SUBR]  = &&op_subr,
+        [OP_OUT]         = &&op_out,        [OP_CALL]  = &&op_call_v,
+        [OP_RET]         = &&op_ret_v,      [OP_MOVA_PTRB]  = &&op_mova_ptrb,
+        [OP_STORA_PTRB]  = &&op_stora_ptrb, [OP_PUSH]  = &&op_push_v,
+        [OP_POP]         = &&op_pop_v,      [OP_ADDSP] = &&op_addsp_v,
+        [OP_SUBSP]       = &&op_subsp_v,    [OP_SSTOF] = &&op_sstof,
+        [OP_SSTUF]       = &&op_sstuf,      [OP_XCHG]  = &&op_xchg,
+        [OP_CAS]         = &&op_cas,        [OP_LDID]  = &&op_ldid,
+        [OP_SBANK]       = &&op_sbank,      [OP_SMAR]  = &&op_smar,
+        [OP_FLD]         = &&op_fld,        [OP_FST]   = &&op_fst,
+        [OP_BCOPY]       = &&op_bcopy,      [OP_BFILL] = &&op_bfill,
+        [OP_BCMP]        = &&op_bcmp,       [OP_MUL]   = &&op_mul,
+        [OP_HLT]         = &&op_hlt,
+    };
+#pragma GCC diagnostic pop
+    const void *const *table = cpu->verified ? verified_handlers : handlers;
+
+    ec72_decoded_t *dec = cpu->decoded;
+    uint16_t *memory = cpu->memory;
+    ec72_bus_t *bus = cpu->bus;
+
+    // Entries only depend on their word, so after a foreign change (store by
+    // another engine, snapshot restore) just the words that differ are dropped
+    if (cpu->decoded_for != cpu || cpu->decoded_verified != cpu->verified || cpu->decoded_bus != bus ||
+        (bus && cpu->decoded_bus_base != bus->base)) {
+        for (int i = 0; i < MEM_SIZE; i++) dec[i].handler = &&decode;
+        cpu->decoded_for = cpu;
+        cpu->decoded_verified = cpu->verified;
+        cpu->decoded_bus = bus;
+        if (bus) cpu->decoded_bus_base = bus->base;
+    } else if (cpu->decoded_epoch != cpu->mem_epoch) {
+        for (int i = 0; i < MEM_SIZE; i++) {
+            if (dec[i].word != memory[i]) dec[i].handler = &&decode;
+        }
+    }
+
+    uint8_t PC = cpu->PC;
+    uint64_t n = 0;
+    ec72_status_t status = EC72_OK;
+    ec72_decoded_t *d = NULL;
+    uint8_t cur = 0;
+
+// Stores go through here so the decoded copy of the target word is dropped
+#define WRITE(addr, v) do { uint8_t a_ = (addr); memory[a_] = (v); dec[a_].handler = &&decode; } while (0)
+// ... and after the block stores, the words they covered
+#define WRITTEN(addr, count) do {                                            \
+        for (int i_ = 0; i_ < (count); i_++) dec[(uint8_t)((addr) + i_)].handler = &&decode; \
+    } while (0)
+#define DISPATCH() do {                                    \
+        if (__builtin_expect(n == max_instructions, 0)) goto out; \
+        n++;                                               \
+        cur = PC++;                                        \
+        d = &dec[cur];                                     \
+        goto *d->handler;                                  \
+    } while (0)
+#define FAULT(s) do { n--; status = (s); goto out; } while (0)
+#define operand ((uint8_t)d->word)
+// Instruction count at the current instruction, as the switch loop sees it
+#define NOW (cpu->retired + n - 1)
+
+    DISPATCH();
+
+decode: {
+        uint16_t IR = memory[cur];
+        uint8_t opcode = EC72_OPCODE(IR);
+        d->word = IR;
+        d->reg = d->src = NULL;
+        d->handler = table[opcode];
+        switch (opcode) {
+            case OP_MOVR:
+                d->reg = get_register(cpu, (EC72_OPERAND(IR) >> 4) & 0x0F);
+                d->src = get_register(cpu, EC72_OPERAND(IR) & 0x0F);
+                if (!d->reg || !d->src) d->handler = &&op_nop;
+                break;
+            case OP_ADDR: case OP_SUBR: case OP_PUSH: case OP_POP: case OP_MUL:
+                d->reg = get_register(cpu, EC72_OPERAND(IR));
+                if (!d->reg) d->handler = &&op_illegal;
+                break;
+            case OP_MOVA: case OP_MOVB: case OP_MOVC: case OP_MOVE:
+                if (bus && ec72_bus_hit(bus, EC72_OPERAND(IR))) {
+                    d->reg = get_register(cpu, REG_A + (opcode - OP_MOVA));
+                    d->handler = &&op_io_load;
+                }
+                break;
+            case OP_STORA: case OP_STORB: case OP_STORC: case OP_STORE:
+                if (bus && ec72_bus_hit(bus, EC72_OPERAND(IR))) {
+                    d->reg = get_register(cpu, REG_A + (opcode - OP_STORA));
+                    d->handler = &&op_io_store;
+                }
+                break;
+            case OP_MOVA_PTRB:
+                if (bus) d->handler = &&op_mova_ptrb_io;
+                break;
+            case OP_STORA_PTRB:
+                if (bus) d->handler = &&op_stora_ptrb_io;
+                break;
+            default:
+                break;
+        }
+        goto *d->handler;
+    }
+
+op_nop:   DISPATCH();
+op_movr:  *d->reg = *d->src; DISPATCH();
+op_mova:  cpu->RA = memory[operand] & 0xFF; DISPATCH();
+op_movb:  cpu->RB = memory[operand] & 0xFF; DISPATCH();
+op_movc:  cpu->RC = memory[operand] & 0xFF; DISPATCH();
+op_move:  cpu->RE = memory[operand] & 0xFF; DISPATCH();
+op_stora: WRITE(operand, cpu->RA); DISPATCH();
+op_storb: WRITE(operand, cpu->RB); DISPATCH();
+op_storc: WRITE(operand, cpu->RC); DISPATCH();
+op_store: WRITE(operand, cpu->RE); DISPATCH();
+op_ldima: cpu->RA = operand; DISPATCH();
+op_ldimb: cpu->RB = operand; DISPATCH();
+op_ldimc: cpu->RC = operand; DISPATCH();
+op_ldime: cpu->RE = operand; DISPATCH();
+op_jmpn:  if (cpu->NF) PC = operand; DISPATCH();
+op_jmpz:  if (cpu->ZF) PC = operand; DISPATCH();
+op_jmpo:  if (cpu->OF) PC = operand; DISPATCH();
+op_jmp:   PC = operand; DISPATCH();
+op_add:   alu_add(cpu, operand); DISPATCH();
+op_sub:   alu_sub(cpu, operand); DISPATCH();
+op_addr:  alu_add(cpu, *d->reg); DISPATCH();
+op_subr:  alu_sub(cpu, *d->reg); DISPATCH();
+op_out:   if (cpu->out) cpu->out(cpu->out_user, cpu->RA); DISPATCH();
+op_call:
+    if ( (cpu->SP == cpu->STOFR) || (cpu->SP == 0) ) FAULT(EC72_ERR_STACK_OVERFLOW);
+    --cpu->SP;
+    WRITE(cpu->SP, PC);
+    PC = operand;
+    DISPATCH();
+op_ret:
+    if (cpu->SP == MEM_SIZE-1) FAULT(EC72_ERR_STACK_UNDERFLOW);
+    PC = (uint8_t)memory[cpu->SP++];
+    DISPATCH();
+op_mova_ptrb:  cpu->RA = (uint8_t)memory[cpu->RB]; DISPATCH();
+op_stora_ptrb: WRITE(cpu->RB, cpu->RA); DISPATCH();
+op_push:
+    if ( (cpu->SP == cpu->STOFR) || (cpu->SP == 0) ) FAULT(EC72_ERR_STACK_OVERFLOW);
+    {
+        uint8_t v = *d->reg;        // read before SP moves: PUSH SP pushes the old SP
+        --cpu->SP;
+        WRITE(cpu->SP, v);
+    }
+    DISPATCH();
+op_pop:
+    if ( (cpu->SP == cpu->STUFR ) || (cpu->SP == (MEM_SIZE -1) ) ) FAULT(EC72_ERR_STACK_UNDERFLOW);
+    {
+        uint16_t v = memory[cpu->SP++];
+        *d->reg = (uint8_t)v;
+    }
+    DISPATCH();
+op_addsp:
+    if ( (cpu->SP == cpu->STUFR ) || (cpu->SP == (MEM_SIZE -1) ) ) FAULT(EC72_ERR_STACK_UNDERFLOW);
+    cpu->SP += operand;
+    DISPATCH();
+op_subsp:
+    if ( (cpu->SP == cpu->STOFR) || (cpu->SP == 0) ) FAULT(EC72_ERR_STACK_OVERFLOW);
+    cpu->SP -= operand;
+    DISPATCH();
+op_sstof: cpu->STOFR = operand; DISPATCH();
+op_sstuf: cpu->STUFR = operand; cpu->SP = operand; DISPATCH();
+// SMP cores stop in front of the atomics (ec72_smp.h)
+op_xchg:
+    if (cpu->atomic_stop) goto sync;
+    {
+        uint8_t v = cpu->RA;
+        if (bus && ec72_bus_hit(bus, operand)) {
+            cpu->RA = ec72_bus_read(bus, operand, NOW);
+            ec72_bus_write(bus, operand, v, NOW);
+        } else {
+            cpu->RA = (uint8_t)memory[operand];
+            WRITE(operand, v);
+        }
+    }
+    DISPATCH();
+op_cas:
+    if (cpu->atomic_stop) goto sync;
+    {
+        bool io = bus && ec72_bus_hit(bus, operand);
+        uint8_t v = io ? ec72_bus_read(bus, operand, NOW) : (uint8_t)memory[operand];
+        bool swap = v == cpu->RA;
+        if (!swap) cpu->RA = v;
+        else if (io) ec72_bus_write(bus, operand, cpu->RB, NOW);
+        else WRITE(operand, cpu->RB);
+        update_flags(cpu, !swap);
+    }
+    DISPATCH();
+op_ldid: cpu->RA = cpu->core_id; cpu->RB = cpu->cores; DISPATCH();
+op_sbank: cpu->BANK = operand; DISPATCH();
+op_smar: cpu->MAR = (uint16_t)(cpu->RB << 8 | cpu->RC); DISPATCH();
+op_fld: cpu->RA = ec72_far_load(cpu, operand); DISPATCH();
+op_fst: ec72_far_store(cpu, cpu->RA, operand); DISPATCH();
+// Block instructions (ec72_block.h): stack bound checks as in the switch
+// loop (the verifier rejects BCOPY/BFILL, so the verified table needs no
+// unchecked copies), and the bus window test when there is a bus
+op_bcopy:
+    {
+        ec72_status_t bad = ec72_block_stack_check(cpu->RB, cpu->RE, cpu->SP, cpu->STOFR, cpu->STUFR);
+        if (bad != EC72_OK) FAULT(bad);
+    }
+    if (bus && (ec72_bus_block_hit(bus, cpu->RB, cpu->RE) || ec72_bus_block_hit(bus, cpu->RC, cpu->RE)))
+        ec72_bus_block_copy(bus, memory, cpu->RB, cpu->RC, cpu->RE, NOW);
+    else ec72_block_copy(memory, cpu->RB, cpu->RC, cpu->RE);
+    WRITTEN(cpu->RB, cpu->RE);
+    DISPATCH();
+op_bfill:
+    {
+        ec72_status_t bad = ec72_block_stack_check(cpu->RB, cpu->RE, cpu->SP, cpu->STOFR, cpu->STUFR);
+        if (bad != EC72_OK) FAULT(bad);
+    }
+    if (bus && ec72_bus_block_hit(bus, cpu->RB, cpu->RE)) ec72_bus_block_fill(bus, memory, cpu->RB, cpu->RA, cpu->RE, NOW);
+    else ec72_block_fill(memory, cpu->RB, cpu->RA, cpu->RE);
+    WRITTEN(cpu->RB, cpu->RE);
+    DISPATCH();
+op_bcmp:
+    if (bus) alu_bcmp_io(cpu, bus, NOW);
+    else alu_bcmp(cpu);
+    DISPATCH();
+op_mul:  alu_mul(cpu, *d->reg); DISPATCH();
+// Verified mode: no bound checks, and no store reaches code
+op_stora_v: memory[operand] = cpu->RA; DISPATCH();
+op_storb_v: memory[operand] = cpu->RB; DISPATCH();
+op_storc_v: memory[operand] = cpu->RC; DISPATCH();
+op_store_v: memory[operand] = cpu->RE; DISPATCH();
+op_call_v:
+    memory[--cpu->SP] = PC;
+    PC = operand;
+    DISPATCH();
+op_ret_v:  PC = (uint8_t)memory[cpu->SP++]; DISPATCH();
+op_push_v: {
+        uint8_t v = *d->reg;
+        memory[--cpu->SP] = v;
+    }
+    DISPATCH();
+op_pop_v:   *d->reg = (uint8_t)memory[cpu->SP++]; DISPATCH();
+op_addsp_v: cpu->SP += operand; DISPATCH();
+op_subsp_v: cpu->SP -= operand; DISPATCH();
+// I/O bus: fixed device addresses, and the RB-indexed accesses
+op_io_load:  *d->reg = ec72_bus_read(bus, operand, NOW); DISPATCH();
+op_io_store: ec72_bus_write(bus, operand, *d->reg, NOW); DISPATCH();
+op_mova_ptrb_io:
+    cpu->RA = ec72_bus_hit(bus, cpu->RB) ? ec72_bus_read(bus, cpu->RB, NOW) : (uint8_t)memory[cpu->RB];
+    DISPATCH();
+op_stora_ptrb_io:
+    if (ec72_bus_hit(bus, cpu->RB)) ec72_bus_write(bus, cpu->RB, cpu->RA, NOW);
+    else WRITE(cpu->RB, cpu->RA);
+    DISPATCH();
+op_hlt:
+    status = EC72_HALTED;
+    goto out;
+op_illegal: FAULT(EC72_ERR_ILLEGAL_OPERAND);
+op_unknown: FAULT(EC72_ERR_UNKNOWN_OPCODE);
+sync:
+    n--;
+    PC = cur;
+    status = EC72_SYNC;
+    goto out;
+
+#undef WRITE
+#undef WRITTEN
+#undef DISPATCH
+#undef FAULT
+#undef operand
+#undef NOW
+
+out:
+    cpu->PC = PC;
+    if (d) cpu->IR = d->word;
+    cpu->retired += n;
+    if (status != EC72_SYNC) cpu->status = status;
+    // Our own stores already invalidated our entries (verified mode: none
+    // that can run); everyone else resyncs
+    ec72_mem_changed(cpu);
+    cpu->decoded_epoch = cpu->mem_epoch;
+    return status;
+}
+
+#else
+
+// Computed goto needs GCC/Clang; other compilers use the reference loop
+ec72_status_t ec72_threaded_run(ec72_cpu_t *cpu, uint64_t max_instructions) {
+    return ec72_switch_run(cpu, max_instructions);
+}
+
+#endif
@@ -0,0 +1,159 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_trace.h"
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+
+// Records staged in memory before a stream-mode write
+#define STREAM_RECORDS 4096
+
+static void init_header(ec72_trace_header_t *hdr, uint32_t capacity) {
+    memset(hdr, 0, sizeof(*hdr));
+    memcpy(hdr->magic, EC72_TRACE_MAGIC, sizeof(EC72_TRACE_MAGIC));
+    hdr->version = EC72_TRACE_VERSION;
+    hdr->rec_size = sizeof(ec72_trace_rec_t);
+    hdr->capacity = capacity;
+    hdr->bom = EC72_TRACE_BOM;
+}
+
+bool ec72_trace_open(ec72_trace_t *t, const char *path, uint32_t ring_records) {
+    memset(t, 0, sizeof(*t));
+    t->pc_lo = 0;
+    t->pc_hi = 0xFF;
+    memset(t->opcodes, 0xFF, sizeof(t->opcodes));
+
+    if (ring_records) {
+        t->ring = true;
+        t->capacity = ring_records;
+#ifndef _WIN32
+        // The ring lives directly in the mapped file, so whatever was traced
+        // is on disk even if the emulator is killed
+        t->map_size = sizeof(ec72_trace_header_t) + (size_t)ring_records * sizeof(ec72_trace_rec_t);
+        int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ftruncate(fd, (off_t)t->map_size) != 0) {
+            perror("Error opening trace file");
+            if (fd >= 0) close(fd);
+            return false;
+        }
+        t->map = mmap(NULL, t->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (t->map == MAP_FAILED) {
+            perror("Error mapping trace file");
+            t->map = NULL;
+            return false;
+        }
+        t->hdr = t->map;
+        t->rec = (ec72_trace_rec_t *)(t->hdr + 1);
+        init_header(t->hdr, ring_records);
+        return true;
+#endif
+    } else {
+        t->capacity = STREAM_RECORDS;
+    }
+
+    // Stream mode (and the ring on hosts without mmap): staged in memory,
+    // written with stdio
+    t->f = fopen(path, "wb");
+    if (!t->f) {
+        perror("Error opening trace file");
+        return false;
+    }
+    t->hdr = malloc(sizeof(ec72_trace_header_t));
+    t->rec = malloc((size_t)t->capacity * sizeof(ec72_trace_rec_t));
+    if (!t->hdr || !t->rec) {
+        fprintf(stderr, "Out of memory for trace buffer\n");
+        ec72_trace_close(t);
+        return false;
+    }
+    init_header(t->hdr, t->ring ? t->capacity : 0);
+    if (fwrite(t->hdr, sizeof(*t->hdr), 1, t->f) != 1) t->failed = true;
+    return true;
+}
+
+void ec72_trace_spill(ec72_trace_t *t) {
+    if (fwrite(t->rec, sizeof(ec72_trace_rec_t), t->pos, t->f) != t->pos) t->failed = true;
+    t->pos = 0;
+}
+
+bool ec72_trace_close(ec72_trace_t *t) {
+    if (t->map) {
+#ifndef _WIN32
+        if (msync(t->map, t->map_size, MS_SYNC) != 0) t->failed = true;
+        munmap(t->map, t->map_size);
+#endif
+        t->map = NULL;
+    } else if (t->f) {
+        if (t->hdr && t->rec) {
+            if (t->ring) {
+                // The whole ring, unused slots included
+                t->pos = t->capacity;
+            }
+            ec72_trace_spill(t);
+            // Final record count into the header
+            if (fseek(t->f, 0, SEEK_SET) != 0 || fwrite(t->hdr, sizeof(*t->hdr), 1, t->f) != 1) {
+                t->failed = true;
+            }
+        }
+        if (fclose(t->f) != 0) t->failed = true;
+        free(t->hdr);
+        free(t->rec);
+    }
+    t->f = NULL;
+    t->hdr = NULL;
+    t->rec = NULL;
+    return !t->failed;
+}
+
+void ec72_trace_filter_pc(ec72_trace_t *t, uint8_t lo, uint8_t hi) {
+    t->pc_lo = lo;
+    t->pc_hi = hi;
+}
+
+void ec72_trace_filter_opcode(ec72_trace_t *t, uint8_t opcode) {
+    // All opcodes selected means no opcode filter yet
+    bool all = true;
+    for (size_t i = 0; i < sizeof(t->opcodes); i++) all &= (t->opcodes[i] == 0xFF);
+    if (all) memset(t->opcodes, 0, sizeof(t->opcodes));
+    t->opcodes[opcode >> 3] |= (uint8_t)(1u << (opcode & 7));
+}
+
+static bool parse_byte(const char *s, char **end, uint8_t *value) {
+    long v = strtol(s, end, 0);
+    if (*end == s || v < 0 || v > 0xFF) return false;
+    *value = (uint8_t)v;
+    return true;
+}
+
+bool ec72_trace_parse_pc_range(ec72_trace_t *t, const char *arg) {
+    char *end;
+    uint8_t lo, hi;
+    if (!parse_byte(arg, &end, &lo)) return false;
+    if (*end == '\0') {
+        hi = lo;
+    } else if (*end != '-' || !parse_byte(end + 1, &end, &hi) || *end != '\0' || hi < lo) {
+        return false;
+    }
+    ec72_trace_filter_pc(t, lo, hi);
+    return true;
+}
+
+bool ec72_trace_parse_opcodes(ec72_trace_t *t, const char *arg) {
+    const char *s = arg;
+    for (;;) {
+        char *end;
+        uint8_t op;
+        if (!parse_byte(s, &end, &op)) return false;
+        ec72_trace_filter_opcode(t, op);
+        if (*end == '\0') return true;
+        if (*end != ',') return false;
+        s = end + 1;
+    }
+}
@@ -0,0 +1,146 @@
+//Copyright © Martin H. Sharp; August 2025
+// Binary execution trace. Every traced instruction becomes one fixed-size
+// record (state before the instruction plus the memory cell it wrote or
+// popped), stored in a memory-mapped ring buffer or streamed to a file.
+// EC72TRACE turns a trace file back into the text of `EC72CPU -d`.
+#ifndef EC72_TRACE_H
+#define EC72_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "ec72_cpu.h"
+
+#define EC72_TRACE_MAGIC    "EC72TRC"
+#define EC72_TRACE_VERSION  1
+#define EC72_TRACE_BOM      0x01020304u     // detects files from a host of the other byte order
+
+// flags bits of a record
+#define EC72_TRACE_ZF       0x01
+#define EC72_TRACE_NF       0x02
+#define EC72_TRACE_OF       0x04
+#define EC72_TRACE_WRITE    0x08            // mem_addr/mem_value: cell written (the first one for BCOPY/BFILL)
+#define EC72_TRACE_READ     0x10            // mem_addr/mem_value: cell popped (RET/POP)
+
+// 16 bytes, host byte order
+typedef struct {
+    uint16_t ir;
+    uint16_t mem_value;
+    uint8_t pc;                 // address the instruction was fetched from
+    uint8_t sp, stofr, stufr;
+    uint8_t ra, rb, rc, re;
+    uint8_t flags;
+    uint8_t mem_addr;
+    uint8_t status;             // ec72_status_t after the instruction
+    uint8_t reserved;
+} ec72_trace_rec_t;
+
+// File header, followed by the records. capacity 0: records in execution
+// order up to the end of the file. Otherwise a ring of capacity records in
+// which record number count-1 was the last one written.
+typedef struct {
+    char magic[8];
+    uint16_t version;
+    uint16_t rec_size;
+    uint32_t capacity;
+    uint64_t count;             // records written in total
+    uint32_t bom;
+    uint32_t reserved;
+} ec72_trace_header_t;
+
+typedef struct ec72_trace {
+    ec72_trace_header_t *hdr;
+    ec72_trace_rec_t *rec;      // ring (mapped file) or staging buffer (stream)
+    uint32_t capacity, pos;
+    bool ring;
+
+    FILE *f;                    // stream mode
+    void *map;                  // ring mode
+    size_t map_size;
+    bool failed;
+
+    // Filter: only instructions fetched from pc_lo..pc_hi with a selected opcode
+    uint8_t pc_lo, pc_hi;
+    uint8_t opcodes[256 / 8];
+} ec72_trace_t;
+
+// ring_records 0: stream every record to path. Otherwise keep only the last
+// ring_records records in a memory-mapped ring file at path.
+// Returns false (and prints the reason) on failure.
+bool ec72_trace_open(ec72_trace_t *t, const char *path, uint32_t ring_records);
+// Writes out pending records; returns false if any write failed
+bool ec72_trace_close(ec72_trace_t *t);
+
+// Filters; by default everything is traced
+void ec72_trace_filter_pc(ec72_trace_t *t, uint8_t lo, uint8_t hi);
+// First call restricts the trace to the given opcode, later calls add more
+void ec72_trace_filter_opcode(ec72_trace_t *t, uint8_t opcode);
+
+// Parses "lo-hi" and "op,op,..." (numbers in C syntax, e.g. 0x10-0x2F)
+bool ec72_trace_parse_pc_range(ec72_trace_t *t, const char *arg);
+bool ec72_trace_parse_opcodes(ec72_trace_t *t, const char *arg);
+
+// Stream mode: staging buffer full
+void ec72_trace_spill(ec72_trace_t *t);
+
+static inline void ec72_cpu_set_trace(ec72_cpu_t *cpu, ec72_trace_t *t) {
+    cpu->trace = t;
+}
+
+static inline bool ec72_trace_wants(const ec72_trace_t *t, uint8_t pc, uint16_t ir) {
+    uint8_t op = EC72_OPCODE(ir);
+    return pc >= t->pc_lo && pc <= t->pc_hi && (t->opcodes[op >> 3] & (1u << (op & 7)));
+}
+
+// Record of the instruction about to execute at cpu->PC
+static inline ec72_trace_rec_t *ec72_trace_begin(ec72_trace_t *t, const ec72_cpu_t *cpu) {
+    if (t->pos == t->capacity) {
+        if (t->ring) t->pos = 0;
+        else ec72_trace_spill(t);
+    }
+    ec72_trace_rec_t *r = &t->rec[t->pos++];
+    t->hdr->count++;
+
+    r->pc = cpu->PC;
+    r->ir = cpu->memory[cpu->PC];
+    r->sp = cpu->SP;
+    r->stofr = cpu->STOFR;
+    r->stufr = cpu->STUFR;
+    r->ra = cpu->RA;
+    r->rb = cpu->RB;
+    r->rc = cpu->RC;
+    r->re = cpu->RE;
+    r->flags = (cpu->ZF ? EC72_TRACE_ZF : 0) | (cpu->NF ? EC72_TRACE_NF : 0) | (cpu->OF ? EC72_TRACE_OF : 0);
+    r->mem_addr = 0;
+    r->mem_value = 0;
+    r->reserved = 0;
+    return r;
+}
+
+// Completes r after the instruction ran; the accessed cell is derived from
+// the opcode so the interpreter itself needs no trace hooks
+static inline void ec72_trace_end(ec72_trace_rec_t *r, const ec72_cpu_t *cpu, ec72_status_t s) {
+    r->status = (uint8_t)s;
+    if (s != EC72_OK) return;
+
+    uint8_t addr;
+    switch (EC72_OPCODE(r->ir)) {
+        case OP_STORA: case OP_STORB: case OP_STORC: case OP_STORE: case OP_XCHG: case OP_CAS:
+            addr = EC72_OPERAND(r->ir); r->flags |= EC72_TRACE_WRITE; break;
+        case OP_STORA_PTRB:
+            addr = r->rb; r->flags |= EC72_TRACE_WRITE; break;
+        case OP_CALL: case OP_PUSH:
+            addr = (uint8_t)(r->sp - 1); r->flags |= EC72_TRACE_WRITE; break;
+        case OP_RET: case OP_POP:
+            addr = r->sp; r->flags |= EC72_TRACE_READ; break;
+        case OP_BCOPY: case OP_BFILL:
+            if (r->re == 0) return;
+            addr = r->rb; r->flags |= EC72_TRACE_WRITE; break;
+        default:
+            return;
+    }
+    r->mem_addr = addr;
+    r->mem_value = cpu->memory[addr];
+}
+
+#endif
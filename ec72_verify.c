@@ -0,0 +1,392 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_verify.h"
+#include "ec72_engine.h"
+
+#define GREEN   "\x1b[32m"
+#define YELLOW  "\x1b[33m"
+#define RESET   "\x1b[0m"
+
+// Stack cells are kept as shared lists (node 0 = nothing known above SP).
+// A cell is a return address pushed by CALL (with the called address, to
+// spot recursion) or CELL_DATA for anything else.
+#define CELL_DATA UINT32_MAX
+#define CELL_RET(ret, callee) ((uint32_t)(ret) | ((uint32_t)(callee) << 8))
+
+typedef struct {
+    uint32_t cell, parent;
+} Node_t;
+
+typedef struct {
+    uint8_t pc, sp, stofr, stufr;
+    uint32_t stack;
+} State_t;
+
+typedef struct {
+    ec72_verify_t *v;
+    const uint16_t *memory;
+    Node_t *nodes;
+    size_t node_count, node_cap;
+    uint32_t *node_index;       // open addressing, slot holds node id + 1
+    size_t node_index_size;
+    State_t *states;            // every state seen; the unprocessed tail is the worklist
+    size_t state_count, state_cap;
+    uint32_t *state_index;      // slot holds state id + 1
+    size_t state_index_size;
+    int written_by[EC72_MEM_SIZE];      // first instruction writing the address + 1
+    bool stack_write[EC72_MEM_SIZE];    // ... and whether that was CALL/PUSH
+    bool oom;
+} Verify_t;
+
+static uint32_t hash32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+static uint32_t state_hash(const State_t *s) {
+    return hash32(((uint32_t)s->pc | (uint32_t)s->sp << 8 | (uint32_t)s->stofr << 16 | (uint32_t)s->stufr << 24) ^
+                  hash32(s->stack));
+}
+
+static bool fail(Verify_t *t, const char *reason, int address, int target, int sp) {
+    if (!t->v->reason) {
+        t->v->reason = reason;
+        t->v->address = address;
+        t->v->target = target;
+        t->v->sp = sp;
+    }
+    return false;
+}
+
+// Doubles index (size 0: 1024 slots) and re-inserts ids 0..count-1
+static bool rehash(uint32_t **index, size_t *size, size_t count, uint32_t (*hash)(Verify_t *, size_t), Verify_t *t) {
+    size_t n = *size ? *size * 2 : 1024;
+    uint32_t *grown = calloc(n, sizeof(uint32_t));
+    if (!grown) return false;
+    for (size_t i = 0; i < count; i++) {
+        size_t slot = hash(t, i) & (n - 1);
+        while (grown[slot]) slot = (slot + 1) & (n - 1);
+        grown[slot] = (uint32_t)(i + 1);
+    }
+    free(*index);
+    *index = grown;
+    *size = n;
+    return true;
+}
+
+static uint32_t node_hash_at(Verify_t *t, size_t i) {
+    return hash32(t->nodes[i].cell ^ hash32(t->nodes[i].parent));
+}
+
+static uint32_t state_hash_at(Verify_t *t, size_t i) {
+    return state_hash(&t->states[i]);
+}
+
+// Node for cell on top of parent
+static uint32_t push_cell(Verify_t *t, uint32_t parent, uint32_t cell) {
+    if (t->oom) return 0;
+    if (2 * (t->node_count + 1) > t->node_index_size &&
+        !rehash(&t->node_index, &t->node_index_size, t->node_count, node_hash_at, t)) {
+        t->oom = true;
+        return 0;
+    }
+    size_t mask = t->node_index_size - 1;
+    size_t slot = hash32(cell ^ hash32(parent)) & mask;
+    for (; t->node_index[slot]; slot = (slot + 1) & mask) {
+        const Node_t *n = &t->nodes[t->node_index[slot] - 1];
+        if (n->cell == cell && n->parent == parent) return t->node_index[slot] - 1;
+    }
+    if (t->node_count == t->node_cap) {
+        size_t cap = t->node_cap ? t->node_cap * 2 : 1024;
+        Node_t *grown = realloc(t->nodes, cap * sizeof(Node_t));
+        if (!grown) {
+            t->oom = true;
+            return 0;
+        }
+        t->nodes = grown;
+        t->node_cap = cap;
+    }
+    t->nodes[t->node_count] = (Node_t){ cell, parent };
+    t->node_index[slot] = (uint32_t)(t->node_count + 1);
+    return (uint32_t)t->node_count++;
+}
+
+static void add_state(Verify_t *t, uint8_t from, const State_t *s) {
+    ec72_verify_t *v = t->v;
+    v->edge[from][s->pc / 32] |= 1u << (s->pc % 32);
+    if (t->oom) return;
+    if (2 * (t->state_count + 1) > t->state_index_size &&
+        !rehash(&t->state_index, &t->state_index_size, t->state_count, state_hash_at, t)) {
+        t->oom = true;
+        return;
+    }
+    size_t mask = t->state_index_size - 1;
+    size_t slot = state_hash(s) & mask;
+    for (; t->state_index[slot]; slot = (slot + 1) & mask) {
+        if (memcmp(&t->states[t->state_index[slot] - 1], s, sizeof(*s)) == 0) return;
+    }
+    if (t->state_count == t->state_cap) {
+        size_t cap = t->state_cap ? t->state_cap * 2 : 1024;
+        State_t *grown = realloc(t->states, cap * sizeof(State_t));
+        if (!grown) {
+            t->oom = true;
+            return;
+        }
+        t->states = grown;
+        t->state_cap = cap;
+    }
+    t->states[t->state_count] = *s;
+    t->state_index[slot] = (uint32_t)(t->state_count + 1);
+    t->state_count++;
+}
+
+static void record_write(Verify_t *t, uint8_t pc, uint8_t addr, bool stack) {
+    if (t->written_by[addr]) return;
+    t->written_by[addr] = pc + 1;
+    t->stack_write[addr] = stack;
+}
+
+// STORx into the tracked part of the stack must not hit a return address
+static bool store(Verify_t *t, const State_t *s, uint8_t addr) {
+    record_write(t, s->pc, addr, false);
+    if (addr < s->sp) return true;
+    uint32_t node = s->stack;
+    for (int k = addr - s->sp; node && k > 0; k--) node = t->nodes[node].parent;
+    if (node && t->nodes[node].cell != CELL_DATA) return fail(t, "store overwrites a return address", s->pc, -1, s->sp);
+    return true;
+}
+
+// One instruction from state s; false stops the analysis
+static bool step(Verify_t *t, const State_t *s) {
+    ec72_verify_t *v = t->v;
+    uint16_t IR = t->memory[s->pc];
+    uint8_t op = EC72_OPCODE(IR), operand = EC72_OPERAND(IR);
+    bool overflow = s->sp == s->stofr || s->sp == 0;
+    bool underflow = s->sp == s->stufr || s->sp == MEM_SIZE - 1;
+    State_t n = *s;
+    n.pc = (uint8_t)(s->pc + 1);
+
+    v->code[s->pc] |= EC72_VERIFY_CODE;
+    if (s->sp < v->min_sp[s->pc]) v->min_sp[s->pc] = s->sp;
+    if (s->sp > v->max_sp[s->pc]) v->max_sp[s->pc] = s->sp;
+    if (s->sp < v->lowest_sp) v->lowest_sp = s->sp;
+
+    switch (op) {
+        case OP_MOVR: {
+            uint8_t dest = operand >> 4, src = operand & 0x0F;
+            if (dest == REG_SP && src >= REG_A && src < REG_SP)
+                return fail(t, "MOVR loads SP from a register", s->pc, -1, -1);
+            break;
+        }
+        case OP_MOVA: case OP_MOVB: case OP_MOVC: case OP_MOVE:
+        case OP_LDIMA: case OP_LDIMB: case OP_LDIMC: case OP_LDIME:
+        case OP_ADD: case OP_SUB: case OP_OUT: case OP_MOVA_PTRB: case OP_LDID:
+        case OP_SBANK: case OP_SMAR: case OP_FLD: case OP_FST: case OP_BCMP:
+            break;
+        case OP_ADDR: case OP_SUBR: case OP_MUL:
+            if (!ec72_register_name(operand)) return true;      // faults here
+            break;
+        case OP_STORA: case OP_STORB: case OP_STORC: case OP_STORE: case OP_XCHG: case OP_CAS:
+            if (!store(t, s, operand)) return false;
+            break;
+        case OP_STORA_PTRB:
+            return fail(t, "STORA_PTRB writes to an address that is not known statically", s->pc, -1, -1);
+        case OP_BCOPY: case OP_BFILL:
+            return fail(t, "BCOPY/BFILL write to addresses that are not known statically", s->pc, -1, -1);
+        case OP_JMP:
+            n.pc = operand;
+            break;
+        case OP_JMPN: case OP_JMPZ: case OP_JMPO:
+            add_state(t, s->pc, &n);
+            n.pc = operand;
+            break;
+        case OP_CALL:
+            if (overflow) return fail(t, "stack may overflow", s->pc, -1, s->sp);
+            for (uint32_t node = s->stack; node; node = t->nodes[node].parent) {
+                if (t->nodes[node].cell != CELL_DATA && t->nodes[node].cell >> 8 == operand) v->recursion = true;
+            }
+            record_write(t, s->pc, (uint8_t)(s->sp - 1), true);
+            n.sp = (uint8_t)(s->sp - 1);
+            n.stack = push_cell(t, s->stack, CELL_RET(n.pc, operand));
+            n.pc = operand;
+            break;
+        case OP_RET: {
+            if (s->sp == MEM_SIZE - 1) return fail(t, "stack may underflow", s->pc, -1, s->sp);
+            uint32_t cell = s->stack ? t->nodes[s->stack].cell : CELL_DATA;
+            if (cell == CELL_DATA) return fail(t, "RET pops a value that no CALL pushed", s->pc, -1, s->sp);
+            n.pc = (uint8_t)cell;
+            n.sp = (uint8_t)(s->sp + 1);
+            n.stack = t->nodes[s->stack].parent;
+            break;
+        }
+        case OP_PUSH:
+            if (!ec72_register_name(operand)) return true;
+            if (overflow) return fail(t, "stack may overflow", s->pc, -1, s->sp);
+            record_write(t, s->pc, (uint8_t)(s->sp - 1), true);
+            n.sp = (uint8_t)(s->sp - 1);
+            n.stack = push_cell(t, s->stack, CELL_DATA);
+            break;
+        case OP_POP:
+            if (!ec72_register_name(operand)) return true;
+            if (underflow) return fail(t, "stack may underflow", s->pc, -1, s->sp);
+            if (operand == REG_SP) return fail(t, "POP loads SP from the stack", s->pc, -1, -1);
+            n.sp = (uint8_t)(s->sp + 1);
+            n.stack = s->stack ? t->nodes[s->stack].parent : 0;
+            break;
+        case OP_ADDSP:
+            if (underflow) return fail(t, "stack may underflow", s->pc, -1, s->sp);
+            if (s->sp + operand > MEM_SIZE - 1) return fail(t, "ADDSP moves SP past 0xFF", s->pc, -1, s->sp);
+            n.sp = (uint8_t)(s->sp + operand);
+            for (int k = 0; k < operand && n.stack; k++) n.stack = t->nodes[n.stack].parent;
+            break;
+        case OP_SUBSP:
+            if (overflow) return fail(t, "stack may overflow", s->pc, -1, s->sp);
+            if (operand > s->sp) return fail(t, "SUBSP moves SP below 0", s->pc, -1, s->sp);
+            n.sp = (uint8_t)(s->sp - operand);
+            for (int k = 0; k < operand; k++) n.stack = push_cell(t, n.stack, CELL_DATA);
+            break;
+        case OP_SSTOF:
+            n.stofr = operand;
+            break;
+        case OP_SSTUF:
+            n.stufr = n.sp = operand;
+            n.stack = 0;
+            break;
+        default:
+            return true;        // HLT, or an unknown opcode that faults
+    }
+    add_state(t, s->pc, &n);
+    return true;
+}
+
+static bool has_edge(const ec72_verify_t *v, int from, int to) {
+    return (v->edge[from][to / 32] >> (to % 32)) & 1;
+}
+
+// Basic blocks of the reached code: a block starts where control arrives
+// from anywhere but the single instruction in front of it
+static void find_blocks(ec72_verify_t *v) {
+    int preds[EC72_MEM_SIZE] = {0}, succs[EC72_MEM_SIZE] = {0};
+    for (int a = 0; a < MEM_SIZE; a++) {
+        for (int b = 0; b < MEM_SIZE; b++) {
+            if (!has_edge(v, a, b)) continue;
+            preds[b]++;
+            succs[a]++;
+        }
+    }
+    for (int a = 0; a < MEM_SIZE; a++) {
+        if (!(v->code[a] & EC72_VERIFY_CODE)) continue;
+        v->code_words++;
+        uint8_t prev = (uint8_t)(a - 1);
+        if (a == v->start || preds[a] != 1 || !has_edge(v, prev, a) || succs[prev] != 1) {
+            v->code[a] |= EC72_VERIFY_LEADER;
+            v->blocks++;
+        }
+    }
+    for (int a = 0; a < MEM_SIZE; a++) {
+        for (int b = 0; b < MEM_SIZE; b++) {
+            if (has_edge(v, a, b) && (v->code[b] & EC72_VERIFY_LEADER)) v->edges++;
+        }
+    }
+}
+
+bool ec72_verify(const ec72_cpu_t *cpu, ec72_verify_t *v) {
+    memset(v, 0, sizeof(*v));
+    memset(v->min_sp, 0xFF, sizeof(v->min_sp));
+    v->address = v->target = v->sp = -1;
+    v->start = cpu->PC;
+    v->lowest_sp = cpu->SP;
+
+    Verify_t t = { .v = v, .memory = cpu->memory };
+    push_cell(&t, 0, CELL_DATA);        // node 0: the unknown stack above SP
+    State_t start = { cpu->PC, cpu->SP, cpu->STOFR, cpu->STUFR, 0 };
+    if (!t.oom) {
+        add_state(&t, cpu->PC, &start);
+        v->edge[cpu->PC][cpu->PC / 32] &= ~(1u << (cpu->PC % 32));
+    }
+    bool ok = !t.oom;
+    for (size_t i = 0; ok && i < t.state_count; i++) {
+        if (t.state_count > EC72_VERIFY_MAX_STATES) {
+            ok = fail(&t, "too many paths to analyze", -1, -1, -1);
+            break;
+        }
+        State_t s = t.states[i];
+        ok = step(&t, &s) && !t.oom;
+    }
+    if (t.oom) ok = fail(&t, "out of memory", -1, -1, -1);
+    v->states = t.state_count;
+
+    // Writes are only known once all code has been found
+    for (int a = 0; ok && a < MEM_SIZE; a++) {
+        if ((v->code[a] & EC72_VERIFY_CODE) && t.written_by[a]) {
+            ok = fail(&t, t.stack_write[a] ? "stack grows into code" : "store writes code", t.written_by[a] - 1, a, -1);
+        }
+    }
+    find_blocks(v);
+
+    free(t.nodes);
+    free(t.node_index);
+    free(t.states);
+    free(t.state_index);
+    v->ok = ok;
+    return ok;
+}
+
+bool ec72_cpu_verify(ec72_cpu_t *cpu, ec72_verify_t *v) {
+    cpu->verified = ec72_verify(cpu, v);
+    return cpu->verified;
+}
+
+void ec72_verify_print_result(const ec72_verify_t *v, const ec72_symtab_t *syms, FILE *f) {
+    if (v->ok) {
+        fprintf(f, "%sVerified: stack stays within STOFR/STUFR, every RET returns to its CALL, no store hits code%s\n",
+                GREEN, RESET);
+        return;
+    }
+    char where[EC72_SYM_NAME_LEN + 8], target[EC72_SYM_NAME_LEN + 8];
+    fprintf(f, "%sNot verified: %s", YELLOW, v->reason);
+    if (v->address >= 0) fprintf(f, " at %s", ec72_symtab_format(syms, (uint8_t)v->address, where, sizeof(where)));
+    if (v->target >= 0) fprintf(f, " (writes %s)", ec72_symtab_format(syms, (uint8_t)v->target, target, sizeof(target)));
+    if (v->sp >= 0) fprintf(f, " with SP 0x%02X", v->sp);
+    if (v->recursion && strstr(v->reason, "overflow")) fprintf(f, "; the program recurses, so its depth is not bounded statically");
+    fprintf(f, "%s\n", RESET);
+}
+
+void ec72_verify_report(const ec72_verify_t *v, const ec72_cpu_t *cpu, const ec72_symtab_t *syms, FILE *f) {
+    char a[EC72_SYM_NAME_LEN + 8], b[EC72_SYM_NAME_LEN + 8];
+    fprintf(f, "%zu words reached from %s, %zu basic blocks, %zu edges, %zu states\n",
+            v->code_words, ec72_symtab_format(syms, v->start, a, sizeof(a)), v->blocks, v->edges, v->states);
+    fprintf(f, "SP 0x%02X at the start, lowest 0x%02X (%d words deep)%s\n\n",
+            cpu->SP, v->lowest_sp, cpu->SP - v->lowest_sp, v->recursion ? ", recursive" : "");
+
+    for (int start = 0; start < MEM_SIZE; start++) {
+        if (!(v->code[start] & EC72_VERIFY_LEADER)) continue;
+        int end = start;
+        while (end + 1 < MEM_SIZE && (v->code[end + 1] & (EC72_VERIFY_CODE | EC72_VERIFY_LEADER)) == EC72_VERIFY_CODE) end++;
+        uint8_t lo = 0xFF, hi = 0;
+        for (int k = start; k <= end; k++) {
+            if (v->min_sp[k] < lo) lo = v->min_sp[k];
+            if (v->max_sp[k] > hi) hi = v->max_sp[k];
+        }
+        fprintf(f, "0x%02X-0x%02X  %-20s SP 0x%02X-0x%02X  ->", start, end,
+                ec72_symtab_format(syms, (uint8_t)start, a, sizeof(a)), lo, hi);
+        bool any = false;
+        for (int t = 0; t < MEM_SIZE; t++) {
+            if (!has_edge(v, end, t)) continue;
+            fprintf(f, " %s", ec72_symtab_format(syms, (uint8_t)t, b, sizeof(b)));
+            any = true;
+        }
+        fprintf(f, "%s\n", any ? "" : " (stops)");
+        start = end;
+    }
+    fprintf(f, "\n");
+    ec72_verify_print_result(v, syms, f);
+}
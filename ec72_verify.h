@@ -0,0 +1,57 @@
+//Copyright © Martin H. Sharp; August 2025
+// Static verifier: follows every path from the current CPU state with SP,
+// STOFR, STUFR and the return addresses on the stack tracked exactly
+// (register values and branch conditions are not), builds the control flow
+// graph of the code it reaches and checks that
+//   - no CALL/PUSH/POP/RET/ADDSP/SUBSP can fault on the stack bounds,
+//   - every RET pops the address its CALL pushed,
+//   - no store or stack write lands on reachable code.
+// If all of that holds, the engines may run the program without stack
+// checks and without invalidating decoded code on stores (verified mode).
+#ifndef EC72_VERIFY_H
+#define EC72_VERIFY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "ec72_cpu.h"
+#include "ec72_sym.h"
+
+#define EC72_VERIFY_MAX_STATES (1u << 20)
+
+// Code map bits (same meaning as in ec72_image.h)
+#define EC72_VERIFY_CODE   0x01
+#define EC72_VERIFY_LEADER 0x02
+
+typedef struct {
+    bool ok;
+    const char *reason;         // why the proof failed, NULL if ok
+    int address;                // instruction the reason is about, -1 if none
+    int target;                 // code address it would write, -1 if none
+    int sp;                     // SP on that path, -1 if none
+
+    uint8_t code[EC72_MEM_SIZE];        // EC72_VERIFY_* bits per address
+    uint8_t min_sp[EC72_MEM_SIZE];      // lowest SP seen before each instruction
+    uint8_t max_sp[EC72_MEM_SIZE];
+    uint32_t edge[EC72_MEM_SIZE][EC72_MEM_SIZE / 32];  // bit: control can go from [a] to b
+    uint8_t start;              // PC the analysis started at
+    size_t code_words, blocks, edges;
+    size_t states;              // (PC, SP, STOFR, STUFR, stack) states visited
+    uint8_t lowest_sp;          // deepest the stack gets on any path
+    bool recursion;             // a function was reached from itself
+} ec72_verify_t;
+
+// Analyzes the program from the CPU's current state. Returns v->ok.
+bool ec72_verify(const ec72_cpu_t *cpu, ec72_verify_t *v);
+
+// Analyzes and, if the proof holds, puts cpu into verified mode. The mode
+// ends with the next reset, ec72_cpu_invalidate() or snapshot restore.
+bool ec72_cpu_verify(ec72_cpu_t *cpu, ec72_verify_t *v);
+
+// One line: verified, or the reason it is not
+void ec72_verify_print_result(const ec72_verify_t *v, const ec72_symtab_t *syms, FILE *f);
+// Summary, then every basic block with its successors and SP range
+void ec72_verify_report(const ec72_verify_t *v, const ec72_cpu_t *cpu, const ec72_symtab_t *syms, FILE *f);
+
+#endif
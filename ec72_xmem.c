@@ -0,0 +1,119 @@
+//Copyright © Martin H. Sharp; August 2025
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_xmem.h"
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+void ec72_xmem_init(ec72_xmem_t *x) {
+    memset(x, 0, sizeof(*x));
+}
+
+static void unmap_file(ec72_xmem_t *x) {
+    if (!x->file) return;
+#ifndef _WIN32
+    if (x->file_mapped) munmap((void *)x->file, x->file_size);
+    else free((void *)x->file);
+#else
+    free((void *)x->file);
+#endif
+    x->file = NULL;
+    x->file_size = 0;
+    x->file_words = 0;
+}
+
+void ec72_xmem_free(ec72_xmem_t *x) {
+    ec72_xmem_reset(x);
+    unmap_file(x);
+}
+
+void ec72_xmem_reset(ec72_xmem_t *x) {
+    for (size_t p = 0; p < EC72_XMEM_PAGES && x->page_count; p++) {
+        if (!x->pages[p]) continue;
+        free(x->pages[p]);
+        x->pages[p] = NULL;
+        x->page_count--;
+    }
+}
+
+bool ec72_xmem_map_file(ec72_xmem_t *x, const char *path, ec72_xmem_layout_t layout) {
+    unmap_file(x);
+    x->layout = layout;
+    size_t limit = layout == EC72_XMEM_FILE_BYTES ? EC72_XMEM_WORDS : 2 * (size_t)EC72_XMEM_WORDS;
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size > limit) size = limit;
+    if (size == 0) {
+        close(fd);
+        return true;
+    }
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(path);
+        return false;
+    }
+    // Programs mostly stream through the data front to back
+    madvise(map, size, MADV_SEQUENTIAL);
+    x->file_mapped = true;
+#else
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long end = ftell(f);
+    rewind(f);
+    size_t size = end > 0 ? (size_t)end : 0;
+    if (size > limit) size = limit;
+    uint8_t *map = malloc(size ? size : 1);
+    if (!map) {
+        fclose(f);
+        fprintf(stderr, "%s: out of memory\n", path);
+        return false;
+    }
+    size = fread(map, 1, size, f);
+    fclose(f);
+    x->file_mapped = false;
+#endif
+    x->file = map;
+    x->file_size = size;
+    x->file_words = (uint32_t)(layout == EC72_XMEM_FILE_BYTES ? size : size / 2);
+    return true;
+}
+
+uint16_t ec72_xmem_file_word(const ec72_xmem_t *x, uint32_t addr) {
+    if (addr >= x->file_words) return 0;
+    if (x->layout == EC72_XMEM_FILE_BYTES) return x->file[addr];
+    return (uint16_t)(x->file[2 * addr] | (x->file[2 * addr + 1] << 8));
+}
+
+uint16_t *ec72_xmem_page(ec72_xmem_t *x, uint32_t addr) {
+    uint32_t first = addr & ~(EC72_XMEM_PAGE_WORDS - 1);
+    uint16_t *page = malloc(EC72_XMEM_PAGE_WORDS * sizeof(uint16_t));
+    if (!page) return NULL;
+    for (uint32_t i = 0; i < EC72_XMEM_PAGE_WORDS; i++) page[i] = ec72_xmem_file_word(x, first + i);
+    x->pages[addr >> EC72_XMEM_PAGE_BITS] = page;
+    x->page_count++;
+    return page;
+}
@@ -0,0 +1,120 @@
+//Copyright © Martin H. Sharp; August 2025
+// Extended memory: a far address space of EC72_XMEM_WORDS 16-bit words next
+// to the 256 words of main memory, reached only through FLD and FST. The
+// far address is BANK:MAR (8 + 16 bits, set with SBANK and SMAR); FLD/FST
+// add their operand to it after the access, carrying from MAR into BANK, so
+// a loop can walk a data set of any size one word at a time.
+//
+// Pages of EC72_XMEM_PAGE_WORDS words are allocated on the first store
+// into them. A data file can be mapped under the whole space (mmap, so the
+// host reads it page by page as the program gets to it): pages not stored
+// to read from the file, the rest read 0. Stores never reach the file.
+//
+// ec72_cpu_reset() sets BANK and MAR to 0 but leaves extended memory as it
+// is, like the input of the I/O bus; ec72_xmem_reset() clears it.
+//
+// Main memory, instruction fetch, the stack and the I/O bus are not
+// affected: a program that does not use FLD/FST runs exactly as before.
+// Without extended memory attached FLD reads 0 and FST is dropped.
+//
+// Snapshots, checkpoints and the journal keep BANK and MAR but not the
+// contents of extended memory.
+#ifndef EC72_XMEM_H
+#define EC72_XMEM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "ec72_cpu.h"
+
+#define EC72_XMEM_BITS       24
+#define EC72_XMEM_WORDS      (1u << EC72_XMEM_BITS)
+#define EC72_XMEM_PAGE_BITS  12
+#define EC72_XMEM_PAGE_WORDS (1u << EC72_XMEM_PAGE_BITS)
+#define EC72_XMEM_PAGES      (EC72_XMEM_WORDS / EC72_XMEM_PAGE_WORDS)
+
+// How a mapped file fills the words
+typedef enum {
+    EC72_XMEM_FILE_WORDS = 0,   // two bytes per word, little endian (like a .bin)
+    EC72_XMEM_FILE_BYTES        // one byte per word, for text and other byte data
+} ec72_xmem_layout_t;
+
+typedef struct ec72_xmem {
+    uint16_t *pages[EC72_XMEM_PAGES];   // stored-to pages, NULL: file or 0
+    size_t page_count;
+
+    // Mapped file
+    const uint8_t *file;
+    size_t file_size;
+    uint32_t file_words;                // words the file covers
+    ec72_xmem_layout_t layout;
+    bool file_mapped;                   // file is an mmap, else a heap copy
+
+    uint64_t loads, stores;
+    uint64_t lost_stores;               // a page could not be allocated
+} ec72_xmem_t;
+
+void ec72_xmem_init(ec72_xmem_t *x);
+void ec72_xmem_free(ec72_xmem_t *x);
+
+// Maps path under the far address space, replacing an earlier file; false
+// (perror) if it cannot be opened or mapped. Stored-to pages stay.
+bool ec72_xmem_map_file(ec72_xmem_t *x, const char *path, ec72_xmem_layout_t layout);
+// Drops every stored-to page: far memory is the file again (or 0)
+void ec72_xmem_reset(ec72_xmem_t *x);
+
+// Word at a far address that has no page of its own
+uint16_t ec72_xmem_file_word(const ec72_xmem_t *x, uint32_t addr);
+// Allocates the page of addr, filled from the file; NULL if out of memory
+uint16_t *ec72_xmem_page(ec72_xmem_t *x, uint32_t addr);
+
+static inline uint16_t ec72_xmem_read(ec72_xmem_t *x, uint32_t addr) {
+    addr &= EC72_XMEM_WORDS - 1;
+    x->loads++;
+    const uint16_t *page = x->pages[addr >> EC72_XMEM_PAGE_BITS];
+    return page ? page[addr & (EC72_XMEM_PAGE_WORDS - 1)] : ec72_xmem_file_word(x, addr);
+}
+
+static inline void ec72_xmem_write(ec72_xmem_t *x, uint32_t addr, uint16_t value) {
+    addr &= EC72_XMEM_WORDS - 1;
+    x->stores++;
+    uint16_t *page = x->pages[addr >> EC72_XMEM_PAGE_BITS];
+    if (!page && !(page = ec72_xmem_page(x, addr))) {
+        x->lost_stores++;
+        return;
+    }
+    page[addr & (EC72_XMEM_PAGE_WORDS - 1)] = value;
+}
+
+// The far address FLD/FST use next
+static inline uint32_t ec72_far_addr(const ec72_cpu_t *cpu) {
+    return (uint32_t)cpu->BANK << 16 | cpu->MAR;
+}
+
+// After an FLD/FST: BANK:MAR += step
+static inline void ec72_far_advance(ec72_cpu_t *cpu, uint8_t step) {
+    uint32_t a = ec72_far_addr(cpu) + step;
+    cpu->MAR = (uint16_t)a;
+    cpu->BANK = (uint8_t)(a >> 16);
+}
+
+// FLD: the word at the far address (0 without extended memory), then step
+static inline uint8_t ec72_far_load(ec72_cpu_t *cpu, uint8_t step) {
+    uint8_t v = cpu->xmem ? (uint8_t)ec72_xmem_read(cpu->xmem, ec72_far_addr(cpu)) : 0;
+    ec72_far_advance(cpu, step);
+    return v;
+}
+
+// FST
+static inline void ec72_far_store(ec72_cpu_t *cpu, uint8_t value, uint8_t step) {
+    if (cpu->xmem) ec72_xmem_write(cpu->xmem, ec72_far_addr(cpu), value);
+    ec72_far_advance(cpu, step);
+}
+
+// NULL detaches
+static inline void ec72_cpu_attach_xmem(ec72_cpu_t *cpu, ec72_xmem_t *x) {
+    cpu->xmem = x;
+}
+
+#endif
@@ -0,0 +1,308 @@
+//Copyright © Martin H. Sharp; August 2025
+// EC72AOT: ahead-of-time translator from an assembled EC72 image to C.
+//
+// Every statically reachable address becomes a label, JMP*/CALL targets are
+// direct gotos and RET dispatches through a computed-goto table. Registers
+// and flags are C locals, so gcc drops flag updates nobody reads. The
+// generated program links against libec72.a: any store that would hit a
+// translated address, every fault and every jump into untranslated memory
+// hand the machine state over to the reference interpreter, which finishes
+// the run. Observable OUT/HLT/error output matches EC72CPU.
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_isa.h"
+#include "ec72_image.h"
+
+#define RED        "\x1b[31m"
+#define GREEN      "\x1b[32m"
+#define YELLOW     "\x1b[33m"
+#define RESETCOLOR "\x1b[0m"
+
+#define MEM_SIZE EC72_MEM_SIZE
+
+static uint16_t memory[MEM_SIZE];
+static bool is_code[MEM_SIZE];
+static ec72_image_t img;       // entry point and stack bounds
+
+static const char *reg_name(uint8_t code) {
+    switch (code) {
+        case REG_A: return "RA";
+        case REG_B: return "RB";
+        case REG_C: return "RC";
+        case REG_E: return "RE";
+        case REG_SP: return "SP";
+        default: return NULL;
+    }
+}
+
+static bool known_opcode(uint8_t op) {
+    return (op >= OP_MOVR && op <= OP_MUL) || op == OP_HLT;
+}
+
+// Worklist over static successors, starting at the reset vector
+static int find_code(void) {
+    uint8_t work[MEM_SIZE];
+    int top = 0, count = 0;
+    work[top++] = img.entry;
+    is_code[img.entry] = true;
+    while (top > 0) {
+        uint8_t pc = work[--top];
+        count++;
+        uint8_t op = EC72_OPCODE(memory[pc]), operand = EC72_OPERAND(memory[pc]);
+        uint8_t next = (uint8_t)(pc + 1);
+        uint8_t succ[2];
+        int n = 0;
+        if (!known_opcode(op)) continue;
+        switch (op) {
+            case OP_JMP: succ[n++] = operand; break;
+            case OP_JMPN: case OP_JMPZ: case OP_JMPO: case OP_CALL:
+                succ[n++] = operand;
+                succ[n++] = next;       // fall-through / return site
+                break;
+            case OP_RET: case OP_HLT: break;
+            default: succ[n++] = next; break;
+        }
+        for (int i = 0; i < n; i++) {
+            if (!is_code[succ[i]]) {
+                is_code[succ[i]] = true;
+                work[top++] = succ[i];
+            }
+        }
+    }
+    return count;
+}
+
+static void emit_alu(FILE *f, const char *op, const char *value) {
+    fprintf(f, "    { int r = RA %s %s; ZF = (r == 0); NF = (r < 0); OF = (r > 255 || r < 0); RA = (uint8_t)r; }\n", op, value);
+}
+
+static int emit_instruction(FILE *f, uint8_t pc) {
+    uint16_t IR = memory[pc];
+    uint8_t op = EC72_OPCODE(IR), operand = EC72_OPERAND(IR);
+    uint8_t next = (uint8_t)(pc + 1);
+    int code_stores = 0;
+
+    fprintf(f, "L_%02X: /* %04X */\n", pc, IR);
+    switch (op) {
+        case OP_MOVR: {
+            const char *d = reg_name((operand >> 4) & 0x0F), *s = reg_name(operand & 0x0F);
+            if (d && s) fprintf(f, "    %s = %s;\n", d, s);
+            break;
+        }
+        case OP_MOVA: fprintf(f, "    RA = (uint8_t)memory[0x%02X];\n", operand); break;
+        case OP_MOVB: fprintf(f, "    RB = (uint8_t)memory[0x%02X];\n", operand); break;
+        case OP_MOVC: fprintf(f, "    RC = (uint8_t)memory[0x%02X];\n", operand); break;
+        case OP_MOVE: fprintf(f, "    RE = (uint8_t)memory[0x%02X];\n", operand); break;
+        case OP_STORA: case OP_STORB: case OP_STORC: case OP_STORE: {
+            static const char *src[] = { "RA", "RB", "RC", "RE" };
+            if (is_code[operand]) {
+                fprintf(stderr, "%sWarning: instruction at 0x%02X stores into code at 0x%02X; "
+                        "falls back to the interpreter there%s\n", YELLOW, pc, operand, RESETCOLOR);
+                fprintf(f, "    FALLBACK(0x%02X);\n", pc);
+                code_stores++;
+            } else {
+                fprintf(f, "    memory[0x%02X] = %s;\n", operand, src[op - OP_STORA]);
+            }
+            break;
+        }
+        case OP_LDIMA: fprintf(f, "    RA = 0x%02X;\n", operand); break;
+        case OP_LDIMB: fprintf(f, "    RB = 0x%02X;\n", operand); break;
+        case OP_LDIMC: fprintf(f, "    RC = 0x%02X;\n", operand); break;
+        case OP_LDIME: fprintf(f, "    RE = 0x%02X;\n", operand); break;
+        case OP_JMPN: fprintf(f, "    if (NF) goto L_%02X;\n", operand); break;
+        case OP_JMPZ: fprintf(f, "    if (ZF) goto L_%02X;\n", operand); break;
+        case OP_JMPO: fprintf(f, "    if (OF) goto L_%02X;\n", operand); break;
+        case OP_JMP: fprintf(f, "    goto L_%02X;\n", operand); break;
+        case OP_ADD: { char v[8]; sprintf(v, "%u", operand); emit_alu(f, "+", v); break; }
+        case OP_SUB: { char v[8]; sprintf(v, "%u", operand); emit_alu(f, "-", v); break; }
+        case OP_ADDR: case OP_SUBR:
+            if (!reg_name(operand)) fprintf(f, "    FALLBACK(0x%02X);\n", pc);
+            else emit_alu(f, op == OP_ADDR ? "+" : "-", reg_name(operand));
+            break;
+        case OP_OUT: fprintf(f, "    printf(\"%%sOUT: %%d%%s\\n\", GREEN, RA, RESET);\n"); break;
+        case OP_CALL:
+            fprintf(f, "    if ((SP == STOFR) || (SP == 0) || is_code[(uint8_t)(SP - 1)]) FALLBACK(0x%02X);\n", pc);
+            fprintf(f, "    memory[--SP] = 0x%02X;\n", next);
+            fprintf(f, "    goto L_%02X;\n", operand);
+            break;
+        case OP_RET:
+            fprintf(f, "    if (SP == %d) FALLBACK(0x%02X);\n", MEM_SIZE - 1, pc);
+            fprintf(f, "    target = (uint8_t)memory[SP++];\n");
+            fprintf(f, "    goto *ret_dispatch[target];\n");
+            break;
+        case OP_MOVA_PTRB: fprintf(f, "    RA = (uint8_t)memory[RB];\n"); break;
+        case OP_STORA_PTRB:
+            fprintf(f, "    if (is_code[RB]) FALLBACK(0x%02X);\n", pc);
+            fprintf(f, "    memory[RB] = RA;\n");
+            break;
+        case OP_PUSH:
+            if (!reg_name(operand)) { fprintf(f, "    FALLBACK(0x%02X);\n", pc); break; }
+            fprintf(f, "    if ((SP == STOFR) || (SP == 0) || is_code[(uint8_t)(SP - 1)]) FALLBACK(0x%02X);\n", pc);
+            fprintf(f, "    { uint8_t v = %s; memory[--SP] = v; }\n", reg_name(operand));
+            break;
+        case OP_POP:
+            if (!reg_name(operand)) { fprintf(f, "    FALLBACK(0x%02X);\n", pc); break; }
+            fprintf(f, "    if ((SP == STUFR) || (SP == %d)) FALLBACK(0x%02X);\n", MEM_SIZE - 1, pc);
+            fprintf(f, "    { uint8_t v = (uint8_t)memory[SP++]; %s = v; }\n", reg_name(operand));
+            break;
+        case OP_ADDSP:
+            fprintf(f, "    if ((SP == STUFR) || (SP == %d)) FALLBACK(0x%02X);\n", MEM_SIZE - 1, pc);
+            fprintf(f, "    SP += 0x%02X;\n", operand);
+            break;
+        case OP_SUBSP:
+            fprintf(f, "    if ((SP == STOFR) || (SP == 0)) FALLBACK(0x%02X);\n", pc);
+            fprintf(f, "    SP -= 0x%02X;\n", operand);
+            break;
+        case OP_SSTOF: fprintf(f, "    STOFR = 0x%02X;\n", operand); break;
+        case OP_SSTUF: fprintf(f, "    STUFR = 0x%02X; SP = 0x%02X;\n", operand, operand); break;
+        // A native program is a single core
+        case OP_XCHG: case OP_CAS:
+            if (is_code[operand]) {
+                fprintf(f, "    FALLBACK(0x%02X);\n", pc);
+                code_stores++;
+            } else if (op == OP_XCHG) {
+                fprintf(f, "    { uint8_t v = (uint8_t)memory[0x%02X]; memory[0x%02X] = RA; RA = v; }\n", operand, operand);
+            } else {
+                fprintf(f, "    { uint8_t v = (uint8_t)memory[0x%02X]; ZF = (v == RA); NF = OF = false;\n"
+                           "      if (ZF) memory[0x%02X] = RB; else RA = v; }\n", operand, operand);
+            }
+            break;
+        case OP_LDID: fprintf(f, "    RA = 0; RB = 1;\n"); break;
+        // BANK:MAR live in the context; no extended memory is attached, so
+        // FLD reads 0 and FST is dropped as in EC72CPU without -xmem
+        case OP_SBANK: fprintf(f, "    cpu.BANK = 0x%02X;\n", operand); break;
+        case OP_SMAR: fprintf(f, "    cpu.MAR = (uint16_t)(RB << 8 | RC);\n"); break;
+        case OP_FLD: fprintf(f, "    RA = ec72_far_load(&cpu, 0x%02X);\n", operand); break;
+        case OP_FST: fprintf(f, "    ec72_far_store(&cpu, RA, 0x%02X);\n", operand); break;
+        case OP_BCOPY:
+            fprintf(f, "    if (ec72_block_stack_check(RB, RE, SP, STOFR, STUFR) != EC72_OK || code_in(RB, RE)) FALLBACK(0x%02X);\n", pc);
+            fprintf(f, "    ec72_block_copy(memory, RB, RC, RE);\n");
+            break;
+        case OP_BFILL:
+            fprintf(f, "    if (ec72_block_stack_check(RB, RE, SP, STOFR, STUFR) != EC72_OK || code_in(RB, RE)) FALLBACK(0x%02X);\n", pc);
+            fprintf(f, "    ec72_block_fill(memory, RB, RA, RE);\n");
+            break;
+        case OP_BCMP:
+            fprintf(f, "    { uint8_t at; int r = ec72_block_compare(memory, RB, RC, RE, &at);\n"
+                       "      ZF = (r == 0); NF = OF = (r < 0); RA = at; }\n");
+            break;
+        case OP_MUL:
+            if (!reg_name(operand)) { fprintf(f, "    FALLBACK(0x%02X);\n", pc); break; }
+            fprintf(f, "    { int r = RA * %s; ZF = (r == 0); NF = false; OF = (r > 255); RA = (uint8_t)r; RE = (uint8_t)(r >> 8); }\n",
+                    reg_name(operand));
+            break;
+        case OP_HLT: fprintf(f, "    pc = 0x%02X;\n    goto halted;\n", next); break;
+        default: fprintf(f, "    FALLBACK(0x%02X);\n", pc); break;   // interpreter raises the fault
+    }
+    // Fall-through into the next address (wrapping like PC does)
+    if (next == 0 && known_opcode(op) && op != OP_JMP && op != OP_RET && op != OP_HLT)
+        fprintf(f, "    goto L_00;\n");
+    return code_stores;
+}
+
+static int emit_program(FILE *f, const char *src, size_t words) {
+    int code_stores = 0;
+    fprintf(f, "// Generated by EC72AOT from %s; do not edit\n", src);
+    fprintf(f, "#include <stdio.h>\n#include <stdint.h>\n#include <stdbool.h>\n#include \"ec72_cpu.h\"\n#include \"ec72_xmem.h\"\n#include \"ec72_block.h\"\n\n");
+    fprintf(f, "#define GREEN \"\\x1b[32m\"\n#define RESET \"\\x1b[0m\"\n\n");
+
+    fprintf(f, "static const uint16_t image[%zu] = {", words ? words : 1);
+    for (size_t i = 0; i < (words ? words : 1); i++)
+        fprintf(f, "%s0x%04X,", i % 8 ? " " : "\n    ", memory[i]);
+    fprintf(f, "\n};\n\n");
+
+    fprintf(f, "// Addresses translated below; stores into them leave native code\nstatic const bool is_code[256] = {");
+    for (int i = 0; i < MEM_SIZE; i++) fprintf(f, "%s%d,", i % 32 ? "" : "\n    ", is_code[i]);
+    fprintf(f, "\n};\n\n");
+
+    fprintf(f, "// BCOPY/BFILL of count words at a would store into translated code\n"
+               "static inline bool code_in(uint8_t a, uint8_t count) {\n"
+               "    for (int i = 0; i < count; i++)\n"
+               "        if (is_code[(uint8_t)(a + i)]) return true;\n"
+               "    return false;\n}\n\n");
+
+    fprintf(f, "static void print_out(void *user, uint8_t value) {\n"
+               "    (void)user;\n"
+               "    printf(\"%%sOUT: %%d%%s\\n\", GREEN, value, RESET);\n}\n\n");
+
+    fprintf(f, "int main(void) {\n"
+               "    static ec72_cpu_t cpu;\n"
+               "    ec72_cpu_init(&cpu);\n"
+               "    ec72_cpu_set_output(&cpu, print_out, NULL);\n"
+               "    ec72_cpu_load_words(&cpu, image, %zu);\n"
+               "    ec72_cpu_set_start(&cpu, 0x%02X, 0x%02X, 0x%02X);\n\n"
+               "    uint16_t *memory = cpu.memory;\n"
+               "    uint8_t RA = 0, RB = 0, RC = 0, RE = 0;\n"
+               "    uint8_t SP = cpu.SP, STOFR = cpu.STOFR, STUFR = cpu.STUFR;\n"
+               "    bool ZF = false, NF = false, OF = false;\n"
+               "    uint8_t pc = 0x%02X, target = 0;\n"
+               "    (void)target;\n\n", words, img.entry, img.stofr, img.stufr, img.entry);
+
+    fprintf(f, "    static void *const ret_dispatch[256] = {");
+    for (int i = 0; i < MEM_SIZE; i++) {
+        if (is_code[i]) fprintf(f, "%s&&L_%02X,", i % 8 ? " " : "\n        ", i);
+        else fprintf(f, "%s&&dynamic,", i % 8 ? " " : "\n        ");
+    }
+    fprintf(f, "\n    };\n\n");
+
+    fprintf(f, "#define SYNC() do { cpu.RA = RA; cpu.RB = RB; cpu.RC = RC; cpu.RE = RE; cpu.SP = SP; \\\n"
+               "        cpu.STOFR = STOFR; cpu.STUFR = STUFR; cpu.ZF = ZF; cpu.NF = NF; cpu.OF = OF; cpu.PC = pc; } while (0)\n"
+               "#define FALLBACK(at) do { pc = (at); goto fallback; } while (0)\n\n");
+
+    if (img.entry) fprintf(f, "    goto L_%02X;\n", img.entry);
+    for (int pc = 0; pc < MEM_SIZE; pc++) {
+        if (is_code[pc]) code_stores += emit_instruction(f, (uint8_t)pc);
+    }
+
+    fprintf(f, "\ndynamic:\n"
+               "    pc = target;\n"
+               "fallback:\n"
+               "    SYNC();\n"
+               "    ec72_cpu_invalidate(&cpu);\n"
+               "    ec72_cpu_run(&cpu, EC72_RUN_FOREVER);\n"
+               "    goto done;\n"
+               "halted:\n"
+               "    SYNC();\n"
+               "    cpu.IR = memory[(uint8_t)(pc - 1)];\n"
+               "    cpu.status = EC72_HALTED;\n"
+               "done:\n"
+               "    ec72_cpu_print_status(&cpu, stdout);\n"
+               "    return cpu.status == EC72_HALTED ? 0 : 1;\n"
+               "}\n");
+    return code_stores;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s program.bin|program.ec72img output.c\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Raw .bin or image file
+    if (!ec72_image_load(&img, argv[1])) {
+        if (img.error) fprintf(stderr, "%sError: %s: %s%s\n", RED, argv[1], img.error, RESETCOLOR);
+        else perror("Error opening input file");
+        return EXIT_FAILURE;
+    }
+    size_t words = img.word_count;
+    memcpy(memory, img.words, words * sizeof(uint16_t));
+
+    int reachable = find_code();
+
+    FILE *fout = fopen(argv[2], "w");
+    if (!fout) {
+        perror("Error opening output file");
+        return EXIT_FAILURE;
+    }
+    int code_stores = emit_program(fout, argv[1], words);
+    fclose(fout);
+
+    printf("%sTranslated %d reachable instructions of %zu words.%s\n", GREEN, reachable, words, RESETCOLOR);
+    if (code_stores)
+        printf("%s%d instruction(s) write into the code range and run on the interpreter.%s\n",
+               YELLOW, code_stores, RESETCOLOR);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,481 @@
+//Copyright © Martin H. Sharp; August 2025
+// EC72FUZZ: coverage-guided fuzzer for EC72 programs and differential tester
+// for the engines (ec72_fuzz.h), on all cores, in one process.
+//
+// Program mode mutates a range of the initial memory and/or the bytes the
+// program reads from the I/O bus, keeps every input that reaches new edges
+// and reports faults by status and PC. Between runs a context is reset in
+// place (the image copied back into its memory), nothing is forked.
+//
+// -diff runs random programs on the switch interpreter and on the other
+// engines and reports any difference in registers, flags, memory or output.
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "ec72_cpu.h"
+#include "ec72_asm.h"
+#include "ec72_image.h"
+#include "ec72_bus.h"
+#include "ec72_fuzz.h"
+
+#define RED     "\x1b[31m"
+#define GREEN   "\x1b[32m"
+#define YELLOW  "\x1b[33m"
+#define CYAN    "\x1b[36m"
+#define RESET   "\x1b[0m"
+
+#define DEFAULT_BUDGET      100000ULL
+#define DEFAULT_DIFF_BUDGET 10000ULL
+#define DEFAULT_MAX_LEN     256
+#define PARENT_RUNS         32          // mutations of one corpus entry before picking another
+#define MAX_ENGINES         3
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+} Entry_t;
+
+typedef struct {
+    // Program mode
+    ec72_image_t image;
+    ec72_fuzz_layout_t layout;
+    uint8_t bus_base;
+
+    // -diff
+    bool diff;
+    ec72_engine_t engines[MAX_ENGINES];
+    int engine_count;
+
+    uint64_t budget;
+    uint64_t max_execs;             // 0: no limit
+    uint64_t seed;
+    const char *out_dir;            // NULL: nothing is saved
+
+    pthread_mutex_t lock;           // corpus, files and output
+    Entry_t *corpus;
+    size_t corpus_count, corpus_cap;
+    ec72_cov_map_t map;
+    uint8_t crash_seen[(EC72_ERR_IO + 1) * EC72_MEM_SIZE];
+
+    uint64_t execs, crashes, unique_crashes, hangs, differences;
+} Fuzz_t;
+
+static volatile sig_atomic_t stop_requested;
+
+static void on_interrupt(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+static bool stopping(Fuzz_t *f) {
+    return stop_requested || (f->max_execs && __atomic_load_n(&f->execs, __ATOMIC_RELAXED) >= f->max_execs);
+}
+
+static bool save_file(const char *path, const uint8_t *data, size_t len) {
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        perror("Error writing fuzzer output");
+        return false;
+    }
+    fwrite(data, 1, len, out);
+    fclose(out);
+    return true;
+}
+
+// Caller holds f->lock
+static bool corpus_add(Fuzz_t *f, const uint8_t *data, size_t len) {
+    if (f->corpus_count == f->corpus_cap) {
+        size_t cap = f->corpus_cap ? f->corpus_cap * 2 : 64;
+        Entry_t *grown = realloc(f->corpus, cap * sizeof(Entry_t));
+        if (!grown) return false;
+        f->corpus = grown;
+        f->corpus_cap = cap;
+    }
+    Entry_t *e = &f->corpus[f->corpus_count];
+    e->data = malloc(len ? len : 1);
+    if (!e->data) return false;
+    memcpy(e->data, data, len);
+    e->len = len;
+    if (f->out_dir) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/queue-%06zu.in", f->out_dir, f->corpus_count);
+        save_file(path, data, len);
+    }
+    f->corpus_count++;
+    return true;
+}
+
+static void pick(Fuzz_t *f, uint8_t *buf, size_t *len, uint64_t *rng) {
+    pthread_mutex_lock(&f->lock);
+    Entry_t *e = &f->corpus[ec72_fuzz_below(rng, (uint32_t)f->corpus_count)];
+    memcpy(buf, e->data, e->len);
+    *len = e->len;
+    pthread_mutex_unlock(&f->lock);
+}
+
+static void report_crash(Fuzz_t *f, const ec72_cpu_t *cpu, const uint8_t *buf, size_t len) {
+    __atomic_fetch_add(&f->crashes, 1, __ATOMIC_RELAXED);
+    size_t key = (size_t)cpu->status * EC72_MEM_SIZE + cpu->PC;
+    if (__atomic_exchange_n(&f->crash_seen[key], 1, __ATOMIC_RELAXED)) return;
+    __atomic_fetch_add(&f->unique_crashes, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&f->lock);
+    printf("%s%s at PC=0x%02X after %llu instructions%s", RED, ec72_status_str(cpu->status), cpu->PC,
+           (unsigned long long)cpu->retired, RESET);
+    if (f->out_dir) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/crash-%s-pc%02X.in", f->out_dir, ec72_status_str(cpu->status), cpu->PC);
+        for (char *c = path + strlen(f->out_dir); *c; c++) if (*c == ' ') *c = '_';
+        if (save_file(path, buf, len)) printf(" -> %s", path);
+    }
+    putchar('\n');
+    fflush(stdout);
+    pthread_mutex_unlock(&f->lock);
+}
+
+static void *program_worker(void *arg) {
+    Fuzz_t *f = ((void **)arg)[0];
+    uint64_t rng = (uint64_t)(uintptr_t)((void **)arg)[1];
+    const ec72_fuzz_layout_t *l = &f->layout;
+
+    ec72_cpu_t *cpu = ec72_cpu_create();
+    ec72_cov_t *cov = malloc(sizeof(ec72_cov_t));
+    uint8_t *buf = malloc(l->max_len), *parent = malloc(l->max_len), *other = malloc(l->max_len);
+    ec72_bus_t bus;
+    bool have_bus = l->io && ec72_bus_init(&bus, f->bus_base);
+    if (!cpu || !cov || !buf || !parent || !other || (l->io && !have_bus)) {
+        fprintf(stderr, "%sOut of memory for a fuzzer thread%s\n", RED, RESET);
+        stop_requested = 1;
+    } else {
+        ec72_cpu_load_image(cpu, &f->image);
+        ec72_cov_init(cov);
+        ec72_cpu_set_cov(cpu, cov);
+        if (have_bus) ec72_cpu_attach_bus(cpu, &bus);
+    }
+
+    size_t parent_len = 0, other_len = 0;
+    uint64_t local = 0;
+    for (unsigned runs = 0; !stopping(f); runs++) {
+        if (runs % PARENT_RUNS == 0) {
+            pick(f, parent, &parent_len, &rng);
+            pick(f, other, &other_len, &rng);
+        }
+        memcpy(buf, parent, parent_len);
+        size_t len = ec72_fuzz_mutate(l, buf, parent_len, other, other_len, &rng);
+
+        ec72_cpu_reset(cpu);
+        ec72_fuzz_apply(l, cpu, have_bus ? &bus : NULL, buf, len);
+        ec72_status_t s = ec72_cpu_run(cpu, f->budget);
+
+        if (s > EC72_HALTED) {
+            ec72_cov_discard(cov);
+            report_crash(f, cpu, buf, len);
+        } else {
+            if (s == EC72_OK) __atomic_fetch_add(&f->hangs, 1, __ATOMIC_RELAXED);
+            if (ec72_cov_merge(cov, &f->map)) {
+                pthread_mutex_lock(&f->lock);
+                corpus_add(f, buf, len);
+                pthread_mutex_unlock(&f->lock);
+            }
+        }
+        // Batched so that the threads do not fight over one counter
+        if (++local == 64) {
+            __atomic_fetch_add(&f->execs, local, __ATOMIC_RELAXED);
+            local = 0;
+        }
+    }
+    __atomic_fetch_add(&f->execs, local, __ATOMIC_RELAXED);
+
+    if (have_bus) ec72_bus_free(&bus);
+    free(buf);
+    free(parent);
+    free(other);
+    free(cov);
+    if (cpu) ec72_cpu_destroy(cpu);
+    return NULL;
+}
+
+static void report_difference(Fuzz_t *f, const ec72_fuzz_program_t *p, ec72_engine_t engine, const char *why) {
+    pthread_mutex_lock(&f->lock);
+    uint64_t n = f->differences++;
+    printf("%s%s differs from switch: %s%s", RED, ec72_engine_name(engine), why, RESET);
+    if (f->out_dir) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/diff-%s-%llu.ec72img", f->out_dir, ec72_engine_name(engine), (unsigned long long)n);
+        ec72_image_t img;
+        ec72_image_init(&img);
+        memcpy(img.words, p->words, sizeof(p->words));
+        img.word_count = EC72_MEM_SIZE;
+        img.entry = p->entry;
+        img.stofr = p->stofr;
+        img.stufr = p->stufr;
+        if (ec72_image_save(&img, path)) printf(" -> %s", path);
+        ec72_image_free(&img);
+    }
+    putchar('\n');
+    fflush(stdout);
+    pthread_mutex_unlock(&f->lock);
+}
+
+static void *diff_worker(void *arg) {
+    Fuzz_t *f = ((void **)arg)[0];
+    uint64_t rng = (uint64_t)(uintptr_t)((void **)arg)[1];
+
+    ec72_cpu_t *ref = ec72_cpu_create(), *other = ec72_cpu_create();
+    ec72_fuzz_program_t *p = malloc(sizeof(*p));
+    if (!ref || !other || !p) {
+        fprintf(stderr, "%sOut of memory for a fuzzer thread%s\n", RED, RESET);
+        stop_requested = 1;
+    }
+
+    uint64_t local = 0;
+    char why[160];
+    while (!stopping(f)) {
+        ec72_fuzz_random_program(p, &rng);
+        for (int e = 0; e < f->engine_count; e++) {
+            ec72_cpu_set_engine(other, f->engines[e]);
+            if (!ec72_fuzz_compare(ref, other, p, f->budget, &rng, why, sizeof(why))) {
+                report_difference(f, p, f->engines[e], why);
+            }
+        }
+        if (ref->status > EC72_HALTED) __atomic_fetch_add(&f->crashes, 1, __ATOMIC_RELAXED);
+        else if (ref->status == EC72_OK) __atomic_fetch_add(&f->hangs, 1, __ATOMIC_RELAXED);
+        if (++local == 64) {
+            __atomic_fetch_add(&f->execs, local, __ATOMIC_RELAXED);
+            local = 0;
+        }
+    }
+    __atomic_fetch_add(&f->execs, local, __ATOMIC_RELAXED);
+
+    free(p);
+    if (ref) ec72_cpu_destroy(ref);
+    if (other) ec72_cpu_destroy(other);
+    return NULL;
+}
+
+static bool has_suffix(const char *s, const char *suffix) {
+    size_t ls = strlen(s), lx = strlen(suffix);
+    return ls >= lx && strcmp(s + ls - lx, suffix) == 0;
+}
+
+static bool load_program(Fuzz_t *f, const char *path) {
+    ec72_image_init(&f->image);
+    if (has_suffix(path, ".ec72asm")) {
+        ec72_asm_result_t r;
+        if (!ec72_asm_assemble_file(path, 0, &r)) {
+            if (r.diag_count && r.diags[0].error == EC72_ASM_IO) perror("Error opening file");
+            else ec72_asm_print_diags(&r, stderr);
+            ec72_asm_result_free(&r);
+            return false;
+        }
+        f->image.word_count = r.word_count < EC72_MEM_SIZE ? r.word_count : EC72_MEM_SIZE;
+        memcpy(f->image.words, r.words, f->image.word_count * sizeof(uint16_t));
+        ec72_asm_result_free(&r);
+        return true;
+    }
+    if (ec72_image_load(&f->image, path)) return true;
+    if (f->image.error) fprintf(stderr, "%sError loading %s: %s%s\n", RED, path, f->image.error, RESET);
+    else perror("Error opening file");
+    return false;
+}
+
+// First corpus entry: the range as the image has it, then the seed bytes
+static bool seed_corpus(Fuzz_t *f, const char *seed_path) {
+    const ec72_fuzz_layout_t *l = &f->layout;
+    uint8_t *buf = calloc(1, l->max_len);
+    if (!buf) return false;
+    size_t len = (size_t)l->words * 2;
+    for (size_t i = 0; i < l->words; i++) {
+        uint16_t w = f->image.words[(uint8_t)(l->addr + i)];
+        buf[2 * i] = (uint8_t)w;
+        buf[2 * i + 1] = (uint8_t)(w >> 8);
+    }
+    if (seed_path) {
+        FILE *in = fopen(seed_path, "rb");
+        if (!in) {
+            perror("Error opening seed input");
+            free(buf);
+            return false;
+        }
+        len += fread(buf + len, 1, l->max_len - len, in);
+        fclose(in);
+    }
+    bool ok = corpus_add(f, buf, len);
+    free(buf);
+    return ok;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void print_status(Fuzz_t *f, double elapsed, uint64_t execs, uint64_t last_execs, double interval) {
+    if (f->diff) {
+        printf("%s%.0f s: %llu programs (%.0f/s), %llu differences, %llu faulted, %llu ran out of budget%s\n",
+               CYAN, elapsed, (unsigned long long)execs, interval > 0 ? (execs - last_execs) / interval : 0.0,
+               (unsigned long long)f->differences, (unsigned long long)f->crashes, (unsigned long long)f->hangs, RESET);
+    } else {
+        printf("%s%.0f s: %llu execs (%.0f/s), corpus %zu, edges %u, crashes %llu (%llu unique), hangs %llu%s\n",
+               CYAN, elapsed, (unsigned long long)execs, interval > 0 ? (execs - last_execs) / interval : 0.0,
+               f->corpus_count, __atomic_load_n(&f->map.edges, __ATOMIC_RELAXED),
+               (unsigned long long)f->crashes, (unsigned long long)f->unique_crashes, (unsigned long long)f->hangs, RESET);
+    }
+    fflush(stdout);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s <program.bin|program.ec72img|program.ec72asm> [-m addr:words] [-io [base]]\n"
+                    "       [-max bytes] [-in seed_input] [-n max_instructions] [-j threads] [-t seconds]\n"
+                    "       [-x execs] [-o dir] [-seed n]\n"
+                    "       %s -diff [-e engine[,engine]] [-n max_instructions] [-j threads] [-t seconds]\n"
+                    "       [-x programs] [-o dir] [-seed n]\n", name, name);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    static Fuzz_t f;
+    pthread_mutex_init(&f.lock, NULL);
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    double seconds = 0;
+    const char *program = NULL, *seed_path = NULL;
+    bool range_given = false, budget_given = false;
+    f.layout.max_len = DEFAULT_MAX_LEN;
+    f.bus_base = EC72_BUS_DEFAULT_BASE;
+    f.seed = 1;
+    f.engines[0] = EC72_ENGINE_THREADED;
+    f.engines[1] = EC72_ENGINE_JIT;
+    f.engines[2] = EC72_ENGINE_LAZY;
+    f.engine_count = 3;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-diff") == 0) {
+            f.diff = true;
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            int addr, words;
+            if (sscanf(argv[++i], "%i:%i", &addr, &words) != 2 || addr < 0 || addr > 0xFF ||
+                words < 1 || words > 0xFF || addr + words > EC72_MEM_SIZE) {
+                fprintf(stderr, "-m wants addr:words inside memory (at most 255 words), e.g. 0xC0:16\n");
+                return 1;
+            }
+            f.layout.addr = (uint8_t)addr;
+            f.layout.words = (uint8_t)words;
+            range_given = true;
+        } else if (strcmp(argv[i], "-io") == 0) {
+            f.layout.io = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') f.bus_base = (uint8_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-max") == 0 && i + 1 < argc) {
+            f.layout.max_len = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-in") == 0 && i + 1 < argc) {
+            seed_path = argv[++i];
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            f.engine_count = 0;
+            char *names = argv[++i];
+            for (char *name = strtok(names, ","); name; name = strtok(NULL, ",")) {
+                ec72_engine_t e;
+                if (!ec72_engine_from_name(name, &e) || e == EC72_ENGINE_SWITCH || f.engine_count == MAX_ENGINES) {
+                    fprintf(stderr, "-e wants threaded, jit and/or lazy, got %s\n", name);
+                    return 1;
+                }
+                f.engines[f.engine_count++] = e;
+            }
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            f.budget = strtoull(argv[++i], NULL, 10);
+            budget_given = true;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            seconds = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) {
+            f.max_execs = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            f.out_dir = argv[++i];
+        } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+            f.seed = strtoull(argv[++i], NULL, 0);
+        } else if (argv[i][0] != '-' && !program) {
+            program = argv[i];
+        } else {
+            fprintf(stderr, "Unknown flag: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+    if (f.out_dir && mkdir(f.out_dir, 0777) != 0 && errno != EEXIST) {
+        perror("Error creating the output directory");
+        return 1;
+    }
+    if (!budget_given) f.budget = f.diff ? DEFAULT_DIFF_BUDGET : DEFAULT_BUDGET;
+    if (f.seed == 0) f.seed = 1;
+
+    if (!f.diff) {
+        if (!program) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (!range_given && !f.layout.io) {
+            fprintf(stderr, "%sNothing to fuzz: give a memory range (-m) and/or bus input (-io)%s\n", RED, RESET);
+            return 1;
+        }
+        if (!load_program(&f, program)) return 1;
+        if (f.layout.max_len < (size_t)f.layout.words * 2) f.layout.max_len = (size_t)f.layout.words * 2;
+        if (!f.layout.io) f.layout.max_len = (size_t)f.layout.words * 2;
+        if (!seed_corpus(&f, seed_path)) return 1;
+    }
+
+    signal(SIGINT, on_interrupt);
+    void *(*worker)(void *) = f.diff ? diff_worker : program_worker;
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    void **args = malloc(threads * 2 * sizeof(void *));
+    if (!tids || !args) {
+        fprintf(stderr, "%sOut of memory%s\n", RED, RESET);
+        return 1;
+    }
+    double start = now_seconds();
+    for (long t = 0; t < threads; t++) {
+        // Distinct, never zero random states per thread
+        args[2 * t] = &f;
+        args[2 * t + 1] = (void *)(uintptr_t)((f.seed + (uint64_t)t) * 0x9E3779B97F4A7C15ULL | 1);
+        pthread_create(&tids[t], NULL, worker, &args[2 * t]);
+    }
+
+    double last = start;
+    uint64_t last_execs = 0;
+    while (!stopping(&f) && (seconds <= 0 || now_seconds() - start < seconds)) {
+        usleep(100000);
+        double now = now_seconds();
+        if (now - last >= 1.0) {
+            uint64_t execs = __atomic_load_n(&f.execs, __ATOMIC_RELAXED);
+            pthread_mutex_lock(&f.lock);
+            print_status(&f, now - start, execs, last_execs, now - last);
+            pthread_mutex_unlock(&f.lock);
+            last = now;
+            last_execs = execs;
+        }
+    }
+    stop_requested = 1;
+    for (long t = 0; t < threads; t++) pthread_join(tids[t], NULL);
+    double elapsed = now_seconds() - start;
+
+    printf("%sDone after %.1f s on %ld threads:%s ", GREEN, elapsed, threads, RESET);
+    print_status(&f, elapsed, f.execs, 0, elapsed);
+
+    for (size_t i = 0; i < f.corpus_count; i++) free(f.corpus[i].data);
+    free(f.corpus);
+    free(tids);
+    free(args);
+    if (!f.diff) ec72_image_free(&f.image);
+    return f.diff ? (f.differences != 0) : 0;
+}
@@ -0,0 +1,166 @@
+//Copyright © Martin H. Sharp; August 2025
+// EC72TRACE: prints a binary trace written by `EC72CPU -t` in the text
+// format of `EC72CPU -d`.
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_cpu.h"
+#include "ec72_trace.h"
+
+// ANSI escape codes for colors
+    #define RED     "\x1b[31m"
+    #define GREEN   "\x1b[32m"
+    #define YELLOW  "\x1b[33m"
+    #define BLUE    "\x1b[34m"
+    #define MAGENTA "\x1b[35m"
+    #define CYAN    "\x1b[36m"
+    #define RESET   "\x1b[0m"
+
+#define READ_CHUNK 4096
+
+// Same lines, same quirks: PC is printed as the incremented 8-bit PC minus
+// one (FFFFFFFF after a fetch from 0xFF) and POP SP shows the popped SP - 1
+static void print_record(const ec72_trace_rec_t *r) {
+    uint8_t opcode = EC72_OPCODE(r->ir);
+    uint8_t operand = EC72_OPERAND(r->ir);
+    int pc = (uint8_t)(r->pc + 1) - 1;
+
+    printf("%sPC=%02X IR=%04X STOFR=%d STUFR=%d %sOPCODE=%02X OPERAND=%02X %sRA=%d RB=%d RC=%d RE=%d %sZF=%d NF=%d OF=%d %sSP= %d%s\n",
+       MAGENTA, pc, r->ir, r->stofr, r->stufr, GREEN, opcode, operand, CYAN,
+       r->ra, r->rb, r->rc, r->re, YELLOW,
+       (r->flags & EC72_TRACE_ZF) != 0, (r->flags & EC72_TRACE_NF) != 0, (r->flags & EC72_TRACE_OF) != 0,
+       BLUE, r->sp, RESET);
+
+    if (r->status == EC72_OK) {
+        uint8_t v = (uint8_t)r->mem_value;
+        switch (opcode) {
+            case OP_CALL:
+                printf("  [CALL] push return=0x%02X at mem[%s%u%s]\n", v, BLUE, r->mem_addr, RESET);
+                break;
+            case OP_RET:
+                printf("  [RET] popped return=0x%02X from mem[%s%u%s]\n", v, BLUE, r->mem_addr, RESET);
+                break;
+            case OP_PUSH:
+                printf("  [PUSH] push 0x%02X into mem[%s%u%s]\n", v, BLUE, r->mem_addr, RESET);
+                break;
+            case OP_POP:
+                printf("  [POP] pop 0x%02X from mem[%s%u%s]\n", v, BLUE,
+                       operand == REG_SP ? (unsigned)(v - 1) : r->mem_addr, RESET);
+                break;
+            case OP_OUT:
+                printf("%sOUT: %d%s\n", GREEN, r->ra, RESET);
+                break;
+            case OP_BCOPY:
+                printf("  [BCOPY] %u words from mem[%s%u%s] to mem[%s%u%s]\n", r->re, BLUE, r->rc, RESET, BLUE, r->rb, RESET);
+                break;
+            case OP_BFILL:
+                printf("  [BFILL] %u words of 0x%02X into mem[%s%u%s]\n", r->re, r->ra, BLUE, r->rb, RESET);
+                break;
+        }
+    } else {
+        ec72_cpu_t cpu;
+        cpu.status = (ec72_status_t)r->status;
+        cpu.IR = r->ir;
+        ec72_cpu_print_status(&cpu, stdout);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <trace file> [-pc lo-hi] [-op opcode,...] [-n last_records]\n", argv[0]);
+        return 1;
+    }
+
+    // Reuses the recording filter to select records
+    ec72_trace_t filter;
+    memset(&filter, 0, sizeof(filter));
+    filter.pc_hi = 0xFF;
+    memset(filter.opcodes, 0xFF, sizeof(filter.opcodes));
+    uint64_t last = 0;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-pc") == 0 && i + 1 < argc) {
+            if (!ec72_trace_parse_pc_range(&filter, argv[++i])) {
+                fprintf(stderr, "Invalid PC range: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-op") == 0 && i + 1 < argc) {
+            if (!ec72_trace_parse_opcodes(&filter, argv[++i])) {
+                fprintf(stderr, "Invalid opcode list: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            last = strtoull(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "Unknown flag: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) {
+        perror("Error opening file");
+        return 1;
+    }
+
+    ec72_trace_header_t hdr;
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 || memcmp(hdr.magic, EC72_TRACE_MAGIC, sizeof(EC72_TRACE_MAGIC)) != 0) {
+        fprintf(stderr, "%sNot an EC72 trace file: %s%s\n", RED, argv[1], RESET);
+        fclose(f);
+        return 1;
+    }
+    if (hdr.version != EC72_TRACE_VERSION || hdr.rec_size != sizeof(ec72_trace_rec_t) || hdr.bom != EC72_TRACE_BOM) {
+        fprintf(stderr, "%sUnsupported trace version or byte order%s\n", RED, RESET);
+        fclose(f);
+        return 1;
+    }
+
+    // Records in file order; a ring starts at its oldest record
+    fseek(f, 0, SEEK_END);
+    uint64_t stored = (uint64_t)(ftell(f) - (long)sizeof(hdr)) / sizeof(ec72_trace_rec_t);
+    uint64_t total, first_slot = 0;
+    if (hdr.capacity == 0) {
+        total = stored;         // a killed stream still has all spilled records
+    } else {
+        if (stored < hdr.capacity) {
+            fprintf(stderr, "%sTruncated trace file%s\n", RED, RESET);
+            fclose(f);
+            return 1;
+        }
+        total = hdr.count < hdr.capacity ? hdr.count : hdr.capacity;
+        if (hdr.count > hdr.capacity) first_slot = hdr.count % hdr.capacity;
+    }
+    uint64_t skip = (last && last < total) ? total - last : 0;
+
+    static char outbuf[1 << 16];
+    setvbuf(stdout, outbuf, _IOFBF, sizeof(outbuf));
+
+    ec72_trace_rec_t *chunk = malloc(READ_CHUNK * sizeof(ec72_trace_rec_t));
+    if (!chunk) {
+        fclose(f);
+        return 1;
+    }
+    uint64_t done = skip;
+    while (done < total) {
+        uint64_t slot = hdr.capacity ? (first_slot + done) % hdr.capacity : done;
+        uint64_t n = total - done;
+        if (n > READ_CHUNK) n = READ_CHUNK;
+        if (hdr.capacity && slot + n > hdr.capacity) n = hdr.capacity - slot;
+
+        fseek(f, (long)(sizeof(hdr) + slot * sizeof(ec72_trace_rec_t)), SEEK_SET);
+        if (fread(chunk, sizeof(ec72_trace_rec_t), n, f) != n) {
+            fprintf(stderr, "%sError reading trace file%s\n", RED, RESET);
+            break;
+        }
+        for (uint64_t i = 0; i < n; i++) {
+            if (ec72_trace_wants(&filter, chunk[i].pc, chunk[i].ir)) print_record(&chunk[i]);
+        }
+        done += n;
+    }
+
+    free(chunk);
+    fclose(f);
+    return done < total ? 1 : 0;
+}
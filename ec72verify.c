@@ -0,0 +1,81 @@
+//Copyright © Martin H. Sharp; August 2025
+// EC72VERIFY: control flow graph, basic blocks and stack depth of a program,
+// and whether EC72CPU -fast can run it without stack checks (ec72_verify.h).
+// Exit status 0 if the program is verified.
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ec72_cpu.h"
+#include "ec72_asm.h"
+#include "ec72_image.h"
+#include "ec72_verify.h"
+
+#define RED     "\x1b[31m"
+#define RESET   "\x1b[0m"
+
+static bool has_suffix(const char *s, const char *suffix) {
+    size_t ls = strlen(s), lx = strlen(suffix);
+    return ls >= lx && strcmp(s + ls - lx, suffix) == 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <program.bin|program.ec72img|program.ec72asm> [-sym symbols.sym] [-q]\n", argv[0]);
+        return 1;
+    }
+    const char *sym_path = NULL;
+    bool quiet = false;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-sym") == 0 && i + 1 < argc) {
+            sym_path = argv[++i];
+        } else if (strcmp(argv[i], "-q") == 0) {
+            quiet = true;
+        } else {
+            fprintf(stderr, "Unknown flag: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    static ec72_cpu_t cpu;
+    ec72_cpu_init(&cpu);
+    ec72_image_t image;
+    ec72_image_init(&image);
+    if (has_suffix(argv[1], ".ec72asm")) {
+        ec72_asm_result_t r;
+        if (!ec72_asm_assemble_file(argv[1], 0, &r)) {
+            if (r.diag_count && r.diags[0].error == EC72_ASM_IO) perror("Error opening file");
+            else ec72_asm_print_diags(&r, stderr);
+            ec72_asm_result_free(&r);
+            return 1;
+        }
+        ec72_cpu_load_words(&cpu, r.words, r.word_count);
+        for (size_t i = 0; i < r.label_count; i++) ec72_symtab_add(&image.symbols, r.labels[i].name, (uint8_t)r.labels[i].address);
+        ec72_symtab_sort(&image.symbols);
+        ec72_asm_result_free(&r);
+    } else if (ec72_image_load(&image, argv[1])) {
+        ec72_cpu_load_image(&cpu, &image);
+    } else {
+        if (image.error) fprintf(stderr, "%sError loading %s: %s%s\n", RED, argv[1], image.error, RESET);
+        else perror("Error opening file");
+        return 1;
+    }
+
+    ec72_symtab_t syms = image.symbols;
+    image.symbols = (ec72_symtab_t){0};
+    ec72_image_free(&image);
+    if (sym_path) {
+        ec72_symtab_free(&syms);
+        if (!ec72_symtab_load(&syms, sym_path)) return 1;
+    }
+
+    static ec72_verify_t v;
+    ec72_verify(&cpu, &v);
+    if (quiet) ec72_verify_print_result(&v, &syms, stdout);
+    else ec72_verify_report(&v, &cpu, &syms, stdout);
+
+    ec72_symtab_free(&syms);
+    ec72_cpu_fini(&cpu);
+    return v.ok ? 0 : 1;
+}
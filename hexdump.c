@@ -1,7 +1,18 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <errno.h>
 #include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "ec72_image.h"
+
+// Files disassembled per round of worker threads; output is written in
+// argument order after each round
+#define DISASM_ROUND 4096
 
 // Detect native endianness at runtime
 bool is_little_endian() {
@@ -14,36 +25,329 @@ uint16_t swap_bytes(uint16_t val) {
     return (val >> 8) | (val << 8);
 }
 
-int main(int argc, char* argv[]) {
-    if (argc < 2 || argc > 3) {
-        fprintf(stderr, "Usage: %s file.bin [-le|-be]\n", argv[0]);
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s file.bin [-le|-be]\n", prog);
+    fprintf(stderr, "       %s -d [-le|-be] [-j threads] [-o dir] file.bin|file.ec72img ...\n", prog);
+}
+
+// ---------------------------------------------------------------------
+// Disassembler (-d): EC72 source that EC72ASM turns back into the same words
+// ---------------------------------------------------------------------
+
+typedef struct {
+    char *text;
+    size_t len, cap;
+    bool oom;
+} Text_t;
+
+static void text_printf(Text_t *t, const char *fmt, ...) {
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        size_t room = t->cap - t->len;
+        int n = vsnprintf(t->text ? t->text + t->len : NULL, room, fmt, ap);
+        va_end(ap);
+        if (n < 0) return;
+        if ((size_t)n < room) {
+            t->len += (size_t)n;
+            return;
+        }
+        size_t cap = t->cap ? t->cap * 2 : 16384;
+        while (cap - t->len <= (size_t)n) cap *= 2;
+        char *grown = realloc(t->text, cap);
+        if (!grown) {
+            t->oom = true;
+            return;
+        }
+        t->text = grown;
+        t->cap = cap;
+    }
+}
+
+typedef struct {
+    const char *path;
+    Text_t out;
+    const char *error;          // image error, NULL: see err
+    int err;                    // errno of a failed load or write
+} Disasm_job_t;
+
+typedef struct {
+    Disasm_job_t *jobs;
+    size_t count, next;
+    bool swap;                  // raw files are in the other byte order
+    const char *out_dir;        // one .ec72asm per input, NULL: stdout
+} Disasm_pool_t;
+
+// Labels must start with a letter to be read back as labels
+static bool usable_name(const char *name) {
+    return name && isalpha((unsigned char)name[0]);
+}
+
+static bool symbol_named(const ec72_symtab_t *tab, const char *name) {
+    for (size_t i = 0; i < tab->count; i++) {
+        if (strcmp(tab->syms[i].name, name) == 0) return true;
+    }
+    return false;
+}
+
+// Operand text for the instruction, false if the mnemonics cannot spell it
+static bool format_operand(uint16_t word, const char *const *label, char *buf, size_t size) {
+    uint8_t op = EC72_OPCODE(word), operand = EC72_OPERAND(word);
+    buf[0] = '\0';
+    switch (ec72_operand_kind(op)) {
+        case EC72_ARG_INVALID:
+            return false;
+        case EC72_ARG_NONE:
+            return operand == 0;
+        case EC72_ARG_OPT_REG:
+            if (operand == 0) return true;
+            // fall through
+        case EC72_ARG_REG:
+            if (!ec72_register_name(operand)) return false;
+            snprintf(buf, size, " %s", ec72_register_name(operand));
+            return true;
+        case EC72_ARG_REG_PAIR: {
+            const char *rd = ec72_register_name(operand >> 4), *rs = ec72_register_name(operand & 0x0F);
+            if (!rd || !rs) return false;   // no-op at run time, kept as a DW
+            snprintf(buf, size, " %s %s", rd, rs);
+            return true;
+        }
+        case EC72_ARG_ADDR:
+        case EC72_ARG_TARGET:
+            if (label[operand]) {
+                snprintf(buf, size, " %s", label[operand]);
+                return true;
+            }
+            // fall through
+        case EC72_ARG_IMM:
+            snprintf(buf, size, " 0x%02X", operand);
+            return true;
+    }
+    return false;
+}
+
+static void disassemble(const ec72_image_t *img, const char *path, Text_t *t) {
+    const ec72_symtab_t *tab = &img->symbols;
+    const char *label[EC72_MEM_SIZE] = {0};         // name operands use for an address
+    char generated[EC72_MEM_SIZE][8];
+    size_t n = img->word_count;
+
+    // Labels from the image first (the first of several at an address, and
+    // only names that read back to the same address); labels past the end
+    // cannot be placed
+    for (size_t i = 0; i < tab->count; i++) {
+        const ec72_sym_t *sym = &tab->syms[i];
+        if (sym->address > n || label[sym->address] || !usable_name(sym->name)) continue;
+        bool first = true;
+        for (size_t j = 0; j < i && first; j++) first = strcmp(tab->syms[j].name, sym->name) != 0;
+        if (first) label[sym->address] = sym->name;
+    }
+    // Then every jump/call target that the code reaches, and the entry point
+    bool target[EC72_MEM_SIZE] = {0};
+    target[img->entry] = img->entry != 0;
+    for (size_t i = 0; i < n; i++) {
+        if ((img->code_map[i] & EC72_IMG_CODE) && ec72_operand_kind(EC72_OPCODE(img->words[i])) == EC72_ARG_TARGET)
+            target[EC72_OPERAND(img->words[i])] = true;
+    }
+    for (size_t i = 0; i <= n && i < EC72_MEM_SIZE; i++) {
+        if (!target[i] || label[i]) continue;
+        snprintf(generated[i], sizeof(generated[i]), "L%02zX", i);
+        if (symbol_named(tab, generated[i])) snprintf(generated[i], sizeof(generated[i]), "L%02zX_", i);
+        label[i] = generated[i];
+    }
+
+    text_printf(t, "; %s: %zu words", path, n);
+    if (!img->raw) {
+        text_printf(t, ", entry 0x%02X, STOFR 0x%02X, STUFR 0x%02X", img->entry, img->stofr, img->stufr);
+    }
+    text_printf(t, "\n");
+
+    size_t s = 0;
+    for (size_t i = 0; i <= n && i < EC72_MEM_SIZE; i++) {
+        // Symbols of this address, in table order, then a recovered label
+        for (; s < tab->count && tab->syms[s].address <= i; s++) {
+            if (tab->syms[s].address < i) continue;
+            if (usable_name(tab->syms[s].name)) text_printf(t, "%s:\n", tab->syms[s].name);
+            else text_printf(t, "; label %s\n", tab->syms[s].name);
+        }
+        if (label[i] == generated[i]) text_printf(t, "%s:\n", label[i]);
+        if (i == n) break;
+
+        uint16_t word = img->words[i];
+        const char *name = ec72_opcode_name(EC72_OPCODE(word));
+        char operand[EC72_SYM_NAME_LEN + 8];
+        char line[EC72_SYM_NAME_LEN + 32];
+        if (name && format_operand(word, label, operand, sizeof(operand))) {
+            snprintf(line, sizeof(line), "        %s%s", name, operand);
+        } else {
+            snprintf(line, sizeof(line), "        DW 0x%04X", word);
+        }
+        text_printf(t, "%-32s; 0x%02zX: 0x%04X%s\n", line, i, word, img->code_map[i] & EC72_IMG_CODE ? "" : " (not reached)");
+    }
+}
+
+static bool write_text(const char *path, const Text_t *t) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(t->text, 1, t->len, f) == t->len;
+    return fclose(f) == 0 && ok;
+}
+
+static void disasm_job(Disasm_pool_t *pool, Disasm_job_t *job) {
+    ec72_image_t img;
+    if (!ec72_image_load(&img, job->path)) {
+        job->error = img.error;
+        job->err = img.error ? 0 : errno;
+        ec72_image_free(&img);
+        return;
+    }
+    if (img.raw && pool->swap) {
+        for (size_t i = 0; i < img.word_count; i++) img.words[i] = swap_bytes(img.words[i]);
+    }
+    if (!img.has_code_map) ec72_image_build_code_map(&img);
+    disassemble(&img, job->path, &job->out);
+    ec72_image_free(&img);
+    if (job->out.oom) {
+        job->error = "out of memory";
+        return;
+    }
+
+    if (pool->out_dir) {
+        const char *base = strrchr(job->path, '/');
+        base = base ? base + 1 : job->path;
+        size_t stem = strcspn(base, ".");
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%.*s.ec72asm", pool->out_dir, (int)stem, base);
+        if (!write_text(path, &job->out)) job->err = errno;
+        free(job->out.text);
+        job->out.text = NULL;
+        job->out.len = 0;
+    }
+}
+
+static void *disasm_worker(void *arg) {
+    Disasm_pool_t *pool = arg;
+    for (;;) {
+        size_t i = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+        if (i >= pool->count) return NULL;
+        disasm_job(pool, &pool->jobs[i]);
+    }
+}
+
+static int disasm_main(char **files, size_t file_count, bool swap, long threads, const char *out_dir) {
+    if (threads <= 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads <= 0) threads = 1;
+    Disasm_job_t *jobs = calloc(DISASM_ROUND, sizeof(Disasm_job_t));
+    pthread_t *tids = malloc((size_t)threads * sizeof(pthread_t));
+    if (!jobs || !tids) {
+        fprintf(stderr, "Out of memory\n");
         return 1;
     }
+    static char outbuf[1 << 16];
+    setvbuf(stdout, outbuf, _IOFBF, sizeof(outbuf));
 
+    int failed = 0;
+    bool printed = false;
+    for (size_t first = 0; first < file_count; first += DISASM_ROUND) {
+        Disasm_pool_t pool = { .jobs = jobs, .swap = swap, .out_dir = out_dir };
+        pool.count = file_count - first < DISASM_ROUND ? file_count - first : DISASM_ROUND;
+        memset(jobs, 0, pool.count * sizeof(Disasm_job_t));
+        for (size_t i = 0; i < pool.count; i++) jobs[i].path = files[first + i];
+
+        long started = (size_t)threads < pool.count ? threads : (long)pool.count;
+        for (long t = 1; t < started; t++) pthread_create(&tids[t], NULL, disasm_worker, &pool);
+        disasm_worker(&pool);
+        for (long t = 1; t < started; t++) pthread_join(tids[t], NULL);
+
+        for (size_t i = 0; i < pool.count; i++) {
+            Disasm_job_t *job = &jobs[i];
+            if (job->error) {
+                fflush(stdout);
+                fprintf(stderr, "Invalid image %s: %s\n", job->path, job->error);
+                failed = 1;
+            } else if (job->err) {
+                fflush(stdout);
+                fprintf(stderr, "%s: %s\n", job->path, strerror(job->err));
+                failed = 1;
+            } else if (job->out.len) {
+                if (printed) fputc('\n', stdout);
+                fwrite(job->out.text, 1, job->out.len, stdout);
+                printed = true;
+            }
+            free(job->out.text);
+        }
+    }
+    fflush(stdout);
+    free(jobs);
+    free(tids);
+    return failed;
+}
+
+int main(int argc, char* argv[]) {
     bool native_is_le = is_little_endian();
     bool use_little_endian = native_is_le; // default native
-    const char* endian_str;
+    const char* endian_str = native_is_le ? "Little Endian (native detected)" : "Big Endian (native detected)";
+    bool disasm = false;
+    long threads = 0;
+    const char *out_dir = NULL;
+    char **files = malloc((size_t)argc * sizeof(char *));
+    size_t file_count = 0;
+    if (!files) return 1;
 
-    if (argc == 3) {
-        if (strcmp(argv[2], "-le") == 0) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-le") == 0) {
             use_little_endian = true;
             endian_str = "Little Endian (forced)";
-        } else if (strcmp(argv[2], "-be") == 0) {
+        } else if (strcmp(argv[i], "-be") == 0) {
             use_little_endian = false;
             endian_str = "Big Endian (forced)";
-        } else {
-            fprintf(stderr, "Unknown flag: %s\n", argv[2]);
-            fprintf(stderr, "Usage: %s file.bin [-le|-be]\n", argv[0]);
+        } else if (strcmp(argv[i], "-d") == 0) {
+            disasm = true;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Unknown flag: %s\n", argv[i]);
+            usage(argv[0]);
             return 1;
+        } else {
+            files[file_count++] = argv[i];
         }
-    } else {
-        endian_str = native_is_le ? "Little Endian (native detected)" : "Big Endian (native detected)";
     }
+    if (file_count == 0 || (!disasm && (file_count > 1 || threads || out_dir))) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (disasm) {
+        int rc = disasm_main(files, file_count, use_little_endian != native_is_le, threads, out_dir);
+        free(files);
+        return rc;
+    }
+    const char *file = files[0];
+    free(files);
+
+    // Image files say which byte order they use, so there is nothing to guess
+    ec72_image_t img;
+    if (!ec72_image_load(&img, file)) {
+        if (img.error) fprintf(stderr, "Invalid image %s: %s\n", file, img.error);
+        else perror("Failed to open file");
+        return 1;
+    }
+    if (!img.raw) {
+        printf("EC72 image v%d, %s, entry 0x%02X, STOFR 0x%02X, STUFR 0x%02X, %zu symbols%s\n\n",
+               EC72_IMG_VERSION, img.big_endian ? "Big Endian" : "Little Endian", img.entry, img.stofr,
+               img.stufr, img.symbols.count, img.has_code_map ? ", code map" : "");
+        for (size_t i = 0; i < img.word_count; i++) printf("0x%04zX: 0x%04X\n", i, img.words[i]);
+        ec72_image_free(&img);
+        return 0;
+    }
+    ec72_image_free(&img);
 
     printf("Native CPU endianness detected: %s\n", native_is_le ? "Little Endian" : "Big Endian");
     printf("Using dump mode: %s\n\n", endian_str);
 
-    FILE* f = fopen(argv[1], "rb");
+    FILE* f = fopen(file, "rb");
     if (!f) {
         perror("Failed to open file");
         return 1;